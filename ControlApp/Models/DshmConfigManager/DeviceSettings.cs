@@ -297,6 +297,8 @@ public class OutputReportSettings : DeviceSubSettings
     public bool IsOutputReportRateControlEnabled { get; set; } = true;
     public int MaxOutputRate { get; set; } = 150;
     public bool IsOutputReportDeduplicatorEnabled { get; set; }
+    public int FFBCoalescingWindow { get; set; } = 5;
+    public bool IsFFBRecordingEnabled { get; set; }
 
     public override void ResetToDefault()
     {
@@ -308,6 +310,8 @@ public class OutputReportSettings : DeviceSubSettings
         destiny.IsOutputReportDeduplicatorEnabled = source.IsOutputReportDeduplicatorEnabled;
         destiny.IsOutputReportRateControlEnabled = source.IsOutputReportRateControlEnabled;
         destiny.MaxOutputRate = source.MaxOutputRate;
+        destiny.FFBCoalescingWindow = source.FFBCoalescingWindow;
+        destiny.IsFFBRecordingEnabled = source.IsFFBRecordingEnabled;
     }
 }
 
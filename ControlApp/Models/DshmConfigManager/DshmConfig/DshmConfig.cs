@@ -20,6 +20,8 @@ public class DshmDeviceSettings
     public bool? DisableWirelessIdleTimeout { get; set; } // = false;
     public bool? IsOutputRateControlEnabled { get; set; } // = true;
     public byte? OutputRateControlPeriodMs { get; set; } // = 150;
+    public byte? FFBCoalescingWindowMs { get; set; } // = 5;
+    public bool? IsFFBRecordingEnabled { get; set; } // = false;
     public bool? IsOutputDeduplicatorEnabled { get; set; } // = false;
     public double? WirelessIdleTimeoutPeriodMs { get; set; } // = 300000;
     public bool? IsQuickDisconnectComboEnabled { get; set; } = true;
@@ -231,6 +231,8 @@ public class DshmManagerToDriverConversion
         driverFormat.IsOutputRateControlEnabled = x_OutRep.IsOutputReportRateControlEnabled;
         driverFormat.OutputRateControlPeriodMs = (byte)x_OutRep.MaxOutputRate;
         driverFormat.IsOutputDeduplicatorEnabled = x_OutRep.IsOutputReportDeduplicatorEnabled;
+        driverFormat.FFBCoalescingWindowMs = (byte)x_OutRep.FFBCoalescingWindow;
+        driverFormat.IsFFBRecordingEnabled = x_OutRep.IsFFBRecordingEnabled;
 
         ////////////////////////////////////////////////////////////////////////////////
         ///  Left Motor Rescaling
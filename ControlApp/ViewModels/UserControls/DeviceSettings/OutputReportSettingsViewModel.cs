@@ -39,6 +39,26 @@ public class OutputReportSettingsViewModel : DeviceSettingsViewModel
         }
     }
 
+    public int FFBCoalescingWindow
+    {
+        get => _tempBackingData.FFBCoalescingWindow;
+        set
+        {
+            _tempBackingData.FFBCoalescingWindow = value;
+            OnPropertyChanged();
+        }
+    }
+
+    public bool IsFFBRecordingEnabled
+    {
+        get => _tempBackingData.IsFFBRecordingEnabled;
+        set
+        {
+            _tempBackingData.IsFFBRecordingEnabled = value;
+            OnPropertyChanged();
+        }
+    }
+
     //public override void SaveSettingsToBackingDataContainer(BackingDataContainer dataContainerSource)
     //{
     //    BackingData_OutRepControl.CopySettings(dataContainerSource.OutputReport, _tempBackingData);
@@ -0,0 +1,288 @@
+﻿using System.Diagnostics.CodeAnalysis;
+using System.Net.NetworkInformation;
+using System.Runtime.CompilerServices;
+using System.Runtime.InteropServices;
+
+using Nefarius.DsHidMini.IPC.Exceptions;
+using Nefarius.DsHidMini.IPC.Models;
+using Nefarius.DsHidMini.IPC.Models.Public;
+
+namespace Nefarius.DsHidMini.IPC;
+
+public partial class DsHidMiniInterop
+{
+    /// <summary>
+    ///     Sets up command <paramref name="index" /> of a batch in a zeroed message buffer.
+    /// </summary>
+    private delegate void BatchCommandBuilder<TRequest>(ref TRequest request, int index) where TRequest : unmanaged;
+
+    /// <summary>
+    ///     Takes the reply to command <paramref name="index" /> of a batch, or just the dispatch status if
+    ///     <paramref name="isDispatched" /> is FALSE. Returns FALSE if the reply is implausible.
+    /// </summary>
+    private delegate bool BatchReplyReader<TReply>(ref TReply reply, bool isDispatched, UInt32 dispatchStatus, int index)
+        where TReply : unmanaged;
+
+    /// <summary>
+    ///     Writes a new host address to several devices, as many per round trip as the driver takes.
+    /// </summary>
+    /// <remarks>
+    ///     This is synonymous with "pairing" to a new Bluetooth host. A device the driver couldn't dispatch the command to
+    ///     (e.g. not connected) gets the reason as both statuses of its result. Drivers predating batched commands get one
+    ///     command per device.
+    /// </remarks>
+    /// <param name="deviceIndexes">The one-based device indexes.</param>
+    /// <param name="hostAddress">The new host address.</param>
+    /// <returns>A <see cref="SetHostResult" /> per entry of <paramref name="deviceIndexes" />.</returns>
+    /// <exception cref="DsHidMiniInteropUnavailableException">
+    ///     Driver IPC unavailable, make sure that at least one compatible
+    ///     controller is connected and operational.
+    /// </exception>
+    /// <exception cref="DsHidMiniInteropInvalidDeviceIndexException">
+    ///     A device index was outside a valid range.
+    /// </exception>
+    /// <exception cref="DsHidMiniInteropConcurrencyException">A different thread is currently performing a data exchange.</exception>
+    /// <exception cref="DsHidMiniInteropReplyTimeoutException">The driver didn't respond within an expected period.</exception>
+    /// <exception cref="DsHidMiniInteropUnexpectedReplyException">The driver returned unexpected or malformed data.</exception>
+    [SuppressMessage("ReSharper", "UnusedMember.Global")]
+    public unsafe SetHostResult[] SetHostAddress(IReadOnlyList<int> deviceIndexes, PhysicalAddress hostAddress)
+    {
+        if (_cmdView is null)
+        {
+            throw new DsHidMiniInteropUnavailableException();
+        }
+
+        foreach (int deviceIndex in deviceIndexes)
+        {
+            ValidateDeviceIndex(deviceIndex);
+        }
+
+        SetHostResult[] results = new SetHostResult[deviceIndexes.Count];
+
+        if (!HasCommandBatches)
+        {
+            for (int index = 0; index < results.Length; index++)
+            {
+                results[index] = SetHostAddress(deviceIndexes[index], hostAddress);
+            }
+
+            return results;
+        }
+
+        byte[] address = hostAddress.GetAddressBytes();
+
+        ExchangeBatch(
+            results.Length,
+            (ref DSHM_IPC_MSG_PAIR_TO_REQUEST request, int index) =>
+            {
+                request.Header.Type = DSHM_IPC_MSG_TYPE.DSHM_IPC_MSG_TYPE_REQUEST_RESPONSE;
+                request.Header.Target = DSHM_IPC_MSG_TARGET.DSHM_IPC_MSG_TARGET_DEVICE;
+                request.Header.Command.Device = DSHM_IPC_MSG_CMD_DEVICE.DSHM_IPC_MSG_CMD_DEVICE_PAIR_TO;
+                request.Header.TargetIndex = (uint)deviceIndexes[index];
+                request.Header.Size = (uint)Marshal.SizeOf<DSHM_IPC_MSG_PAIR_TO_REQUEST>();
+
+                // a zeroed buffer covers an empty address
+                for (int offset = 0; offset < address.Length && offset < 6; offset++)
+                {
+                    request.Address[offset] = address[offset];
+                }
+            },
+            (ref DSHM_IPC_MSG_PAIR_TO_REPLY reply, bool isDispatched, UInt32 dispatchStatus, int index) =>
+            {
+                if (!isDispatched)
+                {
+                    results[index] = new SetHostResult { WriteStatus = dispatchStatus, ReadStatus = dispatchStatus };
+                    return true;
+                }
+
+                results[index] = new SetHostResult { WriteStatus = reply.WriteStatus, ReadStatus = reply.ReadStatus };
+
+                return reply.Header is
+                       {
+                           Type: DSHM_IPC_MSG_TYPE.DSHM_IPC_MSG_TYPE_REQUEST_REPLY,
+                           Target: DSHM_IPC_MSG_TARGET.DSHM_IPC_MSG_TARGET_CLIENT,
+                           Command.Device: DSHM_IPC_MSG_CMD_DEVICE.DSHM_IPC_MSG_CMD_DEVICE_PAIR_TO
+                       }
+                       && reply.Header.TargetIndex == deviceIndexes[index]
+                       && reply.Header.Size == Marshal.SizeOf<DSHM_IPC_MSG_PAIR_TO_REPLY>();
+            }
+        );
+
+        return results;
+    }
+
+    /// <summary>
+    ///     Overwrites the player slot indicator (player LEDs) of several devices, as many per round trip as the driver
+    ///     takes.
+    /// </summary>
+    /// <remarks>
+    ///     A device the driver couldn't dispatch the command to (e.g. not connected) gets the reason as its status.
+    ///     Drivers predating batched commands get one command per device.
+    /// </remarks>
+    /// <param name="deviceIndexes">The one-based device indexes.</param>
+    /// <param name="playerIndexes">The player index per device to set to. Valid values include 1 to 7.</param>
+    /// <returns>The NTSTATUS per entry of <paramref name="deviceIndexes" />.</returns>
+    /// <exception cref="DsHidMiniInteropUnavailableException">
+    ///     Driver IPC unavailable, make sure that at least one compatible
+    ///     controller is connected and operational.
+    /// </exception>
+    /// <exception cref="ArgumentException">The lists differ in length.</exception>
+    /// <exception cref="ArgumentOutOfRangeException">A player index was out of range.</exception>
+    /// <exception cref="DsHidMiniInteropInvalidDeviceIndexException">
+    ///     A device index was outside a valid range.
+    /// </exception>
+    /// <exception cref="DsHidMiniInteropConcurrencyException">A different thread is currently performing a data exchange.</exception>
+    /// <exception cref="DsHidMiniInteropReplyTimeoutException">The driver didn't respond within an expected period.</exception>
+    /// <exception cref="DsHidMiniInteropUnexpectedReplyException">The driver returned unexpected or malformed data.</exception>
+    [SuppressMessage("ReSharper", "UnusedMember.Global")]
+    public UInt32[] SetPlayerIndex(IReadOnlyList<int> deviceIndexes, IReadOnlyList<byte> playerIndexes)
+    {
+        if (_cmdView is null)
+        {
+            throw new DsHidMiniInteropUnavailableException();
+        }
+
+        if (playerIndexes.Count != deviceIndexes.Count)
+        {
+            throw new ArgumentException("Every device needs a player index.", nameof(playerIndexes));
+        }
+
+        for (int index = 0; index < deviceIndexes.Count; index++)
+        {
+            ValidateDeviceIndex(deviceIndexes[index]);
+
+            if (playerIndexes[index] is < 1 or > 7)
+            {
+                throw new ArgumentOutOfRangeException(nameof(playerIndexes),
+                    "Player index must be between (including) 1 and 7.");
+            }
+        }
+
+        UInt32[] results = new UInt32[deviceIndexes.Count];
+
+        if (!HasCommandBatches)
+        {
+            for (int index = 0; index < results.Length; index++)
+            {
+                results[index] = SetPlayerIndex(deviceIndexes[index], playerIndexes[index]);
+            }
+
+            return results;
+        }
+
+        ExchangeBatch(
+            results.Length,
+            (ref DSHM_IPC_MSG_SET_PLAYER_INDEX_REQUEST request, int index) =>
+            {
+                request.Header.Type = DSHM_IPC_MSG_TYPE.DSHM_IPC_MSG_TYPE_REQUEST_RESPONSE;
+                request.Header.Target = DSHM_IPC_MSG_TARGET.DSHM_IPC_MSG_TARGET_DEVICE;
+                request.Header.Command.Device = DSHM_IPC_MSG_CMD_DEVICE.DSHM_IPC_MSG_CMD_DEVICE_SET_PLAYER_INDEX;
+                request.Header.TargetIndex = (uint)deviceIndexes[index];
+                request.Header.Size = (uint)Marshal.SizeOf<DSHM_IPC_MSG_SET_PLAYER_INDEX_REQUEST>();
+
+                request.PlayerIndex = playerIndexes[index];
+            },
+            (ref DSHM_IPC_MSG_SET_PLAYER_INDEX_REPLY reply, bool isDispatched, UInt32 dispatchStatus, int index) =>
+            {
+                results[index] = isDispatched ? reply.NtStatus : dispatchStatus;
+
+                return !isDispatched
+                       || (reply.Header is
+                           {
+                               Type: DSHM_IPC_MSG_TYPE.DSHM_IPC_MSG_TYPE_REQUEST_REPLY,
+                               Target: DSHM_IPC_MSG_TARGET.DSHM_IPC_MSG_TARGET_CLIENT,
+                               Command.Device: DSHM_IPC_MSG_CMD_DEVICE.DSHM_IPC_MSG_CMD_DEVICE_SET_PLAYER_INDEX
+                           }
+                           && reply.Header.TargetIndex == deviceIndexes[index]
+                           && reply.Header.Size == Marshal.SizeOf<DSHM_IPC_MSG_SET_PLAYER_INDEX_REPLY>());
+            }
+        );
+
+        return results;
+    }
+
+    /// <summary>
+    ///     Sends <paramref name="count" /> commands as batches, as many per command ring slot as fit, so the whole lot
+    ///     costs one driver wake-up per slot instead of one per command.
+    /// </summary>
+    /// <exception cref="DsHidMiniInteropConcurrencyException">All command ring slots are in use.</exception>
+    /// <exception cref="DsHidMiniInteropReplyTimeoutException">The driver didn't respond within an expected period.</exception>
+    /// <exception cref="DsHidMiniInteropUnexpectedReplyException">The driver returned unexpected or malformed data.</exception>
+    private unsafe void ExchangeBatch<TRequest, TReply>(
+        int count,
+        BatchCommandBuilder<TRequest> build,
+        BatchReplyReader<TReply> read
+    )
+        where TRequest : unmanaged
+        where TReply : unmanaged
+    {
+        int messageSize = Math.Max(Math.Max(sizeof(TRequest), sizeof(TReply)), DSHM_IPC_MSG_BATCH_REQUEST.MinMessageSize);
+        int entrySize = (sizeof(DSHM_IPC_MSG_BATCH_ENTRY) + messageSize + 7) / 8 * 8;
+        int perBatch = Math.Min(
+            DSHM_IPC_MSG_BATCH_REQUEST.MaxCount,
+            (IPC_CMD_SLOT.MaxMessageSize - sizeof(DSHM_IPC_MSG_BATCH_REQUEST)) / entrySize
+        );
+
+        for (int first = 0; first < count; first += perBatch)
+        {
+            int batchCount = Math.Min(perBatch, count - first);
+            int size = sizeof(DSHM_IPC_MSG_BATCH_REQUEST) + entrySize * batchCount;
+
+            using CommandLease lease = BeginCommand();
+
+            Unsafe.InitBlockUnaligned(lease.Buffer, 0, (uint)size);
+
+            ref DSHM_IPC_MSG_BATCH_REQUEST batch = ref Unsafe.AsRef<DSHM_IPC_MSG_BATCH_REQUEST>(lease.Buffer);
+
+            batch.Header.Type = DSHM_IPC_MSG_TYPE.DSHM_IPC_MSG_TYPE_REQUEST_RESPONSE;
+            batch.Header.Target = DSHM_IPC_MSG_TARGET.DSHM_IPC_MSG_TARGET_DRIVER;
+            batch.Header.Command.Driver = DSHM_IPC_MSG_CMD_DRIVER.DSHM_IPC_MSG_CMD_DRIVER_BATCH;
+            batch.Header.TargetIndex = 0;
+            batch.Header.Size = (uint)size;
+            batch.Count = (uint)batchCount;
+
+            for (int index = 0; index < batchCount; index++)
+            {
+                byte* entry = lease.Buffer + sizeof(DSHM_IPC_MSG_BATCH_REQUEST) + entrySize * index;
+
+                Unsafe.AsRef<DSHM_IPC_MSG_BATCH_ENTRY>(entry).Size = (uint)entrySize;
+                build(ref Unsafe.AsRef<TRequest>(entry + sizeof(DSHM_IPC_MSG_BATCH_ENTRY)), first + index);
+            }
+
+            if (!lease.SendAndWait())
+            {
+                throw new DsHidMiniInteropReplyTimeoutException();
+            }
+
+            //
+            // Plausibility check
+            // 
+            if (batch.Header is not
+                {
+                    Type: DSHM_IPC_MSG_TYPE.DSHM_IPC_MSG_TYPE_REQUEST_REPLY,
+                    Target: DSHM_IPC_MSG_TARGET.DSHM_IPC_MSG_TARGET_CLIENT,
+                    Command.Driver: DSHM_IPC_MSG_CMD_DRIVER.DSHM_IPC_MSG_CMD_DRIVER_BATCH, TargetIndex: 0
+                }
+                || batch.Header.Size != size
+                || batch.Count != batchCount)
+            {
+                throw new DsHidMiniInteropUnexpectedReplyException(ref batch.Header);
+            }
+
+            for (int index = 0; index < batchCount; index++)
+            {
+                byte* entry = lease.Buffer + sizeof(DSHM_IPC_MSG_BATCH_REQUEST) + entrySize * index;
+                UInt32 status = Unsafe.AsRef<DSHM_IPC_MSG_BATCH_ENTRY>(entry).Status;
+                ref TReply reply = ref Unsafe.AsRef<TReply>(entry + sizeof(DSHM_IPC_MSG_BATCH_ENTRY));
+
+                // NT_SUCCESS
+                if (!read(ref reply, (int)status >= 0, status, first + index))
+                {
+                    throw new DsHidMiniInteropUnexpectedReplyException(
+                        ref Unsafe.AsRef<DSHM_IPC_MSG_HEADER>(entry + sizeof(DSHM_IPC_MSG_BATCH_ENTRY))
+                    );
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,304 @@
+﻿using System.Diagnostics;
+using System.Runtime.CompilerServices;
+
+using Nefarius.DsHidMini.IPC.Exceptions;
+using Nefarius.DsHidMini.IPC.Models;
+
+namespace Nefarius.DsHidMini.IPC;
+
+public partial class DsHidMiniInterop
+{
+    private const string CommandRingEventName = "Global\\DsHidMiniCommandRingEvent";
+    private const string CommandReplyEventPrefix = "Global\\DsHidMiniCommandReplyEvent";
+
+    private readonly EventWaitHandle?[] _commandReplyEvents = new EventWaitHandle?[IPC_CMD_RING_HEADER.MaxSlotCount];
+
+    private EventWaitHandle? _commandRingEvent;
+
+    /// <summary>
+    ///     Gets the command ring header within the command region.
+    /// </summary>
+    private unsafe ref IPC_CMD_RING_HEADER CommandRing => ref Unsafe.As<byte, IPC_CMD_RING_HEADER>(
+        ref Unsafe.Add(ref Unsafe.AsRef<byte>(_cmdView), IPC_CMD_RING_HEADER.RingOffset)
+    );
+
+    /// <summary>
+    ///     Opens the command ring doorbell, drivers without a command ring only offer the legacy buffer.
+    /// </summary>
+    private void OpenCommandRing()
+    {
+        try
+        {
+            _commandRingEvent = EventWaitHandle.OpenExisting(CommandRingEventName);
+        }
+        catch (WaitHandleCannotBeOpenedException)
+        {
+            _commandRingEvent = null;
+        }
+    }
+
+    private void CloseCommandRing()
+    {
+        _commandRingEvent?.Dispose();
+        _commandRingEvent = null;
+
+        for (int index = 0; index < _commandReplyEvents.Length; index++)
+        {
+            Interlocked.Exchange(ref _commandReplyEvents[index], null)?.Dispose();
+        }
+    }
+
+    private bool HasCommandRing
+    {
+        get
+        {
+            if (_commandRingEvent is null || _cmdView is null)
+            {
+                return false;
+            }
+
+            ref IPC_CMD_RING_HEADER ring = ref CommandRing;
+
+            return Volatile.Read(ref ring.Magic) == IPC_CMD_RING_HEADER.ExpectedMagic
+                   && ring.SlotCount <= IPC_CMD_RING_HEADER.MaxSlotCount
+                   && ring.QueueCapacity == IPC_CMD_RING_HEADER.MaxQueueCapacity;
+        }
+    }
+
+    /// <summary>
+    ///     Gets whether the driver takes several commands in one round trip.
+    /// </summary>
+    private bool HasCommandBatches => HasCommandRing && CommandRing.Version >= IPC_CMD_RING_HEADER.BatchMinVersion;
+
+    private unsafe ref IPC_CMD_SLOT GetCommandSlot(int slotIndex)
+    {
+        ref IPC_CMD_RING_HEADER ring = ref CommandRing;
+
+        return ref Unsafe.As<IPC_CMD_RING_HEADER, IPC_CMD_SLOT>(ref Unsafe.AddByteOffset(
+            ref ring,
+            (nint)(ring.SlotsOffset + ring.SlotSize * (uint)slotIndex)
+        ));
+    }
+
+    private EventWaitHandle GetCommandReplyEvent(int slotIndex)
+    {
+        EventWaitHandle? replyEvent = Volatile.Read(ref _commandReplyEvents[slotIndex]);
+
+        if (replyEvent is not null)
+        {
+            return replyEvent;
+        }
+
+        replyEvent = EventWaitHandle.OpenExisting(CommandReplyEventPrefix + slotIndex);
+
+        EventWaitHandle? existing = Interlocked.CompareExchange(ref _commandReplyEvents[slotIndex], replyEvent, null);
+
+        if (existing is null)
+        {
+            return replyEvent;
+        }
+
+        replyEvent.Dispose();
+        return existing;
+    }
+
+    /// <summary>
+    ///     Gets a buffer to exchange a command message through. Prefers a command ring slot, so concurrent callers
+    ///     don't block each other, and falls back to the legacy buffer guarded by the command mutex.
+    /// </summary>
+    /// <exception cref="DsHidMiniInteropUnavailableException">
+    ///     Driver IPC unavailable, make sure that at least one compatible
+    ///     controller is connected and operational.
+    /// </exception>
+    /// <exception cref="DsHidMiniInteropConcurrencyException">
+    ///     All command ring slots are in use or, with an older driver, a
+    ///     different thread is currently performing a data exchange.
+    /// </exception>
+    private unsafe CommandLease BeginCommand()
+    {
+        if (_cmdView is null)
+        {
+            throw new DsHidMiniInteropUnavailableException();
+        }
+
+        if (!HasCommandRing)
+        {
+            AcquireCommandLock();
+
+            return new CommandLease(this, -1, (byte*)_cmdView.Value.Value);
+        }
+
+        ref IPC_CMD_RING_HEADER ring = ref CommandRing;
+        int processId = Environment.ProcessId;
+
+        for (int slotIndex = 0; slotIndex < ring.SlotCount; slotIndex++)
+        {
+            ref IPC_CMD_SLOT slot = ref GetCommandSlot(slotIndex);
+
+            if (Volatile.Read(ref slot.OwnerProcessId) != 0
+                || Interlocked.CompareExchange(ref slot.OwnerProcessId, processId, 0) != 0)
+            {
+                continue;
+            }
+
+            Volatile.Write(ref slot.State, DSHM_IPC_CMD_SLOT_STATE.Idle);
+
+            return new CommandLease(
+                this,
+                slotIndex,
+                (byte*)Unsafe.AsPointer(ref Unsafe.AddByteOffset(ref slot, IPC_CMD_SLOT.MessageOffset))
+            );
+        }
+
+        throw new DsHidMiniInteropConcurrencyException();
+    }
+
+    /// <summary>
+    ///     Queues an owned slot for the driver to pick up.
+    /// </summary>
+    /// <returns>FALSE if the queue is full, which only happens if a slot got queued twice.</returns>
+    private bool SubmitCommandSlot(int slotIndex)
+    {
+        ref IPC_CMD_RING_HEADER ring = ref CommandRing;
+        ref IPC_CMD_SLOT slot = ref GetCommandSlot(slotIndex);
+
+        Volatile.Write(ref slot.State, DSHM_IPC_CMD_SLOT_STATE.Submitted);
+
+        while (true)
+        {
+            int position = Volatile.Read(ref ring.Tail);
+            ref IPC_CMD_QUEUE_CELL cell = ref ring.Queue[position & (IPC_CMD_RING_HEADER.MaxQueueCapacity - 1)];
+            int distance = Volatile.Read(ref cell.Sequence) - position;
+
+            if (distance == 0)
+            {
+                if (Interlocked.CompareExchange(ref ring.Tail, position + 1, position) == position)
+                {
+                    ref long value = ref Unsafe.As<IPC_CMD_QUEUE_CELL, long>(ref cell);
+                    long current = Volatile.Read(ref value);
+
+                    //
+                    // Sequence and slot index get published at once; fails if the driver skipped the cell
+                    // meanwhile (took too long to get here), queue again then
+                    // 
+                    if ((int)current == position
+                        && Interlocked.CompareExchange(ref value, IPC_CMD_QUEUE_CELL.Value(position + 1, slotIndex),
+                            current) == current)
+                    {
+                        break;
+                    }
+                }
+            }
+            else if (distance < 0)
+            {
+                Volatile.Write(ref slot.State, DSHM_IPC_CMD_SLOT_STATE.Idle);
+                return false;
+            }
+        }
+
+        _commandRingEvent!.Set();
+
+        return true;
+    }
+
+    private bool WaitCommandSlot(int slotIndex, TimeSpan timeout)
+    {
+        ref IPC_CMD_SLOT slot = ref GetCommandSlot(slotIndex);
+        EventWaitHandle replyEvent = GetCommandReplyEvent(slotIndex);
+        long deadline = Stopwatch.GetTimestamp() + (long)(timeout.TotalSeconds * Stopwatch.Frequency);
+
+        //
+        // The event may still be set from a previous user of the slot, so the state decides
+        //
+        while (Volatile.Read(ref slot.State) != DSHM_IPC_CMD_SLOT_STATE.Completed)
+        {
+            TimeSpan remaining = Stopwatch.GetElapsedTime(Stopwatch.GetTimestamp(), deadline);
+
+            if (remaining <= TimeSpan.Zero)
+            {
+                return false;
+            }
+
+            replyEvent.WaitOne(remaining);
+        }
+
+        //
+        // Keeps reading the reply from being reordered before the state
+        //
+        Interlocked.MemoryBarrier();
+
+        return true;
+    }
+
+    private void EndCommandSlot(int slotIndex)
+    {
+        ref IPC_CMD_SLOT slot = ref GetCommandSlot(slotIndex);
+
+        //
+        // Still queued or being processed after a timeout, the driver frees abandoned slots once it's done with them
+        //
+        if (Interlocked.CompareExchange(
+                ref slot.State,
+                DSHM_IPC_CMD_SLOT_STATE.Abandoned,
+                DSHM_IPC_CMD_SLOT_STATE.Submitted
+            ) == DSHM_IPC_CMD_SLOT_STATE.Submitted)
+        {
+            return;
+        }
+
+        Volatile.Write(ref slot.OwnerProcessId, 0);
+    }
+
+    /// <summary>
+    ///     Exclusive use of a command message buffer for one request/reply round trip.
+    /// </summary>
+    private readonly unsafe ref struct CommandLease
+    {
+        private readonly DsHidMiniInterop _owner;
+
+        /// <summary>
+        ///     Zero-based command ring slot, -1 for the legacy buffer.
+        /// </summary>
+        private readonly int _slotIndex;
+
+        public CommandLease(DsHidMiniInterop owner, int slotIndex, byte* buffer)
+        {
+            _owner = owner;
+            _slotIndex = slotIndex;
+            Buffer = buffer;
+        }
+
+        /// <summary>
+        ///     Request message goes here, the reply replaces it.
+        /// </summary>
+        public byte* Buffer { get; }
+
+        /// <summary>
+        ///     Hands the request to the driver and awaits the reply.
+        /// </summary>
+        /// <param name="timeoutMs">Timeout to wait for a reply. Defaults to 500 ms.</param>
+        /// <returns>TRUE if we got a reply in time, FALSE otherwise.</returns>
+        public bool SendAndWait(int timeoutMs = 500)
+        {
+            if (_slotIndex < 0)
+            {
+                return _owner.SendAndWait(timeoutMs);
+            }
+
+            return _owner.SubmitCommandSlot(_slotIndex)
+                   && _owner.WaitCommandSlot(_slotIndex, TimeSpan.FromMilliseconds(timeoutMs));
+        }
+
+        public void Dispose()
+        {
+            if (_slotIndex < 0)
+            {
+                _owner._commandMutex?.ReleaseMutex();
+            }
+            else
+            {
+                _owner.EndCommandSlot(_slotIndex);
+            }
+        }
+    }
+}
@@ -12,6 +12,11 @@ namespace Nefarius.DsHidMini.IPC;
 
 public partial class DsHidMiniInterop
 {
+    /// <summary>
+    ///     Torn reads of an input report slot tolerated before giving up.
+    /// </summary>
+    private const int MaxSnapshotAttempts = 1000;
+
     /// <summary>
     ///     Attempts to read the <see cref="DS3_RAW_INPUT_REPORT" /> from a given device instance.
     /// </summary>
@@ -43,7 +48,46 @@ public partial class DsHidMiniInterop
     ///     occupied.
     /// </returns>
     [SuppressMessage("ReSharper", "UnusedMember.Global")]
-    public unsafe bool GetRawInputReport(int deviceIndex, ref DS3_RAW_INPUT_REPORT report, TimeSpan? timeout = null)
+    public bool GetRawInputReport(int deviceIndex, ref DS3_RAW_INPUT_REPORT report, TimeSpan? timeout = null)
+    {
+        return GetRawInputReport(deviceIndex, ref report, out _, timeout);
+    }
+
+    /// <summary>
+    ///     Attempts to read the <see cref="DS3_RAW_INPUT_REPORT" /> from a given device instance along with its sequence
+    ///     number.
+    /// </summary>
+    /// <remarks>
+    ///     The driver bumps the sequence number of a slot with every update, so comparing it to the value of a previous
+    ///     call tells whether anything changed in between. The copy is guaranteed to be consistent; reads racing with an
+    ///     update are retried. Drivers without sequence numbers report 0 and no such guarantee. See
+    ///     <see cref="GetRawInputReport(int, ref DS3_RAW_INPUT_REPORT, TimeSpan?)" /> for the use of
+    ///     <paramref name="timeout" />.
+    /// </remarks>
+    /// <param name="deviceIndex">The one-based device index.</param>
+    /// <param name="report">The <see cref="DS3_RAW_INPUT_REPORT" /> to populate.</param>
+    /// <param name="sequence">Receives the sequence number of the copied report.</param>
+    /// <param name="timeout">Optional timeout to wait for a report update to arrive. Default invocation returns immediately.</param>
+    /// <exception cref="DsHidMiniInteropAccessDeniedException">
+    ///     Driver process interaction failed due to missing permissions;
+    ///     this operation requires elevated privileges.
+    /// </exception>
+    /// <exception cref="DsHidMiniInteropUnexpectedReplyException">The driver returned unexpected or malformed data.</exception>
+    /// <exception cref="Win32Exception">Handle duplication failed.</exception>
+    /// <exception cref="DsHidMiniInteropReplyTimeoutException">The driver didn't respond within an expected period.</exception>
+    /// <exception cref="DsHidMiniInteropConcurrencyException">A different thread is currently performing a data exchange.</exception>
+    /// <exception cref="DsHidMiniInteropUnavailableException">
+    ///     No driver instance is available. Make sure that at least one
+    ///     device is connected and that the driver is installed and working properly. Call <see cref="IsAvailable" /> prior to
+    ///     avoid this exception.
+    /// </exception>
+    /// <returns>
+    ///     TRUE if <paramref name="report" /> got filled in or FALSE if the given <paramref name="deviceIndex" /> is not
+    ///     occupied.
+    /// </returns>
+    [SuppressMessage("ReSharper", "UnusedMember.Global")]
+    public unsafe bool GetRawInputReport(int deviceIndex, ref DS3_RAW_INPUT_REPORT report, out uint sequence,
+        TimeSpan? timeout = null)
     {
         if (_hidView is null)
         {
@@ -52,7 +96,17 @@ public partial class DsHidMiniInterop
 
         ValidateDeviceIndex(deviceIndex);
 
-        ref IPC_HID_INPUT_REPORT_MESSAGE message = ref Unsafe.AsRef<IPC_HID_INPUT_REPORT_MESSAGE>(_hidView);
+        ref byte region = ref Unsafe.AsRef<byte>(_hidView);
+        ref IPC_HID_REGION_HEADER header =
+            ref Unsafe.As<byte, IPC_HID_REGION_HEADER>(ref Unsafe.Add(ref region, IPC_HID_REGION_HEADER.HeaderOffset));
+        bool hasSequence = header.Magic == IPC_HID_REGION_HEADER.ExpectedMagic && deviceIndex <= header.SlotCount;
+
+        int slotOffset = hasSequence
+            ? (int)(header.SlotsOffset + header.SlotStride * (deviceIndex - 1))
+            : sizeof(IPC_HID_INPUT_REPORT_MESSAGE) * (deviceIndex - 1);
+
+        ref IPC_HID_INPUT_REPORT_MESSAGE slot =
+            ref Unsafe.As<byte, IPC_HID_INPUT_REPORT_MESSAGE>(ref Unsafe.Add(ref region, slotOffset));
 
         if (timeout.HasValue)
         {
@@ -61,6 +115,55 @@ public partial class DsHidMiniInterop
             _inputReportEvent.WaitOne(timeout.Value);
         }
 
+        IPC_HID_INPUT_REPORT_MESSAGE message;
+
+        if (hasSequence)
+        {
+            ref int slotSequence =
+                ref Unsafe.As<byte, int>(ref Unsafe.Add(ref region, slotOffset + (int)header.SequenceOffset));
+            SpinWait spinner = default;
+
+            while (true)
+            {
+                int begin = Volatile.Read(ref slotSequence);
+
+                //
+                // Odd while the driver is updating the slot
+                // 
+                if ((begin & 1) == 0)
+                {
+                    message = slot;
+
+                    //
+                    // Keeps the copy from being reordered past the second read
+                    // 
+                    Interlocked.MemoryBarrier();
+
+                    if (Volatile.Read(ref slotSequence) == begin)
+                    {
+                        sequence = (uint)begin;
+                        break;
+                    }
+                }
+
+                //
+                // The driver host went away in the middle of an update
+                // 
+                if (spinner.Count >= MaxSnapshotAttempts)
+                {
+                    sequence = 0;
+                    return false;
+                }
+
+                spinner.SpinOnce(-1);
+            }
+        }
+        else
+        {
+            message = slot;
+            sequence = 0;
+        }
+
         //
         // Device is/got disconnected
         // 
@@ -83,61 +186,324 @@ public partial class DsHidMiniInterop
     }
 
     /// <summary>
-    ///     Send a PING to the driver and awaits the reply.
+    ///     Reads the <see cref="INPUT_STATE" /> of a given device instance.
     /// </summary>
+    /// <remarks>
+    ///     Unlike the <see cref="DS3_RAW_INPUT_REPORT" /> the thumb axes come with the dead zone and axis flip settings
+    ///     of the device applied by the driver, so they match what the HID device reports. The state is updated
+    ///     together with the raw report; combine with <see cref="WaitForInputChanges" /> to wait for updates.
+    /// </remarks>
+    /// <param name="deviceIndex">The one-based device index.</param>
+    /// <param name="state">The <see cref="INPUT_STATE" /> to populate.</param>
+    /// <param name="sequence">
+    ///     Receives the update counter of the device, the same value as for
+    ///     <see cref="GetRawInputReport(int, ref DS3_RAW_INPUT_REPORT, out uint, TimeSpan?)" />.
+    /// </param>
     /// <exception cref="DsHidMiniInteropUnavailableException">
-    ///     Driver IPC unavailable, make sure that at least one compatible
-    ///     controller is connected and operational.
+    ///     No driver instance is available or the driver doesn't publish states.
     /// </exception>
-    /// <exception cref="DsHidMiniInteropReplyTimeoutException">The driver didn't respond within an expected period.</exception>
-    /// <exception cref="DsHidMiniInteropUnexpectedReplyException">The driver returned unexpected or malformed data.</exception>
+    /// <exception cref="DsHidMiniInteropInvalidDeviceIndexException">
+    ///     The <paramref name="deviceIndex" /> was outside a valid
+    ///     range.
+    /// </exception>
+    /// <returns>
+    ///     TRUE if <paramref name="state" /> got filled in or FALSE if the given <paramref name="deviceIndex" /> is not
+    ///     occupied.
+    /// </returns>
     [SuppressMessage("ReSharper", "UnusedMember.Global")]
-    public unsafe void SendPing()
+    public unsafe bool GetInputState(int deviceIndex, ref INPUT_STATE state, out uint sequence)
     {
-        if (_commandMutex is null || _cmdView is null)
+        if (_hidView is null)
         {
             throw new DsHidMiniInteropUnavailableException();
         }
 
-        AcquireCommandLock();
+        ValidateDeviceIndex(deviceIndex);
+
+        ref byte region = ref Unsafe.AsRef<byte>(_hidView);
+        ref IPC_HID_REGION_HEADER header =
+            ref Unsafe.As<byte, IPC_HID_REGION_HEADER>(ref Unsafe.Add(ref region, IPC_HID_REGION_HEADER.HeaderOffset));
 
-        try
+        if (header.Magic != IPC_HID_REGION_HEADER.ExpectedMagic
+            || header.StateOffset == 0)
         {
-            ref DSHM_IPC_MSG_HEADER message = ref Unsafe.AsRef<DSHM_IPC_MSG_HEADER>(_cmdView);
+            throw new DsHidMiniInteropUnavailableException();
+        }
 
-            message.Type = DSHM_IPC_MSG_TYPE.DSHM_IPC_MSG_TYPE_REQUEST_RESPONSE;
-            message.Target = DSHM_IPC_MSG_TARGET.DSHM_IPC_MSG_TARGET_DRIVER;
-            message.Command.Driver = DSHM_IPC_MSG_CMD_DRIVER.DSHM_IPC_MSG_CMD_DRIVER_PING;
-            message.TargetIndex = 0;
-            message.Size = (uint)Marshal.SizeOf<DSHM_IPC_MSG_HEADER>();
+        int slotOffset = (int)(header.SlotsOffset + header.SlotStride * (deviceIndex - 1));
 
-            if (!SendAndWait())
-            {
-                throw new DsHidMiniInteropReplyTimeoutException();
-            }
+        ref IPC_HID_INPUT_REPORT_MESSAGE slot =
+            ref Unsafe.As<byte, IPC_HID_INPUT_REPORT_MESSAGE>(ref Unsafe.Add(ref region, slotOffset));
+        ref INPUT_STATE current = ref Unsafe.As<byte, INPUT_STATE>(ref Unsafe.Add(
+            ref region,
+            (int)(header.StateOffset + header.StateStride * (deviceIndex - 1))
+        ));
+        ref int slotSequence =
+            ref Unsafe.As<byte, int>(ref Unsafe.Add(ref region, slotOffset + (int)header.SequenceOffset));
+        SpinWait spinner = default;
 
-            ref DSHM_IPC_MSG_HEADER reply = ref Unsafe.AsRef<DSHM_IPC_MSG_HEADER>(_cmdView);
+        while (true)
+        {
+            int begin = Volatile.Read(ref slotSequence);
 
             //
-            // Plausibility check
+            // Odd while the driver is updating the slot and its state
             // 
-            if (reply is
+            if ((begin & 1) == 0)
+            {
+                uint slotIndex = slot.SlotIndex;
+                INPUT_STATE copy = current;
+
+                //
+                // Keeps the copies from being reordered past the second read
+                // 
+                Interlocked.MemoryBarrier();
+
+                if (Volatile.Read(ref slotSequence) == begin)
                 {
-                    Type: DSHM_IPC_MSG_TYPE.DSHM_IPC_MSG_TYPE_REQUEST_REPLY,
-                    Target: DSHM_IPC_MSG_TARGET.DSHM_IPC_MSG_TARGET_CLIENT,
-                    Command.Driver: DSHM_IPC_MSG_CMD_DRIVER.DSHM_IPC_MSG_CMD_DRIVER_PING, TargetIndex: 0
+                    sequence = (uint)begin;
+
+                    //
+                    // Device is/got disconnected
+                    // 
+                    if (slotIndex == 0)
+                    {
+                        return false;
+                    }
+
+                    state = copy;
+
+                    return true;
                 }
-                && reply.Size == Marshal.SizeOf<DSHM_IPC_MSG_HEADER>())
+            }
+
+            //
+            // The driver host went away in the middle of an update
+            // 
+            if (spinner.Count >= MaxSnapshotAttempts)
             {
-                return;
+                sequence = 0;
+                return false;
             }
 
-            throw new DsHidMiniInteropUnexpectedReplyException(ref reply);
+            spinner.SpinOnce(-1);
         }
-        finally
+    }
+
+    /// <summary>
+    ///     Gets the input history cursor of a given device instance that <see cref="DrainInputHistory" /> continues
+    ///     from to only receive reports arriving after this call.
+    /// </summary>
+    /// <param name="deviceIndex">The one-based device index.</param>
+    /// <exception cref="DsHidMiniInteropUnavailableException">
+    ///     No driver instance is available or the driver doesn't keep an input history.
+    /// </exception>
+    /// <exception cref="DsHidMiniInteropInvalidDeviceIndexException">
+    ///     The <paramref name="deviceIndex" /> was outside a valid
+    ///     range.
+    /// </exception>
+    /// <returns>The number of reports the driver recorded for this device so far.</returns>
+    [SuppressMessage("ReSharper", "UnusedMember.Global")]
+    public ulong GetInputHistoryPosition(int deviceIndex)
+    {
+        return (ulong)Volatile.Read(ref GetInputHistory(deviceIndex).WriteCursor);
+    }
+
+    /// <summary>
+    ///     Copies the input reports a device delivered since <paramref name="cursor" />, oldest first.
+    /// </summary>
+    /// <remarks>
+    ///     The driver keeps the most recent reports of each device in a ring buffer in shared memory, so unlike
+    ///     <see cref="GetRawInputReport(int, ref DS3_RAW_INPUT_REPORT, TimeSpan?)" /> no intermediate report is missed as
+    ///     long as the caller drains faster than the ring fills up. Draining never waits and never calls into the system.
+    ///     Start with a <paramref name="cursor" /> of 0 to receive the entire history or with
+    ///     <see cref="GetInputHistoryPosition" /> to receive new reports only; the cursor gets advanced past the copied
+    ///     reports. The ring size is configured via the IPCInputHistoryDepth driver parameter (default 64).
+    /// </remarks>
+    /// <param name="deviceIndex">The one-based device index.</param>
+    /// <param name="cursor">Position to continue from, receives the position to continue from next time.</param>
+    /// <param name="entries">Receives the reports.</param>
+    /// <param name="lost">Receives the number of reports overwritten before they could be copied.</param>
+    /// <exception cref="DsHidMiniInteropUnavailableException">
+    ///     No driver instance is available or the driver doesn't keep an input history.
+    /// </exception>
+    /// <exception cref="DsHidMiniInteropInvalidDeviceIndexException">
+    ///     The <paramref name="deviceIndex" /> was outside a valid
+    ///     range.
+    /// </exception>
+    /// <returns>The number of entries copied to <paramref name="entries" />.</returns>
+    [SuppressMessage("ReSharper", "UnusedMember.Global")]
+    public int DrainInputHistory(int deviceIndex, ref ulong cursor, Span<INPUT_HISTORY_ENTRY> entries, out ulong lost)
+    {
+        ref IPC_HID_HISTORY ring = ref GetInputHistory(deviceIndex);
+        ref INPUT_HISTORY_ENTRY first =
+            ref Unsafe.As<IPC_HID_HISTORY, INPUT_HISTORY_ENTRY>(ref Unsafe.Add(ref ring, 1));
+        ulong depth = _historyDepth;
+        ulong written = (ulong)Volatile.Read(ref ring.WriteCursor);
+        ulong next = cursor;
+
+        lost = 0;
+
+        //
+        // Cursor from before the driver host restarted, the ring started over
+        // 
+        if (next > written)
         {
-            _commandMutex.ReleaseMutex();
+            next = 0;
         }
+
+        if (written - next > depth)
+        {
+            lost = written - next - depth;
+            next = written - depth;
+        }
+
+        int count = (int)Math.Min(written - next, (ulong)entries.Length);
+
+        for (int index = 0; index < count; index++)
+        {
+            entries[index] = Unsafe.Add(ref first, (int)((next + (ulong)index) & (depth - 1)));
+        }
+
+        //
+        // Keeps the copies from being reordered past the second read
+        // 
+        Interlocked.MemoryBarrier();
+
+        //
+        // While copying, the driver may have started overwriting entries up to and including (cursor - depth),
+        // those copies can't be trusted
+        // 
+        ulong after = (ulong)Volatile.Read(ref ring.WriteCursor);
+        int torn = 0;
+
+        if (after >= depth && after - depth >= next)
+        {
+            torn = (int)Math.Min(after - depth - next + 1, (ulong)count);
+
+            entries.Slice(torn, count - torn).CopyTo(entries);
+        }
+
+        lost += (ulong)torn;
+        cursor = next + (ulong)count;
+
+        return count - torn;
+    }
+
+    private unsafe ref IPC_HID_HISTORY GetInputHistory(int deviceIndex)
+    {
+        if (_historyView is null || _historyDepth == 0)
+        {
+            throw new DsHidMiniInteropUnavailableException();
+        }
+
+        ValidateDeviceIndex(deviceIndex);
+
+        return ref Unsafe.As<byte, IPC_HID_HISTORY>(ref Unsafe.Add(
+            ref Unsafe.AsRef<byte>(_historyView),
+            (nint)_historyStride * (deviceIndex - 1)
+        ));
+    }
+
+    /// <summary>
+    ///     Reads the output report path counters of a given device instance.
+    /// </summary>
+    /// <remarks>
+    ///     The counters are updated by the driver without synchronization, individual values are consistent but a
+    ///     snapshot may mix values from slightly different points in time.
+    /// </remarks>
+    /// <param name="deviceIndex">The one-based device index.</param>
+    /// <param name="telemetry">The <see cref="OUTPUT_REPORT_TELEMETRY" /> to populate.</param>
+    /// <exception cref="DsHidMiniInteropUnavailableException">
+    ///     No driver instance is available. Make sure that at least one
+    ///     device is connected and that the driver is installed and working properly. Call <see cref="IsAvailable" /> prior to
+    ///     avoid this exception.
+    /// </exception>
+    /// <exception cref="DsHidMiniInteropInvalidDeviceIndexException">
+    ///     The <paramref name="deviceIndex" /> was outside a valid
+    ///     range.
+    /// </exception>
+    /// <returns>
+    ///     TRUE if <paramref name="telemetry" /> got filled in or FALSE if the given <paramref name="deviceIndex" /> is
+    ///     not occupied.
+    /// </returns>
+    [SuppressMessage("ReSharper", "UnusedMember.Global")]
+    public unsafe bool GetOutputReportTelemetry(int deviceIndex, ref OUTPUT_REPORT_TELEMETRY telemetry)
+    {
+        if (_telemetryView is null)
+        {
+            throw new DsHidMiniInteropUnavailableException();
+        }
+
+        ValidateDeviceIndex(deviceIndex);
+
+        ref OUTPUT_REPORT_TELEMETRY entry = ref Unsafe.Add(
+            ref Unsafe.AsRef<OUTPUT_REPORT_TELEMETRY>(_telemetryView),
+            deviceIndex - 1
+        );
+
+        //
+        // Device is/got disconnected
+        // 
+        if (entry.SlotIndex != deviceIndex)
+        {
+            return false;
+        }
+
+        telemetry = entry;
+
+        return true;
+    }
+
+    /// <summary>
+    ///     Send a PING to the driver and awaits the reply.
+    /// </summary>
+    /// <exception cref="DsHidMiniInteropUnavailableException">
+    ///     Driver IPC unavailable, make sure that at least one compatible
+    ///     controller is connected and operational.
+    /// </exception>
+    /// <exception cref="DsHidMiniInteropReplyTimeoutException">The driver didn't respond within an expected period.</exception>
+    /// <exception cref="DsHidMiniInteropUnexpectedReplyException">The driver returned unexpected or malformed data.</exception>
+    [SuppressMessage("ReSharper", "UnusedMember.Global")]
+    public unsafe void SendPing()
+    {
+        if (_cmdView is null)
+        {
+            throw new DsHidMiniInteropUnavailableException();
+        }
+
+        using CommandLease lease = BeginCommand();
+
+        ref DSHM_IPC_MSG_HEADER message = ref Unsafe.AsRef<DSHM_IPC_MSG_HEADER>(lease.Buffer);
+
+        message.Type = DSHM_IPC_MSG_TYPE.DSHM_IPC_MSG_TYPE_REQUEST_RESPONSE;
+        message.Target = DSHM_IPC_MSG_TARGET.DSHM_IPC_MSG_TARGET_DRIVER;
+        message.Command.Driver = DSHM_IPC_MSG_CMD_DRIVER.DSHM_IPC_MSG_CMD_DRIVER_PING;
+        message.TargetIndex = 0;
+        message.Size = (uint)Marshal.SizeOf<DSHM_IPC_MSG_HEADER>();
+
+        if (!lease.SendAndWait())
+        {
+            throw new DsHidMiniInteropReplyTimeoutException();
+        }
+
+        ref DSHM_IPC_MSG_HEADER reply = ref Unsafe.AsRef<DSHM_IPC_MSG_HEADER>(lease.Buffer);
+
+        //
+        // Plausibility check
+        // 
+        if (reply is
+            {
+                Type: DSHM_IPC_MSG_TYPE.DSHM_IPC_MSG_TYPE_REQUEST_REPLY,
+                Target: DSHM_IPC_MSG_TARGET.DSHM_IPC_MSG_TARGET_CLIENT,
+                Command.Driver: DSHM_IPC_MSG_CMD_DRIVER.DSHM_IPC_MSG_CMD_DRIVER_PING, TargetIndex: 0
+            }
+            && reply.Size == Marshal.SizeOf<DSHM_IPC_MSG_HEADER>())
+        {
+            return;
+        }
+
+        throw new DsHidMiniInteropUnexpectedReplyException(ref reply);
     }
 
     /// <summary>
@@ -161,67 +527,60 @@ public partial class DsHidMiniInterop
     [SuppressMessage("ReSharper", "UnusedMember.Global")]
     public unsafe SetHostResult SetHostAddress(int deviceIndex, PhysicalAddress hostAddress)
     {
-        if (_commandMutex is null || _cmdView is null)
+        if (_cmdView is null)
         {
             throw new DsHidMiniInteropUnavailableException();
         }
 
         ValidateDeviceIndex(deviceIndex);
 
-        AcquireCommandLock();
+        using CommandLease lease = BeginCommand();
 
-        try
-        {
-            ref DSHM_IPC_MSG_PAIR_TO_REQUEST request = ref Unsafe.AsRef<DSHM_IPC_MSG_PAIR_TO_REQUEST>(_cmdView);
+        ref DSHM_IPC_MSG_PAIR_TO_REQUEST request = ref Unsafe.AsRef<DSHM_IPC_MSG_PAIR_TO_REQUEST>(lease.Buffer);
 
-            request.Header.Type = DSHM_IPC_MSG_TYPE.DSHM_IPC_MSG_TYPE_REQUEST_RESPONSE;
-            request.Header.Target = DSHM_IPC_MSG_TARGET.DSHM_IPC_MSG_TARGET_DEVICE;
-            request.Header.Command.Device = DSHM_IPC_MSG_CMD_DEVICE.DSHM_IPC_MSG_CMD_DEVICE_PAIR_TO;
-            request.Header.TargetIndex = (uint)deviceIndex;
-            request.Header.Size = (uint)Marshal.SizeOf<DSHM_IPC_MSG_PAIR_TO_REQUEST>();
+        request.Header.Type = DSHM_IPC_MSG_TYPE.DSHM_IPC_MSG_TYPE_REQUEST_RESPONSE;
+        request.Header.Target = DSHM_IPC_MSG_TARGET.DSHM_IPC_MSG_TARGET_DEVICE;
+        request.Header.Command.Device = DSHM_IPC_MSG_CMD_DEVICE.DSHM_IPC_MSG_CMD_DEVICE_PAIR_TO;
+        request.Header.TargetIndex = (uint)deviceIndex;
+        request.Header.Size = (uint)Marshal.SizeOf<DSHM_IPC_MSG_PAIR_TO_REQUEST>();
 
-            fixed (byte* source = hostAddress.GetAddressBytes())
-            fixed (byte* address = request.Address)
+        fixed (byte* source = hostAddress.GetAddressBytes())
+        fixed (byte* address = request.Address)
+        {
+            if (source is not null)
             {
-                if (source is not null)
-                {
-                    Buffer.MemoryCopy(source, address, 6, 6);
-                }
-                else
-                {
-                    // there might be previous values there we need to zero out
-                    Unsafe.InitBlockUnaligned(address, 0, 6);
-                }
+                Buffer.MemoryCopy(source, address, 6, 6);
             }
-
-            if (!SendAndWait())
+            else
             {
-                throw new DsHidMiniInteropReplyTimeoutException();
+                // there might be previous values there we need to zero out
+                Unsafe.InitBlockUnaligned(address, 0, 6);
             }
+        }
 
-            ref DSHM_IPC_MSG_PAIR_TO_REPLY reply = ref Unsafe.AsRef<DSHM_IPC_MSG_PAIR_TO_REPLY>(_cmdView);
+        if (!lease.SendAndWait())
+        {
+            throw new DsHidMiniInteropReplyTimeoutException();
+        }
 
-            //
-            // Plausibility check
-            // 
-            if (reply.Header.Type == DSHM_IPC_MSG_TYPE.DSHM_IPC_MSG_TYPE_REQUEST_REPLY
-                && reply.Header is
-                {
-                    Target: DSHM_IPC_MSG_TARGET.DSHM_IPC_MSG_TARGET_CLIENT,
-                    Command.Device: DSHM_IPC_MSG_CMD_DEVICE.DSHM_IPC_MSG_CMD_DEVICE_PAIR_TO
-                }
-                && reply.Header.TargetIndex == deviceIndex
-                && reply.Header.Size == Marshal.SizeOf<DSHM_IPC_MSG_PAIR_TO_REPLY>())
+        ref DSHM_IPC_MSG_PAIR_TO_REPLY reply = ref Unsafe.AsRef<DSHM_IPC_MSG_PAIR_TO_REPLY>(lease.Buffer);
+
+        //
+        // Plausibility check
+        // 
+        if (reply.Header.Type == DSHM_IPC_MSG_TYPE.DSHM_IPC_MSG_TYPE_REQUEST_REPLY
+            && reply.Header is
             {
-                return new SetHostResult { WriteStatus = reply.WriteStatus, ReadStatus = reply.ReadStatus };
+                Target: DSHM_IPC_MSG_TARGET.DSHM_IPC_MSG_TARGET_CLIENT,
+                Command.Device: DSHM_IPC_MSG_CMD_DEVICE.DSHM_IPC_MSG_CMD_DEVICE_PAIR_TO
             }
-
-            throw new DsHidMiniInteropUnexpectedReplyException(ref reply.Header);
-        }
-        finally
+            && reply.Header.TargetIndex == deviceIndex
+            && reply.Header.Size == Marshal.SizeOf<DSHM_IPC_MSG_PAIR_TO_REPLY>())
         {
-            _commandMutex.ReleaseMutex();
+            return new SetHostResult { WriteStatus = reply.WriteStatus, ReadStatus = reply.ReadStatus };
         }
+
+        throw new DsHidMiniInteropUnexpectedReplyException(ref reply.Header);
     }
 
     /// <summary>
@@ -244,7 +603,7 @@ public partial class DsHidMiniInterop
     [SuppressMessage("ReSharper", "UnusedMember.Global")]
     public unsafe UInt32 SetPlayerIndex(int deviceIndex, byte playerIndex)
     {
-        if (_commandMutex is null || _cmdView is null)
+        if (_cmdView is null)
         {
             throw new DsHidMiniInteropUnavailableException();
         }
@@ -257,49 +616,42 @@ public partial class DsHidMiniInterop
                 "Player index must be between (including) 1 and 7.");
         }
 
-        AcquireCommandLock();
+        using CommandLease lease = BeginCommand();
 
-        try
-        {
-            ref DSHM_IPC_MSG_SET_PLAYER_INDEX_REQUEST request =
-                ref Unsafe.AsRef<DSHM_IPC_MSG_SET_PLAYER_INDEX_REQUEST>(_cmdView);
+        ref DSHM_IPC_MSG_SET_PLAYER_INDEX_REQUEST request =
+            ref Unsafe.AsRef<DSHM_IPC_MSG_SET_PLAYER_INDEX_REQUEST>(lease.Buffer);
 
-            request.Header.Type = DSHM_IPC_MSG_TYPE.DSHM_IPC_MSG_TYPE_REQUEST_RESPONSE;
-            request.Header.Target = DSHM_IPC_MSG_TARGET.DSHM_IPC_MSG_TARGET_DEVICE;
-            request.Header.Command.Device = DSHM_IPC_MSG_CMD_DEVICE.DSHM_IPC_MSG_CMD_DEVICE_SET_PLAYER_INDEX;
-            request.Header.TargetIndex = (uint)deviceIndex;
-            request.Header.Size = (uint)Marshal.SizeOf<DSHM_IPC_MSG_SET_PLAYER_INDEX_REQUEST>();
+        request.Header.Type = DSHM_IPC_MSG_TYPE.DSHM_IPC_MSG_TYPE_REQUEST_RESPONSE;
+        request.Header.Target = DSHM_IPC_MSG_TARGET.DSHM_IPC_MSG_TARGET_DEVICE;
+        request.Header.Command.Device = DSHM_IPC_MSG_CMD_DEVICE.DSHM_IPC_MSG_CMD_DEVICE_SET_PLAYER_INDEX;
+        request.Header.TargetIndex = (uint)deviceIndex;
+        request.Header.Size = (uint)Marshal.SizeOf<DSHM_IPC_MSG_SET_PLAYER_INDEX_REQUEST>();
 
-            request.PlayerIndex = playerIndex;
+        request.PlayerIndex = playerIndex;
 
-            if (!SendAndWait())
-            {
-                throw new DsHidMiniInteropReplyTimeoutException();
-            }
+        if (!lease.SendAndWait())
+        {
+            throw new DsHidMiniInteropReplyTimeoutException();
+        }
 
-            ref DSHM_IPC_MSG_SET_PLAYER_INDEX_REPLY reply =
-                ref Unsafe.AsRef<DSHM_IPC_MSG_SET_PLAYER_INDEX_REPLY>(_cmdView);
+        ref DSHM_IPC_MSG_SET_PLAYER_INDEX_REPLY reply =
+            ref Unsafe.AsRef<DSHM_IPC_MSG_SET_PLAYER_INDEX_REPLY>(lease.Buffer);
 
-            //
-            // Plausibility check
-            // 
-            if (reply.Header is
-                {
-                    Type: DSHM_IPC_MSG_TYPE.DSHM_IPC_MSG_TYPE_REQUEST_REPLY,
-                    Target: DSHM_IPC_MSG_TARGET.DSHM_IPC_MSG_TARGET_CLIENT,
-                    Command.Device: DSHM_IPC_MSG_CMD_DEVICE.DSHM_IPC_MSG_CMD_DEVICE_SET_PLAYER_INDEX
-                }
-                && reply.Header.TargetIndex == deviceIndex
-                && reply.Header.Size == Marshal.SizeOf<DSHM_IPC_MSG_SET_PLAYER_INDEX_REPLY>())
+        //
+        // Plausibility check
+        // 
+        if (reply.Header is
             {
-                return reply.NtStatus;
+                Type: DSHM_IPC_MSG_TYPE.DSHM_IPC_MSG_TYPE_REQUEST_REPLY,
+                Target: DSHM_IPC_MSG_TARGET.DSHM_IPC_MSG_TARGET_CLIENT,
+                Command.Device: DSHM_IPC_MSG_CMD_DEVICE.DSHM_IPC_MSG_CMD_DEVICE_SET_PLAYER_INDEX
             }
-
-            throw new DsHidMiniInteropUnexpectedReplyException(ref reply.Header);
-        }
-        finally
+            && reply.Header.TargetIndex == deviceIndex
+            && reply.Header.Size == Marshal.SizeOf<DSHM_IPC_MSG_SET_PLAYER_INDEX_REPLY>())
         {
-            _commandMutex.ReleaseMutex();
+            return reply.NtStatus;
         }
+
+        throw new DsHidMiniInteropUnexpectedReplyException(ref reply.Header);
     }
 }
\ No newline at end of file
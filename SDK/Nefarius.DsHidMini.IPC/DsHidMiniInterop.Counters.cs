@@ -0,0 +1,147 @@
+﻿using System.ComponentModel;
+using System.Diagnostics.CodeAnalysis;
+using System.Runtime.CompilerServices;
+using System.Runtime.InteropServices;
+
+using Windows.Win32;
+using Windows.Win32.System.Memory;
+
+using Nefarius.DsHidMini.IPC.Exceptions;
+using Nefarius.DsHidMini.IPC.Models;
+using Nefarius.DsHidMini.IPC.Models.Public;
+
+namespace Nefarius.DsHidMini.IPC;
+
+public partial class DsHidMiniInterop
+{
+    private MEMORY_MAPPED_VIEW_ADDRESS? _countersView;
+
+    /// <summary>
+    ///     Maps the performance counters read-only if the driver advertises them in the HID region header.
+    /// </summary>
+    private void MapCountersView()
+    {
+        ref IPC_HID_REGION_HEADER header = ref HidRegionHeader;
+
+        if (header.Magic != IPC_HID_REGION_HEADER.ExpectedMagic
+            || header.CountersOffset == 0)
+        {
+            return;
+        }
+
+        _countersView = PInvoke.MapViewOfFile(
+            _fileMapping,
+            FILE_MAP.FILE_MAP_READ,
+            0,
+            header.CountersOffset,
+            header.CountersSize
+        );
+
+        if (_countersView.Value == 0)
+        {
+            throw new Win32Exception(Marshal.GetLastWin32Error(), "Failed to access counters view");
+        }
+    }
+
+    private void UnmapCountersView()
+    {
+        if (_countersView.HasValue)
+        {
+            PInvoke.UnmapViewOfFile(_countersView.Value);
+            _countersView = null;
+        }
+    }
+
+    private unsafe ref IPC_COUNTERS_REGION_HEADER CountersRegion =>
+        ref Unsafe.AsRef<IPC_COUNTERS_REGION_HEADER>((void*)_countersView!.Value.Value);
+
+    /// <summary>
+    ///     Gets whether the driver maintains <see cref="DEVICE_COUNTERS" />.
+    /// </summary>
+    public bool HasDeviceCounters =>
+        _countersView is not null && Volatile.Read(ref CountersRegion.Magic) == IPC_COUNTERS_REGION_HEADER.ExpectedMagic;
+
+    /// <summary>
+    ///     Ticks per second of <see cref="DEVICE_COUNTERS.ProcessingTicks" />, 0 if <see cref="HasDeviceCounters" /> is
+    ///     FALSE.
+    /// </summary>
+    public long CountersTimestampFrequency => HasDeviceCounters ? CountersRegion.TimestampFrequency : 0;
+
+    /// <summary>
+    ///     Samples the performance counters of a device. Only reads shared memory, the driver isn't involved.
+    /// </summary>
+    /// <param name="deviceIndex">The one-based device index.</param>
+    /// <param name="counters">The <see cref="DEVICE_COUNTERS" /> to populate.</param>
+    /// <exception cref="DsHidMiniInteropUnavailableException">
+    ///     No driver instance is available or the driver doesn't maintain
+    ///     counters, check <see cref="HasDeviceCounters" /> prior.
+    /// </exception>
+    /// <exception cref="DsHidMiniInteropInvalidDeviceIndexException">
+    ///     The <paramref name="deviceIndex" /> was outside a valid
+    ///     range.
+    /// </exception>
+    /// <returns>
+    ///     TRUE if <paramref name="counters" /> got filled in, also with the final values of a device that is gone, or
+    ///     FALSE if no device ever occupied the given <paramref name="deviceIndex" />.
+    /// </returns>
+    [SuppressMessage("ReSharper", "UnusedMember.Global")]
+    public bool GetDeviceCounters(int deviceIndex, ref DEVICE_COUNTERS counters)
+    {
+        if (!HasDeviceCounters)
+        {
+            throw new DsHidMiniInteropUnavailableException();
+        }
+
+        ValidateDeviceIndex(deviceIndex);
+
+        ref IPC_COUNTERS_REGION_HEADER region = ref CountersRegion;
+        ref DEVICE_COUNTERS current = ref Unsafe.As<IPC_COUNTERS_REGION_HEADER, DEVICE_COUNTERS>(ref Unsafe.AddByteOffset(
+            ref region,
+            (nint)(region.SlotsOffset + region.SlotStride * (uint)(deviceIndex - 1))
+        ));
+        int count = (int)Math.Min(region.CounterCount, DEVICE_COUNTERS.CounterCount);
+        SpinWait spinner = default;
+
+        while (true)
+        {
+            int generation = Volatile.Read(ref current.Generation);
+
+            if (generation == 0)
+            {
+                return false;
+            }
+
+            //
+            // Odd while the driver resets the slot for another device
+            // 
+            if ((generation & 1) == 0)
+            {
+                DEVICE_COUNTERS copy = default;
+
+                copy.SlotIndex = Volatile.Read(ref current.SlotIndex);
+
+                for (int index = 0; index < count; index++)
+                {
+                    Unsafe.Add(ref copy.InputReports, index) = Volatile.Read(ref Unsafe.Add(ref current.InputReports, index));
+                }
+
+                Interlocked.MemoryBarrier();
+
+                if (Volatile.Read(ref current.Generation) == generation)
+                {
+                    copy.Generation = generation;
+                    counters = copy;
+
+                    return true;
+                }
+            }
+
+            if (spinner.Count >= MaxSnapshotAttempts)
+            {
+                return false;
+            }
+
+            spinner.SpinOnce();
+        }
+    }
+}
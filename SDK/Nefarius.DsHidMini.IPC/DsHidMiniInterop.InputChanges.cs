@@ -0,0 +1,139 @@
+﻿using System.Diagnostics.CodeAnalysis;
+using System.Numerics;
+using System.Runtime.CompilerServices;
+
+using Nefarius.DsHidMini.IPC.Exceptions;
+using Nefarius.DsHidMini.IPC.Models;
+using Nefarius.DsHidMini.IPC.Models.Public;
+
+namespace Nefarius.DsHidMini.IPC;
+
+public partial class DsHidMiniInterop
+{
+    private const string InputChangedEventName = "Global\\DsHidMiniInputChangedEvent";
+
+    private readonly ulong[] _pendingChanges = new ulong[IPC_HID_REGION_HEADER.ChangedSlotsWords];
+
+    private EventWaitHandle? _inputChangedEvent;
+
+    /// <summary>
+    ///     Opens the driver-wide input event if the driver maintains the changed slots mask.
+    /// </summary>
+    private void OpenInputChangedEvent()
+    {
+        ref IPC_HID_REGION_HEADER header = ref HidRegionHeader;
+
+        Array.Clear(_pendingChanges);
+
+        if (header.Magic != IPC_HID_REGION_HEADER.ExpectedMagic)
+        {
+            return;
+        }
+
+        try
+        {
+            _inputChangedEvent = EventWaitHandle.OpenExisting(InputChangedEventName);
+        }
+        catch (WaitHandleCannotBeOpenedException)
+        {
+            _inputChangedEvent = null;
+        }
+    }
+
+    private void CloseInputChangedEvent()
+    {
+        _inputChangedEvent?.Dispose();
+        _inputChangedEvent = null;
+    }
+
+    private unsafe ref IPC_HID_REGION_HEADER HidRegionHeader => ref Unsafe.As<byte, IPC_HID_REGION_HEADER>(
+        ref Unsafe.Add(ref Unsafe.AsRef<byte>(_hidView), IPC_HID_REGION_HEADER.HeaderOffset)
+    );
+
+    /// <summary>
+    ///     Gets whether the driver supports <see cref="WaitForInputChanges" />.
+    /// </summary>
+    public bool HasInputChangedEvent => _inputChangedEvent is not null && _hidView is not null;
+
+    /// <summary>
+    ///     Waits until any device instance delivered an input report or went away and returns which ones did.
+    /// </summary>
+    /// <remarks>
+    ///     One wait covers all devices, unlike waiting on each device's own input report event. The driver marks every
+    ///     device that changed in a mask in shared memory and only signals when the first mark is placed, which this
+    ///     call takes as a whole, so changes that arrived in the meantime return right away without a system call. Only
+    ///     a single thread on the machine may use this: the mask goes to whoever takes it first. Devices that don't fit
+    ///     into <paramref name="deviceIndexes" /> are returned by the next call. Read the reports with
+    ///     <see cref="GetRawInputReport(int, ref DS3_RAW_INPUT_REPORT, TimeSpan?)" /> (without timeout)
+    ///     or <see cref="DrainInputHistory" />.
+    /// </remarks>
+    /// <param name="deviceIndexes">Receives the one-based indexes of the devices that changed.</param>
+    /// <param name="timeout">How long to wait for a change, unlimited if omitted.</param>
+    /// <exception cref="DsHidMiniInteropUnavailableException">
+    ///     No driver instance is available or the driver doesn't maintain the
+    ///     changed slots mask, check <see cref="HasInputChangedEvent" /> prior.
+    /// </exception>
+    /// <returns>The number of entries written to <paramref name="deviceIndexes" />, 0 on timeout.</returns>
+    [SuppressMessage("ReSharper", "UnusedMember.Global")]
+    public unsafe int WaitForInputChanges(Span<int> deviceIndexes, TimeSpan? timeout = null)
+    {
+        if (!HasInputChangedEvent)
+        {
+            throw new DsHidMiniInteropUnavailableException();
+        }
+
+        ref IPC_HID_REGION_HEADER header = ref HidRegionHeader;
+
+        while (true)
+        {
+            int count = TakePendingChanges(deviceIndexes);
+
+            if (count > 0 || deviceIndexes.IsEmpty)
+            {
+                return count;
+            }
+
+            bool hasChanges = false;
+
+            for (int word = 0; word < IPC_HID_REGION_HEADER.ChangedSlotsWords; word++)
+            {
+                ref long changed = ref header.ChangedSlots[word];
+
+                //
+                // Only words with bits set get written, the others stay shared with the driver
+                // 
+                if (Volatile.Read(ref changed) != 0)
+                {
+                    _pendingChanges[word] |= (ulong)Interlocked.Exchange(ref changed, 0);
+                    hasChanges = true;
+                }
+            }
+
+            //
+            // An empty mask after waking means the bits got taken before the event reset
+            // 
+            if (!hasChanges && !_inputChangedEvent!.WaitOne(timeout ?? Timeout.InfiniteTimeSpan))
+            {
+                return 0;
+            }
+        }
+    }
+
+    private int TakePendingChanges(Span<int> deviceIndexes)
+    {
+        int count = 0;
+
+        for (int word = 0; word < _pendingChanges.Length && count < deviceIndexes.Length; word++)
+        {
+            while (_pendingChanges[word] != 0 && count < deviceIndexes.Length)
+            {
+                int bit = BitOperations.TrailingZeroCount(_pendingChanges[word]);
+
+                _pendingChanges[word] &= _pendingChanges[word] - 1;
+                deviceIndexes[count++] = word * 64 + bit + 1;
+            }
+        }
+
+        return count;
+    }
+}
@@ -0,0 +1,189 @@
+﻿using System.ComponentModel;
+using System.Runtime.CompilerServices;
+using System.Runtime.InteropServices;
+
+using Windows.Win32;
+using Windows.Win32.System.Memory;
+
+using Nefarius.DsHidMini.IPC.Exceptions;
+using Nefarius.DsHidMini.IPC.Models;
+using Nefarius.DsHidMini.IPC.Models.Public;
+
+namespace Nefarius.DsHidMini.IPC;
+
+public partial class DsHidMiniInterop
+{
+    private const string OutputRingEventName = "Global\\DsHidMiniOutputRingEvent";
+
+    private readonly object _outputRingLock = new();
+
+    private EventWaitHandle? _outputRingEvent;
+    private MEMORY_MAPPED_VIEW_ADDRESS? _outputView;
+
+    /// <summary>
+    ///     Maps the output rings if the driver advertises them in the HID region header.
+    /// </summary>
+    private unsafe void MapOutputView()
+    {
+        ref IPC_HID_REGION_HEADER header = ref Unsafe.As<byte, IPC_HID_REGION_HEADER>(ref Unsafe.Add(
+            ref Unsafe.AsRef<byte>(_hidView),
+            IPC_HID_REGION_HEADER.HeaderOffset
+        ));
+
+        if (header.Magic != IPC_HID_REGION_HEADER.ExpectedMagic
+            || header.OutputOffset == 0)
+        {
+            return;
+        }
+
+        try
+        {
+            _outputRingEvent = EventWaitHandle.OpenExisting(OutputRingEventName);
+        }
+        catch (WaitHandleCannotBeOpenedException)
+        {
+            return;
+        }
+
+        _outputView = PInvoke.MapViewOfFile(
+            _fileMapping,
+            FILE_MAP.FILE_MAP_READ | FILE_MAP.FILE_MAP_WRITE,
+            0,
+            header.OutputOffset,
+            header.OutputSize
+        );
+
+        if (_outputView.Value == 0)
+        {
+            throw new Win32Exception(Marshal.GetLastWin32Error(), "Failed to access output view");
+        }
+    }
+
+    private unsafe void UnmapOutputView()
+    {
+        if (_outputView.HasValue)
+        {
+            ref IPC_OUTPUT_REGION_HEADER region = ref OutputRegion;
+            int processId = Environment.ProcessId;
+
+            //
+            // Hands our rings back, the driver would otherwise only reclaim them once this process is gone
+            // 
+            if (Volatile.Read(ref region.Magic) == IPC_OUTPUT_REGION_HEADER.ExpectedMagic)
+            {
+                for (int deviceIndex = 1; deviceIndex <= Math.Min(region.RingCount, IPC_HID_REGION_HEADER.MaxSlotCount); deviceIndex++)
+                {
+                    Interlocked.CompareExchange(ref GetOutputRing(deviceIndex).OwnerProcessId, 0, processId);
+                }
+            }
+
+            PInvoke.UnmapViewOfFile(_outputView.Value);
+            _outputView = null;
+        }
+
+        _outputRingEvent?.Dispose();
+        _outputRingEvent = null;
+    }
+
+    private unsafe ref IPC_OUTPUT_REGION_HEADER OutputRegion =>
+        ref Unsafe.AsRef<IPC_OUTPUT_REGION_HEADER>((void*)_outputView!.Value.Value);
+
+    private ref IPC_OUTPUT_RING GetOutputRing(int deviceIndex)
+    {
+        ref IPC_OUTPUT_REGION_HEADER region = ref OutputRegion;
+
+        return ref Unsafe.As<IPC_OUTPUT_REGION_HEADER, IPC_OUTPUT_RING>(ref Unsafe.AddByteOffset(
+            ref region,
+            (nint)(region.RingsOffset + region.RingStride * (uint)(deviceIndex - 1))
+        ));
+    }
+
+    /// <summary>
+    ///     Gets whether the driver accepts <see cref="TrySendOutputRequest" />.
+    /// </summary>
+    public bool HasOutputChannel
+    {
+        get
+        {
+            if (_outputView is null || _outputRingEvent is null)
+            {
+                return false;
+            }
+
+            ref IPC_OUTPUT_REGION_HEADER region = ref OutputRegion;
+
+            return Volatile.Read(ref region.Magic) == IPC_OUTPUT_REGION_HEADER.ExpectedMagic
+                   && region.RingCount == IPC_HID_REGION_HEADER.MaxSlotCount
+                   && region.RingDepth == IPC_OUTPUT_REGION_HEADER.MaxRingDepth
+                   && region.RequestSize == Unsafe.SizeOf<OUTPUT_REQUEST>();
+        }
+    }
+
+    /// <summary>
+    ///     Submits the desired rumble and/or LED state of a given device instance.
+    /// </summary>
+    /// <remarks>
+    ///     Requests get appended to a ring in shared memory owned by this process, no command round trip is involved.
+    ///     The driver folds all requests it finds pending into the output state of the device and sends at most one
+    ///     output report, subject to the same deduplication and rate control as output coming from the HID stack, so
+    ///     high-rate callers don't need to throttle themselves. LED fields are ignored if the driver is in charge of
+    ///     the LEDs.
+    /// </remarks>
+    /// <param name="deviceIndex">The one-based device index.</param>
+    /// <param name="request">The <see cref="OUTPUT_REQUEST" /> to submit.</param>
+    /// <exception cref="DsHidMiniInteropUnavailableException">
+    ///     No driver instance is available or the driver doesn't offer an
+    ///     output channel, check <see cref="HasOutputChannel" /> prior.
+    /// </exception>
+    /// <exception cref="DsHidMiniInteropInvalidDeviceIndexException">
+    ///     The <paramref name="deviceIndex" /> was outside a valid
+    ///     range.
+    /// </exception>
+    /// <exception cref="DsHidMiniInteropConcurrencyException">
+    ///     A different process is submitting output requests to this
+    ///     device.
+    /// </exception>
+    /// <returns>TRUE if the request got queued, FALSE if the driver hasn't caught up with earlier requests yet.</returns>
+    public bool TrySendOutputRequest(int deviceIndex, in OUTPUT_REQUEST request)
+    {
+        if (!HasOutputChannel)
+        {
+            throw new DsHidMiniInteropUnavailableException();
+        }
+
+        ValidateDeviceIndex(deviceIndex);
+
+        ref IPC_OUTPUT_RING ring = ref GetOutputRing(deviceIndex);
+        int processId = Environment.ProcessId;
+
+        if (Volatile.Read(ref ring.OwnerProcessId) != processId
+            && Interlocked.CompareExchange(ref ring.OwnerProcessId, processId, 0) != 0)
+        {
+            throw new DsHidMiniInteropConcurrencyException();
+        }
+
+        //
+        // Single producer per process by contract, concurrent callers of this instance are serialized here
+        // 
+        lock (_outputRingLock)
+        {
+            int tail = ring.Tail;
+
+            //
+            // Acquire, the driver is done reading the entry once Head moved past it
+            // 
+            if (tail - Volatile.Read(ref ring.Head) >= IPC_OUTPUT_REGION_HEADER.MaxRingDepth)
+            {
+                return false;
+            }
+
+            ring.Requests[tail & (IPC_OUTPUT_REGION_HEADER.MaxRingDepth - 1)] = request;
+
+            Volatile.Write(ref ring.Tail, tail + 1);
+        }
+
+        _outputRingEvent!.Set();
+
+        return true;
+    }
+}
@@ -15,6 +15,7 @@ using Microsoft.Win32.SafeHandles;
 using Nefarius.DsHidMini.IPC.Exceptions;
 using Nefarius.DsHidMini.IPC.Models;
 using Nefarius.DsHidMini.IPC.Models.Drivers;
+using Nefarius.DsHidMini.IPC.Models.Public;
 using Nefarius.Utilities.DeviceManagement.PnP;
 
 namespace Nefarius.DsHidMini.IPC;
@@ -37,6 +38,10 @@ public sealed partial class DsHidMiniInterop : IDisposable
 
     private SafeFileHandle? _fileMapping;
     private MEMORY_MAPPED_VIEW_ADDRESS? _hidView;
+    private MEMORY_MAPPED_VIEW_ADDRESS? _telemetryView;
+    private MEMORY_MAPPED_VIEW_ADDRESS? _historyView;
+    private uint _historyDepth;
+    private uint _historyStride;
 
     private EventWaitHandle? _inputReportEvent;
 
@@ -95,13 +100,30 @@ public sealed partial class DsHidMiniInterop : IDisposable
             PInvoke.UnmapViewOfFile(_hidView.Value);
         }
 
+        if (_telemetryView.HasValue)
+        {
+            PInvoke.UnmapViewOfFile(_telemetryView.Value);
+        }
+
+        if (_historyView.HasValue)
+        {
+            PInvoke.UnmapViewOfFile(_historyView.Value);
+            _historyView = null;
+        }
+
+        UnmapOutputView();
+        UnmapCountersView();
+
         _fileMapping?.Dispose();
 
         _readEvent?.Dispose();
         _writeEvent?.Dispose();
         _inputReportEvent?.Dispose();
+        CloseInputChangedEvent();
 
         _commandMutex?.Dispose();
+
+        CloseCommandRing();
     }
 
     /// <summary>
@@ -152,9 +174,12 @@ public sealed partial class DsHidMiniInterop : IDisposable
             long alignedOffset = systemInfo.dwAllocationGranularity / pageSize * pageSize;
             long offsetWithinPage = systemInfo.dwAllocationGranularity % pageSize;
 
+            //
+            // Writable for taking the changed slots mask
+            // 
             _hidView = PInvoke.MapViewOfFile(
                 _fileMapping,
-                FILE_MAP.FILE_MAP_READ,
+                FILE_MAP.FILE_MAP_READ | FILE_MAP.FILE_MAP_WRITE,
                 0,
                 (uint)alignedOffset,
                 (uint)(systemInfo.dwAllocationGranularity + offsetWithinPage)
@@ -164,6 +189,31 @@ public sealed partial class DsHidMiniInterop : IDisposable
             {
                 throw new Win32Exception(Marshal.GetLastWin32Error(), "Failed to access HID view");
             }
+
+            //
+            // Follows command and HID regions, one entry per possible device
+            // 
+            uint telemetryRegionSize =
+                (uint)((Marshal.SizeOf<OUTPUT_REPORT_TELEMETRY>() * byte.MaxValue + pageSize - 1) / pageSize * pageSize);
+
+            _telemetryView = PInvoke.MapViewOfFile(
+                _fileMapping,
+                FILE_MAP.FILE_MAP_READ,
+                0,
+                pageSize * 2,
+                telemetryRegionSize
+            );
+
+            if (_telemetryView.Value == 0)
+            {
+                throw new Win32Exception(Marshal.GetLastWin32Error(), "Failed to access telemetry view");
+            }
+
+            MapHistoryView();
+            MapOutputView();
+            MapCountersView();
+            OpenInputChangedEvent();
+            OpenCommandRing();
         }
         catch (FileNotFoundException)
         {
@@ -171,6 +221,41 @@ public sealed partial class DsHidMiniInterop : IDisposable
         }
     }
 
+    /// <summary>
+    ///     Maps the input history rings if the driver advertises them in the HID region header.
+    /// </summary>
+    private unsafe void MapHistoryView()
+    {
+        ref IPC_HID_REGION_HEADER header = ref Unsafe.As<byte, IPC_HID_REGION_HEADER>(ref Unsafe.Add(
+            ref Unsafe.AsRef<byte>(_hidView),
+            IPC_HID_REGION_HEADER.HeaderOffset
+        ));
+
+        _historyDepth = 0;
+
+        if (header.Magic != IPC_HID_REGION_HEADER.ExpectedMagic
+            || header.HistoryDepth == 0)
+        {
+            return;
+        }
+
+        _historyView = PInvoke.MapViewOfFile(
+            _fileMapping,
+            FILE_MAP.FILE_MAP_READ,
+            0,
+            header.HistoryOffset,
+            (nuint)header.HistoryStride * IPC_HID_REGION_HEADER.MaxSlotCount
+        );
+
+        if (_historyView.Value == 0)
+        {
+            throw new Win32Exception(Marshal.GetLastWin32Error(), "Failed to access input history view");
+        }
+
+        _historyDepth = header.HistoryDepth;
+        _historyStride = header.HistoryStride;
+    }
+
     private void RefreshDevices()
     {
         _connectedDevices.Clear();
@@ -230,98 +315,91 @@ public sealed partial class DsHidMiniInterop : IDisposable
     /// </exception>
     private unsafe EventWaitHandle GetHidReportWaitHandle(int deviceIndex)
     {
-        if (_commandMutex is null || _cmdView is null)
+        if (_cmdView is null)
         {
             throw new DsHidMiniInteropUnavailableException();
         }
 
         ValidateDeviceIndex(deviceIndex);
 
-        AcquireCommandLock();
+        using CommandLease lease = BeginCommand();
 
-        try
+        ref DSHM_IPC_MSG_HEADER request = ref Unsafe.AsRef<DSHM_IPC_MSG_HEADER>(lease.Buffer);
+
+        request.Type = DSHM_IPC_MSG_TYPE.DSHM_IPC_MSG_TYPE_RESPONSE_ONLY;
+        request.Target = DSHM_IPC_MSG_TARGET.DSHM_IPC_MSG_TARGET_DEVICE;
+        request.Command.Device = DSHM_IPC_MSG_CMD_DEVICE.DSHM_IPC_MSG_CMD_DEVICE_GET_HID_WAIT_HANDLE;
+        request.TargetIndex = (uint)deviceIndex;
+        request.Size = (uint)Marshal.SizeOf<DSHM_IPC_MSG_HEADER>();
+
+        if (!lease.SendAndWait())
         {
-            ref DSHM_IPC_MSG_HEADER request = ref Unsafe.AsRef<DSHM_IPC_MSG_HEADER>(_cmdView);
+            throw new DsHidMiniInteropReplyTimeoutException();
+        }
 
-            request.Type = DSHM_IPC_MSG_TYPE.DSHM_IPC_MSG_TYPE_RESPONSE_ONLY;
-            request.Target = DSHM_IPC_MSG_TARGET.DSHM_IPC_MSG_TARGET_DEVICE;
-            request.Command.Device = DSHM_IPC_MSG_CMD_DEVICE.DSHM_IPC_MSG_CMD_DEVICE_GET_HID_WAIT_HANDLE;
-            request.TargetIndex = (uint)deviceIndex;
-            request.Size = (uint)Marshal.SizeOf<DSHM_IPC_MSG_HEADER>();
+        ref DSHM_IPC_MSG_GET_HID_WAIT_HANDLE_RESPONSE reply =
+            ref Unsafe.AsRef<DSHM_IPC_MSG_GET_HID_WAIT_HANDLE_RESPONSE>(lease.Buffer);
 
-            if (!SendAndWait())
+        //
+        // Plausibility check
+        // 
+        if (reply.Header is
             {
-                throw new DsHidMiniInteropReplyTimeoutException();
+                Type: DSHM_IPC_MSG_TYPE.DSHM_IPC_MSG_TYPE_RESPONSE_ONLY,
+                Target: DSHM_IPC_MSG_TARGET.DSHM_IPC_MSG_TARGET_CLIENT,
+                Command.Device: DSHM_IPC_MSG_CMD_DEVICE.DSHM_IPC_MSG_CMD_DEVICE_GET_HID_WAIT_HANDLE
             }
+            && reply.Header.TargetIndex == deviceIndex
+            && reply.Header.Size == Marshal.SizeOf<DSHM_IPC_MSG_GET_HID_WAIT_HANDLE_RESPONSE>())
+        {
+            HANDLE driverProcess = PInvoke.OpenProcess(
+                PROCESS_ACCESS_RIGHTS.PROCESS_DUP_HANDLE,
+                new BOOL(false),
+                reply.ProcessId
+            );
 
-            ref DSHM_IPC_MSG_GET_HID_WAIT_HANDLE_RESPONSE reply =
-                ref Unsafe.AsRef<DSHM_IPC_MSG_GET_HID_WAIT_HANDLE_RESPONSE>(_cmdView);
-
-            //
-            // Plausibility check
-            // 
-            if (reply.Header is
-                {
-                    Type: DSHM_IPC_MSG_TYPE.DSHM_IPC_MSG_TYPE_RESPONSE_ONLY,
-                    Target: DSHM_IPC_MSG_TARGET.DSHM_IPC_MSG_TARGET_CLIENT,
-                    Command.Device: DSHM_IPC_MSG_CMD_DEVICE.DSHM_IPC_MSG_CMD_DEVICE_GET_HID_WAIT_HANDLE
-                }
-                && reply.Header.TargetIndex == deviceIndex
-                && reply.Header.Size == Marshal.SizeOf<DSHM_IPC_MSG_GET_HID_WAIT_HANDLE_RESPONSE>())
+            try
             {
-                HANDLE driverProcess = PInvoke.OpenProcess(
-                    PROCESS_ACCESS_RIGHTS.PROCESS_DUP_HANDLE,
-                    new BOOL(false),
-                    reply.ProcessId
-                );
-
-                try
+                if (driverProcess.IsNull)
                 {
-                    if (driverProcess.IsNull)
+                    if (Marshal.GetLastWin32Error() == (int)WIN32_ERROR.ERROR_ACCESS_DENIED)
                     {
-                        if (Marshal.GetLastWin32Error() == (int)WIN32_ERROR.ERROR_ACCESS_DENIED)
-                        {
-                            throw new DsHidMiniInteropAccessDeniedException();
-                        }
-
-                        throw new Win32Exception(Marshal.GetLastWin32Error(), "OpenProcess call failed.");
+                        throw new DsHidMiniInteropAccessDeniedException();
                     }
 
-                    HANDLE dupHandle;
-
-                    if (!PInvoke.DuplicateHandle(
-                            driverProcess,
-                            new HANDLE(reply.WaitHandle),
-                            PInvoke.GetCurrentProcess(),
-                            &dupHandle,
-                            0,
-                            new BOOL(false),
-                            DUPLICATE_HANDLE_OPTIONS.DUPLICATE_SAME_ACCESS
-                        ))
-                    {
-                        throw new Win32Exception(Marshal.GetLastWin32Error(), "DuplicateHandle call failed.");
-                    }
+                    throw new Win32Exception(Marshal.GetLastWin32Error(), "OpenProcess call failed.");
+                }
 
-                    return new EventWaitHandle(false, EventResetMode.AutoReset)
-                    {
-                        SafeWaitHandle = new SafeWaitHandle(dupHandle, true)
-                    };
+                HANDLE dupHandle;
+
+                if (!PInvoke.DuplicateHandle(
+                        driverProcess,
+                        new HANDLE(reply.WaitHandle),
+                        PInvoke.GetCurrentProcess(),
+                        &dupHandle,
+                        0,
+                        new BOOL(false),
+                        DUPLICATE_HANDLE_OPTIONS.DUPLICATE_SAME_ACCESS
+                    ))
+                {
+                    throw new Win32Exception(Marshal.GetLastWin32Error(), "DuplicateHandle call failed.");
                 }
-                finally
+
+                return new EventWaitHandle(false, EventResetMode.AutoReset)
                 {
-                    if (!driverProcess.IsNull)
-                    {
-                        PInvoke.CloseHandle(driverProcess);
-                    }
+                    SafeWaitHandle = new SafeWaitHandle(dupHandle, true)
+                };
+            }
+            finally
+            {
+                if (!driverProcess.IsNull)
+                {
+                    PInvoke.CloseHandle(driverProcess);
                 }
             }
-
-            throw new DsHidMiniInteropUnexpectedReplyException(ref reply.Header);
-        }
-        finally
-        {
-            _commandMutex.ReleaseMutex();
         }
+
+        throw new DsHidMiniInteropUnexpectedReplyException(ref reply.Header);
     }
 
     private void AcquireCommandLock()
@@ -0,0 +1,157 @@
+﻿using System.Diagnostics.CodeAnalysis;
+using System.Runtime.CompilerServices;
+using System.Runtime.InteropServices;
+
+namespace Nefarius.DsHidMini.IPC.Models;
+
+/// <summary>
+///     Life cycle of a command ring slot.
+/// </summary>
+/// <remarks>Mirrors DSHM_IPC_CMD_SLOT_STATE of the native include/DsHidMini/IpcCommandRing.h.</remarks>
+[SuppressMessage("ReSharper", "InconsistentNaming")]
+internal static class DSHM_IPC_CMD_SLOT_STATE
+{
+    /// <summary>
+    ///     Owned by a client, the message buffer is the client's.
+    /// </summary>
+    public const int Idle = 0;
+
+    /// <summary>
+    ///     Queued or being processed, the message buffer is the driver's.
+    /// </summary>
+    public const int Submitted = 1;
+
+    /// <summary>
+    ///     Reply written, the message buffer is the client's again.
+    /// </summary>
+    public const int Completed = 2;
+
+    /// <summary>
+    ///     The client gave up waiting, the driver frees the slot once done.
+    /// </summary>
+    public const int Abandoned = 3;
+}
+
+/// <summary>
+///     Request queue entry referencing a slot.
+/// </summary>
+[StructLayout(LayoutKind.Sequential)]
+[SuppressMessage("ReSharper", "InconsistentNaming")]
+internal struct IPC_CMD_QUEUE_CELL
+{
+    /// <summary>
+    ///     Queue position the cell is ready for.
+    /// </summary>
+    public Int32 Sequence;
+
+    /// <summary>
+    ///     Zero-based slot index.
+    /// </summary>
+    public UInt32 SlotIndex;
+
+    /// <summary>
+    ///     The cell content as a single 64 bit value, <see cref="Sequence" /> in the low half.
+    /// </summary>
+    public static long Value(int sequence, int slotIndex)
+    {
+        return (uint)sequence | ((long)(uint)slotIndex << 32);
+    }
+}
+
+[InlineArray(IPC_CMD_RING_HEADER.MaxQueueCapacity)]
+[SuppressMessage("ReSharper", "InconsistentNaming")]
+internal struct IPC_CMD_QUEUE
+{
+    private IPC_CMD_QUEUE_CELL _cell;
+}
+
+/// <summary>
+///     Describes the multi-client command ring, located <see cref="RingOffset" /> bytes into the command region.
+/// </summary>
+/// <remarks>Mirrors IPC_CMD_RING_HEADER of the native include/DsHidMini/IpcCommandRing.h.</remarks>
+[StructLayout(LayoutKind.Sequential)]
+[SuppressMessage("ReSharper", "InconsistentNaming")]
+internal unsafe struct IPC_CMD_RING_HEADER
+{
+    public const int RingOffset = 0x1000;
+
+    public const uint ExpectedMagic = 0x444D4344;
+
+    public const int MaxQueueCapacity = 64;
+
+    public const int MaxSlotCount = 32;
+
+    /// <summary>
+    ///     Rings of this version or newer belong to drivers handling <see cref="DSHM_IPC_MSG_BATCH_REQUEST" />.
+    /// </summary>
+    public const uint BatchMinVersion = 2;
+
+    /// <summary>
+    ///     <see cref="ExpectedMagic" /> once the driver initialized the ring, anything else means an older driver.
+    /// </summary>
+    public UInt32 Magic;
+
+    public UInt32 Version;
+
+    /// <summary>
+    ///     Size of the header in bytes.
+    /// </summary>
+    public UInt32 Size;
+
+    public UInt32 SlotCount;
+
+    /// <summary>
+    ///     Offset of the first slot from the start of the header.
+    /// </summary>
+    public UInt32 SlotsOffset;
+
+    public UInt32 SlotSize;
+
+    public UInt32 QueueCapacity;
+
+    private fixed UInt32 Reserved[9];
+
+    /// <summary>
+    ///     Next queue position to fill, shared by all clients.
+    /// </summary>
+    public Int32 Tail;
+
+    private fixed byte TailPadding[60];
+
+    /// <summary>
+    ///     Next queue position the driver takes.
+    /// </summary>
+    public Int32 Head;
+
+    private fixed byte HeadPadding[60];
+
+    public IPC_CMD_QUEUE Queue;
+}
+
+/// <summary>
+///     Command ring slot header, the message buffer follows at <see cref="MessageOffset" />.
+/// </summary>
+/// <remarks>Mirrors IPC_CMD_SLOT of the native include/DsHidMini/IpcCommandRing.h.</remarks>
+[StructLayout(LayoutKind.Sequential)]
+[SuppressMessage("ReSharper", "InconsistentNaming")]
+internal unsafe struct IPC_CMD_SLOT
+{
+    public const int MessageOffset = 64;
+
+    /// <summary>
+    ///     Largest request or reply message a slot holds.
+    /// </summary>
+    public const int MaxMessageSize = 1024 - MessageOffset;
+
+    /// <summary>
+    ///     Process ID of the owning client, 0 if the slot is free.
+    /// </summary>
+    public Int32 OwnerProcessId;
+
+    /// <summary>
+    ///     One of <see cref="DSHM_IPC_CMD_SLOT_STATE" />.
+    /// </summary>
+    public Int32 State;
+
+    private fixed UInt32 Reserved[14];
+}
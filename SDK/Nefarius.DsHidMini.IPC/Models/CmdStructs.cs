@@ -146,3 +146,50 @@ internal struct DSHM_IPC_MSG_GET_HID_WAIT_HANDLE_RESPONSE
     /// <remarks>The requester of this handle must duplicate it into the current process before it becomes usable.</remarks>
     public IntPtr WaitHandle;
 }
+
+/// <summary>
+///     Runs several commands in a single round trip. <see cref="Count" /> entries follow back to back, each a
+///     <see cref="DSHM_IPC_MSG_BATCH_ENTRY" /> followed by a complete command message; the reply replaces the command
+///     within its entry.
+/// </summary>
+/// <remarks>The driver ignores the batch as a whole if the framing of any entry is off.</remarks>
+[StructLayout(LayoutKind.Sequential)]
+[SuppressMessage("ReSharper", "InconsistentNaming")]
+internal struct DSHM_IPC_MSG_BATCH_REQUEST
+{
+    /// <summary>
+    ///     Most commands a single batch may carry.
+    /// </summary>
+    public const int MaxCount = 64;
+
+    /// <summary>
+    ///     Message bytes every entry has room for at the least, enough for the largest reply.
+    /// </summary>
+    public const int MinMessageSize = 32;
+
+    public DSHM_IPC_MSG_HEADER Header;
+
+    /// <summary>
+    ///     Number of entries following, 1 to <see cref="MaxCount" />
+    /// </summary>
+    public UInt32 Count;
+}
+
+/// <summary>
+///     Prefix of a <see cref="DSHM_IPC_MSG_BATCH_REQUEST" /> entry, the command message follows.
+/// </summary>
+[StructLayout(LayoutKind.Sequential)]
+[SuppressMessage("ReSharper", "InconsistentNaming")]
+internal struct DSHM_IPC_MSG_BATCH_ENTRY
+{
+    /// <summary>
+    ///     Size of the entry including this prefix in bytes, a multiple of 8 with room for at least
+    ///     <see cref="DSHM_IPC_MSG_BATCH_REQUEST.MinMessageSize" /> message bytes
+    /// </summary>
+    public UInt32 Size;
+
+    /// <summary>
+    ///     NTSTATUS of dispatching the command, the outcome of the action itself is part of the reply as usual
+    /// </summary>
+    public UInt32 Status;
+}
@@ -0,0 +1,55 @@
+﻿using System.Diagnostics.CodeAnalysis;
+using System.Runtime.InteropServices;
+
+using Nefarius.DsHidMini.IPC.Models.Public;
+
+namespace Nefarius.DsHidMini.IPC.Models;
+
+/// <summary>
+///     Describes the counters region, advertised by <see cref="IPC_HID_REGION_HEADER.CountersOffset" />.
+/// </summary>
+/// <remarks>Mirrors IPC_COUNTERS_REGION_HEADER of the native include/DsHidMini/IpcCounters.h.</remarks>
+[StructLayout(LayoutKind.Sequential)]
+[SuppressMessage("ReSharper", "InconsistentNaming")]
+internal unsafe struct IPC_COUNTERS_REGION_HEADER
+{
+    public const uint ExpectedMagic = 0x544E4344;
+
+    /// <summary>
+    ///     <see cref="ExpectedMagic" /> once the driver initialized the region.
+    /// </summary>
+    public UInt32 Magic;
+
+    public UInt32 Version;
+
+    /// <summary>
+    ///     Size of the header in bytes.
+    /// </summary>
+    public UInt32 Size;
+
+    public UInt32 SlotCount;
+
+    /// <summary>
+    ///     Offset of the first <see cref="DEVICE_COUNTERS" /> from the start of the header.
+    /// </summary>
+    public UInt32 SlotsOffset;
+
+    /// <summary>
+    ///     Distance between two slots in bytes.
+    /// </summary>
+    public UInt32 SlotStride;
+
+    /// <summary>
+    ///     64 bit counters per slot following <see cref="DEVICE_COUNTERS.Generation" />.
+    /// </summary>
+    public UInt32 CounterCount;
+
+    private UInt32 Reserved;
+
+    /// <summary>
+    ///     <see cref="DEVICE_COUNTERS.ProcessingTicks" /> per second.
+    /// </summary>
+    public Int64 TimestampFrequency;
+
+    private fixed UInt32 Reserved2[6];
+}
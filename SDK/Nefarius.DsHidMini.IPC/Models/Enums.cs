@@ -78,7 +78,12 @@ internal enum DSHM_IPC_MSG_CMD_DRIVER : UInt32
     /// <summary>
     ///     Message without payload, useful to check for functionality
     /// </summary>
-    DSHM_IPC_MSG_CMD_DRIVER_PING
+    DSHM_IPC_MSG_CMD_DRIVER_PING,
+
+    /// <summary>
+    ///     Carries several commands handled in one go, see <see cref="DSHM_IPC_MSG_BATCH_REQUEST" />
+    /// </summary>
+    DSHM_IPC_MSG_CMD_DRIVER_BATCH
 }
 
 // Describes a per-device command
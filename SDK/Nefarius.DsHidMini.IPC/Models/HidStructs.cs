@@ -8,7 +8,7 @@ namespace Nefarius.DsHidMini.IPC.Models;
 /// <summary>
 ///     Represents the most current raw DS3 HID input report.
 /// </summary>
-[StructLayout(LayoutKind.Sequential)]
+[StructLayout(LayoutKind.Sequential, Pack = 1)]
 [SuppressMessage("ReSharper", "InconsistentNaming")]
 internal struct IPC_HID_INPUT_REPORT_MESSAGE
 {
@@ -21,4 +21,133 @@ internal struct IPC_HID_INPUT_REPORT_MESSAGE
     ///     The <see cref="DS3_RAW_INPUT_REPORT" /> coming directly from the device with no transformations applied.
     /// </summary>
     public DS3_RAW_INPUT_REPORT InputReport;
-}
\ No newline at end of file
+}
+
+/// <summary>
+///     Describes the HID region layout, located <see cref="HeaderOffset" /> bytes into the region.
+/// </summary>
+/// <remarks>Mirrors IPC_HID_REGION_HEADER of the native include/DsHidMini/IpcHidRegion.h.</remarks>
+[StructLayout(LayoutKind.Sequential)]
+[SuppressMessage("ReSharper", "InconsistentNaming")]
+internal unsafe struct IPC_HID_REGION_HEADER
+{
+    public const int HeaderOffset = 0x4000;
+
+    public const uint ExpectedMagic = 0x44494844;
+
+    public const int MaxSlotCount = 255;
+
+    public const int ChangedSlotsWords = (MaxSlotCount + 63) / 64;
+
+    /// <summary>
+    ///     <see cref="ExpectedMagic" /> once the driver initialized the header, anything else means an older driver.
+    /// </summary>
+    public UInt32 Magic;
+
+    /// <summary>
+    ///     Layout revision the driver implements.
+    /// </summary>
+    public UInt32 Version;
+
+    /// <summary>
+    ///     Size of the header in bytes.
+    /// </summary>
+    public UInt32 Size;
+
+    /// <summary>
+    ///     Number of slots.
+    /// </summary>
+    public UInt32 SlotCount;
+
+    /// <summary>
+    ///     Offset of the first slot from the start of the region.
+    /// </summary>
+    public UInt32 SlotsOffset;
+
+    /// <summary>
+    ///     Distance between two slots in bytes.
+    /// </summary>
+    public UInt32 SlotStride;
+
+    /// <summary>
+    ///     Offset of the sequence counter within a slot. The counter is odd while the driver updates the slot, even once
+    ///     stable.
+    /// </summary>
+    public UInt32 SequenceOffset;
+
+    private UInt32 Reserved;
+
+    /// <summary>
+    ///     Input history entries per slot, a power of two, 0 if there's no history.
+    /// </summary>
+    public UInt32 HistoryDepth;
+
+    /// <summary>
+    ///     Distance between two history rings in bytes.
+    /// </summary>
+    public UInt32 HistoryStride;
+
+    /// <summary>
+    ///     Offset of the first history ring from the start of the file mapping.
+    /// </summary>
+    public UInt32 HistoryOffset;
+
+    private UInt32 Reserved2;
+
+    /// <summary>
+    ///     History timestamp ticks per second.
+    /// </summary>
+    public Int64 TimestampFrequency;
+
+    /// <summary>
+    ///     Offset of the output region from the start of the file mapping, 0 if there's none.
+    /// </summary>
+    public UInt32 OutputOffset;
+
+    /// <summary>
+    ///     Size of the output region in bytes.
+    /// </summary>
+    public UInt32 OutputSize;
+
+    /// <summary>
+    ///     One bit per slot the driver sets after the slot changed, bit (N - 1) % 64 of word
+    ///     (N - 1) / 64 for slot N. Cleared by the reader.
+    /// </summary>
+    public fixed Int64 ChangedSlots[ChangedSlotsWords];
+
+    private fixed byte Reserved3[32];
+
+    /// <summary>
+    ///     Offset of the first <see cref="Public.INPUT_STATE" /> from the start of the region, 0 if there are none.
+    /// </summary>
+    public UInt32 StateOffset;
+
+    /// <summary>
+    ///     Distance between two states in bytes.
+    /// </summary>
+    public UInt32 StateStride;
+
+    /// <summary>
+    ///     Offset of the counters region from the start of the file mapping, 0 if there's none.
+    /// </summary>
+    public UInt32 CountersOffset;
+
+    /// <summary>
+    ///     Size of the counters region in bytes.
+    /// </summary>
+    public UInt32 CountersSize;
+}
+
+/// <summary>
+///     Leads each per slot input history ring, followed by <see cref="IPC_HID_REGION_HEADER.HistoryDepth" /> entries.
+/// </summary>
+/// <remarks>Mirrors IPC_HID_HISTORY of the native include/DsHidMini/IpcHidRegion.h.</remarks>
+[StructLayout(LayoutKind.Sequential, Size = 64)]
+[SuppressMessage("ReSharper", "InconsistentNaming")]
+internal struct IPC_HID_HISTORY
+{
+    /// <summary>
+    ///     Number of entries ever written, entry N lives at index N % HistoryDepth.
+    /// </summary>
+    public Int64 WriteCursor;
+}
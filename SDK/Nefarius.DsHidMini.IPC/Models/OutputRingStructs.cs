@@ -0,0 +1,93 @@
+﻿using System.Diagnostics.CodeAnalysis;
+using System.Runtime.CompilerServices;
+using System.Runtime.InteropServices;
+
+using Nefarius.DsHidMini.IPC.Models.Public;
+
+namespace Nefarius.DsHidMini.IPC.Models;
+
+/// <summary>
+///     Describes the output region, advertised by <see cref="IPC_HID_REGION_HEADER.OutputOffset" />.
+/// </summary>
+/// <remarks>Mirrors IPC_OUTPUT_REGION_HEADER of the native include/DsHidMini/IpcOutputRing.h.</remarks>
+[StructLayout(LayoutKind.Sequential)]
+[SuppressMessage("ReSharper", "InconsistentNaming")]
+internal unsafe struct IPC_OUTPUT_REGION_HEADER
+{
+    public const uint ExpectedMagic = 0x54554F44;
+
+    public const int MaxRingDepth = 16;
+
+    /// <summary>
+    ///     <see cref="ExpectedMagic" /> once the driver initialized the region.
+    /// </summary>
+    public UInt32 Magic;
+
+    public UInt32 Version;
+
+    /// <summary>
+    ///     Size of the header in bytes.
+    /// </summary>
+    public UInt32 Size;
+
+    public UInt32 RingCount;
+
+    /// <summary>
+    ///     Offset of the first ring from the start of the header.
+    /// </summary>
+    public UInt32 RingsOffset;
+
+    /// <summary>
+    ///     Distance between two rings in bytes.
+    /// </summary>
+    public UInt32 RingStride;
+
+    /// <summary>
+    ///     Requests per ring, a power of two.
+    /// </summary>
+    public UInt32 RingDepth;
+
+    /// <summary>
+    ///     Size of <see cref="OUTPUT_REQUEST" /> in bytes.
+    /// </summary>
+    public UInt32 RequestSize;
+
+    private fixed UInt32 Reserved[8];
+}
+
+[InlineArray(IPC_OUTPUT_REGION_HEADER.MaxRingDepth)]
+[SuppressMessage("ReSharper", "InconsistentNaming")]
+internal struct IPC_OUTPUT_REQUESTS
+{
+    private OUTPUT_REQUEST _request;
+}
+
+/// <summary>
+///     Single producer, single consumer output request ring of a device.
+/// </summary>
+/// <remarks>Mirrors IPC_OUTPUT_RING of the native include/DsHidMini/IpcOutputRing.h.</remarks>
+[StructLayout(LayoutKind.Sequential)]
+[SuppressMessage("ReSharper", "InconsistentNaming")]
+internal unsafe struct IPC_OUTPUT_RING
+{
+    /// <summary>
+    ///     Number of requests ever appended, only the owner writes it.
+    /// </summary>
+    public Int32 Tail;
+
+    /// <summary>
+    ///     Process ID of the producing client, 0 if unclaimed.
+    /// </summary>
+    public Int32 OwnerProcessId;
+
+    private fixed byte TailPadding[56];
+
+    /// <summary>
+    ///     Number of requests ever consumed, only the driver writes it.
+    /// </summary>
+    public Int32 Head;
+
+    private fixed byte HeadPadding[60];
+
+    public IPC_OUTPUT_REQUESTS Requests;
+}
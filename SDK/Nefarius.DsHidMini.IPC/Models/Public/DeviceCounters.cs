@@ -0,0 +1,88 @@
+﻿using System.Diagnostics.CodeAnalysis;
+using System.Runtime.InteropServices;
+
+namespace Nefarius.DsHidMini.IPC.Models.Public;
+
+/// <summary>
+///     Performance counters of a device as maintained by the driver.
+/// </summary>
+/// <remarks>
+///     Each counter is exact on its own but a sample isn't consistent across counters; rates are the difference of two
+///     samples of the same <see cref="Generation" />.
+/// </remarks>
+[StructLayout(LayoutKind.Sequential, Size = 128)]
+[SuppressMessage("ReSharper", "InconsistentNaming")]
+public struct DEVICE_COUNTERS
+{
+    /// <summary>
+    ///     Amount of 64 bit counters this revision knows, starting at <see cref="InputReports" />.
+    /// </summary>
+    public const int CounterCount = 11;
+
+    /// <summary>
+    ///     The one-based device index these counters belong to. 0 if the device is gone, the counters then hold its final
+    ///     values until another device takes the slot.
+    /// </summary>
+    public Int32 SlotIndex;
+
+    /// <summary>
+    ///     Changes whenever another device takes the slot. Samples of different generations can't be subtracted.
+    /// </summary>
+    public Int32 Generation;
+
+    /// <summary>
+    ///     Input reports received and passed on to the HID stack and IPC readers.
+    /// </summary>
+    public long InputReports;
+
+    /// <summary>
+    ///     Input reports ignored as too short or broken.
+    /// </summary>
+    public long InputDropped;
+
+    /// <summary>
+    ///     Output reports transferred to the device.
+    /// </summary>
+    public long OutputReports;
+
+    /// <summary>
+    ///     Output reports lost due to no free queue buffer or a failed transfer.
+    /// </summary>
+    public long OutputDropped;
+
+    /// <summary>
+    ///     Output reports not sent since the output state didn't change.
+    /// </summary>
+    public long DuplicatesSuppressed;
+
+    /// <summary>
+    ///     Output reports held back by rate control.
+    /// </summary>
+    public long RateLimitDelays;
+
+    /// <summary>
+    ///     Button combos (quick disconnect, alternative rumble mode toggle) that triggered their action.
+    /// </summary>
+    public long ComboFires;
+
+    /// <summary>
+    ///     Battery status changes picked up from input reports.
+    /// </summary>
+    public long BatteryChanges;
+
+    /// <summary>
+    ///     Configuration reloads after the configuration file changed.
+    /// </summary>
+    public long ConfigReloads;
+
+    /// <summary>
+    ///     Time spent translating and publishing input reports, see
+    ///     <see cref="DsHidMiniInterop.CountersTimestampFrequency" /> for the ticks per second.
+    /// </summary>
+    public long ProcessingTicks;
+
+    /// <summary>
+    ///     Input reports not published to IPC readers since the device's slot stayed claimed.
+    /// </summary>
+    public long InputSlotSkips;
+}
@@ -0,0 +1,22 @@
+﻿using System.Diagnostics.CodeAnalysis;
+using System.Runtime.InteropServices;
+
+namespace Nefarius.DsHidMini.IPC.Models.Public;
+
+/// <summary>
+///     Timestamped input report as kept in the input history of a device.
+/// </summary>
+[StructLayout(LayoutKind.Sequential, Pack = 1, Size = 64)]
+[SuppressMessage("ReSharper", "InconsistentNaming")]
+public struct INPUT_HISTORY_ENTRY
+{
+    /// <summary>
+    ///     The time the driver processed the report at, in <see cref="System.Diagnostics.Stopwatch" /> ticks.
+    /// </summary>
+    public long Timestamp;
+
+    /// <summary>
+    ///     The <see cref="DS3_RAW_INPUT_REPORT" /> coming directly from the device with no transformations applied.
+    /// </summary>
+    public DS3_RAW_INPUT_REPORT InputReport;
+}
@@ -0,0 +1,49 @@
+﻿using System.Diagnostics.CodeAnalysis;
+using System.Runtime.InteropServices;
+
+namespace Nefarius.DsHidMini.IPC.Models.Public;
+
+/// <summary>
+///     Controller state of a device as its HID device reports it, with the configured thumb axis dead zones and axis
+///     flips applied.
+/// </summary>
+[StructLayout(LayoutKind.Sequential, Pack = 1, Size = 64)]
+[SuppressMessage("ReSharper", "InconsistentNaming")]
+public struct INPUT_STATE
+{
+    /// <summary>
+    ///     The time the driver processed the report at, in <see cref="System.Diagnostics.Stopwatch" /> ticks. Same as
+    ///     in the <see cref="INPUT_HISTORY_ENTRY" /> of the report.
+    /// </summary>
+    public long Timestamp;
+
+    /// <summary>
+    ///     Button states.
+    /// </summary>
+    public DS3_RAW_INPUT_REPORT.ButtonUnion Buttons;
+
+    /// <summary>
+    ///     Left Thumb X-axis.
+    /// </summary>
+    public byte LeftThumbX;
+
+    /// <summary>
+    ///     Left Thumb Y-axis.
+    /// </summary>
+    public byte LeftThumbY;
+
+    /// <summary>
+    ///     Right Thumb X-axis.
+    /// </summary>
+    public byte RightThumbX;
+
+    /// <summary>
+    ///     Right Thumb Y-axis.
+    /// </summary>
+    public byte RightThumbY;
+
+    /// <summary>
+    ///     Pressure button values.
+    /// </summary>
+    public DS3_RAW_INPUT_REPORT.PressureUnion Pressure;
+}
@@ -0,0 +1,121 @@
+﻿using System.Diagnostics.CodeAnalysis;
+using System.Runtime.InteropServices;
+
+namespace Nefarius.DsHidMini.IPC.Models.Public;
+
+/// <summary>
+///     Latency distribution of an output report path stage.
+/// </summary>
+/// <remarks>
+///     Bucket 0 counts samples below 250 microseconds, every following bucket doubles the upper bound, the last one
+///     is open-ended.
+/// </remarks>
+[StructLayout(LayoutKind.Sequential)]
+[SuppressMessage("ReSharper", "InconsistentNaming")]
+public unsafe struct OUTPUT_TELEMETRY_HISTOGRAM
+{
+    /// <summary>
+    ///     Amount of buckets in <see cref="Buckets" />.
+    /// </summary>
+    public const int BucketCount = 10;
+
+    /// <summary>
+    ///     Sample counts per latency bucket.
+    /// </summary>
+    public fixed long Buckets[BucketCount];
+
+    /// <summary>
+    ///     Sum of all samples in microseconds.
+    /// </summary>
+    public long TotalMicroseconds;
+
+    /// <summary>
+    ///     Highest sample in microseconds.
+    /// </summary>
+    public long MaxMicroseconds;
+}
+
+/// <summary>
+///     Output report (rumble, LEDs) path counters of a device as maintained by the driver.
+/// </summary>
+[StructLayout(LayoutKind.Sequential)]
+[SuppressMessage("ReSharper", "InconsistentNaming")]
+public struct OUTPUT_REPORT_TELEMETRY
+{
+    /// <summary>
+    ///     The one-based device index these counters belong to. 0 if the slot is unoccupied.
+    /// </summary>
+    public UInt32 SlotIndex;
+
+    /// <summary>
+    ///     Buffers currently queued or held back by rate control.
+    /// </summary>
+    public Int32 InFlight;
+
+    /// <summary>
+    ///     Highest observed value of <see cref="InFlight" />.
+    /// </summary>
+    public Int32 PeakInFlight;
+
+    internal Int32 Reserved;
+
+    /// <summary>
+    ///     Reports handed to the send queue.
+    /// </summary>
+    public long Enqueued;
+
+    /// <summary>
+    ///     Reports dropped since the output state didn't change.
+    /// </summary>
+    public long Skipped;
+
+    /// <summary>
+    ///     Reports lost due to no free queue buffer.
+    /// </summary>
+    public long EnqueueFailed;
+
+    /// <summary>
+    ///     Buffers picked up by the queue worker.
+    /// </summary>
+    public long Dequeued;
+
+    /// <summary>
+    ///     Buffers held back by rate control.
+    /// </summary>
+    public long Delayed;
+
+    /// <summary>
+    ///     Held back buffers superseded by a newer one.
+    /// </summary>
+    public long Replaced;
+
+    /// <summary>
+    ///     Held back buffers put back into the queue after the delay elapsed.
+    /// </summary>
+    public long Requeued;
+
+    /// <summary>
+    ///     Successful transfers to the device.
+    /// </summary>
+    public long Sent;
+
+    /// <summary>
+    ///     Failed transfers to the device.
+    /// </summary>
+    public long SendFailed;
+
+    /// <summary>
+    ///     Time between (re-)enqueue and dequeue.
+    /// </summary>
+    public OUTPUT_TELEMETRY_HISTOGRAM QueueTime;
+
+    /// <summary>
+    ///     Duration of the transfer to the device.
+    /// </summary>
+    public OUTPUT_TELEMETRY_HISTOGRAM SendLatency;
+
+    /// <summary>
+    ///     Time between initial enqueue and transfer completion.
+    /// </summary>
+    public OUTPUT_TELEMETRY_HISTOGRAM EndToEnd;
+}
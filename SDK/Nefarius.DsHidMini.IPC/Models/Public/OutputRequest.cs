@@ -0,0 +1,104 @@
+﻿using System.Diagnostics.CodeAnalysis;
+using System.Runtime.CompilerServices;
+using System.Runtime.InteropServices;
+
+namespace Nefarius.DsHidMini.IPC.Models.Public;
+
+/// <summary>
+///     Selects the members of an <see cref="OUTPUT_REQUEST" /> the driver applies.
+/// </summary>
+[Flags]
+[SuppressMessage("ReSharper", "InconsistentNaming")]
+public enum OUTPUT_REQUEST_FIELDS : uint
+{
+    None = 0,
+
+    /// <summary>
+    ///     <see cref="OUTPUT_REQUEST.LedFlags" />
+    /// </summary>
+    LedFlags = 0x00000001,
+
+    /// <summary>
+    ///     <see cref="OUTPUT_REQUEST.Leds" /> entry of Player 1.
+    /// </summary>
+    Led1 = 0x00000002,
+    Led2 = 0x00000004,
+    Led3 = 0x00000008,
+    Led4 = 0x00000010,
+    Leds = Led1 | Led2 | Led3 | Led4,
+
+    SmallMotorDuration = 0x00000020,
+    SmallMotorStrength = 0x00000040,
+    LargeMotorDuration = 0x00000080,
+    LargeMotorStrength = 0x00000100,
+    Motors = SmallMotorDuration | SmallMotorStrength | LargeMotorDuration | LargeMotorStrength,
+
+    All = LedFlags | Leds | Motors
+}
+
+/// <summary>
+///     Properties of a single Player LED.
+/// </summary>
+[StructLayout(LayoutKind.Sequential, Pack = 1)]
+[SuppressMessage("ReSharper", "InconsistentNaming")]
+public struct OUTPUT_REQUEST_LED
+{
+    public UInt16 BasePortionDuration;
+
+    public byte TotalDuration;
+
+    public byte OffPortionMultiplier;
+
+    public byte OnPortionMultiplier;
+
+    internal byte Reserved;
+}
+
+[InlineArray(4)]
+[SuppressMessage("ReSharper", "InconsistentNaming")]
+public struct OUTPUT_REQUEST_LEDS
+{
+    private OUTPUT_REQUEST_LED _led;
+}
+
+/// <summary>
+///     Desired output state of a device, submitted via <see cref="DsHidMiniInterop.TrySendOutputRequest" />.
+/// </summary>
+/// <remarks>Mirrors IPC_OUTPUT_REQUEST of the native include/DsHidMini/IpcOutputRing.h.</remarks>
+[StructLayout(LayoutKind.Sequential, Size = 40)]
+[SuppressMessage("ReSharper", "InconsistentNaming")]
+public struct OUTPUT_REQUEST
+{
+    /// <summary>
+    ///     Members to apply, the rest of the output state stays untouched.
+    /// </summary>
+    public OUTPUT_REQUEST_FIELDS Fields;
+
+    /// <summary>
+    ///     Player LED enable bits, 0x02 is Player 1.
+    /// </summary>
+    public byte LedFlags;
+
+    public byte SmallMotorDuration;
+
+    /// <summary>
+    ///     Right (light) motor, on/off only.
+    /// </summary>
+    public byte SmallMotorStrength;
+
+    public byte LargeMotorDuration;
+
+    /// <summary>
+    ///     Left (heavy) motor, subject to the rumble settings of the device.
+    /// </summary>
+    public byte LargeMotorStrength;
+
+    private byte _reserved0;
+    private byte _reserved1;
+    private byte _reserved2;
+
+    /// <summary>
+    ///     Index 0 is Player 1.
+    /// </summary>
+    public OUTPUT_REQUEST_LEDS Leds;
+}
@@ -195,6 +195,92 @@ ConfigParseButtonComboSettings(
 }
 #pragma warning(pop)
 
+//
+// Gets the lButtons bits of an enabled combo, 0 if disabled
+// 
+static ULONG ConfigButtonComboMask(_In_ const DS_BUTTON_COMBO* Combo)
+{
+	ULONG mask = 0;
+
+	if (!Combo->IsEnabled)
+	{
+		return 0;
+	}
+
+	for (ULONGLONG buttonIndex = 0; buttonIndex < _countof(Combo->Buttons); buttonIndex++)
+	{
+		mask |= 1UL << Combo->Buttons[buttonIndex];
+	}
+
+	return mask;
+}
+
+#pragma region Hashing
+
+#define CONFIG_HASH_OFFSET_BASIS	0xCBF29CE484222325ULL
+#define CONFIG_HASH_PRIME			0x100000001B3ULL
+
+//
+// FNV-1a, continues from Hash
+// 
+static ULONGLONG ConfigHashBytes(_In_ ULONGLONG Hash, _In_reads_bytes_(Length) const VOID* Buffer, _In_ SIZE_T Length)
+{
+	const UCHAR* bytes = (const UCHAR*)Buffer;
+
+	for (SIZE_T index = 0; index < Length; index++)
+	{
+		Hash ^= bytes[index];
+		Hash *= CONFIG_HASH_PRIME;
+	}
+
+	return Hash;
+}
+
+static ULONGLONG ConfigHashString(_In_ ULONGLONG Hash, _In_opt_ const char* String)
+{
+	//
+	// Terminator included so neighbouring strings can't run into each other
+	// 
+	return String ? ConfigHashBytes(Hash, String, strlen(String) + 1) : ConfigHashBytes(Hash, "", 1);
+}
+
+//
+// Hashes a node with its name and all children, formatting of the file doesn't matter
+// 
+static ULONGLONG ConfigHashNode(_In_ ULONGLONG Hash, _In_opt_ const cJSON* Node)
+{
+	if (Node == NULL)
+	{
+		return ConfigHashBytes(Hash, "", 1);
+	}
+
+	const int type = Node->type & 0xFF;
+
+	Hash = ConfigHashBytes(Hash, &type, sizeof(type));
+	Hash = ConfigHashString(Hash, Node->string);
+
+	if (cJSON_IsString(Node))
+	{
+		Hash = ConfigHashString(Hash, Node->valuestring);
+	}
+	else if (cJSON_IsNumber(Node))
+	{
+		Hash = ConfigHashBytes(Hash, &Node->valuedouble, sizeof(Node->valuedouble));
+	}
+
+	for (const cJSON* child = Node->child; child != NULL; child = child->next)
+	{
+		Hash = ConfigHashNode(Hash, child);
+	}
+
+	//
+	// Marks the end of the children
+	// 
+	return ConfigHashBytes(Hash, &type, sizeof(type));
+}
+
+#pragma endregion
+
 #pragma region Parsers
 
 //
@@ -532,6 +618,18 @@ static void ConfigNodeParse(
 		EventWriteOverrideSettingUInt(ParentNode->string, "OutputRateControlPeriodMs", pCfg->OutputRateControlPeriodMs);
 	}
 
+	if ((pNode = cJSON_GetObjectItem(ParentNode, "FFBCoalescingWindowMs")))
+	{
+		pCfg->FFBCoalescingWindowMs = (UCHAR)cJSON_GetNumberValue(pNode);
+		EventWriteOverrideSettingUInt(ParentNode->string, "FFBCoalescingWindowMs", pCfg->FFBCoalescingWindowMs);
+	}
+
+	if ((pNode = cJSON_GetObjectItem(ParentNode, "IsFFBRecordingEnabled")))
+	{
+		pCfg->IsFFBRecordingEnabled = (BOOLEAN)cJSON_IsTrue(pNode);
+		EventWriteOverrideSettingUInt(ParentNode->string, "IsFFBRecordingEnabled", pCfg->IsFFBRecordingEnabled);
+	}
+
 	if ((pNode = cJSON_GetObjectItem(ParentNode, "WirelessIdleTimeoutPeriodMs")))
 	{
 		pCfg->WirelessIdleTimeoutPeriodMs = (ULONG)cJSON_GetNumberValue(pNode);
@@ -667,129 +765,90 @@ static void ConfigNodeParse(
 #pragma endregion
 
 //
-// Load/refresh device-specific overrides
+// Gets the parsed configuration file content, only reads and parses the file if it
+// changed since the last device loaded it. Release with ConfigCacheRelease.
 // 
 _Must_inspect_result_
+static
 NTSTATUS
-ConfigLoadForDevice(
-	_Inout_ PDEVICE_CONTEXT Context,
-	_In_opt_ BOOLEAN IsHotReload
+ConfigCacheAcquire(
+	_In_ HANDLE FileHandle,
+	_Out_ PDS_CONFIG_CACHE_ENTRY* Entry
 )
 {
+	const PDSHM_DRIVER_CONTEXT driverContext = DriverGetContext(WdfGetDriver());
 	NTSTATUS status = STATUS_SUCCESS;
-	CHAR programDataPath[MAX_PATH];
-	CHAR configFilePath[MAX_PATH];
-	HANDLE hFile = NULL;
+	BY_HANDLE_FILE_INFORMATION info;
+	PDS_CONFIG_CACHE_ENTRY entry = NULL;
 	PCHAR content = NULL;
-	cJSON* config_json = NULL;
-	LARGE_INTEGER size = { 0 };
 
-	FuncEntry(TRACE_CONFIG);
-
-	if (!IsHotReload)
-	{
-		ConfigSetDefaults(&Context->Configuration);
-	}
+	*Entry = NULL;
 
-	do
+	if (!GetFileInformationByHandle(FileHandle, &info))
 	{
-		if (GetEnvironmentVariableA(
-			CONFIG_ENV_VAR_NAME,
-			programDataPath,
-			MAX_PATH
-		) == 0)
-		{
-			status = STATUS_NOT_FOUND;
-			break;
-		}
+		const DWORD error = GetLastError();
 
-		TraceVerbose(
+		TraceError(
 			TRACE_CONFIG,
-			"Expanded environment variable to %s",
-			programDataPath
+			"Failed to get configuration file information, error: %!WINERROR!",
+			error
 		);
+		EventWriteFailedWithWin32Error(__FUNCTION__, L"Getting configuration file information", error);
 
-		if (sprintf_s(
-			configFilePath,
-			MAX_PATH / sizeof(WCHAR),
-			"%s\\%s\\%s",
-			programDataPath,
-			CONFIG_SUB_DIR_NAME,
-			CONFIG_FILE_NAME
-		) == -1)
-		{
-			status = STATUS_BUFFER_OVERFLOW;
-			break;
-		}
-
-		TraceVerbose(
-			TRACE_CONFIG,
-			"Set config file path to %s",
-			configFilePath
-		);
+		return STATUS_ACCESS_DENIED;
+	}
 
-		hFile = CreateFileA(configFilePath,
-			GENERIC_READ,
-			FILE_SHARE_READ,
-			NULL,
-			OPEN_EXISTING,
-			FILE_ATTRIBUTE_NORMAL,
-			NULL
-		);
+	const ULONGLONG fileIndex = ((ULONGLONG)info.nFileIndexHigh << 32) | info.nFileIndexLow;
+	const ULONGLONG size = ((ULONGLONG)info.nFileSizeHigh << 32) | info.nFileSizeLow;
 
-		DWORD error = GetLastError();
+	TraceVerbose(
+		TRACE_CONFIG,
+		"File size in bytes: %I64u",
+		size
+	);
 
-		if (hFile == INVALID_HANDLE_VALUE)
-		{
-			TraceError(
-				TRACE_CONFIG,
-				"Configuration file %s not accessible, error: %!WINERROR!",
-				configFilePath,
-				error
-			);
-			EventWriteFailedWithWin32Error(__FUNCTION__, L"Reading configuration file", error);
+	WdfWaitLockAcquire(driverContext->ConfigCache.Lock, NULL);
 
-			status = STATUS_ACCESS_DENIED;
-			break;
-		}
+	do
+	{
+		entry = driverContext->ConfigCache.Current;
 
-		if (!GetFileSizeEx(hFile, &size))
+		//
+		// Same file with same size and last write time, content didn't change
+		// 
+		if (entry != NULL
+			&& entry->VolumeSerialNumber == info.dwVolumeSerialNumber
+			&& entry->FileIndex == fileIndex
+			&& entry->Size == size
+			&& CompareFileTime(&entry->LastWriteTime, &info.ftLastWriteTime) == 0)
 		{
-			error = GetLastError();
-
-			TraceError(
+			TraceVerbose(
 				TRACE_CONFIG,
-				"Failed to get configuration file size, error: %!WINERROR!",
-				error
+				"Configuration file unchanged, using cached content"
 			);
-			EventWriteFailedWithWin32Error(__FUNCTION__, L"Getting configuration file size", error);
 
-			status = STATUS_ACCESS_DENIED;
+			InterlockedIncrement(&entry->RefCount);
 			break;
 		}
 
-		TraceVerbose(
-			TRACE_CONFIG,
-			"File size in bytes: %Iu64",
-			(size_t)size.QuadPart
-		);
+		entry = NULL;
 
 		//
 		// Protection against nonsense
 		// 
-		if (size.QuadPart > 20000000 /* 20 MB of JSON, w00t?! */)
+		if (size > 20000000 /* 20 MB of JSON, w00t?! */)
 		{
 			TraceError(
 				TRACE_CONFIG,
-				"Configuration file too big to parse, reported size: %I64d",
-				size.QuadPart
+				"Configuration file too big to parse, reported size: %I64u",
+				size
 			);
 			EventWriteFailedWithWin32Error(__FUNCTION__, L"Reading configuration file", ERROR_BUFFER_OVERFLOW);
 			status = STATUS_BUFFER_OVERFLOW;
 			break;
 		}
 
-		content = (char*)calloc((size_t)size.QuadPart, sizeof(char));
+		content = (char*)calloc((size_t)size, sizeof(char));
 
 		if (content == NULL)
 		{
@@ -799,9 +858,9 @@ ConfigLoadForDevice(
 
 		DWORD bytesRead = 0;
 
-		if (!ReadFile(hFile, content, (DWORD)size.QuadPart, &bytesRead, NULL))
+		if (!ReadFile(FileHandle, content, (DWORD)size, &bytesRead, NULL))
 		{
-			error = GetLastError();
+			const DWORD error = GetLastError();
 
 			TraceError(
 				TRACE_CONFIG,
@@ -813,168 +872,962 @@ ConfigLoadForDevice(
 			break;
 		}
 
-		config_json = cJSON_ParseWithLength(content, size.QuadPart);
-
-		if (config_json == NULL)
-		{
-			TraceError(
-				TRACE_CONFIG,
-				"JSON parsing failed"
-			);
-
-			const char* error_ptr = cJSON_GetErrorPtr();
-			if (error_ptr != NULL)
-			{
-				TraceError(
-					TRACE_CONFIG,
-					"JSON parsing error: %s",
-					error_ptr
-				);
-				EventWriteJSONParseError(error_ptr);
-			}
+		const ULONGLONG contentHash = ConfigHashBytes(CONFIG_HASH_OFFSET_BASIS, content, bytesRead);
 
-			status = STATUS_ACCESS_VIOLATION;
-			break;
-		}
+		entry = driverContext->ConfigCache.Current;
 
 		//
-		// Read global configuration first, then overwrite device-specific ones
+		// Touched or saved again without changes, keep the parsed document
 		// 
-		const cJSON* globalNode = cJSON_GetObjectItem(config_json, "Global");
-
-		if (globalNode)
+		if (entry != NULL && entry->ContentHash == contentHash)
 		{
 			TraceVerbose(
 				TRACE_CONFIG,
-				"Loading global configuration"
+				"Configuration file content unchanged, using cached content"
 			);
 
-			ConfigNodeParse(globalNode, Context, IsHotReload);
+			entry->VolumeSerialNumber = info.dwVolumeSerialNumber;
+			entry->FileIndex = fileIndex;
+			entry->Size = size;
+			entry->LastWriteTime = info.ftLastWriteTime;
+
+			InterlockedIncrement(&entry->RefCount);
+			break;
 		}
 
-		const cJSON* devicesNode = cJSON_GetObjectItem(config_json, "Devices");
+		entry = (PDS_CONFIG_CACHE_ENTRY)calloc(1, sizeof(DS_CONFIG_CACHE_ENTRY));
 
-		if (!devicesNode)
+		if (entry == NULL)
 		{
+			status = STATUS_NO_MEMORY;
 			break;
 		}
 
+		entry->VolumeSerialNumber = info.dwVolumeSerialNumber;
+		entry->FileIndex = fileIndex;
+		entry->Size = size;
+		entry->LastWriteTime = info.ftLastWriteTime;
+		entry->ContentHash = contentHash;
+		entry->Root = cJSON_ParseWithLength(content, bytesRead);
+
 		//
-		// Try to read device-specific properties
+		// Invalid content gets cached as well so it's reported once and not by every device
 		// 
-		const cJSON* deviceNode = cJSON_GetObjectItem(devicesNode, Context->DeviceAddressString);
-
-		if (deviceNode)
+		if (entry->Root == NULL)
 		{
-			TraceVerbose(
+			TraceError(
 				TRACE_CONFIG,
-				"Found device-specific (%s) config, loading",
-				Context->DeviceAddressString
+				"JSON parsing failed"
 			);
 
-			EventWriteLoadingDeviceSpecificConfig(Context->DeviceAddressString);
-
-			ConfigNodeParse(deviceNode, Context, IsHotReload);
-		}
-		else
-		{
-			TraceVerbose(
-				TRACE_CONFIG,
-				"Device-specific (%s) config not found",
-				Context->DeviceAddressString
-			);
+			const char* error_ptr = cJSON_GetErrorPtr();
+			if (error_ptr != NULL)
+			{
+				TraceError(
+					TRACE_CONFIG,
+					"JSON parsing error: %s",
+					error_ptr
+				);
+				EventWriteJSONParseError(error_ptr);
+			}
 		}
 
-	} while (FALSE);
-
-	//
-	// Verify if desired new range for heavy rumbling rescale is valid and attempt to calculate rescaling constants if so
-	// 
-	const DS_RUMBLE_SETTINGS* rumbSet = &Context->Configuration.RumbleSettings;
+		//
+		// One reference for the driver, one for the caller
+		// 
+		entry->RefCount = 2;
 
-	if (
-		rumbSet->AlternativeMode.MaxRange > rumbSet->AlternativeMode.MinRange
-		&& rumbSet->AlternativeMode.MinRange > 0
-		)
-	{
-		Context->RumbleControlState.AltMode.IsEnabled = rumbSet->AlternativeMode.IsEnabled;
+		ConfigCacheRelease(driverContext->ConfigCache.Current);
+		driverContext->ConfigCache.Current = entry;
 
-		const DOUBLE LConstA = (DOUBLE)(rumbSet->AlternativeMode.MaxRange - rumbSet->AlternativeMode.MinRange) / (254);
-		const DOUBLE LConstB = rumbSet->AlternativeMode.MaxRange - LConstA * 255;
+	} while (FALSE);
 
-		Context->RumbleControlState.AltMode.LightRescale.ConstA = LConstA;
-		Context->RumbleControlState.AltMode.LightRescale.ConstB = LConstB;
-		Context->RumbleControlState.AltMode.LightRescale.IsAllowed = TRUE;
+	WdfWaitLockRelease(driverContext->ConfigCache.Lock);
 
-		TraceVerbose(
-			TRACE_CONFIG,
-			"Light rumble rescaling constants: A = %f and B = %f.",
-			Context->RumbleControlState.AltMode.LightRescale.ConstA,
-			Context->RumbleControlState.AltMode.LightRescale.ConstB
-		);
-	}
-	else
+	if (content)
 	{
-		TraceVerbose(
-			TRACE_CONFIG,
-			"Disallowing light rumble rescaling because an invalid range was defined"
-		);
-		Context->RumbleControlState.AltMode.LightRescale.IsAllowed = FALSE;
+		free(content);
 	}
 
-	//
-	// Verify if desired new range for light rumbling rescale when in alternative mode is valid and attempt to calculate rescaling constants if so
-	// 
-	if (
-		rumbSet->HeavyRescaling.MaxRange > rumbSet->HeavyRescaling.MinRange
-		&& rumbSet->HeavyRescaling.MinRange > 0
-		)
+	if (!NT_SUCCESS(status))
 	{
-		Context->RumbleControlState.HeavyRescaleEnabled = rumbSet->HeavyRescaling.IsEnabled;
+		if (entry)
+		{
+			free(entry);
+		}
 
-		const DOUBLE HConstA = (DOUBLE)(rumbSet->HeavyRescaling.MaxRange - rumbSet->HeavyRescaling.MinRange) / (254);
-		const DOUBLE HConstB = rumbSet->HeavyRescaling.MaxRange - HConstA * 255;
+		return status;
+	}
 
-		Context->RumbleControlState.HeavyRescale.ConstA = HConstA;
-		Context->RumbleControlState.HeavyRescale.ConstB = HConstB;
-		Context->RumbleControlState.HeavyRescale.IsAllowed = TRUE;
+	*Entry = entry;
 
-		TraceVerbose(
-			TRACE_CONFIG,
-			"Heavy rumble rescaling constants:  A = %f and B = %f.",
-			Context->RumbleControlState.HeavyRescale.ConstA,
-			Context->RumbleControlState.HeavyRescale.ConstB
-		);
-	}
-	else
-	{
-		TraceVerbose(
-			TRACE_CONFIG,
-			"Disallowing heavy rumble rescalling because an invalid range was defined"
-		);
-		Context->RumbleControlState.HeavyRescale.IsAllowed = FALSE;
-	}
+	return status;
+}
 
-	if (config_json)
+//
+// Drops a reference to a shared configuration, the last one frees it
+// 
+VOID
+ConfigCacheRelease(
+	_In_opt_ PDS_CONFIG_CACHE_ENTRY Entry
+)
+{
+	if (Entry == NULL)
 	{
-		cJSON_Delete(config_json);
+		return;
 	}
 
-	if (content)
+	if (InterlockedDecrement(&Entry->RefCount) > 0)
 	{
-		free(content);
+		return;
 	}
 
-	if (hFile != INVALID_HANDLE_VALUE)
+	if (Entry->Root)
 	{
-		CloseHandle(hFile);
+		cJSON_Delete(Entry->Root);
 	}
 
-	FuncExit(TRACE_CONFIG, "status=%!STATUS!", status);
-
-	return status;
+	free(Entry);
 }
 
+//
+// Gets the configuration file content shared by all devices, release with ConfigCacheRelease
+// 
+_Must_inspect_result_
+NTSTATUS
+ConfigLoadShared(
+	_Out_ PDS_CONFIG_CACHE_ENTRY* Entry
+)
+{
+	NTSTATUS status = STATUS_SUCCESS;
+	CHAR programDataPath[MAX_PATH];
+	CHAR configFilePath[MAX_PATH];
+	HANDLE hFile = INVALID_HANDLE_VALUE;
+
+	FuncEntry(TRACE_CONFIG);
+
+	*Entry = NULL;
+
+	do
+	{
+		if (GetEnvironmentVariableA(
+			CONFIG_ENV_VAR_NAME,
+			programDataPath,
+			MAX_PATH
+		) == 0)
+		{
+			status = STATUS_NOT_FOUND;
+			break;
+		}
+
+		TraceVerbose(
+			TRACE_CONFIG,
+			"Expanded environment variable to %s",
+			programDataPath
+		);
+
+		if (sprintf_s(
+			configFilePath,
+			MAX_PATH / sizeof(WCHAR),
+			"%s\\%s\\%s",
+			programDataPath,
+			CONFIG_SUB_DIR_NAME,
+			CONFIG_FILE_NAME
+		) == -1)
+		{
+			status = STATUS_BUFFER_OVERFLOW;
+			break;
+		}
+
+		TraceVerbose(
+			TRACE_CONFIG,
+			"Set config file path to %s",
+			configFilePath
+		);
+
+		hFile = CreateFileA(configFilePath,
+			GENERIC_READ,
+			FILE_SHARE_READ,
+			NULL,
+			OPEN_EXISTING,
+			FILE_ATTRIBUTE_NORMAL,
+			NULL
+		);
+
+		DWORD error = GetLastError();
+
+		if (hFile == INVALID_HANDLE_VALUE)
+		{
+			TraceError(
+				TRACE_CONFIG,
+				"Configuration file %s not accessible, error: %!WINERROR!",
+				configFilePath,
+				error
+			);
+			EventWriteFailedWithWin32Error(__FUNCTION__, L"Reading configuration file", error);
+
+			status = STATUS_ACCESS_DENIED;
+			break;
+		}
+
+		status = ConfigCacheAcquire(hFile, Entry);
+
+	} while (FALSE);
+
+	if (hFile != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(hFile);
+	}
+
+	FuncExit(TRACE_CONFIG, "status=%!STATUS!", status);
+
+	return status;
+}
+
+//
+// Waits until no read section can still see a replaced snapshot
+// 
+static
+VOID
+ConfigSnapshotSynchronize(
+	_In_ PDEVICE_CONTEXT Context
+)
+{
+	//
+	// New sections count on the other counter after each flip, so the old one
+	// drains. Twice, since a reader might have picked its counter just before
+	// the first flip and still be in the middle of incrementing it.
+	// 
+	for (ULONG phase = 0; phase < 2; phase++)
+	{
+		const LONG epoch = InterlockedXor(&Context->ConfigSnapshot.Epoch, 1) & 1;
+
+		while (ReadAcquire(&Context->ConfigSnapshot.Readers[epoch]) != 0)
+		{
+			SwitchToThread();
+		}
+	}
+}
+
+//
+// Compiles the loaded configuration and the state derived from it into a new
+// snapshot, publishes it and frees the replaced one once no reader can see
+// it anymore. Caller holds ConfigurationLock and no read section.
+// 
+NTSTATUS
+ConfigPublishForDevice(
+	_Inout_ PDEVICE_CONTEXT Context
+)
+{
+	FuncEntry(TRACE_CONFIG);
+
+	const PDS_CONFIG_SNAPSHOT snapshot = (PDS_CONFIG_SNAPSHOT)calloc(1, sizeof(DS_CONFIG_SNAPSHOT));
+
+	if (snapshot == NULL)
+	{
+		TraceError(
+			TRACE_CONFIG,
+			"Allocating configuration snapshot failed, keeping the previous one"
+		);
+
+		FuncExit(TRACE_CONFIG, "status=%!STATUS!", STATUS_NO_MEMORY);
+
+		return STATUS_NO_MEMORY;
+	}
+
+	RtlCopyMemory(&snapshot->Configuration, &Context->Configuration, sizeof(DS_DRIVER_CONFIGURATION));
+
+	const DS_RUMBLE_SETTINGS* rumbSet = &snapshot->Configuration.RumbleSettings;
+	DOUBLE HConstA = 0, HConstB = 0, LConstA = 0, LConstB = 0;
+
+	//
+	// Verify if desired new range for heavy rumbling rescale is valid and attempt to calculate rescaling constants if so
+	// 
+	if (
+		rumbSet->HeavyRescaling.MaxRange > rumbSet->HeavyRescaling.MinRange
+		&& rumbSet->HeavyRescaling.MinRange > 0
+		)
+	{
+		HConstA = (DOUBLE)(rumbSet->HeavyRescaling.MaxRange - rumbSet->HeavyRescaling.MinRange) / (254);
+		HConstB = rumbSet->HeavyRescaling.MaxRange - HConstA * 255;
+
+		snapshot->HeavyRescale.IsAllowed = TRUE;
+
+		TraceVerbose(
+			TRACE_CONFIG,
+			"Heavy rumble rescaling constants:  A = %f and B = %f.",
+			HConstA,
+			HConstB
+		);
+	}
+	else
+	{
+		TraceVerbose(
+			TRACE_CONFIG,
+			"Disallowing heavy rumble rescalling because an invalid range was defined"
+		);
+	}
+
+	//
+	// Verify if desired new range for light rumbling rescale when in alternative mode is valid and attempt to calculate rescaling constants if so
+	// 
+	if (
+		rumbSet->AlternativeMode.MaxRange > rumbSet->AlternativeMode.MinRange
+		&& rumbSet->AlternativeMode.MinRange > 0
+		)
+	{
+		LConstA = (DOUBLE)(rumbSet->AlternativeMode.MaxRange - rumbSet->AlternativeMode.MinRange) / (254);
+		LConstB = rumbSet->AlternativeMode.MaxRange - LConstA * 255;
+
+		snapshot->LightRescale.IsAllowed = TRUE;
+
+		TraceVerbose(
+			TRACE_CONFIG,
+			"Light rumble rescaling constants: A = %f and B = %f.",
+			LConstA,
+			LConstB
+		);
+	}
+	else
+	{
+		TraceVerbose(
+			TRACE_CONFIG,
+			"Disallowing light rumble rescaling because an invalid range was defined"
+		);
+	}
+
+	//
+	// Bake rescaling into lookup tables so rumble updates don't need any floating point math
+	// 
+	// LINEAR RANGE RESCALLING
+	// 
+	// To rescale a value that exists in a range into a new range:
+	// newvalue = a * value + b
+	//
+	// a = (max'-min')/(max-min)
+	// b = max' - a * max
+	//
+	// In which max and min are the limits of the the original range
+	// For the DS3 rumble, it's max = 255 and min = 1 since 0 is not considered.
+	// 
+	// max' and min' are the limits of the new range
+	// 0 is not considered for the new range too regarding rumble
+	//
+	// In alternative mode the light motor strength gets rescaled and then merged into the
+	// heavy motor (which gets rescaled once more), so the light table maps straight to the
+	// final heavy motor strength. Heavy rescaling is monotonic, so the merge boils down to
+	// taking the maximum of both table entries.
+	// 
+	const BOOLEAN isHeavyRescaled = rumbSet->HeavyRescaling.IsEnabled
+		&& snapshot->HeavyRescale.IsAllowed;
+
+	for (ULONG value = 0; value <= UCHAR_MAX; value++)
+	{
+		DOUBLE heavyRumble = value;
+		DOUBLE lightRumble = 0;
+
+		if (value > 0 && isHeavyRescaled)
+		{
+			heavyRumble = HConstA * value + HConstB;
+		}
+
+		if (value > 0 && snapshot->LightRescale.IsAllowed)
+		{
+			lightRumble = LConstA * value + LConstB;
+
+			if (isHeavyRescaled)
+			{
+				lightRumble = HConstA * lightRumble + HConstB;
+			}
+		}
+
+		snapshot->HeavyRescale.Table[value] = (UCHAR)heavyRumble;
+		snapshot->LightRescale.Table[value] = (UCHAR)lightRumble;
+	}
+
+	//
+	// Disabled thresholds can never be reached
+	// 
+	snapshot->ForcedRightHeavyThreshold =
+		rumbSet->AlternativeMode.ForcedRight.IsHeavyThresholdEnabled
+		? rumbSet->AlternativeMode.ForcedRight.HeavyThreshold
+		: UCHAR_MAX + 1;
+	snapshot->ForcedRightLightThreshold =
+		rumbSet->AlternativeMode.ForcedRight.IsLightThresholdEnabled
+		? rumbSet->AlternativeMode.ForcedRight.LightThreshold
+		: UCHAR_MAX + 1;
+
+	//
+	// Combos are engaged once all of their buttons are held
+	// 
+	snapshot->WirelessDisconnectComboMask = ConfigButtonComboMask(&snapshot->Configuration.WirelessDisconnectButtonCombo);
+	snapshot->AltModeToggleComboMask = ConfigButtonComboMask(&rumbSet->AlternativeMode.ToggleButtonCombo);
+
+	const PDS_CONFIG_SNAPSHOT previous = (PDS_CONFIG_SNAPSHOT)InterlockedExchangePointer(
+		(PVOID volatile*)&Context->ConfigSnapshot.Current,
+		snapshot
+	);
+
+	if (previous)
+	{
+		ConfigSnapshotSynchronize(Context);
+
+		free(previous);
+	}
+
+	FuncExit(TRACE_CONFIG, "status=%!STATUS!", STATUS_SUCCESS);
+
+	return STATUS_SUCCESS;
+}
+
+//
+// Publishes the default configuration so readers always find a snapshot
+// 
+NTSTATUS
+ConfigInitForDevice(
+	_Inout_ PDEVICE_CONTEXT Context
+)
+{
+	WdfWaitLockAcquire(Context->ConfigurationLock, NULL);
+
+	ConfigSetDefaults(&Context->Configuration);
+
+	const NTSTATUS status = ConfigPublishForDevice(Context);
+
+	WdfWaitLockRelease(Context->ConfigurationLock);
+
+	return status;
+}
+
+//
+// Frees the published snapshot, no read section may be left
+// 
+VOID
+ConfigFreeForDevice(
+	_Inout_ PDEVICE_CONTEXT Context
+)
+{
+	const PDS_CONFIG_SNAPSHOT snapshot = (PDS_CONFIG_SNAPSHOT)InterlockedExchangePointer(
+		(PVOID volatile*)&Context->ConfigSnapshot.Current,
+		NULL
+	);
+
+	if (snapshot)
+	{
+		free(snapshot);
+	}
+}
+
+//
+// Applies global and device-specific overrides of the shared configuration and
+// publishes them. A hot-reload only applies what changed for this device and
+// keeps the current settings if there's no valid configuration.
+// 
+NTSTATUS
+ConfigApplyForDevice(
+	_Inout_ PDEVICE_CONTEXT Context,
+	_In_opt_ const DS_CONFIG_CACHE_ENTRY* Config,
+	_In_ BOOLEAN IsHotReload,
+	_Out_opt_ PBOOLEAN IsChanged
+)
+{
+	NTSTATUS status = STATUS_SUCCESS;
+	BOOLEAN isChanged = !IsHotReload;
+	const cJSON* globalNode = NULL;
+	const cJSON* deviceNode = NULL;
+
+	FuncEntry(TRACE_CONFIG);
+
+	WdfWaitLockAcquire(Context->ConfigurationLock, NULL);
+
+	do
+	{
+		if (Config == NULL)
+		{
+			break;
+		}
+
+		const cJSON* config_json = Config->Root;
+
+		if (config_json == NULL)
+		{
+			status = STATUS_ACCESS_VIOLATION;
+			break;
+		}
+
+		//
+		// Same file content as applied last, nothing to do
+		// 
+		if (IsHotReload && Config->ContentHash == Context->ConfigurationHash.Content)
+		{
+			break;
+		}
+
+		globalNode = cJSON_GetObjectItem(config_json, "Global");
+
+		const cJSON* devicesNode = cJSON_GetObjectItem(config_json, "Devices");
+
+		if (devicesNode)
+		{
+			deviceNode = cJSON_GetObjectItem(devicesNode, Context->DeviceAddressString);
+		}
+
+		const ULONGLONG nodesHash = ConfigHashNode(
+			ConfigHashNode(CONFIG_HASH_OFFSET_BASIS, globalNode),
+			deviceNode
+		);
+
+		Context->ConfigurationHash.Content = Config->ContentHash;
+
+		//
+		// Changes elsewhere in the file, like other devices, don't concern this one
+		// 
+		if (IsHotReload && nodesHash == Context->ConfigurationHash.Nodes)
+		{
+			break;
+		}
+
+		Context->ConfigurationHash.Nodes = nodesHash;
+		isChanged = TRUE;
+
+	} while (FALSE);
+
+	if (isChanged)
+	{
+		if (!IsHotReload)
+		{
+			ConfigSetDefaults(&Context->Configuration);
+		}
+
+		//
+		// Read global configuration first, then overwrite device-specific ones
+		// 
+		if (globalNode)
+		{
+			TraceVerbose(
+				TRACE_CONFIG,
+				"Loading global configuration"
+			);
+
+			ConfigNodeParse(globalNode, Context, IsHotReload);
+		}
+
+		if (deviceNode)
+		{
+			TraceVerbose(
+				TRACE_CONFIG,
+				"Found device-specific (%s) config, loading",
+				Context->DeviceAddressString
+			);
+
+			EventWriteLoadingDeviceSpecificConfig(Context->DeviceAddressString);
+
+			ConfigNodeParse(deviceNode, Context, IsHotReload);
+		}
+		else
+		{
+			TraceVerbose(
+				TRACE_CONFIG,
+				"Device-specific (%s) config not found",
+				Context->DeviceAddressString
+			);
+		}
+
+		//
+		// Alternative rumble mode starts over as configured
+		// 
+		const DS_RUMBLE_SETTINGS* rumbSet = &Context->Configuration.RumbleSettings;
+
+		if (rumbSet->AlternativeMode.MaxRange > rumbSet->AlternativeMode.MinRange
+			&& rumbSet->AlternativeMode.MinRange > 0)
+		{
+			Context->RumbleControlState.AltMode.IsEnabled = rumbSet->AlternativeMode.IsEnabled;
+		}
+
+		const NTSTATUS publishStatus = ConfigPublishForDevice(Context);
+
+		if (NT_SUCCESS(status))
+		{
+			status = publishStatus;
+		}
+
+		//
+		// Custom LED pattern only changes here, bake it into the output state once
+		// 
+		DS3_APPLY_LED_SETTINGS(Context);
+	}
+	else
+	{
+		TraceVerbose(
+			TRACE_CONFIG,
+			"Configuration for device %s unchanged",
+			Context->DeviceAddressString
+		);
+	}
+
+	WdfWaitLockRelease(Context->ConfigurationLock);
+
+	if (IsChanged)
+	{
+		*IsChanged = isChanged;
+	}
+
+	FuncExit(TRACE_CONFIG, "status=%!STATUS!", status);
+
+	return status;
+}
+
+//
+// Load/refresh device-specific overrides
+// 
+_Must_inspect_result_
+NTSTATUS
+ConfigLoadForDevice(
+	_Inout_ PDEVICE_CONTEXT Context,
+	_In_opt_ BOOLEAN IsHotReload
+)
+{
+	PDS_CONFIG_CACHE_ENTRY config = NULL;
+
+	FuncEntry(TRACE_CONFIG);
+
+	NTSTATUS status = ConfigLoadShared(&config);
+	const NTSTATUS applyStatus = ConfigApplyForDevice(Context, config, IsHotReload, NULL);
+
+	if (NT_SUCCESS(status))
+	{
+		status = applyStatus;
+	}
+
+	ConfigCacheRelease(config);
+
+	FuncExit(TRACE_CONFIG, "status=%!STATUS!", status);
+
+	return status;
+}
+
+#pragma region Hot-reload
+
+//
+// Gets invoked when something got written to the configuration directory
+// 
+static
+VOID CALLBACK
+ConfigWatcherChangeCallback(
+	_In_ PVOID   lpParameter,
+	_In_ BOOLEAN TimerOrWaitFired
+)
+{
+	const PDSHM_DRIVER_CONTEXT driverContext = (PDSHM_DRIVER_CONTEXT)lpParameter;
+	LARGE_INTEGER dueTime;
+	FILETIME dueFileTime;
+
+	UNREFERENCED_PARAMETER(TimerOrWaitFired);
+
+	FindNextChangeNotification(driverContext->ConfigWatcher.ChangeEvent);
+
+	//
+	// Saving a file usually fires a burst of changes and the writing application
+	// might still hold the file locked, so every change pushes the reload back
+	// until the directory stayed quiet for a bit
+	// 
+	dueTime.QuadPart = -(LONGLONG)CONFIG_HOT_RELOAD_DELAY_MS * 10000;
+	dueFileTime.dwLowDateTime = dueTime.LowPart;
+	dueFileTime.dwHighDateTime = (DWORD)dueTime.HighPart;
+
+	SetThreadpoolTimer(driverContext->ConfigWatcher.DebounceTimer, &dueFileTime, 0, 0);
+}
+
+//
+// Gets invoked once the configuration directory settled, parses the file once for all devices
+// 
+static
+VOID CALLBACK
+ConfigWatcherDebounceCallback(
+	_Inout_ PTP_CALLBACK_INSTANCE Instance,
+	_Inout_opt_ PVOID Context,
+	_Inout_ PTP_TIMER Timer
+)
+{
+	const PDSHM_DRIVER_CONTEXT driverContext = (PDSHM_DRIVER_CONTEXT)Context;
+	PDS_CONFIG_CACHE_ENTRY config = NULL;
+
+	UNREFERENCED_PARAMETER(Timer);
+
+	FuncEntry(TRACE_CONFIG);
+
+	//
+	// Pairing and output reports can take a while
+	// 
+	CallbackMayRunLong(Instance);
+
+	TraceVerbose(
+		TRACE_CONFIG,
+		"Reloading configuration"
+	);
+
+	//
+	// Failures are traced already, devices keep their settings then
+	// 
+	(void)ConfigLoadShared(&config);
+
+	WdfWaitLockAcquire(driverContext->ConfigWatcher.Lock, NULL);
+	{
+		for (ULONG index = 0; index < ARRAYSIZE(driverContext->ConfigWatcher.Devices); index++)
+		{
+			if (driverContext->ConfigWatcher.Devices[index] != NULL)
+			{
+				DsDevice_HotReload(driverContext->ConfigWatcher.Devices[index], config);
+			}
+		}
+	}
+	WdfWaitLockRelease(driverContext->ConfigWatcher.Lock);
+
+	ConfigCacheRelease(config);
+
+	TraceVerbose(
+		TRACE_CONFIG,
+		"Reloaded configuration"
+	);
+
+	FuncExitNoReturn(TRACE_CONFIG);
+}
+
+//
+// Starts listening for changes in the configuration directory, caller holds ConfigWatcher.Lock
+// 
+static
+VOID
+ConfigWatcherStart(
+	_Inout_ PDSHM_DRIVER_CONTEXT DriverContext
+)
+{
+	CHAR programDataPath[MAX_PATH];
+	CHAR configPath[MAX_PATH];
+
+	FuncEntry(TRACE_CONFIG);
+
+	do
+	{
+		if (GetEnvironmentVariableA(
+			CONFIG_ENV_VAR_NAME,
+			programDataPath,
+			MAX_PATH
+		) == 0)
+		{
+			break;
+		}
+
+		if (sprintf_s(
+			configPath,
+			MAX_PATH / sizeof(WCHAR),
+			"%s\\%s",
+			programDataPath,
+			CONFIG_SUB_DIR_NAME
+		) == -1)
+		{
+			break;
+		}
+
+		//
+		// Check if directory exists
+		// 
+		if (GetFileAttributesA(configPath) == INVALID_FILE_ATTRIBUTES)
+		{
+			TraceWarning(
+				TRACE_CONFIG,
+				"Configuration directory %s not found, can't listen for changes",
+				configPath
+			);
+			break;
+		}
+
+		DriverContext->ConfigWatcher.DebounceTimer = CreateThreadpoolTimer(
+			ConfigWatcherDebounceCallback,
+			DriverContext,
+			NULL
+		);
+
+		if (DriverContext->ConfigWatcher.DebounceTimer == NULL)
+		{
+			const DWORD error = GetLastError();
+			TraceError(
+				TRACE_CONFIG,
+				"CreateThreadpoolTimer failed with error %!WINERROR!",
+				error
+			);
+			EventWriteFailedWithWin32Error(__FUNCTION__, L"CreateThreadpoolTimer", error);
+			break;
+		}
+
+		DriverContext->ConfigWatcher.ChangeEvent = FindFirstChangeNotificationA(
+			configPath,
+			FALSE,
+			FILE_NOTIFY_CHANGE_LAST_WRITE
+		);
+
+		if (DriverContext->ConfigWatcher.ChangeEvent == INVALID_HANDLE_VALUE)
+		{
+			const DWORD error = GetLastError();
+			TraceError(
+				TRACE_CONFIG,
+				"FindFirstChangeNotificationA failed with error %!WINERROR!",
+				error
+			);
+			EventWriteFailedWithWin32Error(__FUNCTION__, L"FindFirstChangeNotificationA", error);
+
+			DriverContext->ConfigWatcher.ChangeEvent = NULL;
+			break;
+		}
+
+		if (!RegisterWaitForSingleObject(
+			&DriverContext->ConfigWatcher.WaitHandle,
+			DriverContext->ConfigWatcher.ChangeEvent,
+			ConfigWatcherChangeCallback,
+			DriverContext,
+			INFINITE,
+			WT_EXECUTEDEFAULT
+		))
+		{
+			const DWORD error = GetLastError();
+			TraceError(
+				TRACE_CONFIG,
+				"RegisterWaitForSingleObject failed with error %!WINERROR!",
+				error
+			);
+			EventWriteFailedWithWin32Error(__FUNCTION__, L"RegisterWaitForSingleObject", error);
+
+			DriverContext->ConfigWatcher.WaitHandle = NULL;
+			break;
+		}
+
+		FuncExitNoReturn(TRACE_CONFIG);
+
+		return;
+
+	} while (FALSE);
+
+	if (DriverContext->ConfigWatcher.ChangeEvent)
+	{
+		FindCloseChangeNotification(DriverContext->ConfigWatcher.ChangeEvent);
+		DriverContext->ConfigWatcher.ChangeEvent = NULL;
+	}
+
+	if (DriverContext->ConfigWatcher.DebounceTimer)
+	{
+		CloseThreadpoolTimer(DriverContext->ConfigWatcher.DebounceTimer);
+		DriverContext->ConfigWatcher.DebounceTimer = NULL;
+	}
+
+	FuncExitNoReturn(TRACE_CONFIG);
+}
+
+//
+// Adds a device to receive configuration changes, starts the driver-wide watcher if necessary
+// 
+VOID
+ConfigWatcherRegisterDevice(
+	_In_ PDEVICE_CONTEXT Context
+)
+{
+	const PDSHM_DRIVER_CONTEXT driverContext = DriverGetContext(WdfGetDriver());
+	ULONG freeIndex = ULONG_MAX;
+
+	FuncEntry(TRACE_CONFIG);
+
+	WdfWaitLockAcquire(driverContext->ConfigWatcher.Lock, NULL);
+	{
+		for (ULONG index = 0; index < ARRAYSIZE(driverContext->ConfigWatcher.Devices); index++)
+		{
+			if (driverContext->ConfigWatcher.Devices[index] == Context)
+			{
+				freeIndex = ULONG_MAX;
+				break;
+			}
+
+			if (driverContext->ConfigWatcher.Devices[index] == NULL && freeIndex == ULONG_MAX)
+			{
+				freeIndex = index;
+			}
+		}
+
+		if (freeIndex != ULONG_MAX)
+		{
+			driverContext->ConfigWatcher.Devices[freeIndex] = Context;
+		}
+
+		if (driverContext->ConfigWatcher.WaitHandle == NULL)
+		{
+			ConfigWatcherStart(driverContext);
+		}
+	}
+	WdfWaitLockRelease(driverContext->ConfigWatcher.Lock);
+
+	FuncExitNoReturn(TRACE_CONFIG);
+}
+
+//
+// Stops delivering configuration changes to a device, waits for a running reload to finish
+// 
+VOID
+ConfigWatcherUnregisterDevice(
+	_In_ PDEVICE_CONTEXT Context
+)
+{
+	const PDSHM_DRIVER_CONTEXT driverContext = DriverGetContext(WdfGetDriver());
+
+	FuncEntry(TRACE_CONFIG);
+
+	WdfWaitLockAcquire(driverContext->ConfigWatcher.Lock, NULL);
+	{
+		for (ULONG index = 0; index < ARRAYSIZE(driverContext->ConfigWatcher.Devices); index++)
+		{
+			if (driverContext->ConfigWatcher.Devices[index] == Context)
+			{
+				driverContext->ConfigWatcher.Devices[index] = NULL;
+			}
+		}
+	}
+	WdfWaitLockRelease(driverContext->ConfigWatcher.Lock);
+
+	FuncExitNoReturn(TRACE_CONFIG);
+}
+
+//
+// Stops the driver-wide watcher, waits for pending callbacks to finish
+// 
+VOID
+ConfigWatcherStop(
+	_Inout_ PDSHM_DRIVER_CONTEXT DriverContext
+)
+{
+	FuncEntry(TRACE_CONFIG);
+
+	if (DriverContext->ConfigWatcher.WaitHandle)
+	{
+		UnregisterWaitEx(DriverContext->ConfigWatcher.WaitHandle, INVALID_HANDLE_VALUE);
+		DriverContext->ConfigWatcher.WaitHandle = NULL;
+	}
+
+	if (DriverContext->ConfigWatcher.DebounceTimer)
+	{
+		SetThreadpoolTimer(DriverContext->ConfigWatcher.DebounceTimer, NULL, 0, 0);
+		WaitForThreadpoolTimerCallbacks(DriverContext->ConfigWatcher.DebounceTimer, TRUE);
+		CloseThreadpoolTimer(DriverContext->ConfigWatcher.DebounceTimer);
+		DriverContext->ConfigWatcher.DebounceTimer = NULL;
+	}
+
+	if (DriverContext->ConfigWatcher.ChangeEvent)
+	{
+		FindCloseChangeNotification(DriverContext->ConfigWatcher.ChangeEvent);
+		DriverContext->ConfigWatcher.ChangeEvent = NULL;
+	}
+
+	FuncExitNoReturn(TRACE_CONFIG);
+}
+
+#pragma endregion
+
 //
 // Set default values (if no customized configuration is available)
 // 
@@ -999,6 +1852,8 @@ ConfigSetDefaults(
 	}
 	Config->IsOutputRateControlEnabled = TRUE;
 	Config->OutputRateControlPeriodMs = 150;
+	Config->FFBCoalescingWindowMs = 5;
+	Config->IsFFBRecordingEnabled = FALSE;
 	Config->WirelessIdleTimeoutPeriodMs = 300000;
 	Config->DisableWirelessIdleTimeout = FALSE;
 
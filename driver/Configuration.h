@@ -4,7 +4,46 @@
 #define CONFIG_SUB_DIR_NAME		"DsHidMini"
 #define CONFIG_FILE_NAME		"DsHidMini.json"
 
+//
+// Time the configuration directory needs to stay unchanged before a hot-reload
+// 
+#define CONFIG_HOT_RELOAD_DELAY_MS	100
+
 typedef struct _DEVICE_CONTEXT* PDEVICE_CONTEXT;
+typedef struct _DSHM_DRIVER_CONTEXT* PDSHM_DRIVER_CONTEXT;
+
+//
+// Configuration file content parsed once and shared by all devices
+// 
+typedef struct _DS_CONFIG_CACHE_ENTRY
+{
+	//
+	// One reference held by the driver while this is the current entry plus one per loading device
+	// 
+	volatile LONG RefCount;
+
+	//
+	// Identifies the file content this entry got parsed from
+	// 
+	DWORD VolumeSerialNumber;
+
+	ULONGLONG FileIndex;
+
+	ULONGLONG Size;
+
+	FILETIME LastWriteTime;
+
+	//
+	// FNV-1a hash of the file content
+	// 
+	ULONGLONG ContentHash;
+
+	//
+	// Parsed document, NULL if the content isn't valid JSON
+	// 
+	cJSON* Root;
+
+} DS_CONFIG_CACHE_ENTRY, *PDS_CONFIG_CACHE_ENTRY;
 
 _Must_inspect_result_
 NTSTATUS
@@ -12,3 +51,52 @@ ConfigLoadForDevice(
 	_Inout_ PDEVICE_CONTEXT Context,
 	_In_opt_ BOOLEAN IsHotReload
 );
+
+VOID
+ConfigCacheRelease(
+	_In_opt_ PDS_CONFIG_CACHE_ENTRY Entry
+);
+
+_Must_inspect_result_
+NTSTATUS
+ConfigLoadShared(
+	_Out_ PDS_CONFIG_CACHE_ENTRY* Entry
+);
+
+NTSTATUS
+ConfigApplyForDevice(
+	_Inout_ PDEVICE_CONTEXT Context,
+	_In_opt_ const DS_CONFIG_CACHE_ENTRY* Config,
+	_In_ BOOLEAN IsHotReload,
+	_Out_opt_ PBOOLEAN IsChanged
+);
+
+NTSTATUS
+ConfigPublishForDevice(
+	_Inout_ PDEVICE_CONTEXT Context
+);
+
+NTSTATUS
+ConfigInitForDevice(
+	_Inout_ PDEVICE_CONTEXT Context
+);
+
+VOID
+ConfigFreeForDevice(
+	_Inout_ PDEVICE_CONTEXT Context
+);
+
+VOID
+ConfigWatcherRegisterDevice(
+	_In_ PDEVICE_CONTEXT Context
+);
+
+VOID
+ConfigWatcherUnregisterDevice(
+	_In_ PDEVICE_CONTEXT Context
+);
+
+VOID
+ConfigWatcherStop(
+	_Inout_ PDSHM_DRIVER_CONTEXT DriverContext
+);
@@ -222,6 +222,47 @@ void DsHidMini_DeviceCleanup(
 
 	WdfWaitLockAcquire(driverContext->SlotsLock, NULL);
 	{
+		// counters stay for a final sample until the slot gets claimed again
+		if (deviceContext->IPC.Counters)
+		{
+			DSHM_IPC_COUNTERS_RELEASE(deviceContext->IPC.Counters);
+		}
+
+		//
+		// Clean up the shared regions before the slot is free to be claimed
+		// again, a new owner must not have its fresh state wiped
+		// 
+		if (driverContext->IPC.IsEnabled)
+		{
+			const PUCHAR pHIDRegion = driverContext->IPC.SharedRegions.HID.Buffer;
+			ULONG sequence;
+
+			//
+			// Input reports may still be completing, or a client left the
+			// sequence odd; either way readers have to learn we're gone
+			// 
+			if (!DSHM_IPC_HID_WRITE_BEGIN(pHIDRegion, deviceContext->SlotIndex, &sequence))
+			{
+				DSHM_IPC_HID_WRITE_FORCE(pHIDRegion, deviceContext->SlotIndex, &sequence);
+			}
+
+			// zero out the slot so potential readers get notified we're gone
+			RtlZeroMemory(&DSHM_IPC_HID_SLOT(pHIDRegion, deviceContext->SlotIndex)->Message, sizeof(IPC_HID_INPUT_REPORT_MESSAGE));
+			RtlZeroMemory(DSHM_IPC_HID_STATE(pHIDRegion, deviceContext->SlotIndex), sizeof(IPC_HID_STATE));
+
+			DSHM_IPC_HID_WRITE_END(pHIDRegion, deviceContext->SlotIndex, sequence);
+
+			if (DSHM_IPC_HID_MARK_CHANGED(pHIDRegion, deviceContext->SlotIndex))
+			{
+				SetEvent(driverContext->IPC.InputChangedEvent);
+			}
+
+			RtlZeroMemory(
+				&((PIPC_OUTPUT_REPORT_TELEMETRY)driverContext->IPC.SharedRegions.Telemetry.Buffer)[deviceContext->SlotIndex - 1],
+				sizeof(IPC_OUTPUT_REPORT_TELEMETRY)
+			);
+		}
+
 		CLEAR_SLOT(driverContext, deviceContext->SlotIndex);
 		if (driverContext->IPC.IsEnabled)
 		{
@@ -231,14 +272,7 @@ void DsHidMini_DeviceCleanup(
 	}
 	WdfWaitLockRelease(driverContext->SlotsLock);
 
-	if (driverContext->IPC.IsEnabled)
-	{
-		const size_t offset = (sizeof(IPC_HID_INPUT_REPORT_MESSAGE) * (deviceContext->SlotIndex - 1));
-		const PUCHAR pHIDBuffer = (driverContext->IPC.SharedRegions.HID.Buffer + offset);
-
-		// zero out the slot so potential readers get notified we're gone
-		RtlZeroMemory(pHIDBuffer, sizeof(IPC_HID_INPUT_REPORT_MESSAGE));
-	}
+	ConfigFreeForDevice(deviceContext);
 
 	EventWriteUnloadEvent(Object);
 
@@ -399,7 +433,7 @@ NTSTATUS DsDevice_ReadProperties(WDFDEVICE Device)
 
 			DsDevice_RegisterBthDisconnectListener(pDevCtx);
 
-			DsDevice_RegisterHotReloadListener(pDevCtx);
+			ConfigWatcherRegisterDevice(pDevCtx);
 
             sprintf_s(
                 pDevCtx->DeviceAddressString,
@@ -474,6 +508,43 @@ DsDevice_InitContext(
 		return status;
 	}
 
+	//
+	// Desired output state, matches the default reports below
+	// 
+	DS3_OUTPUT_STATE_INIT(&pDevCtx->OutputReport.State);
+
+	//
+	// Expose output path counters to IPC clients, if possible
+	// 
+	pDevCtx->OutputReport.Telemetry = (pDrvCtx->IPC.IsEnabled)
+		? &((PIPC_OUTPUT_REPORT_TELEMETRY)pDrvCtx->IPC.SharedRegions.Telemetry.Buffer)[pDevCtx->SlotIndex - 1]
+		: &pDevCtx->OutputReport.LocalTelemetry;
+
+	RtlZeroMemory(pDevCtx->OutputReport.Telemetry, sizeof(IPC_OUTPUT_REPORT_TELEMETRY));
+	pDevCtx->OutputReport.Telemetry->SlotIndex = pDevCtx->SlotIndex;
+
+	//
+	// Same for the performance counters
+	// 
+	pDevCtx->IPC.Counters = (pDrvCtx->IPC.IsEnabled)
+		? DSHM_IPC_COUNTERS_SLOT((PIPC_COUNTERS_REGION_HEADER)pDrvCtx->IPC.SharedRegions.Counters.Buffer, pDevCtx->SlotIndex)
+		: &pDevCtx->IPC.LocalCounters;
+
+	DSHM_IPC_COUNTERS_CLAIM(pDevCtx->IPC.Counters, pDevCtx->SlotIndex);
+
+	//
+	// Output requests still queued were meant for a previous occupant of the slot
+	// 
+	if (pDrvCtx->IPC.IsEnabled)
+	{
+		const PIPC_OUTPUT_RING pOutputRing = DSHM_IPC_OUTPUT_RING(
+			(PIPC_OUTPUT_REGION_HEADER)pDrvCtx->IPC.SharedRegions.Output.Buffer,
+			pDevCtx->SlotIndex
+		);
+
+		DSHM_IPC_OUTPUT_RING_CONSUME(pOutputRing, DSHM_IPC_LOAD32(&pOutputRing->Tail));
+	}
+
 	// ReSharper disable once CppIncompleteSwitchStatement
 	// ReSharper disable once CppDefaultCaseNotHandledInSwitchStatement
 	switch (pDevCtx->ConnectionType)
@@ -527,7 +598,7 @@ DsDevice_InitContext(
 			&attributes,
 			NonPagedPoolNx,
 			DS3_POOL_TAG,
-			DS3_USB_HID_OUTPUT_REPORT_SIZE,
+			DS3_BTH_HID_OUTPUT_REPORT_SIZE,
 			&pDevCtx->OutputReportMemory,
 			(PVOID*)&outReportBuffer
 		)))
@@ -553,7 +624,7 @@ DsDevice_InitContext(
 		//
 		// Turn flashing LEDs off
 		// 
-		DS3_BTH_SET_LED(outReportBuffer, DS3_LED_OFF);
+		DS3_SET_LED_FLAGS(pDevCtx, DS3_LED_OFF);
 
 #pragma region StartupDelay
 
@@ -670,7 +741,7 @@ DsDevice_InitContext(
 
 		if (!NT_SUCCESS(status = WdfWaitLockCreate(
 			&attributes,
-			&pDevCtx->ConfigurationDirectoryWatcherLock
+			&pDevCtx->ConfigurationLock
 		)))
 		{
 			TraceError(
@@ -682,6 +753,20 @@ DsDevice_InitContext(
 			break;
 		}
 
+		//
+		// Readers always find a configuration, even before it got loaded
+		// 
+		if (!NT_SUCCESS(status = ConfigInitForDevice(pDevCtx)))
+		{
+			TraceError(
+				TRACE_DEVICE,
+				"ConfigInitForDevice failed with status %!STATUS!",
+				status
+			);
+			EventWriteFailedWithNTStatus(__FUNCTION__, L"ConfigInitForDevice", status);
+			break;
+		}
+
 		//
 		// Create timer
 		// 
@@ -709,6 +794,57 @@ DsDevice_InitContext(
 			break;
 		}
 
+#ifdef DSHM_FEATURE_FFB
+
+#pragma region Force Feedback
+
+		FFB_ENGINE_INIT(&pDevCtx->ForceFeedback.Engine);
+		FFB_BLOCKS_INIT(&pDevCtx->ForceFeedback.Blocks);
+
+		WDF_OBJECT_ATTRIBUTES_INIT(&attributes);
+		attributes.ParentObject = Device;
+
+		if (!NT_SUCCESS(status = WdfWaitLockCreate(
+			&attributes,
+			&pDevCtx->ForceFeedback.Lock
+		)))
+		{
+			TraceError(
+				TRACE_DEVICE,
+				"WdfWaitLockCreate (ForceFeedback) failed with status %!STATUS!",
+				status
+			);
+			EventWriteFailedWithNTStatus(__FUNCTION__, L"WdfWaitLockCreate (ForceFeedback)", status);
+			break;
+		}
+
+		WDF_OBJECT_ATTRIBUTES_INIT(&attributes);
+		attributes.ParentObject = Device;
+
+		WDF_TIMER_CONFIG_INIT(
+			&timerCfg,
+			DSHM_FfbTickTimerElapsed
+		);
+
+		if (!NT_SUCCESS(status = WdfTimerCreate(
+			&timerCfg,
+			&attributes,
+			&pDevCtx->ForceFeedback.TickTimer
+		)))
+		{
+			TraceError(
+				TRACE_DEVICE,
+				"WdfTimerCreate (ForceFeedback) failed with status %!STATUS!",
+				status
+			);
+			EventWriteFailedWithNTStatus(__FUNCTION__, L"WdfTimerCreate (ForceFeedback)", status);
+			break;
+		}
+
+#pragma endregion
+
+#endif
+
 #pragma region IPC
 
 		SECURITY_DESCRIPTOR sd = { 0 };
@@ -842,168 +978,69 @@ DsDevice_IsUsbDevice(
 }
 
 //
-// Gets invoked when the hot-reload event got triggered from somewhere
+// Gets invoked by the configuration directory watcher after the configuration got reloaded
 // 
-VOID CALLBACK
-DsDevice_HotReloadEventCallback(
-	_In_ PVOID   lpParameter,
-	_In_ BOOLEAN TimerOrWaitFired
+VOID
+DsDevice_HotReload(
+	_In_ PDEVICE_CONTEXT Context,
+	_In_opt_ const DS_CONFIG_CACHE_ENTRY* Config
 )
 {
-	FuncEntry(TRACE_DEVICE);
+	BOOLEAN isChanged = FALSE;
 
-	LONGLONG timeout = 0;
-	PDEVICE_CONTEXT pDevCtx = (PDEVICE_CONTEXT)lpParameter;
-	UNREFERENCED_PARAMETER(TimerOrWaitFired);
+	FuncEntry(TRACE_DEVICE);
 
-	FindNextChangeNotification(pDevCtx->ConfigurationDirectoryWatcherEvent);
+	(void)ConfigApplyForDevice(Context, Config, TRUE, &isChanged);
 
-	do
+	//
+	// Editors touch files or write temporary ones, don't bother the device then
+	// 
+	if (!isChanged)
 	{
-		//
-		// Protect against parallel reads
-		// 
-		if (WdfWaitLockAcquire(pDevCtx->ConfigurationDirectoryWatcherLock, &timeout) != STATUS_SUCCESS)
-		{
-			TraceVerbose(
-				TRACE_DEVICE,
-				"Couldn't acquire lock, exiting"
-			);
-
-			break;
-		}
-
-		/*
-		 * When this event is fired, the file might still be locked by the application
-		 * that's written the change to it, so we simply wait a bit before attempting a read
-		 */
-		Sleep(100);
-
-		TraceVerbose(
-			TRACE_DEVICE,
-			"Reloading configuration"
-		);
-
-		ConfigLoadForDevice(pDevCtx, TRUE);
-
-		TraceVerbose(
-			TRACE_DEVICE,
-			"Reloaded configuration"
-		);
-
-		WdfWaitLockRelease(pDevCtx->ConfigurationDirectoryWatcherLock);
-
-		//
-		// If PairOnHotReload is enabled and not in disabled pairing mode then attempt pairing process followed by requesting currently set host address
-		//
-		if (pDevCtx->ConnectionType == DsDeviceConnectionTypeUsb
-			&& pDevCtx->Configuration.PairOnHotReload
-			&& pDevCtx->Configuration.DevicePairingMode != DsDevicePairingModeDisabled)
-		{
-			WDFDEVICE wdfDev = DMF_ParentDeviceGet(pDevCtx->DsHidMiniModule);
-			DsUsb_Ds3PairToNewHost(wdfDev);
-			DsUsb_Ds3RequestHostAddress(wdfDev);
-		}
+		FuncExitNoReturn(TRACE_DEVICE);
+		return;
+	}
 
-		//
-		// Changes to LED settings need to be pushed to the device
-		// 
-		(void)DSHM_SendOutputReport(pDevCtx, Ds3OutputReportSourceDriverHighPriority);
+	DSHM_IPC_COUNTER_INCREMENT(&Context->IPC.Counters->ConfigReloads);
 
-	} while (FALSE);
+	LONG epoch;
+	const DS_CONFIG_SNAPSHOT* config = DS_CONFIG_READ_BEGIN(Context, &epoch);
+	const BOOLEAN pairOnHotReload = config->Configuration.PairOnHotReload
+		&& config->Configuration.DevicePairingMode != DsDevicePairingModeDisabled;
+#ifdef DSHM_FEATURE_FFB
+	const BOOLEAN isRecordingEnabled = config->Configuration.IsFFBRecordingEnabled;
+#endif
+	DS_CONFIG_READ_END(Context, epoch);
 
-	FuncExitNoReturn(TRACE_DEVICE);
-}
-
-//
-// Registers an event listener to trigger refreshing runtime properties
-// 
-void DsDevice_RegisterHotReloadListener(PDEVICE_CONTEXT Context)
-{
-	CHAR programDataPath[MAX_PATH];
-	CHAR configPath[MAX_PATH];
-
-	FuncEntry(TRACE_DEVICE);
-
-	do
+#ifdef DSHM_FEATURE_FFB
+	//
+	// Give a failed recording another chance with the new settings, and
+	// release a disabled one so the file can be taken right away
+	//
+	WdfWaitLockAcquire(Context->ForceFeedback.Lock, NULL);
+	Context->ForceFeedback.RecordingFailed = FALSE;
+	if (!isRecordingEnabled && Context->ForceFeedback.RecordingFile)
 	{
-		if (Context->ConfigurationDirectoryWatcherEvent)
-		{
-			FindCloseChangeNotification(Context->ConfigurationDirectoryWatcherEvent);
-			Context->ConfigurationDirectoryWatcherEvent = NULL;
-		}
-
-		if (GetEnvironmentVariableA(
-			CONFIG_ENV_VAR_NAME,
-			programDataPath,
-			MAX_PATH
-		) == 0)
-		{
-			break;
-		}
-
-		if (sprintf_s(
-			configPath,
-			MAX_PATH / sizeof(WCHAR),
-			"%s\\%s",
-			programDataPath,
-			CONFIG_SUB_DIR_NAME
-		) == -1)
-		{
-			break;
-		}
-
-        //
-        // Check if file exists
-        // 
-        if (GetFileAttributesA(configPath) == INVALID_FILE_ATTRIBUTES)
-        {
-            TraceWarning(
-                TRACE_DEVICE,
-                "Configuration file %s not found, can't listen for changes",
-                configPath
-            );
-            break;
-        }
-
-		Context->ConfigurationDirectoryWatcherEvent = FindFirstChangeNotificationA(
-			configPath,
-			FALSE,
-			FILE_NOTIFY_CHANGE_LAST_WRITE
-		);
-
-		if (Context->ConfigurationDirectoryWatcherEvent == NULL)
-		{
-            const DWORD error = GetLastError();
-			TraceError(
-				TRACE_DEVICE,
-				"FindFirstChangeNotificationA failed with error %!WINERROR!",
-                error
-			);
-			EventWriteFailedWithWin32Error(__FUNCTION__, L"FindFirstChangeNotificationA", error);
-			break;
-		}
+		CloseHandle(Context->ForceFeedback.RecordingFile);
+		Context->ForceFeedback.RecordingFile = NULL;
+	}
+	WdfWaitLockRelease(Context->ForceFeedback.Lock);
+#endif
 
-		const BOOL ret = RegisterWaitForSingleObject(
-			&Context->ConfigurationDirectoryWatcherWaitHandle,
-			Context->ConfigurationDirectoryWatcherEvent,
-			DsDevice_HotReloadEventCallback,
-			Context,
-			INFINITE,
-			WT_EXECUTELONGFUNCTION
-		);
+	//
+	// If PairOnHotReload is enabled and not in disabled pairing mode then attempt pairing process followed by requesting currently set host address
+	//
+	if (Context->ConnectionType == DsDeviceConnectionTypeUsb && pairOnHotReload)
+	{
+		WDFDEVICE wdfDev = DMF_ParentDeviceGet(Context->DsHidMiniModule);
+		DsUsb_Ds3PairToNewHost(wdfDev);
+		DsUsb_Ds3RequestHostAddress(wdfDev);
+	}
 
-		if (!ret)
-		{
-            const DWORD error = GetLastError();
-			TraceError(
-				TRACE_DEVICE,
-				"RegisterWaitForSingleObject failed with error %!WINERROR!",
-                error
-			);
-			EventWriteFailedWithWin32Error(__FUNCTION__, L"RegisterWaitForSingleObject", error);
-		}
-	} while (FALSE);
+	//
+	// Changes to LED settings need to be pushed to the device
+	// 
+	(void)DSHM_SendOutputReport(Context, Ds3OutputReportSourceDriverHighPriority);
 
 	FuncExitNoReturn(TRACE_DEVICE);
 }
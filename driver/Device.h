@@ -100,20 +100,6 @@ struct BTH_DEVICE_CONTEXT
 	LARGE_INTEGER IdleDisconnectTimestamp;
 };
 
-#ifdef DSHM_FEATURE_FFB
-typedef struct _FFB_ATTRIBUTES
-{
-	UCHAR EffectBlockIndex;
-
-	PID_EFFECT_TYPE EffectType;
-
-	BOOLEAN IsReserved;
-
-	BOOLEAN IsReported;
-
-} FFB_ATTRIBUTES, *PFFB_ATTRIBUTES;
-#endif
-
 /**
  * Output report context.
  *
@@ -136,6 +122,16 @@ typedef struct _DS_OUTPUT_REPORT_CONTEXT
 	// The initiator of this report
 	// 
 	DS_OUTPUT_REPORT_SOURCE ReportSource;
+
+	//
+	// Held back once already by the per-device rate limit
+	// 
+	BOOLEAN IsRequeued;
+
+	//
+	// Time the buffer got (re-)enqueued
+	// 
+	LARGE_INTEGER EnqueuedTimestamp;
 	
 } DS_OUTPUT_REPORT_CONTEXT, *PDS_OUTPUT_REPORT_CONTEXT;
 
@@ -185,18 +181,162 @@ typedef struct _DS_OUTPUT_REPORT_CACHE
 } DS_OUTPUT_REPORT_CACHE, *PDS_OUTPUT_REPORT_CACHE;
 
 //
-// Stores the constants used for rumble rescaling and if it is allowed
+// Stores the precomputed rumble rescaling table and if it is allowed
 //
 typedef struct _DS_RESCALE_STATE
 {
 	BOOLEAN IsAllowed;
 
-	DOUBLE ConstA;
-
-	DOUBLE ConstB;
+	//
+	// Final motor strength for every possible received strength value
+	//
+	UCHAR Table[UCHAR_MAX + 1];
 
 } DS_RESCALE_STATE, * PDS_RESCALE_STATE;
 
+//
+// Immutable configuration of a device plus the state derived from it.
+// Replaced as a whole on every change, see DS_CONFIG_READ_BEGIN.
+//
+typedef struct _DS_CONFIG_SNAPSHOT
+{
+	//
+	// Settings as loaded
+	//
+	DS_DRIVER_CONFIGURATION Configuration;
+
+	//
+	// Heavy rumble rescaling, identity if disabled
+	//
+	DS_RESCALE_STATE HeavyRescale;
+
+	//
+	// Light rumble rescaling in alternative mode
+	// (maps into heavy motor strength, heavy rescaling applied)
+	//
+	DS_RESCALE_STATE LightRescale;
+
+	//
+	// Received strengths forcing the right motor on in alternative mode (0x100 if disabled)
+	//
+	USHORT ForcedRightHeavyThreshold;
+
+	USHORT ForcedRightLightThreshold;
+
+	//
+	// Buttons of the quick disconnect combo, 0 if disabled
+	//
+	ULONG WirelessDisconnectComboMask;
+
+	//
+	// Buttons of the alternative rumble mode toggle combo, 0 if disabled
+	//
+	ULONG AltModeToggleComboMask;
+
+} DS_CONFIG_SNAPSHOT, * PDS_CONFIG_SNAPSHOT;
+
+#define DS_OUTPUT_TELEMETRY_HISTOGRAM_BUCKETS		10
+#define DS_OUTPUT_TELEMETRY_HISTOGRAM_BASE_US		250
+#define DS_OUTPUT_TELEMETRY_EVENT_INTERVAL_SEC		10
+
+//
+// Latency distribution; bucket 0 counts samples below 250 us, every following
+// bucket doubles the upper bound, the last one is open-ended
+// 
+typedef struct _IPC_OUTPUT_TELEMETRY_HISTOGRAM
+{
+	LONG64 Buckets[DS_OUTPUT_TELEMETRY_HISTOGRAM_BUCKETS];
+
+	LONG64 TotalMicroseconds;
+
+	LONG64 MaxMicroseconds;
+
+} IPC_OUTPUT_TELEMETRY_HISTOGRAM, * PIPC_OUTPUT_TELEMETRY_HISTOGRAM;
+
+//
+// Output report path counters of a device shared via IPC
+// 
+typedef struct _IPC_OUTPUT_REPORT_TELEMETRY
+{
+	//
+	// One-based device index
+	// 
+	UINT32 SlotIndex;
+
+	//
+	// Buffers currently queued or held back by rate control
+	// 
+	LONG InFlight;
+
+	//
+	// Highest observed value of InFlight
+	// 
+	LONG PeakInFlight;
+
+	LONG Reserved;
+
+	//
+	// Reports handed to the queue by DSHM_SendOutputReport
+	// 
+	LONG64 Enqueued;
+
+	//
+	// Reports dropped since output state didn't change
+	// 
+	LONG64 Skipped;
+
+	//
+	// Reports lost due to no free queue buffer
+	// 
+	LONG64 EnqueueFailed;
+
+	//
+	// Buffers picked up by the queue worker
+	// 
+	LONG64 Dequeued;
+
+	//
+	// Buffers held back by rate control
+	// 
+	LONG64 Delayed;
+
+	//
+	// Held back buffers superseded by a newer one
+	// 
+	LONG64 Replaced;
+
+	//
+	// Held back buffers put back into the queue after the delay elapsed
+	// 
+	LONG64 Requeued;
+
+	//
+	// Successful transfers to the device
+	// 
+	LONG64 Sent;
+
+	//
+	// Failed transfers to the device
+	// 
+	LONG64 SendFailed;
+
+	//
+	// Time between (re-)enqueue and dequeue
+	// 
+	IPC_OUTPUT_TELEMETRY_HISTOGRAM QueueTime;
+
+	//
+	// Duration of the transfer to the device
+	// 
+	IPC_OUTPUT_TELEMETRY_HISTOGRAM SendLatency;
+
+	//
+	// Time between initial enqueue and transfer completion
+	// 
+	IPC_OUTPUT_TELEMETRY_HISTOGRAM EndToEnd;
+
+} IPC_OUTPUT_REPORT_TELEMETRY, * PIPC_OUTPUT_REPORT_TELEMETRY;
+
 typedef struct _DEVICE_CONTEXT
 {
 	//
@@ -225,8 +365,79 @@ typedef struct _DEVICE_CONTEXT
 		// Cached output report meta-data
 		// 
 		DS_OUTPUT_REPORT_CACHE Cache;
+
+		//
+		// Desired LED and rumble state, compiled into OutputReportMemory on send
+		// 
+		DS3_OUTPUT_STATE State;
+
+		//
+		// Output path counters, points into IPC region if available
+		// 
+		PIPC_OUTPUT_REPORT_TELEMETRY Telemetry;
+
+		//
+		// Counter storage used if IPC is disabled
+		// 
+		IPC_OUTPUT_REPORT_TELEMETRY LocalTelemetry;
+
+		//
+		// Last time the telemetry got reported via ETW
+		// 
+		LARGE_INTEGER TelemetryEventTimestamp;
+
+		//
+		// Share of the driver-wide Bluetooth writes budget
+		// 
+		DS_AIRTIME_CLIENT Airtime;
 		
 	} OutputReport;
+
+#ifdef DSHM_FEATURE_FFB
+	struct
+	{
+		//
+		// Effect table, scheduler and mixer
+		// 
+		FFB_ENGINE Engine;
+
+		//
+		// Effect block index allocation
+		// 
+		FFB_BLOCK_TABLE Blocks;
+
+		//
+		// Lock protecting engine and block table access
+		// 
+		WDFWAITLOCK Lock;
+
+		//
+		// One-shot, fires when the effect engine needs to be evaluated next
+		// 
+		WDFTIMER TickTimer;
+
+		//
+		// Time (GetTickCount64) the tick timer is due at, 0 if not armed
+		// 
+		ULONGLONG WakeAt;
+
+		//
+		// Open while PID reports get recorded
+		// 
+		HANDLE RecordingFile;
+
+		//
+		// Time (GetTickCount64) the recording started at
+		// 
+		ULONGLONG RecordingStartedAt;
+
+		//
+		// Creating the recording failed, not retried until the next configuration reload
+		// 
+		BOOLEAN RecordingFailed;
+
+	} ForceFeedback;
+#endif
 	
 	//
 	// Type of connection (wired, wireless)
@@ -293,24 +504,49 @@ typedef struct _DEVICE_CONTEXT
 	WDFMEMORY OutputReportMemory;
 
 	//
-	// Registry-stored driver configuration
+	// Configuration as loaded, only touched by writers holding ConfigurationLock.
+	// Everything else reads the published snapshot.
 	// 
 	DS_DRIVER_CONFIGURATION Configuration;
 
 	//
-	// Event to listen for to hot-reload properties
-	//
-	HANDLE ConfigurationDirectoryWatcherEvent;
-
-	//
-	// Wait handle for hot-reload
-	//
-	HANDLE ConfigurationDirectoryWatcherWaitHandle;
+	// Lock serializing configuration writers
+	// 
+	WDFWAITLOCK ConfigurationLock;
 
 	//
-	// Lock protecting against parallel refreshing of configuration
+	// Identifies what got applied last, guarded by ConfigurationLock
 	// 
-	WDFWAITLOCK ConfigurationDirectoryWatcherLock;
+	struct
+	{
+		//
+		// Hash of the whole configuration file content
+		// 
+		ULONGLONG Content;
+
+		//
+		// Hash of the global and device-specific nodes
+		// 
+		ULONGLONG Nodes;
+	} ConfigurationHash;
+
+	struct
+	{
+		//
+		// Published configuration, swapped as a whole
+		// 
+		PDS_CONFIG_SNAPSHOT volatile Current;
+
+		//
+		// Selects the counter new read sections use
+		// 
+		volatile LONG Epoch;
+
+		//
+		// Read sections in progress, per epoch
+		// 
+		volatile LONG Readers[2];
+	} ConfigSnapshot;
 
 	struct
 	{
@@ -324,11 +560,6 @@ typedef struct _DEVICE_CONTEXT
 		// 
 		UCHAR HeavyCache;
 
-		//
-		// Defines if heavy rumble strength rescaling is requested
-		//
-		BOOLEAN HeavyRescaleEnabled;
-
 		struct {
 
 			//
@@ -336,11 +567,6 @@ typedef struct _DEVICE_CONTEXT
 			//
 			BOOLEAN IsEnabled;
 
-			//
-			// Current state of light rumble rescaling parameters
-			//
-			DS_RESCALE_STATE LightRescale;
-
 			//
 			// Allows toggling to occur if the button combo conditions are satisfied
 			//
@@ -353,11 +579,6 @@ typedef struct _DEVICE_CONTEXT
 
 		} AltMode;
 
-		//
-		// Current state of heavy rumble rescaling parameters
-		//
-		DS_RESCALE_STATE HeavyRescale;
-
 	} RumbleControlState;
 
 	UINT32 SlotIndex;
@@ -367,27 +588,19 @@ typedef struct _DEVICE_CONTEXT
 		WDFMEMORY InputReportWaitEventName;
 
 		HANDLE InputReportWaitHandle;
-	} IPC;
 
-} DEVICE_CONTEXT, * PDEVICE_CONTEXT;
+		//
+		// Performance counters, points into IPC region if available
+		// 
+		PIPC_DEVICE_COUNTERS Counters;
 
-#include <pshpack1.h>
-//
-// Describes a raw input report packet shared via IPC
-// 
-typedef struct _IPC_HID_INPUT_REPORT_MESSAGE
-{
-	//
-	// One-based device index
-	// 
-	UINT32 SlotIndex;
+		//
+		// Counter storage used if IPC is disabled
+		// 
+		IPC_DEVICE_COUNTERS LocalCounters;
+	} IPC;
 
-	//
-	// Input report copy
-	// 
-	DS3_RAW_INPUT_REPORT InputReport;
-} IPC_HID_INPUT_REPORT_MESSAGE, *PIPC_HID_INPUT_REPORT_MESSAGE;
-#include <poppack.h>
+} DEVICE_CONTEXT, * PDEVICE_CONTEXT;
 
 //
 // This macro will generate an inline function called DeviceGetContext
@@ -396,6 +609,32 @@ typedef struct _IPC_HID_INPUT_REPORT_MESSAGE
 //
 WDF_DECLARE_CONTEXT_TYPE_WITH_NAME(DEVICE_CONTEXT, DeviceGetContext)
 
+//
+// Enters a configuration read section and gets the published snapshot. It
+// stays valid until DS_CONFIG_READ_END. Writers wait for sections to end
+// before freeing a replaced snapshot, so keep them short and never block.
+//
+FORCEINLINE const DS_CONFIG_SNAPSHOT* DS_CONFIG_READ_BEGIN(
+	_In_ PDEVICE_CONTEXT Context,
+	_Out_ PLONG Epoch
+)
+{
+	const LONG epoch = ReadNoFence(&Context->ConfigSnapshot.Epoch) & 1;
+
+	InterlockedIncrement(&Context->ConfigSnapshot.Readers[epoch]);
+	*Epoch = epoch;
+
+	return (const DS_CONFIG_SNAPSHOT*)ReadPointerAcquire((PVOID volatile*)&Context->ConfigSnapshot.Current);
+}
+
+FORCEINLINE VOID DS_CONFIG_READ_END(
+	_In_ PDEVICE_CONTEXT Context,
+	_In_ LONG Epoch
+)
+{
+	InterlockedDecrement(&Context->ConfigSnapshot.Readers[Epoch]);
+}
+
 DECLARE_DMF_MODULE_NO_CONFIG(DsHidMini)
 
 typedef struct
@@ -415,18 +654,6 @@ typedef struct
 	// 
 	DS3_RAW_INPUT_REPORT GetFeatureReport;
 
-#ifdef DSHM_FEATURE_FFB
-	//
-	// Force Feedback State Info
-	// 
-	PFFB_ATTRIBUTES FfbAttributes;
-
-	//
-	// Hash table holding FFB effect info
-	// 
-	DMFMODULE DmfModuleForceFeedback;
-#endif
-	
 } DMF_CONTEXT_DsHidMini;
 
 _Function_class_(DMF_ChildModulesAdd)
@@ -444,19 +671,32 @@ EVT_DMF_ThreadedBufferQueue_Callback DSHM_EvtExecuteOutputPacketReceived;
 
 EVT_WDF_TIMER DSHM_OutputReportDelayTimerElapsed;
 
+#ifdef DSHM_FEATURE_FFB
+EVT_WDF_TIMER DSHM_FfbTickTimerElapsed;
+#endif
+
 EVT_WDF_IO_QUEUE_IO_DEVICE_CONTROL DSHM_EvtWdfIoQueueIoDeviceControl;
 
 EVT_DSHM_IPC_DispatchDeviceMessage DSHM_EvtDispatchDeviceMessage;
 
+_IRQL_requires_max_(PASSIVE_LEVEL)
+VOID
+DSHM_DispatchDeviceOutputRequests(
+	_In_ PDEVICE_CONTEXT DeviceContext,
+	_In_ PIPC_OUTPUT_RING Ring,
+	_In_ ULONG First,
+	_In_ ULONG Count
+);
+
 NTSTATUS
 DsDevice_ReadProperties(
 	WDFDEVICE Device
 );
 
-VOID CALLBACK
-DsDevice_HotReloadEventCallback(
-	_In_ PVOID   lpParameter,
-	_In_ BOOLEAN TimerOrWaitFired
+VOID
+DsDevice_HotReload(
+	_In_ PDEVICE_CONTEXT Context,
+	_In_opt_ const DS_CONFIG_CACHE_ENTRY* Config
 );
 
 NTSTATUS
@@ -470,11 +710,6 @@ DsDevice_IsUsbDevice(
 	PBOOLEAN Result
 );
 
-void
-DsDevice_RegisterHotReloadListener(
-	PDEVICE_CONTEXT Context
-);
-
 void
 DsDevice_RegisterBthDisconnectListener(
 	PDEVICE_CONTEXT Context
@@ -64,6 +64,39 @@ DriverEntry(
 		return status;
 	}
 
+	if (!NT_SUCCESS(status = WdfWaitLockCreate(WDF_NO_OBJECT_ATTRIBUTES, &context->BthAirtime.Lock)))
+	{
+		TraceEvents(TRACE_LEVEL_ERROR, TRACE_DRIVER, "WdfWaitLockCreate failed with status %!STATUS!", status);
+		WPP_CLEANUP(DriverObject);
+		return status;
+	}
+
+	if (!NT_SUCCESS(status = WdfWaitLockCreate(WDF_NO_OBJECT_ATTRIBUTES, &context->ConfigCache.Lock)))
+	{
+		TraceEvents(TRACE_LEVEL_ERROR, TRACE_DRIVER, "WdfWaitLockCreate failed with status %!STATUS!", status);
+		WPP_CLEANUP(DriverObject);
+		return status;
+	}
+
+	if (!NT_SUCCESS(status = WdfWaitLockCreate(WDF_NO_OBJECT_ATTRIBUTES, &context->ConfigWatcher.Lock)))
+	{
+		TraceEvents(TRACE_LEVEL_ERROR, TRACE_DRIVER, "WdfWaitLockCreate failed with status %!STATUS!", status);
+		WPP_CLEANUP(DriverObject);
+		return status;
+	}
+
+	LARGE_INTEGER freq, now;
+	QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&now);
+
+	DS_AIRTIME_BUDGET_INIT(
+		&context->BthAirtime.Budget,
+		DS_AIRTIME_DEFAULT_WRITES_PER_SECOND,
+		DS_AIRTIME_DEFAULT_BURST_WRITES,
+		freq.QuadPart,
+		now.QuadPart
+	);
+
 	TraceEvents(TRACE_LEVEL_INFORMATION, TRACE_DRIVER, "%!FUNC! Exit");
 
 	return status;
@@ -77,6 +110,13 @@ void dshidminiEvtDriverContextCleanup(WDFOBJECT DriverObject)
 
 	DestroyIPC();
 
+	const PDSHM_DRIVER_CONTEXT context = DriverGetContext(DriverObject);
+
+	ConfigWatcherStop(context);
+
+	ConfigCacheRelease(context->ConfigCache.Current);
+	context->ConfigCache.Current = NULL;
+
 	WPP_CLEANUP(WdfDriverWdmGetDriverObject( (WDFDRIVER) DriverObject));
 }
 #pragma code_seg()
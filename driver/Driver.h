@@ -18,10 +18,20 @@
 #include <DmfModules.Library.h>
 #include <DsHidMini/Ds3Types.h>
 #include <DsHidMini/ScpTypes.h>
+#include <DsHidMini/IpcHidRegion.h>
+#include <DsHidMini/IpcCommandRing.h>
+#include <DsHidMini/IpcOutputRing.h>
+#include <DsHidMini/IpcCounters.h>
+#include <DsHidMini/IpcMessages.h>
 #include "DsCommon.h"
 #include "DsHid.h"
+#include "Ds3.OutputState.h"
+#include "DsAirtime.h"
 #ifdef DSHM_FEATURE_FFB
 #include "PID/PIDTypes.h"
+#include "FFB.Blocks.h"
+#include "FFB.Engine.h"
+#include "FFB.Record.h"
 #endif
 
 //
@@ -80,6 +90,26 @@ typedef struct _DSHM_DRIVER_CONTEXT
 		// 
 		HANDLE WriteEvent;
 
+		//
+		// Signaled by clients after queuing commands in the command ring
+		// 
+		HANDLE CommandRingEvent;
+
+		//
+		// Per command ring slot, signaled once the reply is written
+		// 
+		HANDLE CommandReplyEvents[DSHM_IPC_CMD_SLOT_COUNT];
+
+		//
+		// Signaled by clients after appending output requests
+		// 
+		HANDLE OutputRingEvent;
+
+		//
+		// Signaled once any device slot gets marked in ChangedSlots
+		// 
+		HANDLE InputChangedEvent;
+
 		//
 		// Dispatch thread handle
 		// 
@@ -125,6 +155,75 @@ typedef struct _DSHM_DRIVER_CONTEXT
 				// 
 				size_t BufferSize;
 			} HID;
+
+			//
+			// Per-device output report telemetry, read-only for clients
+			// 
+			struct
+			{
+				//
+				// Pointer to shared memory buffer
+				// 
+				PUCHAR Buffer;
+
+				//
+				// Total size of shared memory region
+				// 
+				size_t BufferSize;
+			} Telemetry;
+
+			//
+			// Per-device input report history rings, read-only for clients
+			// 
+			struct
+			{
+				//
+				// Pointer to shared memory buffer, NULL if disabled
+				// 
+				PUCHAR Buffer;
+
+				//
+				// Total size of shared memory region
+				// 
+				size_t BufferSize;
+
+				//
+				// Entries per ring (power of two)
+				// 
+				ULONG Depth;
+			} History;
+
+			//
+			// Per-device output request rings, written by clients
+			// 
+			struct
+			{
+				//
+				// Pointer to shared memory buffer
+				// 
+				PUCHAR Buffer;
+
+				//
+				// Total size of shared memory region
+				// 
+				size_t BufferSize;
+			} Output;
+
+			//
+			// Per-device performance counters, read-only for clients
+			// 
+			struct
+			{
+				//
+				// Pointer to shared memory buffer
+				// 
+				PUCHAR Buffer;
+
+				//
+				// Total size of shared memory region
+				// 
+				size_t BufferSize;
+			} Counters;
 		} SharedRegions;
 
 		//
@@ -147,6 +246,69 @@ typedef struct _DSHM_DRIVER_CONTEXT
 	// Lock protecting access to Slots
 	// 
 	WDFWAITLOCK SlotsLock;
+
+	//
+	// HID control channel writes budget shared by all wireless devices
+	// 
+	struct
+	{
+		//
+		// Aggregate writes and fair shares
+		// 
+		DS_AIRTIME_BUDGET Budget;
+
+		//
+		// Lock protecting access to Budget
+		// 
+		WDFWAITLOCK Lock;
+	} BthAirtime;
+
+	//
+	// Configuration file content shared by all devices
+	// 
+	struct
+	{
+		//
+		// Most recently parsed configuration file, NULL until a device loaded it
+		// 
+		PDS_CONFIG_CACHE_ENTRY Current;
+
+		//
+		// Lock protecting access to Current, also serializes reading the file
+		// 
+		WDFWAITLOCK Lock;
+	} ConfigCache;
+
+	//
+	// Configuration directory watcher shared by all devices
+	// 
+	struct
+	{
+		//
+		// Change notification of the configuration directory
+		// 
+		HANDLE ChangeEvent;
+
+		//
+		// Wait handle for ChangeEvent
+		// 
+		HANDLE WaitHandle;
+
+		//
+		// Delays reloading until a burst of changes is over
+		// 
+		PTP_TIMER DebounceTimer;
+
+		//
+		// Devices to push reloaded configuration to, NULL entries are unused
+		// 
+		PDEVICE_CONTEXT Devices[DSHM_MAX_DEVICES];
+
+		//
+		// Lock protecting access to all of the above
+		// 
+		WDFWAITLOCK Lock;
+	} ConfigWatcher;
 } DSHM_DRIVER_CONTEXT, * PDSHM_DRIVER_CONTEXT;
 
 WDF_DECLARE_CONTEXT_TYPE_WITH_NAME(DSHM_DRIVER_CONTEXT, DriverGetContext)
@@ -0,0 +1,264 @@
+#include "Ds3.OutputState.h"
+
+//
+// NOTE: this module must stay free of WDF, DMF and WPP dependencies
+//
+
+//
+// Offsets past the Report ID byte, i.e. into the buffer DS3_GET_UNIFIED_OUTPUT_REPORT_BUFFER
+// returns. The buffer DS3_GET_RAW_OUTPUT_REPORT_BUFFER returns starts
+// DS3_OUTPUT_REPORT_FORMAT_PREFIX bytes earlier.
+//
+#define DS3_OUTPUT_OFFSET_SMALL_MOTOR_DURATION	1
+#define DS3_OUTPUT_OFFSET_SMALL_MOTOR_STRENGTH	2
+#define DS3_OUTPUT_OFFSET_LARGE_MOTOR_DURATION	3
+#define DS3_OUTPUT_OFFSET_LARGE_MOTOR_STRENGTH	4
+#define DS3_OUTPUT_OFFSET_LED_FLAGS				9
+#define DS3_OUTPUT_OFFSET_LED_BLOCKS			10
+#define DS3_OUTPUT_LED_BLOCK_SIZE				5
+
+//
+// Bytes up to and including the Report ID byte
+//
+static SIZE_T DS3_OUTPUT_REPORT_FORMAT_PREFIX(
+	DS3_OUTPUT_REPORT_FORMAT Format
+)
+{
+	return (Format == Ds3OutputReportFormatBth) ? 2 : 1;
+}
+
+//
+// LED blocks are stored in reverse order (Player 4 first)
+//
+static SIZE_T DS3_OUTPUT_LED_BLOCK_OFFSET(
+	SIZE_T Prefix,
+	UCHAR LedIndex
+)
+{
+	return Prefix + DS3_OUTPUT_OFFSET_LED_BLOCKS + ((3 - LedIndex) * DS3_OUTPUT_LED_BLOCK_SIZE);
+}
+
+//
+// Resets state to what G_Ds3UsbHidOutputReport/G_Ds3BthHidOutputReport carry
+//
+VOID DS3_OUTPUT_STATE_INIT(
+	PDS3_OUTPUT_STATE State
+)
+{
+	RtlZeroMemory(State, sizeof(DS3_OUTPUT_STATE));
+
+	for (UCHAR index = 0; index < ARRAYSIZE(State->Leds); index++)
+	{
+		State->Leds[index].TotalDuration = 0xFF;
+		State->Leds[index].BasePortionDuration = 0x2710;
+		State->Leds[index].OffPortionMultiplier = 0x00;
+		State->Leds[index].OnPortionMultiplier = 0x32;
+	}
+
+	State->SmallMotor.Duration = 0xFF;
+	State->LargeMotor.Duration = 0xFF;
+
+	//
+	// First serialization writes everything
+	//
+	State->DirtyFlags = DS3_OUTPUT_DIRTY_ALL;
+}
+
+//
+// Pins (or releases) fields so only the owner of the lock may alter them
+//
+VOID DS3_OUTPUT_STATE_SET_LOCKED_FIELDS(
+	PDS3_OUTPUT_STATE State,
+	ULONG Fields
+)
+{
+	State->LockedFields = Fields & DS3_OUTPUT_DIRTY_ALL;
+}
+
+VOID DS3_OUTPUT_STATE_SET_LED_FLAGS(
+	PDS3_OUTPUT_STATE State,
+	UCHAR Value
+)
+{
+	if ((State->LockedFields & DS3_OUTPUT_DIRTY_LED_FLAGS) || State->LedFlags == Value)
+		return;
+
+	State->LedFlags = Value;
+	DS3_OUTPUT_STATE_MARK_DIRTY(State, DS3_OUTPUT_DIRTY_LED_FLAGS);
+}
+
+VOID DS3_OUTPUT_STATE_SET_LED(
+	PDS3_OUTPUT_STATE State,
+	UCHAR LedIndex,
+	UCHAR TotalDuration,
+	USHORT BasePortionDuration,
+	UCHAR OffPortionMultiplier,
+	UCHAR OnPortionMultiplier
+)
+{
+	if (LedIndex > 3 || (State->LockedFields & DS3_OUTPUT_DIRTY_LED(LedIndex)))
+		return;
+
+	const PDS3_OUTPUT_LED_STATE led = &State->Leds[LedIndex];
+
+	if (led->TotalDuration == TotalDuration
+		&& led->BasePortionDuration == BasePortionDuration
+		&& led->OffPortionMultiplier == OffPortionMultiplier
+		&& led->OnPortionMultiplier == OnPortionMultiplier)
+		return;
+
+	led->TotalDuration = TotalDuration;
+	led->BasePortionDuration = BasePortionDuration;
+	led->OffPortionMultiplier = OffPortionMultiplier;
+	led->OnPortionMultiplier = OnPortionMultiplier;
+	DS3_OUTPUT_STATE_MARK_DIRTY(State, DS3_OUTPUT_DIRTY_LED(LedIndex));
+}
+
+VOID DS3_OUTPUT_STATE_SET_SMALL_MOTOR_DURATION(
+	PDS3_OUTPUT_STATE State,
+	UCHAR Value
+)
+{
+	if (State->SmallMotor.Duration == Value)
+		return;
+
+	State->SmallMotor.Duration = Value;
+	DS3_OUTPUT_STATE_MARK_DIRTY(State, DS3_OUTPUT_DIRTY_SMALL_MOTOR_DURATION);
+}
+
+VOID DS3_OUTPUT_STATE_SET_LARGE_MOTOR_DURATION(
+	PDS3_OUTPUT_STATE State,
+	UCHAR Value
+)
+{
+	if (State->LargeMotor.Duration == Value)
+		return;
+
+	State->LargeMotor.Duration = Value;
+	DS3_OUTPUT_STATE_MARK_DIRTY(State, DS3_OUTPUT_DIRTY_LARGE_MOTOR_DURATION);
+}
+
+VOID DS3_OUTPUT_STATE_SET_MOTOR_STRENGTHS(
+	PDS3_OUTPUT_STATE State,
+	UCHAR LargeValue,
+	UCHAR SmallValue
+)
+{
+	ULONG dirty = 0;
+
+	if (State->LargeMotor.Strength != LargeValue)
+	{
+		State->LargeMotor.Strength = LargeValue;
+		dirty |= DS3_OUTPUT_DIRTY_LARGE_MOTOR_STRENGTH;
+	}
+
+	if (State->SmallMotor.Strength != SmallValue)
+	{
+		State->SmallMotor.Strength = SmallValue;
+		dirty |= DS3_OUTPUT_DIRTY_SMALL_MOTOR_STRENGTH;
+	}
+
+	if (dirty)
+		DS3_OUTPUT_STATE_MARK_DIRTY(State, dirty);
+}
+
+//
+// Compiles the requested fields into an existing wire report in one pass.
+// Returns TRUE if at least one field got written.
+//
+BOOLEAN DS3_OUTPUT_STATE_SERIALIZE(
+	const DS3_OUTPUT_STATE* State,
+	ULONG DirtyFlags,
+	DS3_OUTPUT_REPORT_FORMAT Format,
+	PUCHAR Buffer,
+	SIZE_T BufferLength
+)
+{
+	const SIZE_T prefix = DS3_OUTPUT_REPORT_FORMAT_PREFIX(Format);
+
+	if (!(DirtyFlags & DS3_OUTPUT_DIRTY_ALL) || BufferLength < DS3_OUTPUT_REPORT_FORMAT_SIZE(Format))
+		return FALSE;
+
+	if (DirtyFlags & DS3_OUTPUT_DIRTY_SMALL_MOTOR_DURATION)
+		Buffer[prefix + DS3_OUTPUT_OFFSET_SMALL_MOTOR_DURATION] = State->SmallMotor.Duration;
+
+	//
+	// Small motor only knows on or off
+	//
+	if (DirtyFlags & DS3_OUTPUT_DIRTY_SMALL_MOTOR_STRENGTH)
+		Buffer[prefix + DS3_OUTPUT_OFFSET_SMALL_MOTOR_STRENGTH] = State->SmallMotor.Strength > 0 ? 0x01 : 0x00;
+
+	if (DirtyFlags & DS3_OUTPUT_DIRTY_LARGE_MOTOR_DURATION)
+		Buffer[prefix + DS3_OUTPUT_OFFSET_LARGE_MOTOR_DURATION] = State->LargeMotor.Duration;
+
+	if (DirtyFlags & DS3_OUTPUT_DIRTY_LARGE_MOTOR_STRENGTH)
+		Buffer[prefix + DS3_OUTPUT_OFFSET_LARGE_MOTOR_STRENGTH] = State->LargeMotor.Strength;
+
+	if (DirtyFlags & DS3_OUTPUT_DIRTY_LED_FLAGS)
+		Buffer[prefix + DS3_OUTPUT_OFFSET_LED_FLAGS] = State->LedFlags;
+
+	for (UCHAR index = 0; index < ARRAYSIZE(State->Leds); index++)
+	{
+		if (!(DirtyFlags & DS3_OUTPUT_DIRTY_LED(index)))
+			continue;
+
+		const PUCHAR block = &Buffer[DS3_OUTPUT_LED_BLOCK_OFFSET(prefix, index)];
+		const DS3_OUTPUT_LED_STATE* led = &State->Leds[index];
+
+		block[0] = led->TotalDuration;
+		block[1] = (UCHAR)(led->BasePortionDuration >> 8);
+		block[2] = (UCHAR)(led->BasePortionDuration & 0xFF);
+		block[3] = led->OffPortionMultiplier;
+		block[4] = led->OnPortionMultiplier;
+	}
+
+	return TRUE;
+}
+
+//
+// Imports fields from a wire report (e.g. supplied by a pass-through client)
+//
+VOID DS3_OUTPUT_STATE_PARSE(
+	PDS3_OUTPUT_STATE State,
+	ULONG Fields,
+	DS3_OUTPUT_REPORT_FORMAT Format,
+	const UCHAR* Buffer,
+	SIZE_T BufferLength
+)
+{
+	const SIZE_T prefix = DS3_OUTPUT_REPORT_FORMAT_PREFIX(Format);
+
+	if (BufferLength < DS3_OUTPUT_REPORT_FORMAT_SIZE(Format))
+		return;
+
+	Fields &= ~State->LockedFields;
+
+	if (Fields & DS3_OUTPUT_DIRTY_SMALL_MOTOR_DURATION)
+		State->SmallMotor.Duration = Buffer[prefix + DS3_OUTPUT_OFFSET_SMALL_MOTOR_DURATION];
+
+	if (Fields & DS3_OUTPUT_DIRTY_SMALL_MOTOR_STRENGTH)
+		State->SmallMotor.Strength = Buffer[prefix + DS3_OUTPUT_OFFSET_SMALL_MOTOR_STRENGTH];
+
+	if (Fields & DS3_OUTPUT_DIRTY_LARGE_MOTOR_DURATION)
+		State->LargeMotor.Duration = Buffer[prefix + DS3_OUTPUT_OFFSET_LARGE_MOTOR_DURATION];
+
+	if (Fields & DS3_OUTPUT_DIRTY_LARGE_MOTOR_STRENGTH)
+		State->LargeMotor.Strength = Buffer[prefix + DS3_OUTPUT_OFFSET_LARGE_MOTOR_STRENGTH];
+
+	if (Fields & DS3_OUTPUT_DIRTY_LED_FLAGS)
+		State->LedFlags = Buffer[prefix + DS3_OUTPUT_OFFSET_LED_FLAGS];
+
+	for (UCHAR index = 0; index < ARRAYSIZE(State->Leds); index++)
+	{
+		if (!(Fields & DS3_OUTPUT_DIRTY_LED(index)))
+			continue;
+
+		const UCHAR* block = &Buffer[DS3_OUTPUT_LED_BLOCK_OFFSET(prefix, index)];
+		const PDS3_OUTPUT_LED_STATE led = &State->Leds[index];
+
+		led->TotalDuration = block[0];
+		led->BasePortionDuration = (USHORT)((block[1] << 8) | block[2]);
+		led->OffPortionMultiplier = block[3];
+		led->OnPortionMultiplier = block[4];
+	}
+}
@@ -0,0 +1,199 @@
+#pragma once
+
+#include "DsPortable.h"
+
+EXTERN_C_START
+
+//
+// Wire format the output state gets compiled to
+//
+typedef enum
+{
+	//
+	// 0x31 bytes, Report ID prefix
+	//
+	Ds3OutputReportFormatUsb,
+	//
+	// 0x32 bytes, HID BT SET_REPORT and Report ID prefix
+	//
+	Ds3OutputReportFormatBth
+
+} DS3_OUTPUT_REPORT_FORMAT;
+
+//
+// Properties of a single Player LED
+//
+typedef struct _DS3_OUTPUT_LED_STATE
+{
+	UCHAR TotalDuration;
+
+	USHORT BasePortionDuration;
+
+	UCHAR OffPortionMultiplier;
+
+	UCHAR OnPortionMultiplier;
+
+} DS3_OUTPUT_LED_STATE, * PDS3_OUTPUT_LED_STATE;
+
+//
+// Properties of a single motor
+//
+typedef struct _DS3_OUTPUT_MOTOR_STATE
+{
+	UCHAR Duration;
+
+	//
+	// Final (post rescaling) strength
+	//
+	UCHAR Strength;
+
+} DS3_OUTPUT_MOTOR_STATE, * PDS3_OUTPUT_MOTOR_STATE;
+
+//
+// Fields of DS3_OUTPUT_STATE pending to be written to the wire buffer
+//
+#define DS3_OUTPUT_DIRTY_LED_FLAGS				0x00000001
+#define DS3_OUTPUT_DIRTY_LED(_index_)			(0x00000002 << (_index_))
+#define DS3_OUTPUT_DIRTY_LEDS					0x0000001E
+#define DS3_OUTPUT_DIRTY_SMALL_MOTOR_DURATION	0x00000020
+#define DS3_OUTPUT_DIRTY_SMALL_MOTOR_STRENGTH	0x00000040
+#define DS3_OUTPUT_DIRTY_LARGE_MOTOR_DURATION	0x00000080
+#define DS3_OUTPUT_DIRTY_LARGE_MOTOR_STRENGTH	0x00000100
+#define DS3_OUTPUT_DIRTY_MOTORS					0x000001E0
+#define DS3_OUTPUT_DIRTY_ALL					0x000001FF
+
+//
+// Desired output state (LEDs and rumble) independent of connection type
+//
+typedef struct _DS3_OUTPUT_STATE
+{
+	//
+	// Player LED enable bits (DS3_LED_*)
+	//
+	UCHAR LedFlags;
+
+	//
+	// Player LED properties, index 0 is Player 1
+	//
+	DS3_OUTPUT_LED_STATE Leds[4];
+
+	//
+	// Right (light) motor, on/off only
+	//
+	DS3_OUTPUT_MOTOR_STATE SmallMotor;
+
+	//
+	// Left (heavy) motor
+	//
+	DS3_OUTPUT_MOTOR_STATE LargeMotor;
+
+	//
+	// DS3_OUTPUT_DIRTY_* bits of fields changed since last serialization
+	//
+	volatile LONG DirtyFlags;
+
+	//
+	// DS3_OUTPUT_DIRTY_* bits of fields pinned by configuration (e.g. custom LED
+	// pattern) which regular setters and pass-through imports must not touch
+	//
+	ULONG LockedFields;
+
+} DS3_OUTPUT_STATE, * PDS3_OUTPUT_STATE;
+
+//
+// Flags a set of fields to be emitted with the next serialization
+//
+FORCEINLINE VOID DS3_OUTPUT_STATE_MARK_DIRTY(
+	_Inout_ PDS3_OUTPUT_STATE State,
+	_In_ ULONG Flags
+)
+{
+	DS_ATOMIC_OR(&State->DirtyFlags, (LONG)Flags);
+}
+
+//
+// Takes ownership of all currently pending dirty bits
+//
+FORCEINLINE ULONG DS3_OUTPUT_STATE_TAKE_DIRTY(
+	_Inout_ PDS3_OUTPUT_STATE State
+)
+{
+	return (ULONG)DS_ATOMIC_EXCHANGE(&State->DirtyFlags, 0);
+}
+
+//
+// TRUE if any of the motors is currently spinning
+//
+FORCEINLINE BOOLEAN DS3_OUTPUT_STATE_IS_RUMBLE_ACTIVE(
+	_In_ const DS3_OUTPUT_STATE* State
+)
+{
+	return (State->SmallMotor.Strength > 0 || State->LargeMotor.Strength > 0);
+}
+
+//
+// Wire report size for a given format
+//
+FORCEINLINE SIZE_T DS3_OUTPUT_REPORT_FORMAT_SIZE(
+	_In_ DS3_OUTPUT_REPORT_FORMAT Format
+)
+{
+	return (Format == Ds3OutputReportFormatBth) ? 0x32 : 0x31;
+}
+
+VOID DS3_OUTPUT_STATE_INIT(
+	_Out_ PDS3_OUTPUT_STATE State
+);
+
+VOID DS3_OUTPUT_STATE_SET_LOCKED_FIELDS(
+	_Inout_ PDS3_OUTPUT_STATE State,
+	_In_ ULONG Fields
+);
+
+VOID DS3_OUTPUT_STATE_SET_LED_FLAGS(
+	_Inout_ PDS3_OUTPUT_STATE State,
+	_In_ UCHAR Value
+);
+
+VOID DS3_OUTPUT_STATE_SET_LED(
+	_Inout_ PDS3_OUTPUT_STATE State,
+	_In_ UCHAR LedIndex,
+	_In_ UCHAR TotalDuration,
+	_In_ USHORT BasePortionDuration,
+	_In_ UCHAR OffPortionMultiplier,
+	_In_ UCHAR OnPortionMultiplier
+);
+
+VOID DS3_OUTPUT_STATE_SET_SMALL_MOTOR_DURATION(
+	_Inout_ PDS3_OUTPUT_STATE State,
+	_In_ UCHAR Value
+);
+
+VOID DS3_OUTPUT_STATE_SET_LARGE_MOTOR_DURATION(
+	_Inout_ PDS3_OUTPUT_STATE State,
+	_In_ UCHAR Value
+);
+
+VOID DS3_OUTPUT_STATE_SET_MOTOR_STRENGTHS(
+	_Inout_ PDS3_OUTPUT_STATE State,
+	_In_ UCHAR LargeValue,
+	_In_ UCHAR SmallValue
+);
+
+BOOLEAN DS3_OUTPUT_STATE_SERIALIZE(
+	_In_ const DS3_OUTPUT_STATE* State,
+	_In_ ULONG DirtyFlags,
+	_In_ DS3_OUTPUT_REPORT_FORMAT Format,
+	_Inout_updates_bytes_(BufferLength) PUCHAR Buffer,
+	_In_ SIZE_T BufferLength
+);
+
+VOID DS3_OUTPUT_STATE_PARSE(
+	_Inout_ PDS3_OUTPUT_STATE State,
+	_In_ ULONG Fields,
+	_In_ DS3_OUTPUT_REPORT_FORMAT Format,
+	_In_reads_bytes_(BufferLength) const UCHAR* Buffer,
+	_In_ SIZE_T BufferLength
+);
+
+EXTERN_C_END
@@ -413,12 +413,19 @@ NTSTATUS DsUsb_Ds3PairToNewHost(WDFDEVICE Device)
 	NTSTATUS status = STATUS_UNSUCCESSFUL;
 	const PDEVICE_CONTEXT pDevCtx = DeviceGetContext(Device);
 	BD_ADDR newHostAddress = { 0 };
+	BD_ADDR customHostAddress;
+	LONG epoch;
 
 	FuncEntry(TRACE_DS3);
 
+	const DS_CONFIG_SNAPSHOT* config = DS_CONFIG_READ_BEGIN(pDevCtx, &epoch);
+	const DS_DEVICE_PAIRING_MODE pairingMode = config->Configuration.DevicePairingMode;
+	RtlCopyMemory(customHostAddress.Address, config->Configuration.CustomHostAddress, sizeof(BD_ADDR));
+	DS_CONFIG_READ_END(pDevCtx, epoch);
+
 	do
 	{
-		if (pDevCtx->Configuration.DevicePairingMode == DsDevicePairingModeDisabled)
+		if (pairingMode == DsDevicePairingModeDisabled)
 		{
 			TraceInformation(
 				TRACE_DS3,
@@ -428,7 +435,7 @@ NTSTATUS DsUsb_Ds3PairToNewHost(WDFDEVICE Device)
 			break;
 		}
 
-		if (pDevCtx->Configuration.DevicePairingMode == DsDevicePairingModeAuto)
+		if (pairingMode == DsDevicePairingModeAuto)
 		{
 			TraceInformation(
 				TRACE_DS3,
@@ -448,17 +455,14 @@ NTSTATUS DsUsb_Ds3PairToNewHost(WDFDEVICE Device)
 		//
 		// Use configured custom mac address if in custom mode
 		//
-		if (pDevCtx->Configuration.DevicePairingMode == DsDevicePairingModeCustom)
+		if (pairingMode == DsDevicePairingModeCustom)
 		{
 			TraceInformation(
 				TRACE_DS3,
 				"Pairing device to user defined MAC address"
 			);
 
-			for (int i = 0; i < sizeof(BD_ADDR); i++)
-			{
-				newHostAddress.Address[i] = pDevCtx->Configuration.CustomHostAddress[i];
-			}
+			newHostAddress = customHostAddress;
 		}
 
 		//
@@ -558,25 +562,14 @@ VOID DS3_SET_LED_DURATION(
 	UCHAR OnPortionMultiplier
 )
 {
-	if (LedIndex > 3)
-		return;
-
-	// Inverse
-	LedIndex = 3 - LedIndex;
-
-	PUCHAR buffer;
-
-	DS3_GET_UNIFIED_OUTPUT_REPORT_BUFFER(
-		Context,
-		&buffer,
-		NULL
+	DS3_OUTPUT_STATE_SET_LED(
+		&Context->OutputReport.State,
+		LedIndex,
+		TotalDuration,
+		BasePortionDuration,
+		OffPortionMultiplier,
+		OnPortionMultiplier
 	);
-
-	buffer[10 + (LedIndex * 5)] = TotalDuration;
-	buffer[11 + (LedIndex * 5)] = BasePortionDuration >> 8;
-	buffer[12 + (LedIndex * 5)] = BasePortionDuration & 0xFF;
-	buffer[13 + (LedIndex * 5)] = OffPortionMultiplier;
-	buffer[14 + (LedIndex * 5)] = OnPortionMultiplier;
 }
 
 //
@@ -594,6 +587,107 @@ VOID DS3_SET_LED_DURATION_DEFAULT(PDEVICE_CONTEXT Context, UCHAR LedIndex)
 	);
 }
 
+//
+// Bakes the configured LED pattern into the output state and pins it there.
+// Called on configuration (re-)load so the send path never has to touch it.
+// 
+VOID DS3_APPLY_LED_SETTINGS(
+	PDEVICE_CONTEXT Context
+)
+{
+	const PDS_LED_SETTINGS pLED = &Context->Configuration.LEDSettings;
+	const PDS3_OUTPUT_STATE pState = &Context->OutputReport.State;
+
+	WdfWaitLockAcquire(Context->OutputReport.Lock, NULL);
+
+	const BOOLEAN wasPinned = (pState->LockedFields & DS3_OUTPUT_DIRTY_LEDS) != 0;
+
+	//
+	// Release pinned fields so a previously active pattern can be replaced
+	// 
+	DS3_OUTPUT_STATE_SET_LOCKED_FIELDS(pState, 0);
+
+	if (pLED->Mode == DsLEDModeCustomPattern)
+	{
+		const DS_LED* pPlayerSlots[] =
+		{
+			&pLED->CustomPatterns.Player1,
+			&pLED->CustomPatterns.Player2,
+			&pLED->CustomPatterns.Player3,
+			&pLED->CustomPatterns.Player4,
+		};
+
+		DS3_OUTPUT_STATE_SET_LED_FLAGS(pState, pLED->CustomPatterns.LEDFlags);
+
+		for (UCHAR index = 0; index < ARRAYSIZE(pPlayerSlots); index++)
+		{
+			DS3_OUTPUT_STATE_SET_LED(
+				pState,
+				index,
+				pPlayerSlots[index]->TotalDuration,
+				pPlayerSlots[index]->BasePortionDuration,
+				pPlayerSlots[index]->OffPortionMultiplier,
+				pPlayerSlots[index]->OnPortionMultiplier
+			);
+		}
+
+		//
+		// Battery status, DS4 lightbar and pass-through updates can no longer override it
+		// 
+		DS3_OUTPUT_STATE_SET_LOCKED_FIELDS(pState, DS3_OUTPUT_DIRTY_LED_FLAGS | DS3_OUTPUT_DIRTY_LEDS);
+	}
+	//
+	// Other modes expect the default durations, don't leave the custom ones behind
+	// 
+	else if (wasPinned)
+	{
+		for (UCHAR index = 0; index < ARRAYSIZE(pState->Leds); index++)
+		{
+			DS3_SET_LED_DURATION_DEFAULT(Context, index);
+		}
+	}
+
+	WdfWaitLockRelease(Context->OutputReport.Lock);
+}
+
+//
+// Wire format matching the connection type
+// 
+DS3_OUTPUT_REPORT_FORMAT DS3_GET_OUTPUT_REPORT_FORMAT(
+	PDEVICE_CONTEXT Context
+)
+{
+	return (Context->ConnectionType == DsDeviceConnectionTypeBth)
+		? Ds3OutputReportFormatBth
+		: Ds3OutputReportFormatUsb;
+}
+
+//
+// Compiles pending output state changes into the output report buffer
+// 
+BOOLEAN DS3_SERIALIZE_OUTPUT_REPORT(
+	PDEVICE_CONTEXT Context
+)
+{
+	PUCHAR buffer;
+	size_t bufferLength;
+
+	DS3_GET_RAW_OUTPUT_REPORT_BUFFER(
+		Context,
+		&buffer,
+		&bufferLength
+	);
+
+	return DS3_OUTPUT_STATE_SERIALIZE(
+		&Context->OutputReport.State,
+		DS3_OUTPUT_STATE_TAKE_DIRTY(&Context->OutputReport.State),
+		DS3_GET_OUTPUT_REPORT_FORMAT(Context),
+		buffer,
+		bufferLength
+	);
+}
+
+
 //
 // Gets output report protocol-agnostic
 // 
@@ -662,28 +756,7 @@ VOID DS3_SET_LED_FLAGS(
 	UCHAR Value
 )
 {
-	switch (Context->ConnectionType)
-	{
-	case DsDeviceConnectionTypeUsb:
-
-		DS3_USB_SET_LED(
-			(PUCHAR)WdfMemoryGetBuffer(
-				Context->OutputReportMemory,
-				NULL
-			), Value);
-
-		break;
-
-	case DsDeviceConnectionTypeBth:
-
-		DS3_BTH_SET_LED(
-			(PUCHAR)WdfMemoryGetBuffer(
-				Context->OutputReportMemory,
-				NULL
-			), Value);
-
-		break;
-	}
+	DS3_OUTPUT_STATE_SET_LED_FLAGS(&Context->OutputReport.State, Value);
 }
 
 //
@@ -693,26 +766,7 @@ UCHAR DS3_GET_LED_FLAGS(
 	PDEVICE_CONTEXT Context
 )
 {
-	switch (Context->ConnectionType)
-	{
-	case DsDeviceConnectionTypeUsb:
-
-		return DS3_USB_GET_LED(
-			(PUCHAR)WdfMemoryGetBuffer(
-				Context->OutputReportMemory,
-				NULL
-			));
-
-	case DsDeviceConnectionTypeBth:
-
-		return DS3_BTH_GET_LED(
-			(PUCHAR)WdfMemoryGetBuffer(
-				Context->OutputReportMemory,
-				NULL
-			));
-	}
-
-	return 0x00;
+	return Context->OutputReport.State.LedFlags;
 }
 
 VOID DS3_SET_SMALL_RUMBLE_DURATION(
@@ -720,26 +774,7 @@ VOID DS3_SET_SMALL_RUMBLE_DURATION(
 	UCHAR Value
 )
 {
-	switch (Context->ConnectionType)
-	{
-	case DsDeviceConnectionTypeUsb:
-
-		DS3_USB_SET_SMALL_RUMBLE_DURATION(
-			(PUCHAR)WdfMemoryGetBuffer(
-				Context->OutputReportMemory,
-				NULL
-			), Value);
-		break;
-
-	case DsDeviceConnectionTypeBth:
-
-		DS3_BTH_SET_SMALL_RUMBLE_DURATION(
-			(PUCHAR)WdfMemoryGetBuffer(
-				Context->OutputReportMemory,
-				NULL
-			), Value);
-		break;
-	}
+	DS3_OUTPUT_STATE_SET_SMALL_MOTOR_DURATION(&Context->OutputReport.State, Value);
 }
 
 VOID DS3_SET_SMALL_RUMBLE_STRENGTH(
@@ -756,26 +791,7 @@ VOID DS3_SET_LARGE_RUMBLE_DURATION(
 	UCHAR Value
 )
 {
-	switch (Context->ConnectionType)
-	{
-	case DsDeviceConnectionTypeUsb:
-
-		DS3_USB_SET_LARGE_RUMBLE_DURATION(
-			(PUCHAR)WdfMemoryGetBuffer(
-				Context->OutputReportMemory,
-				NULL
-			), Value);
-		break;
-
-	case DsDeviceConnectionTypeBth:
-
-		DS3_BTH_SET_LARGE_RUMBLE_DURATION(
-			(PUCHAR)WdfMemoryGetBuffer(
-				Context->OutputReportMemory,
-				NULL
-			), Value);
-		break;
-	}
+	DS3_OUTPUT_STATE_SET_LARGE_MOTOR_DURATION(&Context->OutputReport.State, Value);
 }
 
 VOID DS3_SET_LARGE_RUMBLE_STRENGTH(
@@ -802,95 +818,44 @@ VOID DS3_PROCESS_RUMBLE_STRENGTH(
 	PDEVICE_CONTEXT Context
 )
 {
-	DS_RUMBLE_SETTINGS* rumbSet = &Context->Configuration.RumbleSettings;
-
-	DS_RESCALE_STATE* heavyResc = &Context->RumbleControlState.HeavyRescale;
-	DS_RESCALE_STATE* lightResc = &Context->RumbleControlState.AltMode.LightRescale;
+	LONG epoch;
+	const DS_CONFIG_SNAPSHOT* config = DS_CONFIG_READ_BEGIN(Context, &epoch);
+	const DS_RUMBLE_SETTINGS* rumbSet = &config->Configuration.RumbleSettings;
 
 	// Get last received rumble values so they can be processed
-	DOUBLE heavyRumble = Context->RumbleControlState.HeavyCache;
-	DOUBLE lightRumble = Context->RumbleControlState.LightCache;
+	const UCHAR heavyCache = Context->RumbleControlState.HeavyCache;
+	const UCHAR lightCache = Context->RumbleControlState.LightCache;
+
+	UCHAR heavyRumble;
+	UCHAR lightRumble;
 
-	// LINEAR RANGE RESCALLING
-	// 
-	// To rescale a value that exists in a range into a new range:
-	// newvalue = a * value + b
-	//
-	// a = (max'-min')/(max-min)
-	// b = max' - a * max
 	//
-	// In which max and min are the limits of the the original range
-	// For the DS3 rumble, it's max = 255 and min = 1 since 0 is not considered.
+	// Rescaling tables are precomputed on configuration (re-)loading
 	// 
-	// max' and min' are the limits of the new range
-	// 0 is not considered for the new range too regarding rumble
-	//
-	// constants a and b are calculated on configuration (re-)loading
 
-	if (Context->RumbleControlState.AltMode.IsEnabled && lightResc->IsAllowed)
+	if (Context->RumbleControlState.AltMode.IsEnabled && config->LightRescale.IsAllowed)
 	{
-		if (lightRumble > 0) {
+		// Light Motor Strength gets merged into Heavy Motor
+		const UCHAR heavyFromHeavy = config->HeavyRescale.Table[heavyCache];
+		const UCHAR heavyFromLight = config->LightRescale.Table[lightCache];
 
-			// Light Motor Strength Rescale 
-			lightRumble = lightResc->ConstA * lightRumble + lightResc->ConstB;
-			if (lightRumble > heavyRumble)
-			{
-				heavyRumble = lightRumble;
-			}
-			lightRumble = 0; // Always disable Light Motor after the if statement above
-		}
+		heavyRumble = (heavyFromLight > heavyFromHeavy) ? heavyFromLight : heavyFromHeavy;
 
 		// Force Activate right motor if original heavy or light values are above their respective thresholds
-		if (
-			(rumbSet->AlternativeMode.ForcedRight.IsHeavyThresholdEnabled && (Context->RumbleControlState.HeavyCache >= rumbSet->AlternativeMode.ForcedRight.HeavyThreshold))
-			||
-			(rumbSet->AlternativeMode.ForcedRight.IsLightThresholdEnabled && (Context->RumbleControlState.LightCache >= rumbSet->AlternativeMode.ForcedRight.LightThreshold))
-			)
-		{
-			lightRumble = 1;
-		}
+		lightRumble = (heavyCache >= config->ForcedRightHeavyThreshold
+			|| lightCache >= config->ForcedRightLightThreshold) ? 1 : 0;
 	}
 	else
 	{
-		if (rumbSet->DisableLeft) heavyRumble = 0;
-		if (rumbSet->DisableRight) lightRumble = 0;
-	}
-
-	// Heavy Motor Strength Rescale
-	if (heavyRumble > 0 && Context->RumbleControlState.HeavyRescaleEnabled && heavyResc->IsAllowed)
-	{
-		heavyRumble = heavyResc->ConstA * heavyRumble + heavyResc->ConstB;
+		heavyRumble = rumbSet->DisableLeft ? 0 : config->HeavyRescale.Table[heavyCache];
+		lightRumble = rumbSet->DisableRight ? 0 : lightCache;
 	}
 
-	switch (Context->ConnectionType)
-	{
-	case DsDeviceConnectionTypeUsb:
-
-		DS3_USB_SET_LARGE_RUMBLE_STRENGTH(
-			(PUCHAR)WdfMemoryGetBuffer(
-				Context->OutputReportMemory,
-				NULL
-			), (UCHAR)heavyRumble);
-		DS3_USB_SET_SMALL_RUMBLE_STRENGTH(
-			(PUCHAR)WdfMemoryGetBuffer(
-				Context->OutputReportMemory,
-				NULL
-			), (UCHAR)lightRumble);
-		break;
-
-	case DsDeviceConnectionTypeBth:
-
-		DS3_BTH_SET_LARGE_RUMBLE_STRENGTH(
-			(PUCHAR)WdfMemoryGetBuffer(
-				Context->OutputReportMemory,
-				NULL
-			), (UCHAR)heavyRumble);
-		DS3_BTH_SET_SMALL_RUMBLE_STRENGTH(
-			(PUCHAR)WdfMemoryGetBuffer(
-				Context->OutputReportMemory,
-				NULL
-			), (UCHAR)lightRumble);
-		break;
-	}
+	DS_CONFIG_READ_END(Context, epoch);
 
+	DS3_OUTPUT_STATE_SET_MOTOR_STRENGTHS(
+		&Context->OutputReport.State,
+		heavyRumble,
+		lightRumble
+	);
 }
@@ -17,22 +17,6 @@ extern const UCHAR G_Ds3BthHidOutputReport[];
 #define DS3_LED_4       0x10
 #define DS3_LED_OFF     0x20
 
-#define DS3_USB_SET_LED(_buf_, _led_)   ((_buf_)[10] = (_led_))
-#define DS3_USB_GET_LED(_buf_)          ((_buf_)[10])
-
-#define DS3_USB_SET_SMALL_RUMBLE_DURATION(_buf_, _dur_)  ((_buf_)[2] = (_dur_))
-#define DS3_USB_SET_LARGE_RUMBLE_DURATION(_buf_, _dur_)  ((_buf_)[4] = (_dur_))
-#define DS3_USB_SET_SMALL_RUMBLE_STRENGTH(_buf_, _str_)  ((_buf_)[3] = (_str_) > 0 ? 0x01 : 0x00)
-#define DS3_USB_SET_LARGE_RUMBLE_STRENGTH(_buf_, _str_)  ((_buf_)[5] = (_str_))
-
-#define DS3_BTH_SET_LED(_buf_, _led_)   ((_buf_)[11] = (_led_))
-#define DS3_BTH_GET_LED(_buf_)          ((_buf_)[11])
-
-#define DS3_BTH_SET_SMALL_RUMBLE_DURATION(_buf_, _dur_)  ((_buf_)[3] = (_dur_))
-#define DS3_BTH_SET_LARGE_RUMBLE_DURATION(_buf_, _dur_)  ((_buf_)[5] = (_dur_))
-#define DS3_BTH_SET_SMALL_RUMBLE_STRENGTH(_buf_, _str_)  ((_buf_)[4] = (_str_) > 0 ? 0x01 : 0x00)
-#define DS3_BTH_SET_LARGE_RUMBLE_STRENGTH(_buf_, _str_)  ((_buf_)[6] = (_str_))
-
 #define DS3_USB_COMMON_ENABLE		0x42, 0x0C, 0x00, 0x00
 #define DS3_USB_COMMON_DISABLE		0x42, 0x0B, 0x00, 0x00
 #define DS3_BTH_SIXAXIS_ENABLE		0x53, 0xF4, 0x42, 0x03, 0x00, 0x00
@@ -76,6 +60,18 @@ VOID DS3_SET_LED_DURATION_DEFAULT(
 	UCHAR LedIndex
 );
 
+VOID DS3_APPLY_LED_SETTINGS(
+	PDEVICE_CONTEXT Context
+);
+
+DS3_OUTPUT_REPORT_FORMAT DS3_GET_OUTPUT_REPORT_FORMAT(
+	PDEVICE_CONTEXT Context
+);
+
+BOOLEAN DS3_SERIALIZE_OUTPUT_REPORT(
+	PDEVICE_CONTEXT Context
+);
+
 VOID DS3_GET_UNIFIED_OUTPUT_REPORT_BUFFER(
 	PDEVICE_CONTEXT Context,
 	UCHAR** Buffer,
@@ -0,0 +1,208 @@
+#include "DsAirtime.h"
+
+//
+// NOTE: this module must stay free of WDF, DMF and WPP dependencies
+//
+
+//
+// Longest span accounted for in one go, buckets are full by then anyway
+//
+#define DS_AIRTIME_MAX_REFILL_SECONDS	1
+
+static LONGLONG DS_AIRTIME_CAPACITY(
+	const DS_AIRTIME_BUDGET* Budget
+)
+{
+	return (LONGLONG)Budget->BurstWrites * DS_AIRTIME_UNIT;
+}
+
+//
+// Distributes tokens accrued since the last call evenly across all clients,
+// whatever a full client can't hold spills over into the shared pool
+//
+static VOID DS_AIRTIME_REFILL(
+	PDS_AIRTIME_BUDGET Budget,
+	LONGLONG Now
+)
+{
+	const LONGLONG capacity = DS_AIRTIME_CAPACITY(Budget);
+	LONGLONG elapsed = Now - Budget->LastRefill;
+
+	if (elapsed <= 0 || Budget->ClientCount == 0)
+	{
+		Budget->LastRefill = Now;
+		return;
+	}
+
+	if (elapsed > Budget->Frequency * DS_AIRTIME_MAX_REFILL_SECONDS)
+	{
+		elapsed = Budget->Frequency * DS_AIRTIME_MAX_REFILL_SECONDS;
+		Budget->Carry = 0;
+	}
+
+	Budget->LastRefill = Now;
+
+	const LONGLONG scaled = elapsed * Budget->WritesPerSecond * DS_AIRTIME_UNIT + Budget->Carry;
+	const LONGLONG accrued = scaled / Budget->Frequency;
+	Budget->Carry = scaled % Budget->Frequency;
+
+	const LONGLONG share = accrued / Budget->ClientCount;
+	Budget->Pool += accrued % Budget->ClientCount;
+
+	for (PDS_AIRTIME_CLIENT client = Budget->Clients; client != NULL; client = client->Next)
+	{
+		client->Tokens += share;
+
+		if (client->Tokens > capacity)
+		{
+			Budget->Pool += client->Tokens - capacity;
+			client->Tokens = capacity;
+		}
+	}
+
+	if (Budget->Pool > capacity)
+	{
+		Budget->Pool = capacity;
+	}
+}
+
+VOID DS_AIRTIME_BUDGET_INIT(
+	PDS_AIRTIME_BUDGET Budget,
+	ULONG WritesPerSecond,
+	ULONG BurstWrites,
+	LONGLONG Frequency,
+	LONGLONG Now
+)
+{
+	RtlZeroMemory(Budget, sizeof(DS_AIRTIME_BUDGET));
+
+	Budget->WritesPerSecond = WritesPerSecond ? WritesPerSecond : DS_AIRTIME_DEFAULT_WRITES_PER_SECOND;
+	Budget->BurstWrites = BurstWrites ? BurstWrites : 1;
+	Budget->Frequency = Frequency;
+	Budget->LastRefill = Now;
+}
+
+//
+// Joins a client, it starts with a single write worth of tokens
+//
+VOID DS_AIRTIME_REGISTER(
+	PDS_AIRTIME_BUDGET Budget,
+	PDS_AIRTIME_CLIENT Client,
+	LONGLONG Now
+)
+{
+	if (Client->IsRegistered)
+		return;
+
+	DS_AIRTIME_REFILL(Budget, Now);
+
+	Client->Tokens = DS_AIRTIME_UNIT;
+	Client->Granted = 0;
+	Client->Borrowed = 0;
+	Client->Forced = 0;
+	Client->Deferred = 0;
+
+	Client->Next = Budget->Clients;
+	Budget->Clients = Client;
+	Budget->ClientCount++;
+
+	Client->IsRegistered = TRUE;
+}
+
+//
+// Removes a client, saved up tokens are handed to the pool
+//
+VOID DS_AIRTIME_UNREGISTER(
+	PDS_AIRTIME_BUDGET Budget,
+	PDS_AIRTIME_CLIENT Client,
+	LONGLONG Now
+)
+{
+	if (!Client->IsRegistered)
+		return;
+
+	DS_AIRTIME_REFILL(Budget, Now);
+
+	for (PDS_AIRTIME_CLIENT* link = &Budget->Clients; *link != NULL; link = &(*link)->Next)
+	{
+		if (*link == Client)
+		{
+			*link = Client->Next;
+			Budget->ClientCount--;
+			break;
+		}
+	}
+
+	if (Client->Tokens > 0)
+	{
+		Budget->Pool += Client->Tokens;
+
+		if (Budget->Pool > DS_AIRTIME_CAPACITY(Budget))
+		{
+			Budget->Pool = DS_AIRTIME_CAPACITY(Budget);
+		}
+	}
+
+	Client->Next = NULL;
+	Client->Tokens = 0;
+	Client->IsRegistered = FALSE;
+}
+
+//
+// Charges one write. Returns 0 if the write may go out now, otherwise the
+// number of milliseconds after which the client's own share covers it.
+// Priority writes are never held back; they are taken on credit and paid
+// back in full from the client's own share, so other clients don't lose
+// airtime.
+//
+ULONG DS_AIRTIME_ACQUIRE(
+	PDS_AIRTIME_BUDGET Budget,
+	PDS_AIRTIME_CLIENT Client,
+	BOOLEAN IsPriority,
+	LONGLONG Now
+)
+{
+	if (!Client->IsRegistered)
+		return 0;
+
+	DS_AIRTIME_REFILL(Budget, Now);
+
+	if (Client->Tokens >= DS_AIRTIME_UNIT)
+	{
+		Client->Tokens -= DS_AIRTIME_UNIT;
+		Client->Granted++;
+		return 0;
+	}
+
+	//
+	// Clients in debt don't borrow, their own share pays it back first
+	//
+	if (Client->Tokens >= 0 && Budget->Pool >= DS_AIRTIME_UNIT)
+	{
+		Budget->Pool -= DS_AIRTIME_UNIT;
+		Client->Borrowed++;
+		return 0;
+	}
+
+	if (IsPriority)
+	{
+		//
+		// Not clamped, the whole debt is paid back before the client's
+		// next regular write
+		//
+		Client->Tokens -= DS_AIRTIME_UNIT;
+		Client->Forced++;
+		return 0;
+	}
+
+	Client->Deferred++;
+
+	//
+	// Each client refills at an equal fraction of the aggregate rate
+	//
+	const LONGLONG missing = DS_AIRTIME_UNIT - Client->Tokens;
+	const LONGLONG rate = (LONGLONG)Budget->WritesPerSecond * DS_AIRTIME_UNIT;
+	const LONGLONG waitMs = (missing * 1000 * Budget->ClientCount + rate - 1) / rate;
+
+	return (ULONG)(waitMs > 0 ? waitMs : 1);
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include "DsPortable.h"
+
+EXTERN_C_START
+
+//
+// Default aggregate HID control channel write rate shared by all wireless devices
+//
+#define DS_AIRTIME_DEFAULT_WRITES_PER_SECOND	125
+
+//
+// Default amount of writes a single device (and the shared pool) may save up
+//
+#define DS_AIRTIME_DEFAULT_BURST_WRITES			4
+
+//
+// Token amounts are fixed point, this represents a single write
+//
+#define DS_AIRTIME_UNIT							1000
+
+//
+// Per-device share of the airtime budget
+//
+typedef struct _DS_AIRTIME_CLIENT
+{
+	//
+	// Next registered client
+	//
+	struct _DS_AIRTIME_CLIENT* Next;
+
+	//
+	// Saved up writes in DS_AIRTIME_UNIT, negative while paying back priority writes
+	//
+	LONGLONG Tokens;
+
+	//
+	// Writes paid for by own share
+	//
+	ULONGLONG Granted;
+
+	//
+	// Writes paid for by shares other devices didn't use
+	//
+	ULONGLONG Borrowed;
+
+	//
+	// Priority writes granted on credit
+	//
+	ULONGLONG Forced;
+
+	//
+	// Writes asked to be retried later
+	//
+	ULONGLONG Deferred;
+
+	//
+	// TRUE while linked into a budget
+	//
+	BOOLEAN IsRegistered;
+
+} DS_AIRTIME_CLIENT, * PDS_AIRTIME_CLIENT;
+
+//
+// Aggregate write budget, fairly split between registered clients. Unused shares
+// overflow into a pool busy clients may borrow from. Not synchronized, callers
+// must serialize access.
+//
+typedef struct _DS_AIRTIME_BUDGET
+{
+	//
+	// Aggregate writes per second
+	//
+	ULONG WritesPerSecond;
+
+	//
+	// Maximum saved up writes per client and for the pool
+	//
+	ULONG BurstWrites;
+
+	//
+	// Clock ticks per second
+	//
+	LONGLONG Frequency;
+
+	//
+	// Clock ticks of last refill
+	//
+	LONGLONG LastRefill;
+
+	//
+	// Sub-token refill carry, in DS_AIRTIME_UNIT * ticks
+	//
+	LONGLONG Carry;
+
+	//
+	// Shares not used by their owners, in DS_AIRTIME_UNIT
+	//
+	LONGLONG Pool;
+
+	//
+	// Number of registered clients
+	//
+	ULONG ClientCount;
+
+	//
+	// Registered clients
+	//
+	PDS_AIRTIME_CLIENT Clients;
+
+} DS_AIRTIME_BUDGET, * PDS_AIRTIME_BUDGET;
+
+VOID DS_AIRTIME_BUDGET_INIT(
+	_Out_ PDS_AIRTIME_BUDGET Budget,
+	_In_ ULONG WritesPerSecond,
+	_In_ ULONG BurstWrites,
+	_In_ LONGLONG Frequency,
+	_In_ LONGLONG Now
+);
+
+VOID DS_AIRTIME_REGISTER(
+	_Inout_ PDS_AIRTIME_BUDGET Budget,
+	_Inout_ PDS_AIRTIME_CLIENT Client,
+	_In_ LONGLONG Now
+);
+
+VOID DS_AIRTIME_UNREGISTER(
+	_Inout_ PDS_AIRTIME_BUDGET Budget,
+	_Inout_ PDS_AIRTIME_CLIENT Client,
+	_In_ LONGLONG Now
+);
+
+ULONG DS_AIRTIME_ACQUIRE(
+	_Inout_ PDS_AIRTIME_BUDGET Budget,
+	_Inout_ PDS_AIRTIME_CLIENT Client,
+	_In_ BOOLEAN IsPriority,
+	_In_ LONGLONG Now
+);
+
+EXTERN_C_END
@@ -60,8 +60,7 @@ DsBth_DisconnectEventCallback(
 
 	FuncEntry(TRACE_DSBTH);
 	
-	UnregisterWait(pDevCtx->ConfigurationDirectoryWatcherWaitHandle);
-	CloseHandle(pDevCtx->ConfigurationDirectoryWatcherEvent);
+	ConfigWatcherUnregisterDevice(pDevCtx);
 
 	if (!NT_SUCCESS(status = DsBth_SendDisconnectRequest(pDevCtx)))
 	{
@@ -102,6 +101,11 @@ NTSTATUS DsBth_D0Entry(WDFDEVICE Device, WDF_POWER_DEVICE_STATE PreviousState)
 		WdfIoTargetStart(pDevCtx->Connection.Bth.HidInterrupt.InputStreamerIoTarget);
 		WdfIoTargetStart(pDevCtx->Connection.Bth.HidControl.OutputWriterIoTarget);
 	}
+
+	//
+	// Claim a share of the radio's output capacity
+	// 
+	DSHM_BthAirtimeRegister(pDevCtx);
 	
 	FuncExit(TRACE_DSBTH, "status=%!STATUS!", status);
 
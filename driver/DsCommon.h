@@ -201,7 +201,12 @@ typedef enum
 	//
 	// Request came from XINPUTHID.SYS
 	// 
-	Ds3OutputReportSourceXInputHID
+	Ds3OutputReportSourceXInputHID,
+
+	//
+	// Request came in through the IPC output rings or commands
+	// 
+	Ds3OutputReportSourceIPC
 } DS_OUTPUT_REPORT_SOURCE, * PDS_OUTPUT_REPORT_SOURCE;
 
 //
@@ -580,6 +585,16 @@ typedef struct _DS_DRIVER_CONFIGURATION
 	// 
 	UCHAR OutputRateControlPeriodMs;
 
+	//
+	// Time in milliseconds to collect a burst of PID reports before the motors get updated
+	// 
+	UCHAR FFBCoalescingWindowMs;
+
+	//
+	// Records received PID reports to a file for later replay
+	// 
+	BOOLEAN IsFFBRecordingEnabled;
+
 	//
 	// Idle disconnect period in milliseconds
 	// 
@@ -229,9 +229,6 @@ DMF_DsHidMini_ChildModulesAdd(
 	DMF_MODULE_ATTRIBUTES moduleAttributes;
 	DMF_CONTEXT_DsHidMini* pModCtx;
 	DMF_CONFIG_VirtualHidMini vHidCfg;
-#ifdef DSHM_FEATURE_FFB
-	DMF_CONFIG_HashTable hashCfg;
-#endif
 	NTSTATUS status;
 	DS_HID_DEVICE_MODE hidDeviceMode = DsHidMiniDeviceModeXInputHIDCompatible;
 
@@ -314,22 +311,6 @@ DMF_DsHidMini_ChildModulesAdd(
 		&pModCtx->DmfModuleVirtualHidMini
 	);
 
-
-#ifdef DSHM_FEATURE_FFB
-	DMF_CONFIG_HashTable_AND_ATTRIBUTES_INIT(&hashCfg, &moduleAttributes);
-
-	hashCfg.MaximumKeyLength = sizeof(UCHAR);
-	hashCfg.MaximumValueLength = sizeof(FFB_ATTRIBUTES);
-	hashCfg.MaximumTableSize = MAX_EFFECT_BLOCKS;
-
-	DMF_DmfModuleAdd(
-		DmfModuleInit,
-		&moduleAttributes,
-		WDF_NO_OBJECT_ATTRIBUTES,
-		&pModCtx->DmfModuleForceFeedback
-	);
-#endif
-
 	FuncExitNoReturn(TRACE_DSHIDMINIDRV);
 }
 #pragma code_seg()
@@ -360,6 +341,12 @@ DMF_DsHidMini_Open(
 	// 
 	ConfigLoadForDevice(pDevCtx, FALSE);
 
+	LONG epoch;
+	const DS_CONFIG_SNAPSHOT* config = DS_CONFIG_READ_BEGIN(pDevCtx, &epoch);
+	DS_HID_DEVICE_MODE hidDeviceMode = config->Configuration.HidDeviceMode;
+	const DS_DEVICE_PAIRING_MODE pairingMode = config->Configuration.DevicePairingMode;
+	DS_CONFIG_READ_END(pDevCtx, epoch);
+
 	pHidCfg->VendorId = pDevCtx->VendorId;
 	pHidCfg->ProductId = pDevCtx->ProductId;
 	pHidCfg->VersionNumber = pDevCtx->VersionNumber;
@@ -367,7 +354,7 @@ DMF_DsHidMini_Open(
 	pHidCfg->HidDeviceAttributes.ProductID = pDevCtx->ProductId;
 	pHidCfg->HidDeviceAttributes.VersionNumber = pDevCtx->VersionNumber;
 
-	switch (pDevCtx->Configuration.HidDeviceMode)  // NOLINT(clang-diagnostic-switch-enum)
+	switch (hidDeviceMode)  // NOLINT(clang-diagnostic-switch-enum)
 	{
 	case DsHidMiniDeviceModeSDF:
 
@@ -459,7 +446,7 @@ DMF_DsHidMini_Open(
 		TraceError(
 			TRACE_DSHIDMINIDRV,
 			"Unknown HID Device Mode: 0x%02X",
-			pDevCtx->Configuration.HidDeviceMode
+			hidDeviceMode
 		);
 
 		goto exit;
@@ -468,7 +455,7 @@ DMF_DsHidMini_Open(
 	//
 	// If not in disabled pairing mode and if on USB then execute pairing process then request currently set host address
 	//
-	if (pDevCtx->ConnectionType == DsDeviceConnectionTypeUsb && pDevCtx->Configuration.DevicePairingMode != DsDevicePairingModeDisabled)
+	if (pDevCtx->ConnectionType == DsDeviceConnectionTypeUsb && pairingMode != DsDevicePairingModeDisabled)
 	{
 		DsUsb_Ds3PairToNewHost(device);
 		DsUsb_Ds3RequestHostAddress(device);
@@ -488,7 +475,7 @@ DMF_DsHidMini_Open(
 		&propertyData,
 		DEVPROP_TYPE_BYTE,
 		sizeof(BYTE),
-		&pDevCtx->Configuration.HidDeviceMode
+		&hidDeviceMode
 	);
 
 exit:
@@ -533,10 +520,15 @@ DsHidMini_RetrieveNextInputReport(
 	const DMFMODULE dmfModuleParent = DMF_ParentModuleGet(DmfModule);
 	DMF_CONTEXT_DsHidMini* moduleContext = DMF_CONTEXT_GET(dmfModuleParent);
 	const PDEVICE_CONTEXT pDevCtx = DeviceGetContext(DMF_ParentDeviceGet(DmfModule));
+	LONG epoch;
+
+	const DS_CONFIG_SNAPSHOT* config = DS_CONFIG_READ_BEGIN(pDevCtx, &epoch);
+	const DS_HID_DEVICE_MODE hidDeviceMode = config->Configuration.HidDeviceMode;
+	DS_CONFIG_READ_END(pDevCtx, epoch);
 
 	*Buffer = moduleContext->InputReport;
 
-	switch (pDevCtx->Configuration.HidDeviceMode)  // NOLINT(clang-diagnostic-switch-enum)
+	switch (hidDeviceMode)  // NOLINT(clang-diagnostic-switch-enum)
 	{
 	case DsHidMiniDeviceModeSDF:
 	case DsHidMiniDeviceModeGPJ:
@@ -558,7 +550,7 @@ DsHidMini_RetrieveNextInputReport(
 		TraceError(
 			TRACE_DSHIDMINIDRV,
 			"Unsupported HID device mode: 0x%04X",
-			pDevCtx->Configuration.HidDeviceMode
+			hidDeviceMode
 		);
 		status = STATUS_INVALID_PARAMETER;
 		break;
@@ -593,9 +585,17 @@ DSHM_ProcessHidInputReport(
 
 	const DMFMODULE dmfModule = (DMFMODULE)Context->DsHidMiniModule;
 	DMF_CONTEXT_DsHidMini* pModCtx = DMF_CONTEXT_GET(dmfModule);
+	LARGE_INTEGER begin, end;
+
+	QueryPerformanceCounter(&begin);
 
 	DSHM_ParseInputReport(Context, pModCtx, Report);
 
+	QueryPerformanceCounter(&end);
+
+	DSHM_IPC_COUNTER_INCREMENT(&Context->IPC.Counters->InputReports);
+	DSHM_IPC_COUNTER_ADD(&Context->IPC.Counters->ProcessingTicks, end.QuadPart - begin.QuadPart);
+
 	FuncExitNoReturn(TRACE_DSHIDMINIDRV);
 }
 
@@ -616,6 +616,8 @@ VOID DsUsb_EvtUsbInterruptPipeReadComplete(
 
 	FuncEntry(TRACE_DSHIDMINIDRV);
 
+	const PDEVICE_CONTEXT pDevCtx = DeviceGetContext(Context);
+
 	//
 	// Validate expected packet size
 	// 
@@ -629,19 +631,32 @@ VOID DsUsb_EvtUsbInterruptPipeReadComplete(
 			sizeof(DS3_RAW_INPUT_REPORT)
 		);
 
+		DSHM_IPC_COUNTER_INCREMENT(&pDevCtx->IPC.Counters->InputDropped);
+
 		FuncExitNoReturn(TRACE_DSHIDMINIDRV);
 		return;
 	}
 
-	const PDEVICE_CONTEXT pDevCtx = DeviceGetContext(Context);
 	DMF_CONTEXT_DsHidMini* pModCtx = DMF_CONTEXT_GET((DMFMODULE)pDevCtx->DsHidMiniModule);
 	const PDS3_RAW_INPUT_REPORT pInReport = (PDS3_RAW_INPUT_REPORT)WdfMemoryGetBuffer(Buffer, NULL);
+	LONG epoch;
+
+	//
+	// Settings used below, sending output reports must not happen in a read section
+	// 
+	const DS_CONFIG_SNAPSHOT* config = DS_CONFIG_READ_BEGIN(pDevCtx, &epoch);
+	const DS_HID_DEVICE_MODE hidDeviceMode = config->Configuration.HidDeviceMode;
+	const DS_LED_MODE ledMode = config->Configuration.LEDSettings.Mode;
+	const DS_LED_AUTHORITY ledAuthority = config->Configuration.LEDSettings.Authority;
+	DS_CONFIG_READ_END(pDevCtx, epoch);
 
 	//
 	// Some controllers occasionally send this broken report, ignore packet
 	// 
 	if (pInReport->Reserved0 == 0xFF)
 	{
+		DSHM_IPC_COUNTER_INCREMENT(&pDevCtx->IPC.Counters->InputDropped);
+
 		FuncExitNoReturn(TRACE_DSHIDMINIDRV);
 		return;
 	}
@@ -656,7 +671,7 @@ VOID DsUsb_EvtUsbInterruptPipeReadComplete(
 	//
 	// Handle special case of SIXAXIS.SYS emulation
 	// 
-	if (pDevCtx->Configuration.HidDeviceMode == DsHidMiniDeviceModeSixaxisCompatible)
+	if (hidDeviceMode == DsHidMiniDeviceModeSixaxisCompatible)
 	{
 		RtlCopyMemory(
 			&pModCtx->GetFeatureReport,
@@ -690,9 +705,9 @@ VOID DsUsb_EvtUsbInterruptPipeReadComplete(
 			sizeof(BYTE),
 			&battery
 		);
-	}
 
-	const PDS_LED_SETTINGS pLED = &pDevCtx->Configuration.LEDSettings;
+		DSHM_IPC_COUNTER_INCREMENT(&pDevCtx->IPC.Counters->BatteryChanges);
+	}
 
 	//
 	// Check if state has changed to Charged
@@ -703,12 +718,12 @@ VOID DsUsb_EvtUsbInterruptPipeReadComplete(
 		pDevCtx->BatteryStatus = battery;
 
 		if (
-			(pLED->Authority == DsLEDAuthorityDriver /* Driver wins over Automatic or Application */ ||
+			(ledAuthority == DsLEDAuthorityDriver /* Driver wins over Automatic or Application */ ||
 				pDevCtx->OutputReport.Mode == Ds3OutputReportModeDriverHandled) &&
-			pLED->Mode > DsLEDModeUnknown && pLED->Mode < DsLEDModeCustomPattern
+			ledMode > DsLEDModeUnknown && ledMode < DsLEDModeCustomPattern
 			)
 		{
-			switch (pLED->Mode)
+			switch (ledMode)
 			{
 			case DsLEDModeBatteryIndicatorPlayerIndex:
 
@@ -751,7 +766,7 @@ VOID DsUsb_EvtUsbInterruptPipeReadComplete(
 
 			UCHAR led = DS3_LED_OFF;
 
-			switch (pLED->Mode)
+			switch (ledMode)
 			{
 			case DsLEDModeBatteryIndicatorPlayerIndex:
 
@@ -786,10 +801,10 @@ VOID DsUsb_EvtUsbInterruptPipeReadComplete(
 			}
 
 			if (
-				(pLED->Authority == DsLEDAuthorityDriver /* Driver wins over Automatic or Application */ ||
+				(ledAuthority == DsLEDAuthorityDriver /* Driver wins over Automatic or Application */ ||
 					pDevCtx->OutputReport.Mode == Ds3OutputReportModeDriverHandled) &&
 				/* validate mode range */
-				pLED->Mode > DsLEDModeUnknown && pLED->Mode < DsLEDModeCustomPattern
+				ledMode > DsLEDModeUnknown && ledMode < DsLEDModeCustomPattern
 				)
 			{
 				DS3_SET_LED_FLAGS(pDevCtx, led);
@@ -830,6 +845,7 @@ DsBth_HidInterruptReadContinuousRequestCompleted(
 	DMF_CONTEXT_DsHidMini* pModCtx;
 	PDS3_RAW_INPUT_REPORT pInReport;
 	WDFDEVICE device;
+	LONG epoch;
 
 	UNREFERENCED_PARAMETER(ClientBufferContextOutput);
 
@@ -853,6 +869,20 @@ DsBth_HidInterruptReadContinuousRequestCompleted(
 	pModCtx = DMF_CONTEXT_GET((DMFMODULE)pDevCtx->DsHidMiniModule);
 	QueryPerformanceFrequency(&freq);
 
+	//
+	// Settings used below, disconnect requests and output reports must not happen in a read section
+	// 
+	const DS_CONFIG_SNAPSHOT* config = DS_CONFIG_READ_BEGIN(pDevCtx, &epoch);
+	const DS_HID_DEVICE_MODE hidDeviceMode = config->Configuration.HidDeviceMode;
+	const DS_LED_MODE ledMode = config->Configuration.LEDSettings.Mode;
+	const DS_LED_AUTHORITY ledAuthority = config->Configuration.LEDSettings.Authority;
+	const ULONG disconnectComboMask = config->WirelessDisconnectComboMask;
+	const ULONG comboHoldTime = config->Configuration.WirelessDisconnectButtonCombo.HoldTime;
+	const ULONG altModeToggleComboMask = config->AltModeToggleComboMask;
+	const BOOLEAN isIdleTimeoutDisabled = config->Configuration.DisableWirelessIdleTimeout;
+	const ULONG idleTimeoutPeriodMs = config->Configuration.WirelessIdleTimeoutPeriodMs;
+	DS_CONFIG_READ_END(pDevCtx, epoch);
+
 	buffer = (PUCHAR)OutputBuffer;
 	bufferLength = OutputBufferSize;
 
@@ -873,6 +903,8 @@ DsBth_HidInterruptReadContinuousRequestCompleted(
 	*/
 	if (buffer[2] == 0xFF)
 	{
+		DSHM_IPC_COUNTER_INCREMENT(&pDevCtx->IPC.Counters->InputDropped);
+
 		return ContinuousRequestTarget_BufferDisposition_ContinuousRequestTargetAndContinueStreaming;
 	}
 
@@ -884,7 +916,7 @@ DsBth_HidInterruptReadContinuousRequestCompleted(
 	//
 	// Handle special case of SIXAXIS.SYS emulation
 	// 
-	if (pDevCtx->Configuration.HidDeviceMode == DsHidMiniDeviceModeSixaxisCompatible)
+	if (hidDeviceMode == DsHidMiniDeviceModeSixaxisCompatible)
 	{
 		RtlCopyMemory(
 			&pModCtx->GetFeatureReport,
@@ -960,18 +992,16 @@ DsBth_HidInterruptReadContinuousRequestCompleted(
 				&battery
 			);
 
-			const PDS_LED_SETTINGS pLED = &pDevCtx->Configuration.LEDSettings;
-
 			//
 			// Don't send update if not initialized yet or custom pattern
 			// 
 			if (DS3_GET_LED_FLAGS(pDevCtx) != 0x00)
 			{
 				if (
-					(pLED->Authority == DsLEDAuthorityDriver /* Driver wins over Automatic or Application */ ||
+					(ledAuthority == DsLEDAuthorityDriver /* Driver wins over Automatic or Application */ ||
 						pDevCtx->OutputReport.Mode == Ds3OutputReportModeDriverHandled) &&
 					/* validate mode range */
-					pLED->Mode > DsLEDModeUnknown && pLED->Mode < DsLEDModeCustomPattern
+					ledMode > DsLEDModeUnknown && ledMode < DsLEDModeCustomPattern
 					)
 				{
 					//
@@ -982,7 +1012,7 @@ DsBth_HidInterruptReadContinuousRequestCompleted(
 					DS3_SET_LED_DURATION_DEFAULT(pDevCtx, 2);
 					DS3_SET_LED_DURATION_DEFAULT(pDevCtx, 3);
 
-					switch (pLED->Mode)
+					switch (ledMode)
 					{
 					case DsLEDModeBatteryIndicatorPlayerIndex:
 
@@ -1042,24 +1072,17 @@ DsBth_HidInterruptReadContinuousRequestCompleted(
 			// Update battery status
 			// 
 			pDevCtx->BatteryStatus = battery;
+
+			DSHM_IPC_COUNTER_INCREMENT(&pDevCtx->IPC.Counters->BatteryChanges);
 		}
 	}
 
 	//
 	// Quick disconnect combo detected
 	// 
-	if (pDevCtx->Configuration.WirelessDisconnectButtonCombo.IsEnabled)
+	if (disconnectComboMask)
 	{
-		int engagedCount = 0;
-		for (int buttonIndex = 0; buttonIndex < (int)_countof(pDevCtx->Configuration.WirelessDisconnectButtonCombo.Buttons); buttonIndex++)
-		{
-			if ((pInReport->Buttons.lButtons >> pDevCtx->Configuration.WirelessDisconnectButtonCombo.Buttons[buttonIndex]) & 1)
-			{
-				engagedCount++;
-			}
-		}
-
-		if (engagedCount == _countof(pDevCtx->Configuration.WirelessDisconnectButtonCombo.Buttons))
+		if ((pInReport->Buttons.lButtons & disconnectComboMask) == disconnectComboMask)
 		{
 			TraceEvents(TRACE_LEVEL_INFORMATION,
 				TRACE_DSHIDMINIDRV,
@@ -1080,13 +1103,15 @@ DsBth_HidInterruptReadContinuousRequestCompleted(
 			//
 			// 1 second passed
 			// 
-			if (ms > pDevCtx->Configuration.WirelessDisconnectButtonCombo.HoldTime)
+			if (ms > comboHoldTime)
 			{
 				TraceEvents(TRACE_LEVEL_INFORMATION,
 					TRACE_DSHIDMINIDRV,
 					"!! Sending disconnect request"
 				);
 
+				DSHM_IPC_COUNTER_INCREMENT(&pDevCtx->IPC.Counters->ComboFires);
+
 				//
 				// Send disconnect request
 				// 
@@ -1117,18 +1142,9 @@ DsBth_HidInterruptReadContinuousRequestCompleted(
 	//
 	// Alternative rumble toggle combo detected
 	// 
-	if (pDevCtx->Configuration.RumbleSettings.AlternativeMode.ToggleButtonCombo.IsEnabled)
+	if (altModeToggleComboMask)
 	{
-		int engagedCount = 0;
-		for (int buttonIndex = 0; buttonIndex < (int)_countof(pDevCtx->Configuration.RumbleSettings.AlternativeMode.ToggleButtonCombo.Buttons); buttonIndex++)
-		{
-			if ((pInReport->Buttons.lButtons >> pDevCtx->Configuration.RumbleSettings.AlternativeMode.ToggleButtonCombo.Buttons[buttonIndex]) & 1)
-			{
-				engagedCount++;
-			}
-		}
-
-		if (engagedCount == _countof(pDevCtx->Configuration.RumbleSettings.AlternativeMode.ToggleButtonCombo.Buttons))
+		if ((pInReport->Buttons.lButtons & altModeToggleComboMask) == altModeToggleComboMask)
 		{
 			TraceEvents(TRACE_LEVEL_INFORMATION,
 				TRACE_DSHIDMINIDRV,
@@ -1150,12 +1166,15 @@ DsBth_HidInterruptReadContinuousRequestCompleted(
 				//
 				// Combo was held for the user defined time period
 				// 
-				if (ms > pDevCtx->Configuration.WirelessDisconnectButtonCombo.HoldTime)
+				if (ms > comboHoldTime)
 				{
 					TraceEvents(TRACE_LEVEL_INFORMATION,
 						TRACE_DSHIDMINIDRV,
 						"!! Toggling alternative rumble mode"
 					);
+
+					DSHM_IPC_COUNTER_INCREMENT(&pDevCtx->IPC.Counters->ComboFires);
+
 					pDevCtx->RumbleControlState.AltMode.IsEnabled = !pDevCtx->RumbleControlState.AltMode.IsEnabled;
 
 					//
@@ -1216,7 +1235,7 @@ DsBth_HidInterruptReadContinuousRequestCompleted(
 	//
 	// Idle disconnect detection
 	// 
-	if (!pDevCtx->Configuration.DisableWirelessIdleTimeout && DS3_RAW_IS_IDLE(pInReport))
+	if (!isIdleTimeoutDisabled && DS3_RAW_IS_IDLE(pInReport))
 	{
 		t1 = &pDevCtx->Connection.Bth.IdleDisconnectTimestamp;
 
@@ -1232,7 +1251,7 @@ DsBth_HidInterruptReadContinuousRequestCompleted(
 		//
 		// Timeout has been reached
 		// 
-		if (ms > pDevCtx->Configuration.WirelessIdleTimeoutPeriodMs)
+		if (ms > idleTimeoutPeriodMs)
 		{
 			TraceEvents(TRACE_LEVEL_INFORMATION,
 				TRACE_DSHIDMINIDRV,
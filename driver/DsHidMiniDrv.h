@@ -22,3 +22,42 @@ DSHM_SendOutputReport(
 	_In_ PDEVICE_CONTEXT Context,
 	_In_ DS_OUTPUT_REPORT_SOURCE Source
 );
+
+VOID
+DSHM_OutputReportTelemetryTrace(
+	_In_ PDEVICE_CONTEXT Context
+);
+
+VOID
+DSHM_BthAirtimeRegister(
+	_In_ PDEVICE_CONTEXT Context
+);
+
+VOID
+DSHM_BthAirtimeUnregister(
+	_In_ PDEVICE_CONTEXT Context
+);
+
+#ifdef DSHM_FEATURE_FFB
+VOID
+DSHM_FfbRender(
+	_In_ PDEVICE_CONTEXT Context
+);
+
+VOID
+DSHM_FfbScheduleRender(
+	_In_ PDEVICE_CONTEXT Context
+);
+
+VOID
+DSHM_FfbRecord(
+	_In_ PDEVICE_CONTEXT Context,
+	_In_ FFB_RECORD_KIND Kind,
+	_In_ const HID_XFER_PACKET* Packet
+);
+
+VOID
+DSHM_FfbStop(
+	_In_ PDEVICE_CONTEXT Context
+);
+#endif
@@ -0,0 +1,84 @@
+#pragma once
+
+//
+// Minimal type and intrinsic shims so that self-contained modules (no WDF, no tracing)
+// can be compiled outside of the driver build, e.g. for host-side verification.
+// Inside the driver all of these come from Windows.h already.
+//
+
+#ifdef _WIN32
+
+#include <Windows.h>
+
+#define DS_ATOMIC_OR(_target_, _value_)			InterlockedOr((volatile LONG*)(_target_), (LONG)(_value_))
+#define DS_ATOMIC_EXCHANGE(_target_, _value_)	InterlockedExchange((volatile LONG*)(_target_), (LONG)(_value_))
+
+//
+// Index of the lowest set bit, _mask_ must not be zero
+//
+FORCEINLINE ULONG DS_BIT_SCAN_FORWARD64(ULONGLONG Mask)
+{
+	ULONG index;
+	(void)_BitScanForward64(&index, Mask);
+	return index;
+}
+
+#else
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+typedef void VOID, * PVOID;
+typedef uint8_t UCHAR, * PUCHAR;
+typedef int8_t CHAR, * PCHAR;
+typedef uint16_t USHORT, * PUSHORT;
+typedef int16_t SHORT, * PSHORT;
+typedef uint32_t ULONG, * PULONG;
+typedef int32_t LONG, * PLONG;
+typedef uint64_t ULONGLONG, * PULONGLONG;
+typedef int64_t LONGLONG, * PLONGLONG;
+typedef uint8_t BOOLEAN, * PBOOLEAN;
+typedef size_t SIZE_T, * PSIZE_T;
+typedef uint32_t UINT32, * PUINT32;
+typedef uint8_t BYTE, * PBYTE;
+typedef uint32_t DWORD, * PDWORD;
+typedef int32_t NTSTATUS;
+typedef void* HANDLE;
+
+#ifndef TRUE
+#define TRUE	1
+#endif
+#ifndef FALSE
+#define FALSE	0
+#endif
+
+#define FORCEINLINE				static inline
+#define EXTERN_C_START
+#define EXTERN_C_END
+#define ARRAYSIZE(_a_)			(sizeof(_a_) / sizeof((_a_)[0]))
+
+#define RtlCopyMemory			memcpy
+#define RtlZeroMemory(_d_, _l_)	memset((_d_), 0, (_l_))
+#define RtlEqualMemory(_a_, _b_, _l_)	(memcmp((_a_), (_b_), (_l_)) == 0)
+#define UNREFERENCED_PARAMETER(_p_)	(void)(_p_)
+#define FIELD_OFFSET(_type_, _field_)	((LONG)offsetof(_type_, _field_))
+
+#define _In_
+#define _In_opt_
+#define _Out_
+#define _Inout_
+#define _In_reads_bytes_(_s_)
+#define _Out_writes_(_s_)
+#define _Out_writes_bytes_(_s_)
+#define _Inout_updates_bytes_(_s_)
+
+#define DS_ATOMIC_OR(_target_, _value_)			__atomic_fetch_or((_target_), (_value_), __ATOMIC_SEQ_CST)
+#define DS_ATOMIC_EXCHANGE(_target_, _value_)	__atomic_exchange_n((_target_), (_value_), __ATOMIC_SEQ_CST)
+
+FORCEINLINE ULONG DS_BIT_SCAN_FORWARD64(ULONGLONG Mask)
+{
+	return (ULONG)__builtin_ctzll(Mask);
+}
+
+#endif
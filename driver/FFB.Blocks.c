@@ -0,0 +1,95 @@
+#include "FFB.Blocks.h"
+
+//
+// NOTE: this module must stay free of WDF, DMF and WPP dependencies
+//
+
+#define FFB_BLOCKS_WORD(_index_)	((_index_) / 64)
+#define FFB_BLOCKS_BIT(_index_)		(1ULL << ((_index_) % 64))
+
+//
+// Returns the lowest index with its bit set, 0 if none
+//
+static UCHAR FFB_BLOCKS_SCAN(
+	const ULONGLONG* Bitmap
+)
+{
+	for (ULONG word = 0; word < FFB_BLOCKS_BITMAP_WORDS; word++)
+	{
+		if (Bitmap[word])
+		{
+			return (UCHAR)(word * 64 + DS_BIT_SCAN_FORWARD64(Bitmap[word]));
+		}
+	}
+
+	return 0;
+}
+
+VOID FFB_BLOCKS_INIT(
+	PFFB_BLOCK_TABLE Table
+)
+{
+	RtlZeroMemory(Table, sizeof(FFB_BLOCK_TABLE));
+
+	for (UCHAR index = 1; index <= MAX_EFFECT_BLOCKS; index++)
+	{
+		Table->Blocks[index].EffectBlockIndex = index;
+		Table->Free[FFB_BLOCKS_WORD(index)] |= FFB_BLOCKS_BIT(index);
+	}
+}
+
+UCHAR FFB_BLOCKS_ALLOCATE(
+	PFFB_BLOCK_TABLE Table,
+	PID_EFFECT_TYPE EffectType
+)
+{
+	const UCHAR index = FFB_BLOCKS_SCAN(Table->Free);
+
+	if (index == 0)
+	{
+		return 0;
+	}
+
+	Table->Free[FFB_BLOCKS_WORD(index)] &= ~FFB_BLOCKS_BIT(index);
+	Table->Pending[FFB_BLOCKS_WORD(index)] |= FFB_BLOCKS_BIT(index);
+
+	Table->Blocks[index].EffectType = EffectType;
+	Table->Blocks[index].IsReserved = TRUE;
+	Table->Blocks[index].IsReported = FALSE;
+
+	return index;
+}
+
+UCHAR FFB_BLOCKS_CLAIM(
+	PFFB_BLOCK_TABLE Table
+)
+{
+	const UCHAR index = FFB_BLOCKS_SCAN(Table->Pending);
+
+	if (index == 0)
+	{
+		return 0;
+	}
+
+	Table->Pending[FFB_BLOCKS_WORD(index)] &= ~FFB_BLOCKS_BIT(index);
+	Table->Blocks[index].IsReported = TRUE;
+
+	return index;
+}
+
+VOID FFB_BLOCKS_FREE(
+	PFFB_BLOCK_TABLE Table,
+	UCHAR EffectBlockIndex
+)
+{
+	if (EffectBlockIndex < 1 || EffectBlockIndex > MAX_EFFECT_BLOCKS)
+	{
+		return;
+	}
+
+	Table->Free[FFB_BLOCKS_WORD(EffectBlockIndex)] |= FFB_BLOCKS_BIT(EffectBlockIndex);
+	Table->Pending[FFB_BLOCKS_WORD(EffectBlockIndex)] &= ~FFB_BLOCKS_BIT(EffectBlockIndex);
+
+	Table->Blocks[EffectBlockIndex].IsReserved = FALSE;
+	Table->Blocks[EffectBlockIndex].IsReported = FALSE;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "DsPortable.h"
+#include "PID/PIDTypes.h"
+
+EXTERN_C_START
+
+//
+// Effect block indexes (1 to MAX_EFFECT_BLOCKS) fit into a bitmap of this many words
+//
+#define FFB_BLOCKS_BITMAP_WORDS		((MAX_EFFECT_BLOCKS + 64) / 64)
+
+typedef struct _FFB_ATTRIBUTES
+{
+	UCHAR EffectBlockIndex;
+
+	PID_EFFECT_TYPE EffectType;
+
+	BOOLEAN IsReserved;
+
+	BOOLEAN IsReported;
+
+} FFB_ATTRIBUTES, *PFFB_ATTRIBUTES;
+
+//
+// Effect block allocator. Blocks are indexed directly, the bitmaps make
+// finding a free or a not yet reported block a bit scan. Not synchronized,
+// callers must serialize access.
+//
+typedef struct _FFB_BLOCK_TABLE
+{
+	//
+	// Indexed by effect block index, entry 0 is never used
+	//
+	FFB_ATTRIBUTES Blocks[MAX_EFFECT_BLOCKS + 1];
+
+	//
+	// Bit set if block index is available
+	//
+	ULONGLONG Free[FFB_BLOCKS_BITMAP_WORDS];
+
+	//
+	// Bit set if block index got reserved but not yet reported via PID_BLOCK_LOAD
+	//
+	ULONGLONG Pending[FFB_BLOCKS_BITMAP_WORDS];
+
+} FFB_BLOCK_TABLE, * PFFB_BLOCK_TABLE;
+
+VOID FFB_BLOCKS_INIT(
+	_Out_ PFFB_BLOCK_TABLE Table
+);
+
+//
+// Reserves the lowest free block, returns its index or 0 if all are in use
+//
+UCHAR FFB_BLOCKS_ALLOCATE(
+	_Inout_ PFFB_BLOCK_TABLE Table,
+	_In_ PID_EFFECT_TYPE EffectType
+);
+
+//
+// Marks the lowest reserved but not yet reported block as reported, returns its
+// index or 0 if there is none. Block loads follow each create, so there is at
+// most one pending in practice.
+//
+UCHAR FFB_BLOCKS_CLAIM(
+	_Inout_ PFFB_BLOCK_TABLE Table
+);
+
+VOID FFB_BLOCKS_FREE(
+	_Inout_ PFFB_BLOCK_TABLE Table,
+	_In_ UCHAR EffectBlockIndex
+);
+
+FORCEINLINE BOOLEAN FFB_BLOCKS_IS_RESERVED(
+	const FFB_BLOCK_TABLE* Table,
+	UCHAR EffectBlockIndex
+)
+{
+	return (EffectBlockIndex >= 1 && EffectBlockIndex <= MAX_EFFECT_BLOCKS)
+		&& Table->Blocks[EffectBlockIndex].IsReserved;
+}
+
+EXTERN_C_END
@@ -0,0 +1,724 @@
+#include "FFB.Engine.h"
+
+//
+// NOTE: this module must stay free of WDF, DMF and WPP dependencies
+//
+
+static LONG FFB_CLAMP(
+	LONG Value,
+	LONG Min,
+	LONG Max
+)
+{
+	return (Value < Min) ? Min : (Value > Max) ? Max : Value;
+}
+
+static LONG FFB_ABS(
+	LONG Value
+)
+{
+	return (Value < 0) ? -Value : Value;
+}
+
+static BOOLEAN FFB_IS_VALID_INDEX(
+	UCHAR EffectBlockIndex
+)
+{
+	return (EffectBlockIndex >= 1 && EffectBlockIndex <= MAX_EFFECT_BLOCKS);
+}
+
+static BOOLEAN FFB_IS_INFINITE(
+	const FFB_EFFECT* Effect
+)
+{
+	return (Effect->Duration == 0 || Effect->Duration >= FFB_ENGINE_INFINITE_DURATION);
+}
+
+//
+// Waveform of periodic effects at a given phase angle, Q15
+//
+static LONG FFB_WAVEFORM(
+	UCHAR Type,
+	USHORT Phase
+)
+{
+	switch (Type)
+	{
+	case PidEtSquare:
+		return (Phase & 0x8000) ? -FFB_Q15_ONE : FFB_Q15_ONE;
+	case PidEtSine:
+		return FFB_Q15_SINE(Phase);
+	case PidEtTriangle:
+		return FFB_Q15_TRIANGLE(Phase);
+	case PidEtSawtoothUp:
+		return FFB_Q15_SAWTOOTH_UP(Phase);
+	case PidEtSawtoothDown:
+		return -FFB_Q15_SAWTOOTH_UP(Phase);
+	default:
+		return 0;
+	}
+}
+
+//
+// Shapes a magnitude (Q15) by attack and fade envelope
+//
+static LONG FFB_APPLY_ENVELOPE(
+	const FFB_EFFECT* Effect,
+	LONG Magnitude,
+	LONGLONG Elapsed
+)
+{
+	const FFB_ENVELOPE* envelope = &Effect->Envelope;
+
+	if (!Effect->HasEnvelope)
+	{
+		return Magnitude;
+	}
+
+	if (envelope->AttackTime > 0 && Elapsed < envelope->AttackTime)
+	{
+		return envelope->AttackLevel
+			+ (LONG)(((Magnitude - envelope->AttackLevel) * Elapsed) / envelope->AttackTime);
+	}
+
+	if (envelope->FadeTime > 0 && !FFB_IS_INFINITE(Effect))
+	{
+		const LONGLONG remaining = (LONGLONG)Effect->Duration - Elapsed;
+
+		if (remaining < envelope->FadeTime)
+		{
+			return envelope->FadeLevel
+				+ (LONG)(((Magnitude - envelope->FadeLevel) * remaining) / envelope->FadeTime);
+		}
+	}
+
+	return Magnitude;
+}
+
+//
+// Spring, damper, inertia and friction against the tracked axis movement
+//
+static LONG FFB_EVALUATE_CONDITION(
+	const FFB_ENGINE* Engine,
+	const FFB_EFFECT* Effect,
+	UCHAR Axis
+)
+{
+	const FFB_CONDITION* condition = &Effect->Conditions[Axis];
+	LONG metric;
+
+	switch (Effect->Type)
+	{
+	case PidEtSpring:
+		metric = Engine->Position[Axis];
+		break;
+	case PidEtDamper:
+	case PidEtFriction:
+		metric = Engine->Velocity[Axis];
+		break;
+	case PidEtInertia:
+		metric = Engine->Acceleration[Axis];
+		break;
+	default:
+		return 0;
+	}
+
+	const LONG distance = metric - condition->CpOffset;
+
+	if (FFB_ABS(distance) <= condition->DeadBand)
+	{
+		return 0;
+	}
+
+	const LONG positiveSaturation = condition->PositiveSaturation ? condition->PositiveSaturation : FFB_Q15_ONE;
+	const LONG negativeSaturation = condition->NegativeSaturation ? condition->NegativeSaturation : FFB_Q15_ONE;
+
+	if (Effect->Type == PidEtFriction)
+	{
+		return (distance > 0)
+			? FFB_CLAMP(condition->PositiveCoefficient, -negativeSaturation, positiveSaturation)
+			: FFB_CLAMP(-condition->NegativeCoefficient, -negativeSaturation, positiveSaturation);
+	}
+
+	const LONG force = (distance > 0)
+		? FFB_Q15_MUL(condition->PositiveCoefficient, distance - condition->DeadBand)
+		: FFB_Q15_MUL(condition->NegativeCoefficient, distance + condition->DeadBand);
+
+	return FFB_CLAMP(force, -negativeSaturation, positiveSaturation);
+}
+
+//
+// Only the first iteration of an effect waits for its start delay
+//
+static ULONGLONG FFB_START_DELAY(
+	const FFB_EFFECT* Effect
+)
+{
+	return Effect->IsRepeating ? 0 : Effect->StartDelay;
+}
+
+//
+// Advances playback of an effect and adds its contribution to both motor channels
+//
+static VOID FFB_EVALUATE_EFFECT(
+	const FFB_ENGINE* Engine,
+	PFFB_EFFECT Effect,
+	ULONGLONG Now,
+	PLONG Strong,
+	PLONG Weak
+)
+{
+	LONG strong = 0, weak = 0;
+
+	if (Now < Effect->StartTime + FFB_START_DELAY(Effect))
+	{
+		return;
+	}
+
+	LONGLONG elapsed = (LONGLONG)(Now - Effect->StartTime - FFB_START_DELAY(Effect));
+
+	//
+	// Iteration is over, either repeat or finish
+	//
+	while (!FFB_IS_INFINITE(Effect) && elapsed >= Effect->Duration)
+	{
+		if (Effect->LoopsRemaining != FFB_ENGINE_INFINITE_LOOPS && --Effect->LoopsRemaining == 0)
+		{
+			Effect->IsPlaying = FALSE;
+			return;
+		}
+
+		Effect->StartTime += FFB_START_DELAY(Effect) + Effect->Duration;
+		Effect->IsRepeating = TRUE;
+
+		elapsed = (LONGLONG)(Now - Effect->StartTime);
+	}
+
+	switch (Effect->Type)
+	{
+	case PidEtConstantForce:
+
+		strong = FFB_APPLY_ENVELOPE(Effect, FFB_ABS(Effect->ConstantMagnitude), elapsed);
+
+		break;
+
+	case PidEtRamp:
+	{
+		LONG value = Effect->RampStart;
+
+		if (!FFB_IS_INFINITE(Effect))
+		{
+			value += (LONG)(((LONGLONG)(Effect->RampEnd - Effect->RampStart) * elapsed) / Effect->Duration);
+		}
+
+		strong = FFB_APPLY_ENVELOPE(Effect, FFB_ABS(value), elapsed);
+
+		break;
+	}
+
+	case PidEtSquare:
+	case PidEtSine:
+	case PidEtTriangle:
+	case PidEtSawtoothUp:
+	case PidEtSawtoothDown:
+	{
+		const FFB_PERIODIC* periodic = &Effect->Periodic;
+		const LONG magnitude = FFB_APPLY_ENVELOPE(Effect, periodic->Magnitude, elapsed);
+
+		//
+		// Too fast to be sampled at tick rate, buzz the small motor instead
+		//
+		if (periodic->Period < FFB_ENGINE_FAST_PERIOD_MS)
+		{
+			weak = magnitude;
+			strong = FFB_ABS(periodic->Offset);
+			break;
+		}
+
+		const USHORT phase = (USHORT)(FFB_Q15_PHASE_AT(periodic->PhaseStep, (ULONG)(elapsed % periodic->Period)) + periodic->Phase);
+
+		strong = FFB_ABS(periodic->Offset + FFB_Q15_MUL(magnitude, FFB_WAVEFORM(Effect->Type, phase)));
+
+		break;
+	}
+
+	case PidEtSpring:
+	case PidEtDamper:
+	case PidEtInertia:
+	case PidEtFriction:
+
+		if (Effect->AxesEnableX || !Effect->AxesEnableY)
+		{
+			strong += FFB_ABS(FFB_EVALUATE_CONDITION(Engine, Effect, 0));
+		}
+
+		if (Effect->AxesEnableY)
+		{
+			strong += FFB_ABS(FFB_EVALUATE_CONDITION(Engine, Effect, 1));
+		}
+
+		break;
+
+	default:
+		break;
+	}
+
+	*Strong += FFB_Q15_MUL(strong, Effect->Gain);
+	*Weak += FFB_Q15_MUL(weak, Effect->Gain);
+}
+
+//
+// Engine time the output of a playing effect may change next at. Changes in
+// between boundaries (waveforms, ramps, envelopes, conditions) need every tick.
+//
+static ULONGLONG FFB_NEXT_DEADLINE(
+	const FFB_EFFECT* Effect,
+	ULONGLONG Now
+)
+{
+	const ULONGLONG begin = Effect->StartTime + FFB_START_DELAY(Effect);
+	const ULONGLONG nextTick = Now + FFB_ENGINE_TICK_MS;
+	const BOOLEAN isInfinite = FFB_IS_INFINITE(Effect);
+
+	if (Now < begin)
+	{
+		return begin;
+	}
+
+	ULONGLONG deadline = isInfinite ? FFB_ENGINE_NO_DEADLINE : begin + Effect->Duration;
+
+	switch (Effect->Type)
+	{
+	case PidEtRamp:
+		if (!isInfinite && Effect->RampStart != Effect->RampEnd)
+			return nextTick;
+		break;
+	case PidEtSquare:
+	case PidEtSine:
+	case PidEtTriangle:
+	case PidEtSawtoothUp:
+	case PidEtSawtoothDown:
+		if (Effect->Periodic.Period >= FFB_ENGINE_FAST_PERIOD_MS)
+			return nextTick;
+		break;
+	case PidEtSpring:
+	case PidEtDamper:
+	case PidEtInertia:
+	case PidEtFriction:
+		return nextTick;
+	default:
+		break;
+	}
+
+	if (Effect->HasEnvelope)
+	{
+		if (Now - begin < Effect->Envelope.AttackTime)
+		{
+			return nextTick;
+		}
+
+		if (Effect->Envelope.FadeTime > 0 && !isInfinite)
+		{
+			const ULONGLONG fadeStart = (Effect->Duration > Effect->Envelope.FadeTime)
+				? deadline - Effect->Envelope.FadeTime
+				: begin;
+
+			if (Now >= fadeStart)
+			{
+				return nextTick;
+			}
+
+			deadline = fadeStart;
+		}
+	}
+
+	return deadline;
+}
+
+static BOOLEAN FFB_IS_CONDITION(
+	UCHAR Type
+)
+{
+	return Type == PidEtSpring || Type == PidEtDamper || Type == PidEtInertia || Type == PidEtFriction;
+}
+
+static VOID FFB_START_EFFECT(
+	PFFB_ENGINE Engine,
+	PFFB_EFFECT Effect,
+	UCHAR LoopCount,
+	ULONGLONG Now
+)
+{
+	if (!Effect->IsInUse)
+	{
+		return;
+	}
+
+	Effect->StartTime = Now;
+	Effect->LoopsRemaining = LoopCount ? LoopCount : 1;
+	Effect->IsRepeating = FALSE;
+	Effect->IsPlaying = TRUE;
+
+	if (FFB_IS_CONDITION(Effect->Type))
+	{
+		Engine->HasConditions = TRUE;
+	}
+}
+
+static VOID FFB_STOP_ALL_EFFECTS(
+	PFFB_ENGINE Engine
+)
+{
+	for (ULONG index = 1; index <= MAX_EFFECT_BLOCKS; index++)
+	{
+		Engine->Effects[index].IsPlaying = FALSE;
+	}
+}
+
+VOID FFB_ENGINE_INIT(
+	PFFB_ENGINE Engine
+)
+{
+	RtlZeroMemory(Engine, sizeof(FFB_ENGINE));
+
+	Engine->DeviceGain = FFB_Q15_ONE;
+	Engine->IsActuatorsEnabled = TRUE;
+	Engine->NextDeadline = FFB_ENGINE_NO_DEADLINE;
+}
+
+VOID FFB_ENGINE_SET_EFFECT(
+	PFFB_ENGINE Engine,
+	const PID_SET_EFFECT_REPORT* Report
+)
+{
+	if (!FFB_IS_VALID_INDEX(Report->EffectBlockIndex))
+		return;
+
+	const PFFB_EFFECT effect = &Engine->Effects[Report->EffectBlockIndex];
+
+	effect->Type = Report->EffectType;
+	effect->Duration = Report->Duration;
+	effect->StartDelay = Report->StartDelay;
+	effect->Gain = (USHORT)FFB_Q15_FROM_PID(Report->Gain);
+	effect->AxesEnableX = Report->AxesEnableX;
+	effect->AxesEnableY = Report->AxesEnableY;
+	effect->IsInUse = TRUE;
+}
+
+VOID FFB_ENGINE_SET_ENVELOPE(
+	PFFB_ENGINE Engine,
+	const PID_SET_ENVELOPE_REPORT* Report
+)
+{
+	if (!FFB_IS_VALID_INDEX(Report->EffectBlockIndex))
+		return;
+
+	const PFFB_EFFECT effect = &Engine->Effects[Report->EffectBlockIndex];
+
+	effect->Envelope.AttackLevel = (USHORT)FFB_Q15_FROM_PID(Report->AttackLevel);
+	effect->Envelope.FadeLevel = (USHORT)FFB_Q15_FROM_PID(Report->FadeLevel);
+	effect->Envelope.AttackTime = Report->AttackTime;
+	effect->Envelope.FadeTime = Report->FadeTime;
+	effect->HasEnvelope = TRUE;
+}
+
+VOID FFB_ENGINE_SET_CONDITION(
+	PFFB_ENGINE Engine,
+	const PID_SET_CONDITION_REPORT* Report
+)
+{
+	if (!FFB_IS_VALID_INDEX(Report->EffectBlockIndex) || Report->ParameterBlockOffset > 1)
+		return;
+
+	const PFFB_CONDITION condition = &Engine->Effects[Report->EffectBlockIndex].Conditions[Report->ParameterBlockOffset];
+
+	condition->CpOffset = (SHORT)FFB_Q15_FROM_PID(Report->CpOffset);
+	condition->PositiveCoefficient = (SHORT)FFB_Q15_FROM_PID(Report->PositiveCoefficient);
+	condition->NegativeCoefficient = (SHORT)FFB_Q15_FROM_PID(Report->NegativeCoefficient);
+	condition->PositiveSaturation = (USHORT)FFB_Q15_FROM_PID(Report->PositiveSaturation);
+	condition->NegativeSaturation = (USHORT)FFB_Q15_FROM_PID(Report->NegativeSaturation);
+	condition->DeadBand = (USHORT)FFB_Q15_FROM_PID(Report->DeadBand);
+}
+
+VOID FFB_ENGINE_SET_PERIODIC(
+	PFFB_ENGINE Engine,
+	const PID_SET_PERIODIC_REPORT* Report
+)
+{
+	if (!FFB_IS_VALID_INDEX(Report->EffectBlockIndex))
+		return;
+
+	const PFFB_PERIODIC periodic = &Engine->Effects[Report->EffectBlockIndex].Periodic;
+
+	periodic->Magnitude = (USHORT)FFB_Q15_FROM_PID(Report->Magnitude);
+	periodic->Offset = (SHORT)FFB_Q15_FROM_PID(Report->Offset);
+	periodic->Phase = FFB_Q15_PHASE_FROM_CENTIDEGREES(Report->Phase);
+	periodic->Period = Report->Period;
+	periodic->PhaseStep = FFB_Q15_PHASE_STEP(Report->Period);
+}
+
+VOID FFB_ENGINE_SET_CONSTANT_FORCE(
+	PFFB_ENGINE Engine,
+	const PID_SET_CONSTANT_FORCE_REPORT* Report
+)
+{
+	if (!FFB_IS_VALID_INDEX(Report->EffectBlockIndex))
+		return;
+
+	Engine->Effects[Report->EffectBlockIndex].ConstantMagnitude = (SHORT)FFB_Q15_FROM_PID(Report->Magnitude);
+}
+
+VOID FFB_ENGINE_SET_RAMP_FORCE(
+	PFFB_ENGINE Engine,
+	const PID_SET_RAMP_FORCE_REPORT* Report
+)
+{
+	if (!FFB_IS_VALID_INDEX(Report->EffectBlockIndex))
+		return;
+
+	Engine->Effects[Report->EffectBlockIndex].RampStart = (SHORT)FFB_Q15_FROM_PID(Report->RampStart);
+	Engine->Effects[Report->EffectBlockIndex].RampEnd = (SHORT)FFB_Q15_FROM_PID(Report->RampEnd);
+}
+
+VOID FFB_ENGINE_EFFECT_OPERATION(
+	PFFB_ENGINE Engine,
+	const PID_EFFECT_OPERATION_REPORT* Report,
+	ULONGLONG Now
+)
+{
+	if (!FFB_IS_VALID_INDEX(Report->EffectBlockIndex))
+		return;
+
+	const PFFB_EFFECT effect = &Engine->Effects[Report->EffectBlockIndex];
+
+	switch (Report->EffectOperation)
+	{
+	case PidEoStartSolo:
+		FFB_STOP_ALL_EFFECTS(Engine);
+		FFB_START_EFFECT(Engine, effect, Report->LoopCount, Now);
+		break;
+	case PidEoStart:
+		FFB_START_EFFECT(Engine, effect, Report->LoopCount, Now);
+		break;
+	case PidEoStop:
+		effect->IsPlaying = FALSE;
+		break;
+	default:
+		break;
+	}
+}
+
+VOID FFB_ENGINE_DEVICE_CONTROL(
+	PFFB_ENGINE Engine,
+	UCHAR Command,
+	ULONGLONG Now
+)
+{
+	switch (Command)
+	{
+	case PidDcEnableActuators:
+		Engine->IsActuatorsEnabled = TRUE;
+		break;
+	case PidDcDisableActuators:
+		Engine->IsActuatorsEnabled = FALSE;
+		break;
+	case PidDcStopAllEffects:
+		FFB_STOP_ALL_EFFECTS(Engine);
+		break;
+	case PidDcReset:
+		RtlZeroMemory(Engine->Effects, sizeof(Engine->Effects));
+		Engine->IsPaused = FALSE;
+		Engine->IsActuatorsEnabled = TRUE;
+		break;
+	case PidDcPause:
+		if (!Engine->IsPaused)
+		{
+			Engine->IsPaused = TRUE;
+			Engine->PausedAt = Now;
+		}
+		break;
+	case PidDcContinue:
+		if (Engine->IsPaused)
+		{
+			//
+			// Resume where playback left off
+			//
+			for (ULONG index = 1; index <= MAX_EFFECT_BLOCKS; index++)
+			{
+				Engine->Effects[index].StartTime += Now - Engine->PausedAt;
+			}
+
+			Engine->IsPaused = FALSE;
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+VOID FFB_ENGINE_SET_DEVICE_GAIN(
+	PFFB_ENGINE Engine,
+	USHORT Gain
+)
+{
+	Engine->DeviceGain = (USHORT)FFB_Q15_FROM_PID(Gain);
+}
+
+VOID FFB_ENGINE_FREE_EFFECT(
+	PFFB_ENGINE Engine,
+	UCHAR EffectBlockIndex
+)
+{
+	if (!FFB_IS_VALID_INDEX(EffectBlockIndex))
+		return;
+
+	RtlZeroMemory(&Engine->Effects[EffectBlockIndex], sizeof(FFB_EFFECT));
+}
+
+VOID FFB_ENGINE_SET_AXES(
+	PFFB_ENGINE Engine,
+	SHORT X,
+	SHORT Y
+)
+{
+	//
+	// Positions went unreported while no condition effect was active, don't
+	// mistake the gap for movement
+	//
+	if (!Engine->IsTrackingAxes)
+	{
+		Engine->LastPosition[0] = X;
+		Engine->LastPosition[1] = Y;
+		RtlZeroMemory(Engine->Velocity, sizeof(Engine->Velocity));
+		RtlZeroMemory(Engine->Acceleration, sizeof(Engine->Acceleration));
+		Engine->IsTrackingAxes = TRUE;
+	}
+
+	Engine->Position[0] = X;
+	Engine->Position[1] = Y;
+}
+
+//
+// Milliseconds until the engine needs to be evaluated again as of the last
+// tick, FALSE if there's nothing pending (no effects playing or paused)
+//
+BOOLEAN FFB_ENGINE_GET_NEXT_WAKE(
+	const FFB_ENGINE* Engine,
+	ULONGLONG Now,
+	PULONG DelayMs
+)
+{
+	if (Engine->NextDeadline == FFB_ENGINE_NO_DEADLINE)
+	{
+		return FALSE;
+	}
+
+	const ULONGLONG delay = (Engine->NextDeadline > Now) ? Engine->NextDeadline - Now : 1;
+
+	*DelayMs = (delay > 0xFFFFFFFF) ? 0xFFFFFFFF : (ULONG)delay;
+
+	return TRUE;
+}
+
+//
+// Evaluates all playing effects and mixes them down to the two motors.
+// Returns TRUE if the motor values differ from the previous tick.
+//
+BOOLEAN FFB_ENGINE_TICK(
+	PFFB_ENGINE Engine,
+	ULONGLONG Now,
+	PUCHAR LargeMotor,
+	PUCHAR SmallMotor
+)
+{
+	LONG strong = 0, weak = 0;
+	ULONGLONG deadline = FFB_ENGINE_NO_DEADLINE;
+
+	//
+	// Derive axis movement for condition effects
+	//
+	if (Engine->HasTicked && Now > Engine->LastTick)
+	{
+		const LONG dt = (LONG)(Now - Engine->LastTick);
+
+		for (UCHAR axis = 0; axis < 2; axis++)
+		{
+			const LONG velocity = FFB_CLAMP(
+				((Engine->Position[axis] - Engine->LastPosition[axis]) * 1000) / dt,
+				-FFB_Q15_ONE,
+				FFB_Q15_ONE
+			);
+
+			Engine->Acceleration[axis] = FFB_CLAMP(
+				((velocity - Engine->Velocity[axis]) * 100) / dt,
+				-FFB_Q15_ONE,
+				FFB_Q15_ONE
+			);
+			Engine->Velocity[axis] = velocity;
+		}
+	}
+
+	Engine->LastPosition[0] = Engine->Position[0];
+	Engine->LastPosition[1] = Engine->Position[1];
+	Engine->LastTick = Now;
+
+	if (!Engine->IsPaused)
+	{
+		BOOLEAN hasConditions = FALSE;
+
+		for (ULONG index = 1; index <= MAX_EFFECT_BLOCKS; index++)
+		{
+			const PFFB_EFFECT effect = &Engine->Effects[index];
+
+			if (!effect->IsPlaying)
+			{
+				continue;
+			}
+
+			FFB_EVALUATE_EFFECT(Engine, effect, Now, &strong, &weak);
+
+			if (effect->IsPlaying)
+			{
+				const ULONGLONG next = FFB_NEXT_DEADLINE(effect, Now);
+
+				if (next < deadline)
+				{
+					deadline = next;
+				}
+
+				hasConditions |= FFB_IS_CONDITION(effect->Type);
+			}
+		}
+
+		Engine->HasConditions = hasConditions;
+
+		if (!hasConditions)
+		{
+			Engine->IsTrackingAxes = FALSE;
+		}
+	}
+
+	Engine->NextDeadline = deadline;
+
+	//
+	// Effects keep running (and expiring) while actuators are disabled
+	//
+	if (!Engine->IsActuatorsEnabled)
+	{
+		strong = 0;
+		weak = 0;
+	}
+
+	*LargeMotor = FFB_Q15_TO_MOTOR(FFB_Q15_MUL(FFB_CLAMP(strong, 0, FFB_Q15_ONE), Engine->DeviceGain));
+	*SmallMotor = FFB_Q15_TO_MOTOR(FFB_Q15_MUL(FFB_CLAMP(weak, 0, FFB_Q15_ONE), Engine->DeviceGain));
+
+	const BOOLEAN isChanged = !Engine->HasTicked
+		|| *LargeMotor != Engine->LargeMotor
+		|| *SmallMotor != Engine->SmallMotor;
+
+	Engine->LargeMotor = *LargeMotor;
+	Engine->SmallMotor = *SmallMotor;
+	Engine->HasTicked = TRUE;
+
+	return isChanged;
+}
@@ -0,0 +1,317 @@
+#pragma once
+
+#include "DsPortable.h"
+#include "FFB.Q15.h"
+#include "PID/PIDTypes.h"
+
+EXTERN_C_START
+
+//
+// Interval in milliseconds effects with continuously changing output get
+// evaluated at (100 Hz), otherwise only effect boundaries wake the engine
+//
+#define FFB_ENGINE_TICK_MS				10
+
+//
+// Durations beyond the logical maximum (like 0xFFFF) mean "play until stopped"
+//
+#define FFB_ENGINE_INFINITE_DURATION	0x7FFF
+
+//
+// Loop count requesting endless repetition
+//
+#define FFB_ENGINE_INFINITE_LOOPS		0xFF
+
+//
+// Periodic effects faster than this can't be rendered at tick rate and
+// drive the small (high frequency) motor with their magnitude instead
+//
+#define FFB_ENGINE_FAST_PERIOD_MS		(FFB_ENGINE_TICK_MS * 4)
+
+//
+// Deadline value meaning "nothing scheduled"
+//
+#define FFB_ENGINE_NO_DEADLINE			(~(ULONGLONG)0)
+
+//
+// Levels, magnitudes, offsets, coefficients and gains below are stored in Q15,
+// converted once when the PID report arrives
+//
+typedef struct _FFB_ENVELOPE
+{
+	USHORT AttackLevel;
+
+	USHORT FadeLevel;
+
+	USHORT AttackTime;
+
+	USHORT FadeTime;
+
+} FFB_ENVELOPE, * PFFB_ENVELOPE;
+
+typedef struct _FFB_PERIODIC
+{
+	USHORT Magnitude;
+
+	SHORT Offset;
+
+	//
+	// Fraction of a turn, see FFB_Q15_PHASE_BITS
+	//
+	USHORT Phase;
+
+	//
+	// Milliseconds
+	//
+	USHORT Period;
+
+	//
+	// Phase advance per millisecond, see FFB_Q15_PHASE_STEP
+	//
+	ULONG PhaseStep;
+
+} FFB_PERIODIC, * PFFB_PERIODIC;
+
+typedef struct _FFB_CONDITION
+{
+	SHORT CpOffset;
+
+	SHORT PositiveCoefficient;
+
+	SHORT NegativeCoefficient;
+
+	USHORT PositiveSaturation;
+
+	USHORT NegativeSaturation;
+
+	USHORT DeadBand;
+
+} FFB_CONDITION, * PFFB_CONDITION;
+
+//
+// Parsed parameters and playback state of a single effect block
+//
+typedef struct _FFB_EFFECT
+{
+	//
+	// Parameters have been received for this block
+	//
+	BOOLEAN IsInUse;
+
+	BOOLEAN IsPlaying;
+
+	//
+	// PID_EFFECT_TYPE
+	//
+	UCHAR Type;
+
+	//
+	// Axes the (condition) effect applies to
+	//
+	BOOLEAN AxesEnableX;
+
+	BOOLEAN AxesEnableY;
+
+	//
+	// Milliseconds, FFB_ENGINE_INFINITE_DURATION or above plays until stopped
+	//
+	USHORT Duration;
+
+	USHORT StartDelay;
+
+	USHORT Gain;
+
+	BOOLEAN HasEnvelope;
+
+	FFB_ENVELOPE Envelope;
+
+	SHORT ConstantMagnitude;
+
+	SHORT RampStart;
+
+	SHORT RampEnd;
+
+	FFB_PERIODIC Periodic;
+
+	//
+	// One block per axis
+	//
+	FFB_CONDITION Conditions[2];
+
+	//
+	// Engine time the current playback iteration began, the first one
+	// includes the start delay
+	//
+	ULONGLONG StartTime;
+
+	//
+	// Iterations left to play, FFB_ENGINE_INFINITE_LOOPS repeats forever
+	//
+	UCHAR LoopsRemaining;
+
+	//
+	// Past the first iteration, the start delay doesn't apply anymore
+	//
+	BOOLEAN IsRepeating;
+
+} FFB_EFFECT, * PFFB_EFFECT;
+
+//
+// Effect table, scheduler and mixer. Time is passed in by the caller in
+// milliseconds so the engine runs against any (fake) clock. Not synchronized,
+// callers must serialize access.
+//
+typedef struct _FFB_ENGINE
+{
+	//
+	// Indexed by effect block index (1 to MAX_EFFECT_BLOCKS)
+	//
+	FFB_EFFECT Effects[MAX_EFFECT_BLOCKS + 1];
+
+	//
+	// Overall gain (Q15)
+	//
+	USHORT DeviceGain;
+
+	BOOLEAN IsActuatorsEnabled;
+
+	BOOLEAN IsPaused;
+
+	//
+	// Time playback got paused at
+	//
+	ULONGLONG PausedAt;
+
+	//
+	// Condition effects are playing (or paused), so axis positions are
+	// needed. May be read without serialization to skip FFB_ENGINE_SET_AXES.
+	//
+	volatile BOOLEAN HasConditions;
+
+	//
+	// Positions got set since condition effects became active, earlier ones
+	// are stale
+	//
+	BOOLEAN IsTrackingAxes;
+
+	//
+	// Latest axis positions (Q15), input to condition effects
+	//
+	SHORT Position[2];
+
+	//
+	// Derived per tick, Q15
+	//
+	LONG Velocity[2];
+
+	LONG Acceleration[2];
+
+	SHORT LastPosition[2];
+
+	ULONGLONG LastTick;
+
+	BOOLEAN HasTicked;
+
+	//
+	// Motor values of the last tick
+	//
+	UCHAR LargeMotor;
+
+	UCHAR SmallMotor;
+
+	//
+	// Engine time the output may change next at, as of the last tick
+	//
+	ULONGLONG NextDeadline;
+
+} FFB_ENGINE, * PFFB_ENGINE;
+
+//
+// Converts a raw 8-bit axis value (centered at 0x80) to an engine position,
+// 0x7F * 258 is FFB_Q15_ONE - 1 so this gets away without a division
+//
+FORCEINLINE SHORT FFB_ENGINE_POSITION_FROM_AXIS(
+	UCHAR Value
+)
+{
+	const LONG position = ((LONG)Value - 0x80) * 258;
+
+	return (SHORT)((position < -FFB_Q15_ONE) ? -FFB_Q15_ONE : position);
+}
+
+VOID FFB_ENGINE_INIT(
+	_Out_ PFFB_ENGINE Engine
+);
+
+VOID FFB_ENGINE_SET_EFFECT(
+	_Inout_ PFFB_ENGINE Engine,
+	_In_ const PID_SET_EFFECT_REPORT* Report
+);
+
+VOID FFB_ENGINE_SET_ENVELOPE(
+	_Inout_ PFFB_ENGINE Engine,
+	_In_ const PID_SET_ENVELOPE_REPORT* Report
+);
+
+VOID FFB_ENGINE_SET_CONDITION(
+	_Inout_ PFFB_ENGINE Engine,
+	_In_ const PID_SET_CONDITION_REPORT* Report
+);
+
+VOID FFB_ENGINE_SET_PERIODIC(
+	_Inout_ PFFB_ENGINE Engine,
+	_In_ const PID_SET_PERIODIC_REPORT* Report
+);
+
+VOID FFB_ENGINE_SET_CONSTANT_FORCE(
+	_Inout_ PFFB_ENGINE Engine,
+	_In_ const PID_SET_CONSTANT_FORCE_REPORT* Report
+);
+
+VOID FFB_ENGINE_SET_RAMP_FORCE(
+	_Inout_ PFFB_ENGINE Engine,
+	_In_ const PID_SET_RAMP_FORCE_REPORT* Report
+);
+
+VOID FFB_ENGINE_EFFECT_OPERATION(
+	_Inout_ PFFB_ENGINE Engine,
+	_In_ const PID_EFFECT_OPERATION_REPORT* Report,
+	_In_ ULONGLONG Now
+);
+
+VOID FFB_ENGINE_DEVICE_CONTROL(
+	_Inout_ PFFB_ENGINE Engine,
+	_In_ UCHAR Command,
+	_In_ ULONGLONG Now
+);
+
+VOID FFB_ENGINE_SET_DEVICE_GAIN(
+	_Inout_ PFFB_ENGINE Engine,
+	_In_ USHORT Gain
+);
+
+VOID FFB_ENGINE_FREE_EFFECT(
+	_Inout_ PFFB_ENGINE Engine,
+	_In_ UCHAR EffectBlockIndex
+);
+
+VOID FFB_ENGINE_SET_AXES(
+	_Inout_ PFFB_ENGINE Engine,
+	_In_ SHORT X,
+	_In_ SHORT Y
+);
+
+BOOLEAN FFB_ENGINE_GET_NEXT_WAKE(
+	_In_ const FFB_ENGINE* Engine,
+	_In_ ULONGLONG Now,
+	_Out_ PULONG DelayMs
+);
+
+BOOLEAN FFB_ENGINE_TICK(
+	_Inout_ PFFB_ENGINE Engine,
+	_In_ ULONGLONG Now,
+	_Out_ PUCHAR LargeMotor,
+	_Out_ PUCHAR SmallMotor
+);
+
+EXTERN_C_END
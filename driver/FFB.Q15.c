@@ -0,0 +1,87 @@
+#include "FFB.Q15.h"
+
+//
+// NOTE: this module must stay free of WDF, DMF and WPP dependencies
+//
+
+//
+// Table index bits of a quarter turn, the remaining bits get interpolated
+//
+#define FFB_Q15_SINE_INDEX_BITS		7
+#define FFB_Q15_SINE_FRACTION_BITS	(FFB_Q15_PHASE_BITS - 2 - FFB_Q15_SINE_INDEX_BITS)
+
+//
+// sin(0..90 degrees) in Q15, 128 steps plus the end point
+//
+static const SHORT G_FfbQ15QuarterSine[(1 << FFB_Q15_SINE_INDEX_BITS) + 1] = {
+	0, 402, 804, 1206, 1608, 2009, 2410, 2811, 3212, 3612,
+	4011, 4410, 4808, 5205, 5602, 5998, 6393, 6786, 7179, 7571,
+	7962, 8351, 8739, 9126, 9512, 9896, 10278, 10659, 11039, 11417,
+	11793, 12167, 12539, 12910, 13279, 13645, 14010, 14372, 14732, 15090,
+	15446, 15800, 16151, 16499, 16846, 17189, 17530, 17869, 18204, 18537,
+	18868, 19195, 19519, 19841, 20159, 20475, 20787, 21096, 21403, 21705,
+	22005, 22301, 22594, 22884, 23170, 23452, 23731, 24007, 24279, 24547,
+	24811, 25072, 25329, 25582, 25832, 26077, 26319, 26556, 26790, 27019,
+	27245, 27466, 27683, 27896, 28105, 28310, 28510, 28706, 28898, 29085,
+	29268, 29447, 29621, 29791, 29956, 30117, 30273, 30424, 30571, 30714,
+	30852, 30985, 31113, 31237, 31356, 31470, 31580, 31685, 31785, 31880,
+	31971, 32057, 32137, 32213, 32285, 32351, 32412, 32469, 32521, 32567,
+	32609, 32646, 32678, 32705, 32728, 32745, 32757, 32765, 32767
+};
+
+//
+// Position within the quarter turn, mirrored on the falling quarters
+//
+static ULONG FFB_Q15_QUARTER(
+	USHORT Phase
+)
+{
+	const ULONG quarter = 1UL << (FFB_Q15_PHASE_BITS - 2);
+	const ULONG within = Phase & (quarter - 1);
+
+	return (Phase & quarter) ? quarter - within : within;
+}
+
+//
+// Table lookup with linear interpolation, stays within 2 LSB of the exact sine
+//
+LONG FFB_Q15_SINE(
+	USHORT Phase
+)
+{
+	const ULONG within = FFB_Q15_QUARTER(Phase);
+	const ULONG index = within >> FFB_Q15_SINE_FRACTION_BITS;
+	const LONG fraction = (LONG)(within & ((1UL << FFB_Q15_SINE_FRACTION_BITS) - 1));
+	LONG value = G_FfbQ15QuarterSine[index];
+
+	if (fraction)
+	{
+		value += ((G_FfbQ15QuarterSine[index + 1] - value) * fraction
+			+ (1 << (FFB_Q15_SINE_FRACTION_BITS - 1))) >> FFB_Q15_SINE_FRACTION_BITS;
+	}
+
+	return (Phase & 0x8000) ? -value : value;
+}
+
+//
+// Rises from 0 to peak over the first quarter turn, exact to rounding
+//
+LONG FFB_Q15_TRIANGLE(
+	USHORT Phase
+)
+{
+	const ULONG within = FFB_Q15_QUARTER(Phase);
+	const LONG value = (LONG)((within * FFB_Q15_ONE + (1UL << (FFB_Q15_PHASE_BITS - 3))) >> (FFB_Q15_PHASE_BITS - 2));
+
+	return (Phase & 0x8000) ? -value : value;
+}
+
+//
+// Rises from -1.0 to 1.0 over a full turn, exact to rounding
+//
+LONG FFB_Q15_SAWTOOTH_UP(
+	USHORT Phase
+)
+{
+	return (LONG)(((ULONG)Phase * (2 * FFB_Q15_ONE) + (1UL << (FFB_Q15_PHASE_BITS - 1))) >> FFB_Q15_PHASE_BITS) - FFB_Q15_ONE;
+}
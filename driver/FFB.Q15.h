@@ -0,0 +1,111 @@
+#pragma once
+
+#include "DsPortable.h"
+
+EXTERN_C_START
+
+//
+// Logical maximum of PID magnitudes, coefficients, levels and gains
+//
+#define FFB_Q15_PID_MAX			10000
+
+//
+// Q15 representation of 1.0 (values range -FFB_Q15_ONE to FFB_Q15_ONE)
+//
+#define FFB_Q15_ONE				0x7FFF
+
+//
+// Phase angles are fractions of a full turn in 16 bits (0x10000 equals 360 degrees)
+//
+#define FFB_Q15_PHASE_BITS		16
+
+//
+// Converts a PID logical value (-10000 to 10000) to Q15, rounding to nearest.
+// Divides, so meant for when reports arrive, not for per tick evaluation.
+//
+FORCEINLINE LONG FFB_Q15_FROM_PID(
+	LONG Value
+)
+{
+	if (Value > FFB_Q15_PID_MAX)
+	{
+		Value = FFB_Q15_PID_MAX;
+	}
+	else if (Value < -FFB_Q15_PID_MAX)
+	{
+		Value = -FFB_Q15_PID_MAX;
+	}
+
+	return (Value >= 0)
+		? (Value * FFB_Q15_ONE + FFB_Q15_PID_MAX / 2) / FFB_Q15_PID_MAX
+		: -((-Value * FFB_Q15_ONE + FFB_Q15_PID_MAX / 2) / FFB_Q15_PID_MAX);
+}
+
+//
+// Product of two Q15 values (either may exceed 1.0 while mixing), rounded.
+// Relies on arithmetic right shifts of negative values, as MSVC, GCC and Clang do.
+//
+FORCEINLINE LONG FFB_Q15_MUL(
+	LONG A,
+	LONG B
+)
+{
+	return (LONG)(((LONGLONG)A * B + (1 << 14)) >> 15);
+}
+
+//
+// Scales a Q15 value (0 to FFB_Q15_ONE) to a motor value (0 to 255)
+//
+FORCEINLINE UCHAR FFB_Q15_TO_MOTOR(
+	LONG Value
+)
+{
+	return (UCHAR)((Value * 255 + (1 << 14)) >> 15);
+}
+
+//
+// Converts hundredths of a degree (0 to 35999) to a phase angle
+//
+FORCEINLINE USHORT FFB_Q15_PHASE_FROM_CENTIDEGREES(
+	USHORT Angle
+)
+{
+	return (USHORT)((((ULONG)(Angle % 36000) << FFB_Q15_PHASE_BITS) + 18000) / 36000);
+}
+
+//
+// Phase advance per millisecond of a period in milliseconds, in 32-bit
+// fractions of a turn. Rounded up so the last millisecond of a period
+// still maps below a full turn.
+//
+FORCEINLINE ULONG FFB_Q15_PHASE_STEP(
+	USHORT Period
+)
+{
+	return Period ? (ULONG)((0x100000000ULL + Period - 1) / Period) : 0;
+}
+
+//
+// Phase angle a given time (0 to period - 1) into the period is at
+//
+FORCEINLINE USHORT FFB_Q15_PHASE_AT(
+	ULONG Step,
+	ULONG Elapsed
+)
+{
+	return (USHORT)(((ULONGLONG)Step * Elapsed) >> (32 - FFB_Q15_PHASE_BITS));
+}
+
+LONG FFB_Q15_SINE(
+	_In_ USHORT Phase
+);
+
+LONG FFB_Q15_TRIANGLE(
+	_In_ USHORT Phase
+);
+
+LONG FFB_Q15_SAWTOOTH_UP(
+	_In_ USHORT Phase
+);
+
+EXTERN_C_END
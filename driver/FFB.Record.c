@@ -0,0 +1,122 @@
+#include "FFB.Record.h"
+
+//
+// NOTE: this module must stay free of WDF, DMF and WPP dependencies
+//
+
+static VOID FFB_RECORD_PUT16(
+	PUCHAR Target,
+	USHORT Value
+)
+{
+	Target[0] = (UCHAR)(Value & 0xFF);
+	Target[1] = (UCHAR)(Value >> 8);
+}
+
+static VOID FFB_RECORD_PUT32(
+	PUCHAR Target,
+	ULONG Value
+)
+{
+	FFB_RECORD_PUT16(Target, (USHORT)(Value & 0xFFFF));
+	FFB_RECORD_PUT16(Target + 2, (USHORT)(Value >> 16));
+}
+
+static USHORT FFB_RECORD_GET16(
+	const UCHAR* Source
+)
+{
+	return (USHORT)(Source[0] | (Source[1] << 8));
+}
+
+static ULONG FFB_RECORD_GET32(
+	const UCHAR* Source
+)
+{
+	return (ULONG)FFB_RECORD_GET16(Source) | ((ULONG)FFB_RECORD_GET16(Source + 2) << 16);
+}
+
+SIZE_T FFB_RECORD_ENCODE_HEADER(
+	PUCHAR Buffer,
+	SIZE_T BufferSize
+)
+{
+	if (BufferSize < FFB_RECORD_FILE_HEADER_SIZE)
+	{
+		return 0;
+	}
+
+	RtlCopyMemory(Buffer, FFB_RECORD_MAGIC, 4);
+	FFB_RECORD_PUT16(Buffer + 4, FFB_RECORD_VERSION);
+	FFB_RECORD_PUT16(Buffer + 6, 0);
+
+	return FFB_RECORD_FILE_HEADER_SIZE;
+}
+
+SIZE_T FFB_RECORD_ENCODE_ENTRY(
+	PUCHAR Buffer,
+	SIZE_T BufferSize,
+	ULONG TimestampMs,
+	FFB_RECORD_KIND Kind,
+	const UCHAR* Data,
+	USHORT Length
+)
+{
+	if (Length > FFB_RECORD_MAX_PAYLOAD || BufferSize < (SIZE_T)FFB_RECORD_ENTRY_HEADER_SIZE + Length)
+	{
+		return 0;
+	}
+
+	FFB_RECORD_PUT32(Buffer, TimestampMs);
+	Buffer[4] = (UCHAR)Kind;
+	Buffer[5] = 0;
+	FFB_RECORD_PUT16(Buffer + 6, Length);
+	RtlCopyMemory(Buffer + FFB_RECORD_ENTRY_HEADER_SIZE, Data, Length);
+
+	return FFB_RECORD_ENTRY_HEADER_SIZE + Length;
+}
+
+SIZE_T FFB_RECORD_DECODE_HEADER(
+	const UCHAR* Buffer,
+	SIZE_T BufferSize
+)
+{
+	if (BufferSize < FFB_RECORD_FILE_HEADER_SIZE
+		|| !RtlEqualMemory(Buffer, FFB_RECORD_MAGIC, 4)
+		|| FFB_RECORD_GET16(Buffer + 4) != FFB_RECORD_VERSION)
+	{
+		return 0;
+	}
+
+	return FFB_RECORD_FILE_HEADER_SIZE;
+}
+
+BOOLEAN FFB_RECORD_DECODE_ENTRY(
+	const UCHAR* Buffer,
+	SIZE_T BufferSize,
+	PSIZE_T Offset,
+	PFFB_RECORD_ENTRY Entry
+)
+{
+	if (*Offset > BufferSize || BufferSize - *Offset < FFB_RECORD_ENTRY_HEADER_SIZE)
+	{
+		return FALSE;
+	}
+
+	const UCHAR* header = Buffer + *Offset;
+	const USHORT length = FFB_RECORD_GET16(header + 6);
+
+	if (length == 0 || BufferSize - *Offset - FFB_RECORD_ENTRY_HEADER_SIZE < length)
+	{
+		return FALSE;
+	}
+
+	Entry->TimestampMs = FFB_RECORD_GET32(header);
+	Entry->Kind = header[4];
+	Entry->Length = length;
+	Entry->Data = header + FFB_RECORD_ENTRY_HEADER_SIZE;
+
+	*Offset += FFB_RECORD_ENTRY_HEADER_SIZE + length;
+
+	return TRUE;
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "DsPortable.h"
+
+EXTERN_C_START
+
+//
+// Recording of the PID reports a game sent, replayable through the effect engine.
+//
+// File layout (all values little endian):
+//
+//   "FFBR", USHORT version, USHORT reserved
+//   entries:
+//     ULONG timestamp (milliseconds since recording started)
+//     UCHAR kind (FFB_RECORD_KIND)
+//     UCHAR reserved
+//     USHORT length
+//     length bytes of report data (report ID first)
+//
+
+#define FFB_RECORD_MAGIC				"FFBR"
+#define FFB_RECORD_VERSION				1
+#define FFB_RECORD_FILE_HEADER_SIZE		8
+#define FFB_RECORD_ENTRY_HEADER_SIZE	8
+
+//
+// Largest report recorded, PID reports are much smaller
+//
+#define FFB_RECORD_MAX_PAYLOAD			64
+
+typedef enum _FFB_RECORD_KIND
+{
+	FfbRecordWriteReport = 1,
+	FfbRecordSetFeature = 2,
+	FfbRecordGetFeature = 3
+
+} FFB_RECORD_KIND;
+
+typedef struct _FFB_RECORD_ENTRY
+{
+	ULONG TimestampMs;
+
+	UCHAR Kind;
+
+	USHORT Length;
+
+	//
+	// Points into the recording buffer
+	//
+	const UCHAR* Data;
+
+} FFB_RECORD_ENTRY, * PFFB_RECORD_ENTRY;
+
+//
+// Writes the file header, returns the number of bytes written or 0 if the buffer is too small
+//
+SIZE_T FFB_RECORD_ENCODE_HEADER(
+	_Out_writes_bytes_(BufferSize) PUCHAR Buffer,
+	_In_ SIZE_T BufferSize
+);
+
+//
+// Writes one entry, returns the number of bytes written or 0 if the buffer is too small
+//
+SIZE_T FFB_RECORD_ENCODE_ENTRY(
+	_Out_writes_bytes_(BufferSize) PUCHAR Buffer,
+	_In_ SIZE_T BufferSize,
+	_In_ ULONG TimestampMs,
+	_In_ FFB_RECORD_KIND Kind,
+	_In_reads_bytes_(Length) const UCHAR* Data,
+	_In_ USHORT Length
+);
+
+//
+// Validates the file header, returns the offset of the first entry or 0 if invalid
+//
+SIZE_T FFB_RECORD_DECODE_HEADER(
+	_In_reads_bytes_(BufferSize) const UCHAR* Buffer,
+	_In_ SIZE_T BufferSize
+);
+
+//
+// Reads the entry at Offset and advances it, FALSE at the end or on truncated data
+//
+BOOLEAN FFB_RECORD_DECODE_ENTRY(
+	_In_reads_bytes_(BufferSize) const UCHAR* Buffer,
+	_In_ SIZE_T BufferSize,
+	_Inout_ PSIZE_T Offset,
+	_Out_ PFFB_RECORD_ENTRY Entry
+);
+
+EXTERN_C_END
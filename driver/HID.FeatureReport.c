@@ -17,8 +17,6 @@ DSHM_GetFeature(
 
 #ifdef DSHM_FEATURE_FFB
 
-	FFB_ATTRIBUTES ffbEntry = { 0 };
-
 	PPID_POOL_REPORT pPool = NULL;
 	PPID_BLOCK_LOAD_REPORT pBlockLoad = NULL;
 
@@ -59,53 +57,38 @@ DSHM_GetFeature(
 	//
 	// Here we should have at least one new effect block index ready
 	// 
-		for (UCHAR index = 1; index < MAX_EFFECT_BLOCKS; index++)
+		WdfWaitLockAcquire(DeviceContext->ForceFeedback.Lock, NULL);
+		pBlockLoad->EffectBlockIndex = FFB_BLOCKS_CLAIM(&DeviceContext->ForceFeedback.Blocks);
+		WdfWaitLockRelease(DeviceContext->ForceFeedback.Lock);
+
+		if (pBlockLoad->EffectBlockIndex)
 		{
-			status = DMF_HashTable_Read(
-				ModuleContext->DmfModuleForceFeedback,
-				&index,
-				sizeof(UCHAR),
-				(PUCHAR)&ffbEntry,
-				sizeof(FFB_ATTRIBUTES),
-				NULL
-			);
-
-			//
-			// Find reserved but unclaimed entry
-			// 
-			if (NT_SUCCESS(status) && ffbEntry.IsReserved && !ffbEntry.IsReported)
-			{
-				ffbEntry.IsReported = TRUE;
-
-				pBlockLoad->EffectBlockIndex = ffbEntry.EffectBlockIndex;
-				pBlockLoad->BlockLoadStatus = PidBlsSuccess;
-
-				status = DMF_HashTable_Write(
-					ModuleContext->DmfModuleForceFeedback,
-					&index,
-					sizeof(UCHAR),
-					(PUCHAR)&ffbEntry,
-					sizeof(FFB_ATTRIBUTES)
-				);
-
-				break;
-			}
+			pBlockLoad->BlockLoadStatus = PidBlsSuccess;
 		}
 
+		status = STATUS_SUCCESS;
+
 		TraceVerbose(TRACE_DSHIDMINIDRV, "!! PID_BLOCK_LOAD_REPORT_ID (EffectBlockIndex: %d)",
 			pBlockLoad->EffectBlockIndex);
 
 		*ReportSize = sizeof(PID_BLOCK_LOAD_REPORT) - 1;
 
+		DSHM_FfbRecord(DeviceContext, FfbRecordGetFeature, Packet);
+
 		break;
 	}
 
 #endif
 
+	LONG epoch;
+	const DS_CONFIG_SNAPSHOT* config = DS_CONFIG_READ_BEGIN(DeviceContext, &epoch);
+	const DS_HID_DEVICE_MODE hidDeviceMode = config->Configuration.HidDeviceMode;
+	DS_CONFIG_READ_END(DeviceContext, epoch);
+
 	//
 	// SIXAXIS.SYS emulation
 	// 
-	if (Packet->reportId == 0x00 && DeviceContext->Configuration.HidDeviceMode == DsHidMiniDeviceModeSixaxisCompatible)
+	if (Packet->reportId == 0x00 && hidDeviceMode == DsHidMiniDeviceModeSixaxisCompatible)
 	{
 		//
 		// Copy last received raw report to buffer
@@ -133,7 +116,7 @@ DSHM_GetFeature(
 	else if (
 		Packet->reportId == 0x12 // Requests device MAC address
 		&& Packet->reportBufferLen == 64
-		&& DeviceContext->Configuration.HidDeviceMode == DsHidMiniDeviceModeDS4WindowsCompatible
+		&& hidDeviceMode == DsHidMiniDeviceModeDS4WindowsCompatible
 		)
 	{
 		RtlCopyMemory(
@@ -187,13 +170,13 @@ DSHM_SetFeature(
 {
 	FuncEntry(TRACE_DSHIDMINIDRV);
 
-	UNREFERENCED_PARAMETER(DeviceContext);
+	UNREFERENCED_PARAMETER(ModuleContext);
 
 	NTSTATUS status = STATUS_SUCCESS;
 
 #ifdef DSHM_FEATURE_FFB
 
-	FFB_ATTRIBUTES ffbEntry = { 0 };
+	UCHAR effectBlockIndex;
 
 	PPID_NEW_EFFECT_REPORT pNewEffect = NULL;
 
@@ -205,43 +188,19 @@ DSHM_SetFeature(
 
 		TraceVerbose(TRACE_DSHIDMINIDRV, "!! PID_CREATE_NEW_EFFECT_REPORT");
 
+		DSHM_FfbRecord(DeviceContext, FfbRecordSetFeature, Packet);
+
 	//
-	// Look for free effect block index and allocate new entry
+	// Reserve next free effect block index, gets claimed by PID_BLOCK_LOAD
 	// 
-		for (UCHAR index = 1; index < MAX_EFFECT_BLOCKS; index++)
-		{
-			status = DMF_HashTable_Read(
-				ModuleContext->DmfModuleForceFeedback,
-				&index,
-				sizeof(UCHAR),
-				(PUCHAR)&ffbEntry,
-				sizeof(FFB_ATTRIBUTES),
-				NULL
-			);
-
-			if (status == STATUS_NOT_FOUND || !ffbEntry.IsReserved)
-			{
-				ffbEntry.EffectBlockIndex = index; // next free index
-				ffbEntry.EffectType = pNewEffect->EffectType; // effect type requested
-				ffbEntry.IsReserved = TRUE; // mark as reserved/allocated
-				ffbEntry.IsReported = FALSE; // index allocated but not claimed yet
-
-				status = DMF_HashTable_Write(
-					ModuleContext->DmfModuleForceFeedback,
-					&index,
-					sizeof(UCHAR),
-					(PUCHAR)&ffbEntry,
-					sizeof(FFB_ATTRIBUTES)
-				);
-
-				break;
-			}
-		}
+		WdfWaitLockAcquire(DeviceContext->ForceFeedback.Lock, NULL);
+		effectBlockIndex = FFB_BLOCKS_ALLOCATE(&DeviceContext->ForceFeedback.Blocks, pNewEffect->EffectType);
+		WdfWaitLockRelease(DeviceContext->ForceFeedback.Lock);
 
 	//
 	// Whoops, guess we're full!
 	// 
-		if (!ffbEntry.IsReserved)
+		if (!effectBlockIndex)
 		{
 			EventWriteFFBNoFreeEffectBlockIndex();
 			status = STATUS_INVALID_PARAMETER;
@@ -17,20 +17,29 @@ DSHM_WriteReport(
 	PUCHAR buffer = NULL;
 	size_t bufferSize = 0;
 
+	UNREFERENCED_PARAMETER(ModuleContext);
+
 #ifdef DSHM_FEATURE_FFB
 
-	FFB_ATTRIBUTES ffbEntry = { 0 };
+	BOOLEAN isFfbReport = TRUE;
 
 	PPID_DEVICE_CONTROL_REPORT pDeviceControl;
 	PPID_DEVICE_GAIN_REPORT pGain;
 	PPID_SET_CONDITION_REPORT pSetCondition;
 	PPID_SET_EFFECT_REPORT pSetEffect;
+	PPID_SET_ENVELOPE_REPORT pSetEnvelope;
 	PPID_SET_PERIODIC_REPORT pSetPeriodic;
 	PPID_SET_CONSTANT_FORCE_REPORT pSetConstant;
+	PPID_SET_RAMP_FORCE_REPORT pSetRamp;
 	PPID_EFFECT_OPERATION_REPORT pEffectOperation;
 	PPID_BLOCK_FREE_REPORT pBlockFree;
 
-	UCHAR rumbleValue = 0;
+	const PFFB_ENGINE pEngine = &DeviceContext->ForceFeedback.Engine;
+
+	//
+	// Reports only update the effect engine, motor output is rendered by DSHM_FfbRender
+	// 
+	WdfWaitLockAcquire(DeviceContext->ForceFeedback.Lock, NULL);
 
 	// ReSharper disable once CppDefaultCaseNotHandledInSwitchStatement
 	switch (Packet->reportId)
@@ -50,41 +59,14 @@ DSHM_WriteReport(
 		case PidDcReset:
 			TraceVerbose(TRACE_DSHIDMINIDRV, "!! DC Reset");
 
-			for (UCHAR index = 1; index < MAX_EFFECT_BLOCKS; index++)
-			{
-				status = DMF_HashTable_Read(
-					ModuleContext->DmfModuleForceFeedback,
-					&index,
-					sizeof(UCHAR),
-					(PUCHAR)&ffbEntry,
-					sizeof(FFB_ATTRIBUTES),
-					NULL
-				);
-
-				if (NT_SUCCESS(status))
-				{
-					ffbEntry.IsReserved = FALSE;
-					ffbEntry.IsReported = FALSE;
-
-					(void)DMF_HashTable_Write(
-						ModuleContext->DmfModuleForceFeedback,
-						&index,
-						sizeof(UCHAR),
-						(PUCHAR)&ffbEntry,
-						sizeof(FFB_ATTRIBUTES)
-					);
-
-					break;
-				}
-			}
+			//
+			// Reset frees all effect blocks
+			// 
+			FFB_BLOCKS_INIT(&DeviceContext->ForceFeedback.Blocks);
 
-		// Fall through
-		case PidDcStopAllEffects:  // NOLINT(clang-diagnostic-implicit-fallthrough)
+			break;
+		case PidDcStopAllEffects:
 			TraceVerbose(TRACE_DSHIDMINIDRV, "!! DC Stop All Effects");
-			DS3_SET_BOTH_RUMBLE_STRENGTH(DeviceContext, 0x00, 0x00);
-
-			(void)DSHM_SendOutputReport(DeviceContext, Ds3OutputReportSourceForceFeedback);
-
 			break;
 		case PidDcPause:
 			TraceVerbose(TRACE_DSHIDMINIDRV, "!! DC Pause");
@@ -96,6 +78,8 @@ DSHM_WriteReport(
 			break;
 		}
 
+		FFB_ENGINE_DEVICE_CONTROL(pEngine, pDeviceControl->DeviceControlCommand, GetTickCount64());
+
 		*ReportSize = Packet->reportBufferLen;
 
 		status = STATUS_SUCCESS;
@@ -109,6 +93,8 @@ DSHM_WriteReport(
 		TraceVerbose(TRACE_DSHIDMINIDRV, "!! PID_DEVICE_GAIN_REPORT, DeviceGain: %d",
 			pGain->DeviceGain);
 
+		FFB_ENGINE_SET_DEVICE_GAIN(pEngine, pGain->DeviceGain);
+
 		*ReportSize = Packet->reportBufferLen;
 
 		status = STATUS_SUCCESS;
@@ -122,6 +108,8 @@ DSHM_WriteReport(
 		TraceVerbose(TRACE_DSHIDMINIDRV, "!! PID_SET_CONDITION_REPORT, EffectBlockIndex: %d",
 			pSetCondition->EffectBlockIndex);
 
+		FFB_ENGINE_SET_CONDITION(pEngine, pSetCondition);
+
 		*ReportSize = Packet->reportBufferLen;
 
 		status = STATUS_SUCCESS;
@@ -150,6 +138,29 @@ DSHM_WriteReport(
 			pSetEffect->DirectionInstance2,
 			pSetEffect->StartDelay);
 
+		FFB_ENGINE_SET_EFFECT(pEngine, pSetEffect);
+
+		*ReportSize = Packet->reportBufferLen;
+
+		status = STATUS_SUCCESS;
+
+		break;
+
+	case PID_SET_ENVELOPE_REPORT_ID:
+
+		pSetEnvelope = (PPID_SET_ENVELOPE_REPORT)Packet->reportBuffer;
+
+		TraceVerbose(TRACE_DSHIDMINIDRV, "!! PID_SET_ENVELOPE_REPORT, "
+			"EffectBlockIndex: %d, AttackLevel: %d, FadeLevel: %d, AttackTime: %d, FadeTime: %d",
+			pSetEnvelope->EffectBlockIndex,
+			pSetEnvelope->AttackLevel,
+			pSetEnvelope->FadeLevel,
+			pSetEnvelope->AttackTime,
+			pSetEnvelope->FadeTime
+		);
+
+		FFB_ENGINE_SET_ENVELOPE(pEngine, pSetEnvelope);
+
 		*ReportSize = Packet->reportBufferLen;
 
 		status = STATUS_SUCCESS;
@@ -169,6 +180,8 @@ DSHM_WriteReport(
 			pSetPeriodic->Period
 		);
 
+		FFB_ENGINE_SET_PERIODIC(pEngine, pSetPeriodic);
+
 		*ReportSize = Packet->reportBufferLen;
 
 		status = STATUS_SUCCESS;
@@ -183,19 +196,24 @@ DSHM_WriteReport(
 			pSetConstant->EffectBlockIndex,
 			pSetConstant->Magnitude);
 
-		rumbleValue = (UCHAR)(pSetConstant->Magnitude / 10000.0f * 255.0f);
+		FFB_ENGINE_SET_CONSTANT_FORCE(pEngine, pSetConstant);
 
-		TraceVerbose(TRACE_DSHIDMINIDRV, "!! DS3 Rumble Value: %d",
-			rumbleValue);
+		*ReportSize = Packet->reportBufferLen;
 
-		if (pSetConstant->EffectBlockIndex % 2 == 0)
-		{
-			DS3_SET_SMALL_RUMBLE_STRENGTH(DeviceContext, rumbleValue);
-		}
-		else
-		{
-			DS3_SET_LARGE_RUMBLE_STRENGTH(DeviceContext, rumbleValue);
-		}
+		status = STATUS_SUCCESS;
+
+		break;
+
+	case PID_SET_RAMP_FORCE_REPORT_ID:
+
+		pSetRamp = (PPID_SET_RAMP_FORCE_REPORT)Packet->reportBuffer;
+
+		TraceVerbose(TRACE_DSHIDMINIDRV, "!! PID_SET_RAMP_FORCE_REPORT, EffectBlockIndex: %d, RampStart: %d, RampEnd: %d",
+			pSetRamp->EffectBlockIndex,
+			pSetRamp->RampStart,
+			pSetRamp->RampEnd);
+
+		FFB_ENGINE_SET_RAMP_FORCE(pEngine, pSetRamp);
 
 		*ReportSize = Packet->reportBufferLen;
 
@@ -213,24 +231,7 @@ DSHM_WriteReport(
 			pEffectOperation->EffectOperation,
 			pEffectOperation->LoopCount);
 
-		switch (pEffectOperation->EffectOperation)
-		{
-		case PidEoStart:
-
-			(void)DSHM_SendOutputReport(DeviceContext, Ds3OutputReportSourceForceFeedback);
-
-			break;
-
-		case PidEoStop:
-
-			DS3_SET_BOTH_RUMBLE_STRENGTH(DeviceContext, 0x00, 0x00);
-
-			(void)DSHM_SendOutputReport(DeviceContext, Ds3OutputReportSourceForceFeedback);
-
-			break;
-		default:
-			break;
-		}
+		FFB_ENGINE_EFFECT_OPERATION(pEngine, pEffectOperation, GetTickCount64());
 
 		*ReportSize = Packet->reportBufferLen;
 
@@ -245,23 +246,35 @@ DSHM_WriteReport(
 		TraceVerbose(TRACE_DSHIDMINIDRV, "!! PID_BLOCK_FREE_REPORT, EffectBlockIndex: %d",
 			pBlockFree->EffectBlockIndex);
 
+		FFB_ENGINE_FREE_EFFECT(pEngine, pBlockFree->EffectBlockIndex);
+
 	//
 	// Mark as free
 	// 
-		ffbEntry.IsReserved = FALSE;
-		ffbEntry.IsReported = FALSE;
-
-		status = DMF_HashTable_Write(
-			ModuleContext->DmfModuleForceFeedback,
-			&pBlockFree->EffectBlockIndex,
-			sizeof(UCHAR),
-			(PUCHAR)&ffbEntry,
-			sizeof(FFB_ATTRIBUTES)
-		);
+		FFB_BLOCKS_FREE(&DeviceContext->ForceFeedback.Blocks, pBlockFree->EffectBlockIndex);
 
 		*ReportSize = Packet->reportBufferLen;
 
+		status = STATUS_SUCCESS;
+
 		break;
+
+	default:
+
+		isFfbReport = FALSE;
+
+		break;
+	}
+
+	WdfWaitLockRelease(DeviceContext->ForceFeedback.Lock);
+
+	//
+	// Reports arrive in bursts, update the motors once the burst is over
+	// 
+	if (isFfbReport)
+	{
+		DSHM_FfbRecord(DeviceContext, FfbRecordWriteReport, Packet);
+		DSHM_FfbScheduleRender(DeviceContext);
 	}
 
 #endif
@@ -269,11 +282,17 @@ DSHM_WriteReport(
 	//
 	// Handle other non-FFB cases
 	// 
+	LONG epoch;
+	const DS_CONFIG_SNAPSHOT* config = DS_CONFIG_READ_BEGIN(DeviceContext, &epoch);
+	const DS_HID_DEVICE_MODE hidDeviceMode = config->Configuration.HidDeviceMode;
+	const DS_LED_AUTHORITY ledAuthority = config->Configuration.LEDSettings.Authority;
+	DS_CONFIG_READ_END(DeviceContext, epoch);
+
 
 	//
 	// SIXAXIS.SYS emulation
 	// 
-	if (Packet->reportId == 0x00 && DeviceContext->Configuration.HidDeviceMode == DsHidMiniDeviceModeSixaxisCompatible)
+	if (Packet->reportId == 0x00 && hidDeviceMode == DsHidMiniDeviceModeSixaxisCompatible)
 	{
 		//
 		// External output report overrides internal behaviour, keep note
@@ -292,7 +311,7 @@ DSHM_WriteReport(
 		//
 		// Prevent LED states from being overwritten from outside
 		// 
-		if (DeviceContext->Configuration.LEDSettings.Authority == DsLEDAuthorityDriver)
+		if (ledAuthority == DsLEDAuthorityDriver)
 		{
 			UCHAR ledBlock[sizeof(UCHAR) + (sizeof(DS_LED) * 4)];
 
@@ -327,6 +346,31 @@ DSHM_WriteReport(
 			);
 		}
 
+		//
+		// Keep output state in sync with what the client dictated
+		// 
+		DS3_GET_RAW_OUTPUT_REPORT_BUFFER(
+			DeviceContext,
+			&buffer,
+			&bufferSize
+		);
+
+		DS3_OUTPUT_STATE_PARSE(
+			&DeviceContext->OutputReport.State,
+			(ledAuthority == DsLEDAuthorityDriver)
+			? DS3_OUTPUT_DIRTY_MOTORS
+			: DS3_OUTPUT_DIRTY_MOTORS | DS3_OUTPUT_DIRTY_LED_FLAGS | DS3_OUTPUT_DIRTY_LEDS,
+			DS3_GET_OUTPUT_REPORT_FORMAT(DeviceContext),
+			buffer,
+			bufferSize
+		);
+
+		//
+		// The copy above overwrote pinned fields (custom LED pattern) on the wire,
+		// the parse kept them in the state so have them written back
+		// 
+		DS3_OUTPUT_STATE_MARK_DIRTY(&DeviceContext->OutputReport.State, DeviceContext->OutputReport.State.LockedFields);
+
 		(void)DSHM_SendOutputReport(DeviceContext, Ds3OutputReportSourcePassThrough);
 
 		status = STATUS_SUCCESS;
@@ -335,7 +379,7 @@ DSHM_WriteReport(
 	//
 	// DS4Windows emulation
 	// 
-	if (Packet->reportId == 0x05 && DeviceContext->Configuration.HidDeviceMode == DsHidMiniDeviceModeDS4WindowsCompatible)
+	if (Packet->reportId == 0x05 && hidDeviceMode == DsHidMiniDeviceModeDS4WindowsCompatible)
 	{
 		//
 		// External output report overrides internal behaviour, keep note
@@ -379,7 +423,7 @@ DSHM_WriteReport(
 		//
 		// Only allowed when when in Automatic or Application setting
 		// 
-		if (DeviceContext->Configuration.LEDSettings.Authority != DsLEDAuthorityDriver)
+		if (ledAuthority != DsLEDAuthorityDriver)
 		{
 			if (isSetColor)
 			{
@@ -462,7 +506,7 @@ DSHM_WriteReport(
 	//
 	// Rumble request from XINPUTHID.SYS
 	// 
-	if (Packet->reportId == 0x00 && DeviceContext->Configuration.HidDeviceMode == DsHidMiniDeviceModeXInputHIDCompatible)
+	if (Packet->reportId == 0x00 && hidDeviceMode == DsHidMiniDeviceModeXInputHIDCompatible)
 	{
 		UCHAR lm = (UCHAR)(Packet->reportBuffer[3] / 100.0f * 255.0f);
 		UCHAR rm = (UCHAR)(Packet->reportBuffer[4] / 100.0f * 255.0f);
@@ -505,3 +549,267 @@ DSHM_WriteReport(
 
 	return status;
 }
+
+#ifdef DSHM_FEATURE_FFB
+
+//
+// Evaluates the effect engine and sends an output report if the motor values changed.
+// Re-arms the tick timer for the next point in time the output may change at.
+// 
+VOID
+DSHM_FfbRender(
+	PDEVICE_CONTEXT Context
+)
+{
+	UCHAR largeMotor, smallMotor;
+	BOOLEAN isChanged;
+	ULONG delayMs;
+
+	WdfWaitLockAcquire(Context->ForceFeedback.Lock, NULL);
+	{
+		const ULONGLONG now = GetTickCount64();
+
+		isChanged = FFB_ENGINE_TICK(
+			&Context->ForceFeedback.Engine,
+			now,
+			&largeMotor,
+			&smallMotor
+		);
+
+		if (FFB_ENGINE_GET_NEXT_WAKE(&Context->ForceFeedback.Engine, now, &delayMs))
+		{
+			(void)WdfTimerStart(Context->ForceFeedback.TickTimer, WDF_REL_TIMEOUT_IN_MS(delayMs));
+			Context->ForceFeedback.WakeAt = now + delayMs;
+		}
+		else if (Context->ForceFeedback.WakeAt)
+		{
+			//
+			// Must not wait, we might be called from the timer callback
+			// 
+			(void)WdfTimerStop(Context->ForceFeedback.TickTimer, FALSE);
+			Context->ForceFeedback.WakeAt = 0;
+		}
+
+		//
+		// Renders may overlap (timer vs. direct), apply the values while the
+		// tick that produced them is still the latest one
+		// 
+		if (isChanged)
+		{
+			TraceVerbose(TRACE_DSHIDMINIDRV, "!! FFB motors, large: %d, small: %d", largeMotor, smallMotor);
+
+			DS3_SET_BOTH_RUMBLE_STRENGTH(Context, largeMotor, smallMotor);
+		}
+	}
+	WdfWaitLockRelease(Context->ForceFeedback.Lock);
+
+	if (!isChanged)
+	{
+		return;
+	}
+
+	(void)DSHM_SendOutputReport(Context, Ds3OutputReportSourceForceFeedback);
+}
+
+//
+// Requests an evaluation of the effect engine after the coalescing window elapsed,
+// unless the tick timer is due earlier anyway
+// 
+VOID
+DSHM_FfbScheduleRender(
+	PDEVICE_CONTEXT Context
+)
+{
+	LONG epoch;
+	const DS_CONFIG_SNAPSHOT* config = DS_CONFIG_READ_BEGIN(Context, &epoch);
+	const UCHAR windowMs = config->Configuration.FFBCoalescingWindowMs;
+	DS_CONFIG_READ_END(Context, epoch);
+
+	if (windowMs == 0)
+	{
+		DSHM_FfbRender(Context);
+		return;
+	}
+
+	WdfWaitLockAcquire(Context->ForceFeedback.Lock, NULL);
+	{
+		const ULONGLONG wakeAt = GetTickCount64() + windowMs;
+
+		if (!Context->ForceFeedback.WakeAt || Context->ForceFeedback.WakeAt > wakeAt)
+		{
+			(void)WdfTimerStart(Context->ForceFeedback.TickTimer, WDF_REL_TIMEOUT_IN_MS(windowMs));
+			Context->ForceFeedback.WakeAt = wakeAt;
+		}
+	}
+	WdfWaitLockRelease(Context->ForceFeedback.Lock);
+}
+
+//
+// Appends a PID report to the recording file, if enabled
+// 
+VOID
+DSHM_FfbRecord(
+	PDEVICE_CONTEXT Context,
+	FFB_RECORD_KIND Kind,
+	const HID_XFER_PACKET* Packet
+)
+{
+	UCHAR entry[FFB_RECORD_ENTRY_HEADER_SIZE + FFB_RECORD_MAX_PAYLOAD];
+	CHAR programDataPath[MAX_PATH];
+	CHAR recordingPath[MAX_PATH];
+	DWORD written;
+
+	LONG epoch;
+	const DS_CONFIG_SNAPSHOT* config = DS_CONFIG_READ_BEGIN(Context, &epoch);
+	const BOOLEAN isRecordingEnabled = config->Configuration.IsFFBRecordingEnabled;
+	DS_CONFIG_READ_END(Context, epoch);
+
+	//
+	// Recording got switched off, possibly racing the reload; let go of the file
+	// 
+	if (!isRecordingEnabled && Context->ForceFeedback.RecordingFile)
+	{
+		WdfWaitLockAcquire(Context->ForceFeedback.Lock, NULL);
+		if (Context->ForceFeedback.RecordingFile)
+		{
+			CloseHandle(Context->ForceFeedback.RecordingFile);
+			Context->ForceFeedback.RecordingFile = NULL;
+		}
+		WdfWaitLockRelease(Context->ForceFeedback.Lock);
+	}
+
+	if (!isRecordingEnabled || Context->ForceFeedback.RecordingFailed)
+	{
+		return;
+	}
+
+	WdfWaitLockAcquire(Context->ForceFeedback.Lock, NULL);
+
+	do
+	{
+		const ULONGLONG now = GetTickCount64();
+
+		if (Context->ForceFeedback.RecordingFile == NULL)
+		{
+			if (GetEnvironmentVariableA(
+				CONFIG_ENV_VAR_NAME,
+				programDataPath,
+				MAX_PATH
+			) == 0)
+			{
+				break;
+			}
+
+			if (sprintf_s(
+				recordingPath,
+				MAX_PATH,
+				"%s\\%s\\FFB_%d_%llu.ffbrec",
+				programDataPath,
+				CONFIG_SUB_DIR_NAME,
+				Context->SlotIndex,
+				now
+			) == -1)
+			{
+				break;
+			}
+
+			const HANDLE hFile = CreateFileA(
+				recordingPath,
+				GENERIC_WRITE,
+				FILE_SHARE_READ,
+				NULL,
+				CREATE_ALWAYS,
+				FILE_ATTRIBUTE_NORMAL,
+				NULL
+			);
+
+			if (hFile == INVALID_HANDLE_VALUE)
+			{
+				const DWORD error = GetLastError();
+
+				TraceError(
+					TRACE_DSHIDMINIDRV,
+					"Creating FFB recording %s failed with error: %!WINERROR!",
+					recordingPath,
+					error
+				);
+				EventWriteFailedWithWin32Error(__FUNCTION__, L"CreateFileA", error);
+
+				//
+				// Don't retry on every report
+				// 
+				Context->ForceFeedback.RecordingFailed = TRUE;
+				break;
+			}
+
+			TraceInformation(
+				TRACE_DSHIDMINIDRV,
+				"Recording PID reports to %s",
+				recordingPath
+			);
+
+			const SIZE_T headerSize = FFB_RECORD_ENCODE_HEADER(entry, sizeof(entry));
+
+			(void)WriteFile(hFile, entry, (DWORD)headerSize, &written, NULL);
+
+			Context->ForceFeedback.RecordingFile = hFile;
+			Context->ForceFeedback.RecordingStartedAt = now;
+		}
+
+		const SIZE_T entrySize = FFB_RECORD_ENCODE_ENTRY(
+			entry,
+			sizeof(entry),
+			(ULONG)(now - Context->ForceFeedback.RecordingStartedAt),
+			Kind,
+			Packet->reportBuffer,
+			(USHORT)Packet->reportBufferLen
+		);
+
+		if (entrySize)
+		{
+			(void)WriteFile(Context->ForceFeedback.RecordingFile, entry, (DWORD)entrySize, &written, NULL);
+		}
+	} while (FALSE);
+
+	WdfWaitLockRelease(Context->ForceFeedback.Lock);
+}
+
+//
+// Stops rendering and recording, used on power down
+// 
+VOID
+DSHM_FfbStop(
+	PDEVICE_CONTEXT Context
+)
+{
+	(void)WdfTimerStop(Context->ForceFeedback.TickTimer, TRUE);
+
+	WdfWaitLockAcquire(Context->ForceFeedback.Lock, NULL);
+	{
+		FFB_ENGINE_DEVICE_CONTROL(&Context->ForceFeedback.Engine, PidDcStopAllEffects, GetTickCount64());
+		Context->ForceFeedback.WakeAt = 0;
+
+		if (Context->ForceFeedback.RecordingFile)
+		{
+			CloseHandle(Context->ForceFeedback.RecordingFile);
+			Context->ForceFeedback.RecordingFile = NULL;
+		}
+	}
+	WdfWaitLockRelease(Context->ForceFeedback.Lock);
+}
+
+//
+// Effect engine deadline reached
+// 
+_Use_decl_annotations_
+VOID
+DSHM_FfbTickTimerElapsed(
+	WDFTIMER Timer
+)
+{
+	const WDFDEVICE device = WdfTimerGetParentObject(Timer);
+
+	DSHM_FfbRender(DeviceGetContext(device));
+}
+
+#endif
@@ -1,6 +1,50 @@
 #include "Driver.h"
 #include "IPC.Device.tmh"
 
+//
+// Output requests map onto output state fields one to one
+// 
+C_ASSERT(DSHM_IPC_OUTPUT_FIELD_LED_FLAGS == DS3_OUTPUT_DIRTY_LED_FLAGS);
+C_ASSERT(DSHM_IPC_OUTPUT_FIELD_LEDS == DS3_OUTPUT_DIRTY_LEDS);
+C_ASSERT(DSHM_IPC_OUTPUT_FIELD_MOTORS == DS3_OUTPUT_DIRTY_MOTORS);
+C_ASSERT(DSHM_IPC_OUTPUT_FIELD_ALL == DS3_OUTPUT_DIRTY_ALL);
+
+//
+// Pairing requests carry the address as stored in the configuration
+// 
+C_ASSERT(sizeof(DSHM_IPC_BD_ADDR) == sizeof(BD_ADDR));
+
+//
+// Player LEDs lit for player index 1 to 7, indexes above 4 add LED 4
+// 
+static const UCHAR G_PlayerIndexLedFlags[] =
+{
+	DS3_LED_1,
+	DS3_LED_2,
+	DS3_LED_3,
+	DS3_LED_4,
+	DS3_LED_4 | DS3_LED_1,
+	DS3_LED_4 | DS3_LED_2,
+	DS3_LED_4 | DS3_LED_3
+};
+
+//
+// Sends the output state on behalf of an IPC client. The device is reachable
+// via IPC before its output worker exists, changes made meanwhile go out with
+// the first report.
+// 
+static NTSTATUS DSHM_IPC_SendOutputReport(
+	_In_ PDEVICE_CONTEXT DeviceContext
+)
+{
+	if (DeviceContext->OutputReport.Worker == NULL)
+	{
+		return STATUS_DEVICE_NOT_READY;
+	}
+
+	return DSHM_SendOutputReport(DeviceContext, Ds3OutputReportSourceIPC);
+}
+
 
 //
 // Processes incoming IPC messages targeted to this device instance
@@ -31,13 +75,25 @@ DSHM_EvtDispatchDeviceMessage(
 			request->Address.Address[5]
 		);
 
-		// TODO: this changes state for runtime settings, improve
+		//
+		// Runtime override, lasts until the next configuration reload sets
+		// the pairing mode. The applied hashes no longer describe the live
+		// configuration, forget them so the reload doesn't get skipped.
+		// 
+		WdfWaitLockAcquire(DeviceContext->ConfigurationLock, NULL);
 		DeviceContext->Configuration.DevicePairingMode = DsDevicePairingModeCustom;
 		RtlCopyMemory(&DeviceContext->Configuration.CustomHostAddress, &request->Address, sizeof(BD_ADDR));
+		RtlZeroMemory(&DeviceContext->ConfigurationHash, sizeof(DeviceContext->ConfigurationHash));
+		NTSTATUS writeStatus = ConfigPublishForDevice(DeviceContext);
+		WdfWaitLockRelease(DeviceContext->ConfigurationLock);
 
 		const WDFDEVICE device = WdfObjectContextGetObject(DeviceContext);
 
-		NTSTATUS writeStatus = DsUsb_Ds3PairToNewHost(device);
+		if (NT_SUCCESS(writeStatus))
+		{
+			writeStatus = DsUsb_Ds3PairToNewHost(device);
+		}
+
 		NTSTATUS readStatus = STATUS_UNSUCCESSFUL;
 		if (!NT_SUCCESS(readStatus = DsUsb_Ds3RequestHostAddress(device)))
 		{
@@ -59,12 +115,45 @@ DSHM_EvtDispatchDeviceMessage(
 	}
 	else if (MessageHeader->Command.Device == DSHM_IPC_MSG_CMD_DEVICE_SET_PLAYER_INDEX)
 	{
-		// TODO: implement me!
+		const PDSHM_IPC_MSG_SET_PLAYER_INDEX_REQUEST request = (PDSHM_IPC_MSG_SET_PLAYER_INDEX_REQUEST)MessageHeader;
+		NTSTATUS setStatus;
+
+		LONG epoch;
+		const DS_CONFIG_SNAPSHOT* config = DS_CONFIG_READ_BEGIN(DeviceContext, &epoch);
+		const DS_LED_AUTHORITY ledAuthority = config->Configuration.LEDSettings.Authority;
+		DS_CONFIG_READ_END(DeviceContext, epoch);
+
+		if (MessageHeader->Size < sizeof(DSHM_IPC_MSG_SET_PLAYER_INDEX_REQUEST)
+			|| request->PlayerIndex < 1
+			|| request->PlayerIndex > ARRAYSIZE(G_PlayerIndexLedFlags))
+		{
+			setStatus = STATUS_INVALID_PARAMETER;
+		}
+		//
+		// Prevent LED states from being overwritten from outside
+		// 
+		else if (ledAuthority == DsLEDAuthorityDriver
+			|| (DeviceContext->OutputReport.State.LockedFields & DS3_OUTPUT_DIRTY_LED_FLAGS))
+		{
+			setStatus = STATUS_ACCESS_DENIED;
+		}
+		else
+		{
+			TraceVerbose(
+				TRACE_IPC,
+				"Setting player index %d",
+				request->PlayerIndex
+			);
+
+			DS3_SET_LED_FLAGS(DeviceContext, G_PlayerIndexLedFlags[request->PlayerIndex - 1]);
+
+			setStatus = DSHM_IPC_SendOutputReport(DeviceContext);
+		}
 
 		DSHM_IPC_MSG_SET_PLAYER_INDEX_RESPONSE_INIT(
 			(PDSHM_IPC_MSG_SET_PLAYER_INDEX_REPLY)MessageHeader,
 			MessageHeader->TargetIndex,
-			STATUS_NOT_IMPLEMENTED
+			setStatus
 		);
 
 		status = STATUS_SUCCESS;
@@ -85,3 +174,112 @@ DSHM_EvtDispatchDeviceMessage(
 
 	return status;
 }
+
+//
+// Folds a single output request into the output state, the same way reports
+// coming in through the HID stack get applied
+// 
+static VOID DSHM_ApplyOutputRequest(
+	_In_ PDEVICE_CONTEXT DeviceContext,
+	_In_ const IPC_OUTPUT_REQUEST* Request
+)
+{
+	ULONG fields = Request->Fields & DSHM_IPC_OUTPUT_FIELD_ALL;
+
+	LONG epoch;
+	const DS_CONFIG_SNAPSHOT* config = DS_CONFIG_READ_BEGIN(DeviceContext, &epoch);
+	const DS_LED_AUTHORITY ledAuthority = config->Configuration.LEDSettings.Authority;
+	DS_CONFIG_READ_END(DeviceContext, epoch);
+
+	//
+	// Prevent LED states from being overwritten from outside
+	// 
+	if (ledAuthority == DsLEDAuthorityDriver)
+	{
+		fields &= ~(DSHM_IPC_OUTPUT_FIELD_LED_FLAGS | DSHM_IPC_OUTPUT_FIELD_LEDS);
+	}
+
+	if (fields & DSHM_IPC_OUTPUT_FIELD_LED_FLAGS)
+	{
+		DS3_SET_LED_FLAGS(DeviceContext, Request->LedFlags);
+	}
+
+	for (UCHAR index = 0; index < ARRAYSIZE(Request->Leds); index++)
+	{
+		if (fields & DSHM_IPC_OUTPUT_FIELD_LED(index))
+		{
+			DS3_SET_LED_DURATION(
+				DeviceContext,
+				index,
+				Request->Leds[index].TotalDuration,
+				Request->Leds[index].BasePortionDuration,
+				Request->Leds[index].OffPortionMultiplier,
+				Request->Leds[index].OnPortionMultiplier
+			);
+		}
+	}
+
+	if (fields & DSHM_IPC_OUTPUT_FIELD_SMALL_MOTOR_DURATION)
+	{
+		DS3_SET_SMALL_RUMBLE_DURATION(DeviceContext, Request->SmallMotorDuration);
+	}
+
+	if (fields & DSHM_IPC_OUTPUT_FIELD_LARGE_MOTOR_DURATION)
+	{
+		DS3_SET_LARGE_RUMBLE_DURATION(DeviceContext, Request->LargeMotorDuration);
+	}
+
+	//
+	// Strengths go through rescaling like any other client's
+	// 
+	switch (fields & (DSHM_IPC_OUTPUT_FIELD_SMALL_MOTOR_STRENGTH | DSHM_IPC_OUTPUT_FIELD_LARGE_MOTOR_STRENGTH))
+	{
+	case DSHM_IPC_OUTPUT_FIELD_SMALL_MOTOR_STRENGTH | DSHM_IPC_OUTPUT_FIELD_LARGE_MOTOR_STRENGTH:
+		DS3_SET_BOTH_RUMBLE_STRENGTH(DeviceContext, Request->LargeMotorStrength, Request->SmallMotorStrength);
+		break;
+	case DSHM_IPC_OUTPUT_FIELD_SMALL_MOTOR_STRENGTH:
+		DS3_SET_SMALL_RUMBLE_STRENGTH(DeviceContext, Request->SmallMotorStrength);
+		break;
+	case DSHM_IPC_OUTPUT_FIELD_LARGE_MOTOR_STRENGTH:
+		DS3_SET_LARGE_RUMBLE_STRENGTH(DeviceContext, Request->LargeMotorStrength);
+		break;
+	default:
+		break;
+	}
+}
+
+//
+// Applies Count pending output requests of the device's ring starting at
+// request number First, then sends a single output report for all of them
+// 
+_Use_decl_annotations_
+VOID
+DSHM_DispatchDeviceOutputRequests(
+	PDEVICE_CONTEXT DeviceContext,
+	PIPC_OUTPUT_RING Ring,
+	ULONG First,
+	ULONG Count
+)
+{
+	FuncEntry(TRACE_IPC);
+
+	for (ULONG index = 0; index < Count; index++)
+	{
+		//
+		// Snapshot, the client may scribble over the shared copy
+		// 
+		const IPC_OUTPUT_REQUEST request = Ring->Requests[(First + index) & (DSHM_IPC_OUTPUT_RING_DEPTH - 1)];
+
+		DSHM_ApplyOutputRequest(DeviceContext, &request);
+	}
+
+	TraceVerbose(
+		TRACE_IPC,
+		"Applied %lu output request(s)",
+		Count
+	);
+
+	(void)DSHM_IPC_SendOutputReport(DeviceContext);
+
+	FuncExitNoReturn(TRACE_IPC);
+}
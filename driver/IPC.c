@@ -1,6 +1,76 @@
 #include "Driver.h"
 #include "IPC.tmh"
 
+//
+// Legacy slots must end before the HID region header
+// 
+C_ASSERT(DSHM_IPC_HID_SLOT_COUNT == DSHM_MAX_DEVICES);
+C_ASSERT(sizeof(IPC_HID_SLOT) == DSHM_IPC_HID_SLOT_STRIDE);
+C_ASSERT(FIELD_OFFSET(IPC_HID_SLOT, Message) == 0);
+C_ASSERT(DSHM_IPC_HID_SLOT_STRIDE * DSHM_IPC_HID_SLOT_COUNT <= DSHM_IPC_HID_HEADER_OFFSET);
+
+//
+// Changed slots mask starts a cache line and has a bit for every slot
+// 
+C_ASSERT(FIELD_OFFSET(IPC_HID_REGION_HEADER, ChangedSlots) % 64 == 0);
+C_ASSERT(DSHM_IPC_HID_CHANGED_WORDS * 64 >= DSHM_IPC_HID_SLOT_COUNT);
+
+//
+// States follow the header and must fit the HID region (one 64 KiB allocation granularity)
+// 
+C_ASSERT(sizeof(IPC_HID_STATE) == DSHM_IPC_HID_STATE_STRIDE);
+C_ASSERT(DSHM_IPC_HID_HEADER_OFFSET + sizeof(IPC_HID_REGION_HEADER) <= DSHM_IPC_HID_STATE_OFFSET);
+C_ASSERT(DSHM_IPC_HID_STATE_OFFSET + DSHM_IPC_HID_STATE_STRIDE * DSHM_IPC_HID_SLOT_COUNT <= 0x10000);
+
+//
+// Command ring must fit the command region (one 64 KiB allocation granularity)
+// 
+C_ASSERT(sizeof(IPC_CMD_SLOT) == DSHM_IPC_CMD_SLOT_SIZE);
+C_ASSERT(sizeof(IPC_CMD_RING_HEADER) <= DSHM_IPC_CMD_SLOTS_OFFSET);
+C_ASSERT(DSHM_IPC_CMD_RING_OFFSET + DSHM_IPC_CMD_SLOTS_OFFSET + DSHM_IPC_CMD_SLOT_SIZE * DSHM_IPC_CMD_SLOT_COUNT <= 0x10000);
+C_ASSERT(DSHM_IPC_CMD_QUEUE_CAPACITY > DSHM_IPC_CMD_SLOT_COUNT);
+C_ASSERT(sizeof(IPC_CMD_QUEUE_CELL) == sizeof(LONGLONG));
+C_ASSERT(FIELD_OFFSET(IPC_CMD_RING_HEADER, Queue) % sizeof(LONGLONG) == 0);
+
+//
+// Output rings are indexed like device slots, producer and consumer indexes
+// must not share a cache line
+// 
+C_ASSERT(DSHM_IPC_OUTPUT_RING_COUNT == DSHM_MAX_DEVICES);
+C_ASSERT((DSHM_IPC_OUTPUT_RING_DEPTH & (DSHM_IPC_OUTPUT_RING_DEPTH - 1)) == 0);
+C_ASSERT(sizeof(IPC_OUTPUT_REGION_HEADER) <= DSHM_IPC_OUTPUT_RINGS_OFFSET);
+C_ASSERT(FIELD_OFFSET(IPC_OUTPUT_RING, Head) == 64);
+C_ASSERT(FIELD_OFFSET(IPC_OUTPUT_RING, Requests) == 128);
+C_ASSERT(sizeof(IPC_OUTPUT_RING) % 64 == 0);
+
+//
+// Counter slots are indexed like device slots and start cache lines
+// 
+C_ASSERT(DSHM_IPC_COUNTERS_SLOT_COUNT == DSHM_MAX_DEVICES);
+C_ASSERT(sizeof(IPC_COUNTERS_REGION_HEADER) <= DSHM_IPC_COUNTERS_SLOTS_OFFSET);
+C_ASSERT(DSHM_IPC_COUNTERS_SLOTS_OFFSET % 64 == 0);
+C_ASSERT(sizeof(IPC_DEVICE_COUNTERS) % 64 == 0);
+
+//
+// Batch entries stay 8 byte aligned and have room for every reply
+// 
+C_ASSERT(sizeof(DSHM_IPC_MSG_BATCH_ENTRY) % 8 == 0);
+C_ASSERT(sizeof(DSHM_IPC_MSG_BATCH_REQUEST) % 8 == 0);
+C_ASSERT(sizeof(DSHM_IPC_MSG_PAIR_TO_REPLY) <= DSHM_IPC_MSG_BATCH_MESSAGE_MIN);
+C_ASSERT(sizeof(DSHM_IPC_MSG_SET_PLAYER_INDEX_REPLY) <= DSHM_IPC_MSG_BATCH_MESSAGE_MIN);
+C_ASSERT(sizeof(DSHM_IPC_MSG_GET_HID_WAIT_HANDLE_RESPONSE) <= DSHM_IPC_MSG_BATCH_MESSAGE_MIN);
+C_ASSERT(sizeof(DSHM_IPC_MSG_BATCH_REQUEST) + DSHM_IPC_MSG_BATCH_ENTRY_SIZE_MIN <= DSHM_IPC_CMD_MESSAGE_MAX);
+
+//
+// Command ring slots taken off the queue before dispatching them
+// 
+#define DSHM_IPC_CMD_DRAIN_BATCH	16
+
+//
+// Interval of the cleanup after clients that died mid-conversation
+// 
+#define DSHM_IPC_MAINTENANCE_INTERVAL_MS	1000
+
 
 static DWORD WINAPI DSHM_IPC_ClientDispatchProc(
 	_In_ LPVOID lpParameter
@@ -14,6 +84,7 @@ NTSTATUS InitIPC(void)
 	FuncEntry(TRACE_IPC);
 
 	DECLARE_CONST_UNICODE_STRING(valNameIPCEnaabled, L"IPCEnabled");
+	DECLARE_CONST_UNICODE_STRING(valNameIPCInputHistoryDepth, L"IPCInputHistoryDepth");
 
 	const WDFDRIVER driver = WdfGetDriver();
 	const PDSHM_DRIVER_CONTEXT context = DriverGetContext(driver);
@@ -22,12 +93,22 @@ NTSTATUS InitIPC(void)
 
 	PUCHAR pCmdBuf = NULL;
 	PUCHAR pHIDBuf = NULL;
+	PUCHAR pTelemetryBuf = NULL;
+	PUCHAR pHistoryBuf = NULL;
+	PUCHAR pOutputBuf = NULL;
+	PUCHAR pCountersBuf = NULL;
+	ULONG historyDepth = DSHM_IPC_HID_HISTORY_DEFAULT_DEPTH;
+	LARGE_INTEGER timestampFrequency;
 	HANDLE hReadEvent = NULL;
 	HANDLE hWriteEvent = NULL;
 	HANDLE hMapFile = NULL;
 	HANDLE hMutex = NULL;
 	HANDLE hThread = NULL;
 	HANDLE hThreadTermination = NULL;
+	HANDLE hCommandRingEvent = NULL;
+	HANDLE hReplyEvents[DSHM_IPC_CMD_SLOT_COUNT] = { NULL };
+	HANDLE hOutputRingEvent = NULL;
+	HANDLE hInputChangedEvent = NULL;
 
 	if (!NT_SUCCESS(status = WdfDriverOpenParametersRegistryKey(
 		driver,
@@ -71,18 +152,52 @@ NTSTATUS InitIPC(void)
 		goto exitFailure;
 	}
 
+	//
+	// Optional, input reports kept per device; 0 disables history
+	// 
+	(void)WdfRegistryQueryULong(
+		hKeyParameters,
+		&valNameIPCInputHistoryDepth,
+		&historyDepth
+	);
+
+	if (historyDepth > DSHM_IPC_HID_HISTORY_MAX_DEPTH)
+	{
+		historyDepth = DSHM_IPC_HID_HISTORY_MAX_DEPTH;
+	}
+
+	// ring index math relies on a power of two
+	while (historyDepth & (historyDepth - 1))
+	{
+		historyDepth &= historyDepth - 1;
+	}
+
+	QueryPerformanceFrequency(&timestampFrequency);
+
 	SYSTEM_INFO sysInfo;
     GetSystemInfo(&sysInfo);
     DWORD pageSize = sysInfo.dwAllocationGranularity;
 
 	DWORD cmdRegionSize = pageSize;
 	DWORD hidRegionSize = pageSize;
-	DWORD totalRegionSize = cmdRegionSize + hidRegionSize;
+	// one entry per possible device, rounded up to allocation granularity
+	DWORD telemetryRegionSize = (DWORD)(((sizeof(IPC_OUTPUT_REPORT_TELEMETRY) * DSHM_MAX_DEVICES) + pageSize - 1) / pageSize) * pageSize;
+	// one ring per possible device, rounded up to allocation granularity
+	DWORD historyRegionSize = historyDepth
+		? (DWORD)(((DSHM_IPC_HID_HISTORY_SIZE(historyDepth) * DSHM_MAX_DEVICES) + pageSize - 1) / pageSize) * pageSize
+		: 0;
+	// one ring per possible device, rounded up to allocation granularity
+	DWORD outputRegionSize = (DWORD)((DSHM_IPC_OUTPUT_REGION_SIZE + pageSize - 1) / pageSize) * pageSize;
+	DWORD outputRegionOffset = cmdRegionSize + hidRegionSize + telemetryRegionSize + historyRegionSize;
+	// one counter slot per possible device, rounded up to allocation granularity
+	DWORD countersRegionSize = (DWORD)((DSHM_IPC_COUNTERS_REGION_SIZE + pageSize - 1) / pageSize) * pageSize;
+	DWORD countersRegionOffset = outputRegionOffset + outputRegionSize;
+	DWORD totalRegionSize = countersRegionOffset + countersRegionSize;
 
 	TraceVerbose(
 		TRACE_IPC,
-		"pageSize = %d, cmdRegionSize = %d, hidRegionSize = %d, totalRegionSize = %d",
-		pageSize, cmdRegionSize, hidRegionSize, totalRegionSize
+		"pageSize = %d, cmdRegionSize = %d, hidRegionSize = %d, telemetryRegionSize = %d, historyRegionSize = %d, outputRegionSize = %d, countersRegionSize = %d, totalRegionSize = %d",
+		pageSize, cmdRegionSize, hidRegionSize, telemetryRegionSize, historyRegionSize, outputRegionSize, countersRegionSize, totalRegionSize
 	);	
 
 	SECURITY_DESCRIPTOR sd = { 0 };
@@ -156,6 +271,61 @@ NTSTATUS InitIPC(void)
 		goto exitFailure;
 	}
 
+	hCommandRingEvent = CreateEventA(&sa, FALSE, FALSE, DSHM_IPC_CMD_RING_EVENT_NAME);
+	if (hCommandRingEvent == NULL)
+	{
+		TraceError(
+			TRACE_IPC,
+			"Could not create COMMAND RING event (%!WINERROR!).",
+			GetLastError()
+		);
+		goto exitFailure;
+	}
+
+	for (ULONG slotIndex = 0; slotIndex < DSHM_IPC_CMD_SLOT_COUNT; slotIndex++)
+	{
+		CHAR eventName[64];
+
+		if (sprintf_s(eventName, ARRAYSIZE(eventName), "%s%lu", DSHM_IPC_CMD_REPLY_EVENT_PREFIX, slotIndex) == -1)
+		{
+			goto exitFailure;
+		}
+
+		hReplyEvents[slotIndex] = CreateEventA(&sa, FALSE, FALSE, eventName);
+		if (hReplyEvents[slotIndex] == NULL)
+		{
+			TraceError(
+				TRACE_IPC,
+				"Could not create REPLY event %lu (%!WINERROR!).",
+				slotIndex,
+				GetLastError()
+			);
+			goto exitFailure;
+		}
+	}
+
+	hOutputRingEvent = CreateEventA(&sa, FALSE, FALSE, DSHM_IPC_OUTPUT_RING_EVENT_NAME);
+	if (hOutputRingEvent == NULL)
+	{
+		TraceError(
+			TRACE_IPC,
+			"Could not create OUTPUT RING event (%!WINERROR!).",
+			GetLastError()
+		);
+		goto exitFailure;
+	}
+
+	hInputChangedEvent = CreateEventA(&sa, FALSE, FALSE, DSHM_IPC_HID_CHANGED_EVENT_NAME);
+	if (hInputChangedEvent == NULL)
+	{
+		TraceError(
+			TRACE_IPC,
+			"Could not create INPUT CHANGED event (%!WINERROR!).",
+			GetLastError()
+		);
+		goto exitFailure;
+	}
+
 	hThreadTermination = CreateEventA(&sa, FALSE, FALSE, NULL);
 	if (hThreadTermination == NULL)
 	{
@@ -206,6 +376,9 @@ NTSTATUS InitIPC(void)
 		goto exitFailure;
 	}
 
+	// legacy clients only ever use the start of the region
+	DSHM_IPC_CMD_RING_INIT(DSHM_IPC_CMD_RING(pCmdBuf));
+
 	// Calculate the nearest page-aligned offset for the HID region
     DWORD alignedOffset = (cmdRegionSize / pageSize) * pageSize; // Page-aligned offset
     DWORD offsetWithinPage = cmdRegionSize % pageSize;           // Offset within the mapped page
@@ -228,11 +401,132 @@ NTSTATUS InitIPC(void)
 		goto exitFailure;
 	}
 
+	//
+	// Describe the slot layout to readers. The mapping may outlive a previous
+	// host process, so start over with all slots stable (even sequences).
+	// 
+	const PIPC_HID_REGION_HEADER pHIDHeader = DSHM_IPC_HID_HEADER(pHIDBuf);
+
+	RtlZeroMemory(pHIDBuf, DSHM_IPC_HID_SLOT_STRIDE * DSHM_IPC_HID_SLOT_COUNT);
+	RtlZeroMemory(pHIDHeader, sizeof(IPC_HID_REGION_HEADER));
+	RtlZeroMemory(DSHM_IPC_HID_STATE(pHIDBuf, 1), DSHM_IPC_HID_STATE_STRIDE * DSHM_IPC_HID_SLOT_COUNT);
+
+	pHIDHeader->Version = DSHM_IPC_HID_VERSION;
+	pHIDHeader->Size = sizeof(IPC_HID_REGION_HEADER);
+	pHIDHeader->SlotCount = DSHM_IPC_HID_SLOT_COUNT;
+	pHIDHeader->SlotsOffset = 0;
+	pHIDHeader->SlotStride = DSHM_IPC_HID_SLOT_STRIDE;
+	pHIDHeader->SequenceOffset = FIELD_OFFSET(IPC_HID_SLOT, Sequence);
+	pHIDHeader->TimestampFrequency = timestampFrequency.QuadPart;
+	pHIDHeader->StateOffset = DSHM_IPC_HID_STATE_OFFSET;
+	pHIDHeader->StateStride = DSHM_IPC_HID_STATE_STRIDE;
+
+	pTelemetryBuf = MapViewOfFile(
+		hMapFile, // handle to map object
+		FILE_MAP_ALL_ACCESS, // read/write permission
+		0,
+		cmdRegionSize + hidRegionSize, // both are multiples of the allocation granularity
+		telemetryRegionSize
+	);
+
+	if (pTelemetryBuf == NULL)
+	{
+		TraceError(
+			TRACE_IPC,
+			"Could not map view of file TELEMETRY REGION (%!WINERROR!).",
+			GetLastError()
+		);
+		goto exitFailure;
+	}
+
+	if (historyRegionSize)
+	{
+		pHistoryBuf = MapViewOfFile(
+			hMapFile, // handle to map object
+			FILE_MAP_ALL_ACCESS, // read/write permission
+			0,
+			cmdRegionSize + hidRegionSize + telemetryRegionSize, // all multiples of the allocation granularity
+			historyRegionSize
+		);
+
+		if (pHistoryBuf == NULL)
+		{
+			TraceError(
+				TRACE_IPC,
+				"Could not map view of file HISTORY REGION (%!WINERROR!).",
+				GetLastError()
+			);
+			goto exitFailure;
+		}
+
+		// write cursors start over, readers detect that
+		RtlZeroMemory(pHistoryBuf, historyRegionSize);
+
+		pHIDHeader->HistoryDepth = historyDepth;
+		pHIDHeader->HistoryStride = (UINT32)DSHM_IPC_HID_HISTORY_SIZE(historyDepth);
+		pHIDHeader->HistoryOffset = cmdRegionSize + hidRegionSize + telemetryRegionSize;
+	}
+
+	pOutputBuf = MapViewOfFile(
+		hMapFile, // handle to map object
+		FILE_MAP_ALL_ACCESS, // read/write permission
+		0,
+		outputRegionOffset, // all multiples of the allocation granularity
+		outputRegionSize
+	);
+
+	if (pOutputBuf == NULL)
+	{
+		TraceError(
+			TRACE_IPC,
+			"Could not map view of file OUTPUT REGION (%!WINERROR!).",
+			GetLastError()
+		);
+		goto exitFailure;
+	}
+
+	// rings of a previous host process are stale
+	DSHM_IPC_OUTPUT_REGION_INIT((PIPC_OUTPUT_REGION_HEADER)pOutputBuf);
+
+	pHIDHeader->OutputOffset = outputRegionOffset;
+	pHIDHeader->OutputSize = outputRegionSize;
+
+	pCountersBuf = MapViewOfFile(
+		hMapFile, // handle to map object
+		FILE_MAP_ALL_ACCESS, // read/write permission
+		0,
+		countersRegionOffset, // all multiples of the allocation granularity
+		countersRegionSize
+	);
+
+	if (pCountersBuf == NULL)
+	{
+		TraceError(
+			TRACE_IPC,
+			"Could not map view of file COUNTERS REGION (%!WINERROR!).",
+			GetLastError()
+		);
+		goto exitFailure;
+	}
+
+	// counters of a previous host process are stale
+	DSHM_IPC_COUNTERS_REGION_INIT((PIPC_COUNTERS_REGION_HEADER)pCountersBuf, timestampFrequency.QuadPart);
+
+	pHIDHeader->CountersOffset = countersRegionOffset;
+	pHIDHeader->CountersSize = countersRegionSize;
+
+	MemoryBarrier();
+	pHIDHeader->Magic = DSHM_IPC_HID_MAGIC;
+
 	context->IPC.DispatchThreadTermination = hThreadTermination;
 	context->IPC.MapFile = hMapFile;
 	context->IPC.ConnectMutex = hMutex;
 	context->IPC.ReadEvent = hReadEvent;
 	context->IPC.WriteEvent = hWriteEvent;
+	context->IPC.CommandRingEvent = hCommandRingEvent;
+	RtlCopyMemory(context->IPC.CommandReplyEvents, hReplyEvents, sizeof(hReplyEvents));
+	context->IPC.OutputRingEvent = hOutputRingEvent;
+	context->IPC.InputChangedEvent = hInputChangedEvent;
 
 	context->IPC.SharedRegions.Commands.Buffer = pCmdBuf;
 	context->IPC.SharedRegions.Commands.BufferSize = cmdRegionSize;
@@ -240,6 +534,19 @@ NTSTATUS InitIPC(void)
 	context->IPC.SharedRegions.HID.Buffer = pHIDBuf;
 	context->IPC.SharedRegions.HID.BufferSize = hidRegionSize;
 
+	context->IPC.SharedRegions.Telemetry.Buffer = pTelemetryBuf;
+	context->IPC.SharedRegions.Telemetry.BufferSize = telemetryRegionSize;
+
+	context->IPC.SharedRegions.History.Buffer = pHistoryBuf;
+	context->IPC.SharedRegions.History.BufferSize = historyRegionSize;
+	context->IPC.SharedRegions.History.Depth = historyDepth;
+
+	context->IPC.SharedRegions.Output.Buffer = pOutputBuf;
+	context->IPC.SharedRegions.Output.BufferSize = outputRegionSize;
+
+	context->IPC.SharedRegions.Counters.Buffer = pCountersBuf;
+	context->IPC.SharedRegions.Counters.BufferSize = countersRegionSize;
+
 	// 
 	// Start thread now that context is initialized at its minimum requirement
 	// 
@@ -281,12 +588,39 @@ exitFailure:
 	if (pHIDBuf)
 		UnmapViewOfFile(pHIDBuf);
 
+	if (pTelemetryBuf)
+		UnmapViewOfFile(pTelemetryBuf);
+
+	if (pHistoryBuf)
+		UnmapViewOfFile(pHistoryBuf);
+
+	if (pOutputBuf)
+		UnmapViewOfFile(pOutputBuf);
+
+	if (pCountersBuf)
+		UnmapViewOfFile(pCountersBuf);
+
 	if (hReadEvent)
 		CloseHandle(hReadEvent);
 
 	if (hWriteEvent)
 		CloseHandle(hWriteEvent);
 
+	if (hCommandRingEvent)
+		CloseHandle(hCommandRingEvent);
+
+	for (ULONG slotIndex = 0; slotIndex < DSHM_IPC_CMD_SLOT_COUNT; slotIndex++)
+	{
+		if (hReplyEvents[slotIndex])
+			CloseHandle(hReplyEvents[slotIndex]);
+	}
+
+	if (hOutputRingEvent)
+		CloseHandle(hOutputRingEvent);
+
+	if (hInputChangedEvent)
+		CloseHandle(hInputChangedEvent);
+
 	if (hMapFile)
 		CloseHandle(hMapFile);
 
@@ -333,6 +667,18 @@ void DestroyIPC(void)
 	if (context->IPC.SharedRegions.HID.Buffer)
 		UnmapViewOfFile(context->IPC.SharedRegions.HID.Buffer);
 
+	if (context->IPC.SharedRegions.Telemetry.Buffer)
+		UnmapViewOfFile(context->IPC.SharedRegions.Telemetry.Buffer);
+
+	if (context->IPC.SharedRegions.History.Buffer)
+		UnmapViewOfFile(context->IPC.SharedRegions.History.Buffer);
+
+	if (context->IPC.SharedRegions.Output.Buffer)
+		UnmapViewOfFile(context->IPC.SharedRegions.Output.Buffer);
+
+	if (context->IPC.SharedRegions.Counters.Buffer)
+		UnmapViewOfFile(context->IPC.SharedRegions.Counters.Buffer);
+
 	if (context->IPC.MapFile)
 		CloseHandle(context->IPC.MapFile);
 
@@ -342,6 +688,21 @@ void DestroyIPC(void)
 	if (context->IPC.WriteEvent)
 		CloseHandle(context->IPC.WriteEvent);
 
+	if (context->IPC.CommandRingEvent)
+		CloseHandle(context->IPC.CommandRingEvent);
+
+	for (ULONG slotIndex = 0; slotIndex < DSHM_IPC_CMD_SLOT_COUNT; slotIndex++)
+	{
+		if (context->IPC.CommandReplyEvents[slotIndex])
+			CloseHandle(context->IPC.CommandReplyEvents[slotIndex]);
+	}
+
+	if (context->IPC.OutputRingEvent)
+		CloseHandle(context->IPC.OutputRingEvent);
+
+	if (context->IPC.InputChangedEvent)
+		CloseHandle(context->IPC.InputChangedEvent);
+
 	if (context->IPC.ConnectMutex)
 		CloseHandle(context->IPC.ConnectMutex);
 
@@ -349,17 +710,22 @@ void DestroyIPC(void)
 }
 
 //
-// Processes incoming IPC commands
+// Processes a single command, the reply gets written over the message.
+// HasReply tells whether the client expects a reply and one got written.
 // 
-static NTSTATUS DSHM_IPC_DispatchIncomingCommandMessage(
+static NTSTATUS DSHM_IPC_DispatchCommandMessage(
 	_In_ const PDSHM_DRIVER_CONTEXT Context,
-	_In_ const PDSHM_IPC_MSG_HEADER Message
+	_In_ const PDSHM_IPC_MSG_HEADER Message,
+	_In_ size_t MaxSize,
+	_Out_ PBOOLEAN HasReply
 )
 {
 	FuncEntry(TRACE_IPC);
 
 	NTSTATUS status = STATUS_NOT_IMPLEMENTED;
 
+	*HasReply = FALSE;
+
 	//
 	// Sanity check
 	// 
@@ -371,7 +737,7 @@ static NTSTATUS DSHM_IPC_DispatchIncomingCommandMessage(
 	//
 	// Message outside of region bounds
 	// 
-	if (Message->Size > Context->IPC.SharedRegions.Commands.BufferSize)
+	if (Message->Size > MaxSize)
 	{
 		return STATUS_BUFFER_OVERFLOW;
 	}
@@ -386,11 +752,9 @@ static NTSTATUS DSHM_IPC_DispatchIncomingCommandMessage(
 			"IPC: PING message received"
 		);
 
-		const PDSHM_IPC_MSG_HEADER header = (PDSHM_IPC_MSG_HEADER)Context->IPC.SharedRegions.Commands.Buffer;
+		DSHM_IPC_MSG_PING_RESPONSE_INIT(Message);
 
-		DSHM_IPC_MSG_PING_RESPONSE_INIT(header);
-
-		DSHM_IPC_SIGNAL_WRITE_DONE(Context);
+		*HasReply = TRUE;
 
 		status = STATUS_SUCCESS;
 	}
@@ -420,10 +784,7 @@ static NTSTATUS DSHM_IPC_DispatchIncomingCommandMessage(
 			);
 		}
 
-		if (expectsReply)
-		{
-			DSHM_IPC_SIGNAL_WRITE_DONE(Context);
-		}
+		*HasReply = expectsReply;
 	}
 
 	FuncExit(TRACE_IPC, "status=%!STATUS!", status);
@@ -431,6 +792,376 @@ static NTSTATUS DSHM_IPC_DispatchIncomingCommandMessage(
 	return status;
 }
 
+//
+// Runs the commands of a batch one after another in a single pass, each
+// reply gets written over its command within the entry
+// 
+static NTSTATUS DSHM_IPC_DispatchBatchMessage(
+	_In_ const PDSHM_DRIVER_CONTEXT Context,
+	_In_ const PDSHM_IPC_MSG_HEADER Message,
+	_In_ size_t MaxSize,
+	_Out_ PBOOLEAN HasReply
+)
+{
+	FuncEntry(TRACE_IPC);
+
+	const PDSHM_IPC_MSG_BATCH_REQUEST batch = (PDSHM_IPC_MSG_BATCH_REQUEST)Message;
+	const UINT32 size = Message->Size;
+	UINT32 offsets[DSHM_IPC_MSG_BATCH_MAX_COUNT + 1];
+	UINT32 count;
+
+	*HasReply = FALSE;
+
+	//
+	// Message outside of region bounds
+	// 
+	if (size > MaxSize)
+	{
+		return STATUS_BUFFER_OVERFLOW;
+	}
+
+	//
+	// Framing gets checked up front, nothing runs if any entry is off
+	// 
+	if (!DSHM_IPC_MSG_BATCH_PARSE(batch, size, offsets, &count))
+	{
+		TraceWarning(
+			TRACE_IPC,
+			"Ignoring malformed command batch of %lu bytes",
+			size
+		);
+
+		return STATUS_INVALID_USER_BUFFER;
+	}
+
+	for (UINT32 index = 0; index < count; index++)
+	{
+		const PDSHM_IPC_MSG_BATCH_ENTRY entry = (PDSHM_IPC_MSG_BATCH_ENTRY)((PUCHAR)Message + offsets[index]);
+		const PDSHM_IPC_MSG_HEADER command = DSHM_IPC_MSG_BATCH_ENTRY_MESSAGE(entry);
+		NTSTATUS entryStatus;
+		BOOLEAN hasReply;
+
+		//
+		// Batches don't nest
+		// 
+		if (DSHM_IPC_MSG_IS_BATCH(command))
+		{
+			entryStatus = STATUS_INVALID_PARAMETER;
+		}
+		else
+		{
+			entryStatus = DSHM_IPC_DispatchCommandMessage(
+				Context,
+				command,
+				// recorded bounds, the client may have changed Size since
+				offsets[index + 1] - offsets[index] - sizeof(DSHM_IPC_MSG_BATCH_ENTRY),
+				&hasReply
+			);
+		}
+
+		if (!NT_SUCCESS(entryStatus))
+		{
+			TraceWarning(
+				TRACE_IPC,
+				"Batched command %lu of %lu failed with status %!STATUS!",
+				index + 1,
+				count,
+				entryStatus
+			);
+		}
+
+		entry->Status = entryStatus;
+	}
+
+	TraceVerbose(
+		TRACE_IPC,
+		"IPC: dispatched command batch of %lu command(s)",
+		count
+	);
+
+	DSHM_IPC_MSG_BATCH_RESPONSE_INIT(batch, size, count);
+
+	*HasReply = TRUE;
+
+	FuncExitNoReturn(TRACE_IPC);
+
+	return STATUS_SUCCESS;
+}
+
+//
+// Processes incoming IPC messages, replies get written over the message.
+// HasReply tells whether the client expects a reply and one got written.
+// 
+static NTSTATUS DSHM_IPC_DispatchIncomingCommandMessage(
+	_In_ const PDSHM_DRIVER_CONTEXT Context,
+	_In_ const PDSHM_IPC_MSG_HEADER Message,
+	_In_ size_t MaxSize,
+	_Out_ PBOOLEAN HasReply
+)
+{
+	if (DSHM_IPC_MSG_IS_BATCH(Message))
+	{
+		return DSHM_IPC_DispatchBatchMessage(Context, Message, MaxSize, HasReply);
+	}
+
+	return DSHM_IPC_DispatchCommandMessage(Context, Message, MaxSize, HasReply);
+}
+
+//
+// Takes queued command ring slots off in batches and dispatches them until
+// the queue is empty
+// 
+static void DSHM_IPC_DrainCommandRing(
+	_In_ const PDSHM_DRIVER_CONTEXT Context
+)
+{
+	const PIPC_CMD_RING_HEADER ring = DSHM_IPC_CMD_RING(Context->IPC.SharedRegions.Commands.Buffer);
+	ULONG batch[DSHM_IPC_CMD_DRAIN_BATCH];
+	ULONG count;
+
+	do
+	{
+		count = 0;
+
+		while (count < ARRAYSIZE(batch) && DSHM_IPC_CMD_DEQUEUE(ring, &batch[count]))
+		{
+			count++;
+		}
+
+		for (ULONG index = 0; index < count; index++)
+		{
+			const ULONG slotIndex = batch[index];
+			BOOLEAN hasReply;
+
+			//
+			// Index comes from a client
+			// 
+			if (slotIndex >= DSHM_IPC_CMD_SLOT_COUNT)
+			{
+				TraceWarning(
+					TRACE_IPC,
+					"Ignoring invalid command ring slot index %lu",
+					slotIndex
+				);
+				continue;
+			}
+
+			const PIPC_CMD_SLOT slot = DSHM_IPC_CMD_SLOT(ring, slotIndex);
+			const PDSHM_IPC_MSG_HEADER header = (PDSHM_IPC_MSG_HEADER)slot->Message;
+
+			TraceInformation(
+				TRACE_IPC,
+				"Got ring message type %d for target %d and command %d in slot %lu",
+				header->Type, header->Target, header->Command.Device, slotIndex
+			);
+
+			const NTSTATUS status = DSHM_IPC_DispatchIncomingCommandMessage(
+				Context,
+				header,
+				DSHM_IPC_CMD_MESSAGE_MAX,
+				&hasReply
+			);
+
+			if (!NT_SUCCESS(status))
+			{
+				TraceError(
+					TRACE_IPC,
+					"DSHM_IPC_DispatchIncomingCommandMessage reported non-success status %!STATUS!",
+					status
+				);
+			}
+
+			//
+			// The slot goes back to the client either way, reply or not
+			// 
+			if (DSHM_IPC_CMD_COMPLETE(ring, slotIndex))
+			{
+				SetEvent(Context->IPC.CommandReplyEvents[slotIndex]);
+			}
+		}
+	} while (count == ARRAYSIZE(batch));
+}
+
+//
+// TRUE if the client process that claimed a shared resource has exited
+// 
+static BOOLEAN DSHM_IPC_IsOwnerGone(
+	_In_ ULONG ProcessId
+)
+{
+	const HANDLE owner = OpenProcess(SYNCHRONIZE, FALSE, ProcessId);
+
+	if (owner != NULL)
+	{
+		const BOOL isAlive = WaitForSingleObject(owner, 0) == WAIT_TIMEOUT;
+
+		CloseHandle(owner);
+
+		return !isAlive;
+	}
+
+	//
+	// Access denied means it's alive, but we may not touch it
+	// 
+	return GetLastError() == ERROR_INVALID_PARAMETER;
+}
+
+//
+// Frees command ring slots whose owning process is gone without releasing
+// them, including submitted ones that never made it into the queue. Runs on
+// the dispatch thread, so no dequeued slot is in flight meanwhile.
+// 
+static void DSHM_IPC_ReclaimCommandRingSlots(
+	_In_ const PDSHM_DRIVER_CONTEXT Context
+)
+{
+	const PIPC_CMD_RING_HEADER ring = DSHM_IPC_CMD_RING(Context->IPC.SharedRegions.Commands.Buffer);
+
+	for (ULONG slotIndex = 0; slotIndex < DSHM_IPC_CMD_SLOT_COUNT; slotIndex++)
+	{
+		const PIPC_CMD_SLOT slot = DSHM_IPC_CMD_SLOT(ring, slotIndex);
+		const ULONG ownerProcessId = DSHM_IPC_LOAD32(&slot->OwnerProcessId);
+
+		// queued slots get freed on completion if need be
+		if (ownerProcessId == 0
+			|| !DSHM_IPC_IsOwnerGone(ownerProcessId)
+			|| DSHM_IPC_CMD_IS_QUEUED(ring, slotIndex))
+		{
+			continue;
+		}
+
+		if (DSHM_IPC_CAS32(&slot->OwnerProcessId, ownerProcessId, 0))
+		{
+			TraceWarning(
+				TRACE_IPC,
+				"Reclaimed command ring slot %lu of exited process %lu",
+				slotIndex,
+				ownerProcessId
+			);
+		}
+	}
+}
+
+//
+// Skips the cell at the head of the command queue if a client claimed it but
+// didn't publish it since the previous call, it died in between. Clients
+// queued behind it would wait forever otherwise.
+// 
+static void DSHM_IPC_RecoverCommandQueue(
+	_In_ const PDSHM_DRIVER_CONTEXT Context,
+	_Inout_ PBOOLEAN IsStalled,
+	_Inout_ PULONG StalledPosition
+)
+{
+	const PIPC_CMD_RING_HEADER ring = DSHM_IPC_CMD_RING(Context->IPC.SharedRegions.Commands.Buffer);
+	ULONG position;
+
+	if (!DSHM_IPC_CMD_IS_STALLED(ring, &position))
+	{
+		*IsStalled = FALSE;
+		return;
+	}
+
+	if (!*IsStalled || *StalledPosition != position)
+	{
+		*IsStalled = TRUE;
+		*StalledPosition = position;
+		return;
+	}
+
+	*IsStalled = FALSE;
+
+	if (DSHM_IPC_CMD_SKIP(ring, position))
+	{
+		TraceWarning(
+			TRACE_IPC,
+			"Skipped command queue position %lu claimed by a client that never published it",
+			position
+		);
+
+		DSHM_IPC_DrainCommandRing(Context);
+	}
+}
+
+//
+// Frees output rings whose producing process is gone without releasing them
+// 
+static void DSHM_IPC_ReclaimOutputRings(
+	_In_ const PDSHM_DRIVER_CONTEXT Context
+)
+{
+	const PIPC_OUTPUT_REGION_HEADER region = (PIPC_OUTPUT_REGION_HEADER)Context->IPC.SharedRegions.Output.Buffer;
+
+	for (ULONG slotIndex = 1; slotIndex <= DSHM_IPC_OUTPUT_RING_COUNT; slotIndex++)
+	{
+		const PIPC_OUTPUT_RING ring = DSHM_IPC_OUTPUT_RING(region, slotIndex);
+		const ULONG ownerProcessId = DSHM_IPC_LOAD32(&ring->OwnerProcessId);
+
+		if (ownerProcessId == 0 || !DSHM_IPC_IsOwnerGone(ownerProcessId))
+		{
+			continue;
+		}
+
+		if (DSHM_IPC_CAS32(&ring->OwnerProcessId, ownerProcessId, 0))
+		{
+			TraceWarning(
+				TRACE_IPC,
+				"Reclaimed output ring %lu of exited process %lu",
+				slotIndex,
+				ownerProcessId
+			);
+		}
+	}
+}
+
+//
+// Hands pending output requests to their devices, requests for vacant slots
+// get dropped
+// 
+static void DSHM_IPC_DrainOutputRings(
+	_In_ const PDSHM_DRIVER_CONTEXT Context
+)
+{
+	const PIPC_OUTPUT_REGION_HEADER region = (PIPC_OUTPUT_REGION_HEADER)Context->IPC.SharedRegions.Output.Buffer;
+
+	for (ULONG slotIndex = 1; slotIndex <= DSHM_IPC_OUTPUT_RING_COUNT; slotIndex++)
+	{
+		const PIPC_OUTPUT_RING ring = DSHM_IPC_OUTPUT_RING(region, slotIndex);
+		ULONG tail;
+
+		if (DSHM_IPC_LOAD32(&ring->Tail) == (ULONG)ring->Head)
+		{
+			continue;
+		}
+
+		const ULONG pending = DSHM_IPC_OUTPUT_RING_PENDING(ring, &tail);
+
+		//
+		// Device cleanup waits for us, so the context stays valid meanwhile
+		// 
+		WdfWaitLockAcquire(Context->SlotsLock, NULL);
+		{
+			const PDEVICE_CONTEXT deviceContext = Context->IPC.DeviceDispatchers.Contexts[slotIndex];
+
+			if (deviceContext && pending > 0)
+			{
+				DSHM_DispatchDeviceOutputRequests(deviceContext, ring, tail - pending, pending);
+			}
+			else
+			{
+				TraceWarning(
+					TRACE_IPC,
+					"Dropping output ring %lu content (vacant slot or corrupt index)",
+					slotIndex
+				);
+			}
+
+			DSHM_IPC_OUTPUT_RING_CONSUME(ring, tail);
+		}
+		WdfWaitLockRelease(Context->SlotsLock);
+	}
+}
+
 //
 // Listens for client connection and processes data exchange
 // 
@@ -446,18 +1177,42 @@ static DWORD WINAPI DSHM_IPC_ClientDispatchProc(
 		// driver shutdown signals thread termination
 		context->IPC.DispatchThreadTermination,
 		// read is signaled when an outside app has finished writing
-		context->IPC.ReadEvent
+		context->IPC.ReadEvent,
+		// clients queued commands in the command ring
+		context->IPC.CommandRingEvent,
+		// clients appended output requests
+		context->IPC.OutputRingEvent
 	};
 
+	ULONGLONG lastMaintenance = GetTickCount64();
+	BOOLEAN isCommandQueueStalled = FALSE;
+	ULONG stalledCommandPosition = 0;
+
 	do
 	{
-		DWORD waitResult = WaitForMultipleObjects(ARRAYSIZE(waits), waits, FALSE, 1000);
+		DWORD waitResult = WaitForMultipleObjects(ARRAYSIZE(waits), waits, FALSE, DSHM_IPC_MAINTENANCE_INTERVAL_MS);
+
+		//
+		// Clean up after clients that died mid-conversation, by elapsed time
+		// so busy clients can't hold it off
+		// 
+		if (waitResult != WAIT_FAILED && waitResult != WAIT_OBJECT_0
+			&& GetTickCount64() - lastMaintenance >= DSHM_IPC_MAINTENANCE_INTERVAL_MS)
+		{
+			lastMaintenance = GetTickCount64();
+
+			DSHM_IPC_RecoverCommandQueue(context, &isCommandQueueStalled, &stalledCommandPosition);
+			DSHM_IPC_ReclaimCommandRingSlots(context);
+			DSHM_IPC_ReclaimOutputRings(context);
+		}
 
 		//
 		// Retry indefinitely until an event is signaled
 		// 
 		if (waitResult == WAIT_TIMEOUT)
+		{
 			continue;
+		}
 
 		//
 		// Unexpected result
@@ -496,7 +1251,19 @@ static DWORD WINAPI DSHM_IPC_ClientDispatchProc(
 				header->Type, header->Target, header->Command.Device
 			);
 
-			NTSTATUS status = DSHM_IPC_DispatchIncomingCommandMessage(context, header);
+			BOOLEAN hasReply;
+			NTSTATUS status = DSHM_IPC_DispatchIncomingCommandMessage(
+				context,
+				header,
+				// the command ring follows the legacy buffer
+				DSHM_IPC_CMD_RING_OFFSET,
+				&hasReply
+			);
+
+			if (hasReply)
+			{
+				DSHM_IPC_SIGNAL_WRITE_DONE(context);
+			}
 
 			if (!NT_SUCCESS(status))
 			{
@@ -510,6 +1277,25 @@ static DWORD WINAPI DSHM_IPC_ClientDispatchProc(
 			}
 		}
 
+		//
+		// Commands got queued in the command ring; also checked after legacy
+		// messages so a busy legacy client can't hold ring clients off
+		// 
+		if (waitResult == WAIT_OBJECT_0 + 1 || waitResult == WAIT_OBJECT_0 + 2)
+		{
+			DSHM_IPC_DrainCommandRing(context);
+		}
+
+		//
+		// Output requests got appended; polled after commands as well so a
+		// busy command client can't hold output clients off
+		// 
+		if (waitResult == WAIT_OBJECT_0 + 3
+			|| WaitForSingleObject(context->IPC.OutputRingEvent, 0) == WAIT_OBJECT_0)
+		{
+			DSHM_IPC_DrainOutputRings(context);
+		}
+
 	} while (TRUE);
 
 	FuncExitNoReturn(TRACE_IPC);
@@ -15,49 +15,169 @@ DSHM_ParseInputReport(
 {
 	FuncEntry(TRACE_DSHIDMINIDRV);
 
+	//
+	// Copy what the translation needs, the section must not span the HID completions
+	// 
+	LONG epoch;
+	const DS_CONFIG_SNAPSHOT* config = DS_CONFIG_READ_BEGIN(DeviceContext, &epoch);
+	const DS_HID_DEVICE_MODE hidDeviceMode = config->Configuration.HidDeviceMode;
+	DS_THUMB_SETTINGS thumbSettings = config->Configuration.ThumbSettings;
+	DS_FLIP_AXIS_SETTINGS flipAxis = config->Configuration.FlipAxis;
+	const DS_PRESSURE_EXPOSURE_MODE gpjPressureExposureMode = config->Configuration.GPJ.PressureExposureMode;
+	const DS_DPAD_EXPOSURE_MODE gpjDPadExposureMode = config->Configuration.GPJ.DPadExposureMode;
+	const DS_PRESSURE_EXPOSURE_MODE sdfPressureExposureMode = config->Configuration.SDF.PressureExposureMode;
+	const DS_DPAD_EXPOSURE_MODE sdfDPadExposureMode = config->Configuration.SDF.DPadExposureMode;
+	DS_CONFIG_READ_END(DeviceContext, epoch);
+
 #pragma region IPC Copy
 
 	const WDFDRIVER driver = WdfGetDriver();
 	const PDSHM_DRIVER_CONTEXT pDrvCtx = DriverGetContext(driver);
 
+	ULONG sequence;
+	BOOLEAN isClaimed = FALSE;
+
+	/*
+	 * Each device owns the slot at its index, the sequence counter of the
+	 * slot stays odd while the copy is in progress so readers can
+	 * detect torn reads. Completions of the same device may overlap, the
+	 * claim is held for a few dozen bytes only so retry a few times; this
+	 * keeps the history ring single-producer. Clients can write the
+	 * mapping too, a slot that stays claimed loses the update instead of
+	 * stalling the input path.
+	 */
 	if (pDrvCtx->IPC.IsEnabled)
 	{
-		/*
-		 * Offset calculation puts each devices' input report copy 
-	     * in their respective position in the memory region, like:
-	     *   1st device: ((4 + 49) * (1 - 1)) = 0
-	     *   2nd device: ((4 + 49) * (2 - 1)) = 53
-	     *   3rd device: ((4 + 49) * (3 - 1)) = 106
-	     * and so on
-		 */
-		const size_t offset = (sizeof(IPC_HID_INPUT_REPORT_MESSAGE) * (DeviceContext->SlotIndex - 1));
-		const PIPC_HID_INPUT_REPORT_MESSAGE pHIDBuffer = (PIPC_HID_INPUT_REPORT_MESSAGE)(pDrvCtx->IPC.SharedRegions.HID.Buffer +
-			offset);
+		for (ULONG attempt = 0; attempt < DSHM_IPC_HID_WRITE_ATTEMPTS; attempt++)
+		{
+			if (DSHM_IPC_HID_WRITE_BEGIN(pDrvCtx->IPC.SharedRegions.HID.Buffer, DeviceContext->SlotIndex, &sequence))
+			{
+				isClaimed = TRUE;
+				break;
+			}
+
+			YieldProcessor();
+		}
+
+		if (!isClaimed)
+		{
+			DSHM_IPC_COUNTER_INCREMENT(&DeviceContext->IPC.Counters->InputSlotSkips);
+		}
+	}
+
+	if (isClaimed)
+	{
+		const PIPC_HID_INPUT_REPORT_MESSAGE pHIDBuffer = &DSHM_IPC_HID_SLOT(
+			pDrvCtx->IPC.SharedRegions.HID.Buffer,
+			DeviceContext->SlotIndex
+		)->Message;
+
+		const PIPC_HID_STATE pState = DSHM_IPC_HID_STATE(
+			pDrvCtx->IPC.SharedRegions.HID.Buffer,
+			DeviceContext->SlotIndex
+		);
+
+		LARGE_INTEGER timestamp;
+		QueryPerformanceCounter(&timestamp);
 
 		// prefix each report with associated device index
 		pHIDBuffer->SlotIndex = DeviceContext->SlotIndex;
 		// skip index and copy unmodified raw report to the section
 		RtlCopyMemory(&pHIDBuffer->InputReport, Report, sizeof(DS3_RAW_INPUT_REPORT));
 
+		//
+		// Same axis transformation the HID input report translation applies,
+		// so clients don't have to replicate the thumb and flip settings
+		// 
+		pState->Timestamp = timestamp.QuadPart;
+		pState->Buttons = Report->Buttons.lButtons;
+		RtlCopyMemory(pState->Pressure, Report->Pressure.bValues, sizeof(pState->Pressure));
+
+		DS3_RAW_AXIS_TRANSFORM(
+			Report->LeftThumbX,
+			Report->LeftThumbY,
+			&pState->LeftThumbX,
+			&pState->LeftThumbY,
+			thumbSettings.DeadZoneLeft.Apply,
+			thumbSettings.DeadZoneLeft.PolarValue,
+			flipAxis.LeftX,
+			flipAxis.LeftY
+		);
+		DS3_RAW_AXIS_TRANSFORM(
+			Report->RightThumbX,
+			Report->RightThumbY,
+			&pState->RightThumbX,
+			&pState->RightThumbY,
+			thumbSettings.DeadZoneRight.Apply,
+			thumbSettings.DeadZoneRight.PolarValue,
+			flipAxis.RightX,
+			flipAxis.RightY
+		);
+
+		if (pDrvCtx->IPC.SharedRegions.History.Depth)
+		{
+			DSHM_IPC_HID_HISTORY_APPEND(
+				DSHM_IPC_HID_HISTORY_RING(
+					pDrvCtx->IPC.SharedRegions.History.Buffer,
+					DSHM_IPC_HID_HEADER(pDrvCtx->IPC.SharedRegions.HID.Buffer),
+					DeviceContext->SlotIndex
+				),
+				pDrvCtx->IPC.SharedRegions.History.Depth,
+				Report,
+				timestamp.QuadPart
+			);
+		}
+
+		DSHM_IPC_HID_WRITE_END(pDrvCtx->IPC.SharedRegions.HID.Buffer, DeviceContext->SlotIndex, sequence);
+
 		// signal any reader that there is new data available
 		SetEvent(DeviceContext->IPC.InputReportWaitHandle);
+
+		// the driver-wide event only on the first change the reader hasn't taken yet
+		if (DSHM_IPC_HID_MARK_CHANGED(pDrvCtx->IPC.SharedRegions.HID.Buffer, DeviceContext->SlotIndex))
+		{
+			SetEvent(pDrvCtx->IPC.InputChangedEvent);
+		}
 	}
 
 #pragma endregion
 
+#ifdef DSHM_FEATURE_FFB
+
+#pragma region Force Feedback axes
+
+	//
+	// Left stick drives condition effects (spring, damper, ...), most of
+	// the time none play so don't take the lock for nothing
+	// 
+	if (DeviceContext->ForceFeedback.Engine.HasConditions)
+	{
+		WdfWaitLockAcquire(DeviceContext->ForceFeedback.Lock, NULL);
+		FFB_ENGINE_SET_AXES(
+			&DeviceContext->ForceFeedback.Engine,
+			FFB_ENGINE_POSITION_FROM_AXIS(Report->LeftThumbX),
+			FFB_ENGINE_POSITION_FROM_AXIS(Report->LeftThumbY)
+		);
+		WdfWaitLockRelease(DeviceContext->ForceFeedback.Lock);
+	}
+
+#pragma endregion
+
+#endif
+
 #pragma region HID Input Report (SDF, GPJ ID 01) processing
 
-	switch (DeviceContext->Configuration.HidDeviceMode) // NOLINT(clang-diagnostic-switch-enum)
+	switch (hidDeviceMode) // NOLINT(clang-diagnostic-switch-enum)
 	{
 	case DsHidMiniDeviceModeGPJ:
 
 		DS3_RAW_TO_GPJ_HID_INPUT_REPORT_01(
 			Report,
 			ModuleDeviceContext->InputReport,
-			DeviceContext->Configuration.GPJ.PressureExposureMode,
-			DeviceContext->Configuration.GPJ.DPadExposureMode,
-			&DeviceContext->Configuration.ThumbSettings,
-			&DeviceContext->Configuration.FlipAxis
+			gpjPressureExposureMode,
+			gpjDPadExposureMode,
+			&thumbSettings,
+			&flipAxis
 		);
 
 #ifdef DBG
@@ -70,10 +190,10 @@ DSHM_ParseInputReport(
 		DS3_RAW_TO_SDF_HID_INPUT_REPORT(
 			Report,
 			ModuleDeviceContext->InputReport,
-			DeviceContext->Configuration.SDF.PressureExposureMode,
-			DeviceContext->Configuration.SDF.DPadExposureMode,
-			&DeviceContext->Configuration.ThumbSettings,
-			&DeviceContext->Configuration.FlipAxis
+			sdfPressureExposureMode,
+			sdfDPadExposureMode,
+			&thumbSettings,
+			&flipAxis
 		);
 
 		break;
@@ -102,8 +222,8 @@ DSHM_ParseInputReport(
 
 #pragma region HID Input Report (GPJ ID 02) processing
 
-	if (DeviceContext->Configuration.HidDeviceMode == DsHidMiniDeviceModeGPJ
-		&& (DeviceContext->Configuration.GPJ.PressureExposureMode & DsPressureExposureModeAnalogue) != 0)
+	if (hidDeviceMode == DsHidMiniDeviceModeGPJ
+		&& (gpjPressureExposureMode & DsPressureExposureModeAnalogue) != 0)
 	{
 		DS3_RAW_TO_GPJ_HID_INPUT_REPORT_02(
 			Report,
@@ -132,13 +252,13 @@ DSHM_ParseInputReport(
 
 #pragma region HID Input Report (SIXAXIS compatible) processing
 
-	if (DeviceContext->Configuration.HidDeviceMode == DsHidMiniDeviceModeSixaxisCompatible)
+	if (hidDeviceMode == DsHidMiniDeviceModeSixaxisCompatible)
 	{
 		DS3_RAW_TO_SIXAXIS_HID_INPUT_REPORT(
 			Report,
 			ModuleDeviceContext->InputReport,
-			&DeviceContext->Configuration.ThumbSettings,
-			&DeviceContext->Configuration.FlipAxis
+			&thumbSettings,
+			&flipAxis
 		);
 
 		//
@@ -163,14 +283,14 @@ DSHM_ParseInputReport(
 
 #pragma region HID Input Report (DualShock 4 Rev1 compatible) processing
 
-	if (DeviceContext->Configuration.HidDeviceMode == DsHidMiniDeviceModeDS4WindowsCompatible)
+	if (hidDeviceMode == DsHidMiniDeviceModeDS4WindowsCompatible)
 	{
 		DS3_RAW_TO_DS4WINDOWS_HID_INPUT_REPORT(
 			Report,
 			ModuleDeviceContext->InputReport,
 			(DeviceContext->ConnectionType == DsDeviceConnectionTypeUsb) ? TRUE : FALSE,
-			&DeviceContext->Configuration.ThumbSettings,
-			&DeviceContext->Configuration.FlipAxis
+			&thumbSettings,
+			&flipAxis
 		);
 
 		//
@@ -195,14 +315,14 @@ DSHM_ParseInputReport(
 
 #pragma region HID Input Report (XINPUT compatible HID device) processing
 
-	if (DeviceContext->Configuration.HidDeviceMode == DsHidMiniDeviceModeXInputHIDCompatible)
+	if (hidDeviceMode == DsHidMiniDeviceModeXInputHIDCompatible)
 	{
 		DS3_RAW_TO_XINPUTHID_HID_INPUT_REPORT(
 			Report,
 			// ReSharper disable once CppRedundantCastExpression
 			(PXINPUT_HID_INPUT_REPORT)ModuleDeviceContext->InputReport,
-			&DeviceContext->Configuration.ThumbSettings,
-			&DeviceContext->Configuration.FlipAxis
+			&thumbSettings,
+			&flipAxis
 		);
 
 		//
@@ -227,7 +347,7 @@ DSHM_ParseInputReport(
 
 #pragma region HID Input Report (Datalogic Scanner) processing
 
-	if (DeviceContext->Configuration.HidDeviceMode == DsHidMiniDeviceModeDatalogicScanner)
+	if (hidDeviceMode == DsHidMiniDeviceModeDatalogicScanner)
 	{
 		// Process scanner data using our scanner module
 		status = DsScanner_ProcessInputData(
@@ -2,6 +2,158 @@
 #include "OutputReport.tmh"
 
 
+//
+// Files a QPC tick span into a latency histogram
+//
+static VOID
+DSHM_OutputTelemetryRecordLatency(
+	_Inout_ PIPC_OUTPUT_TELEMETRY_HISTOGRAM Histogram,
+	_In_ LONGLONG Ticks,
+	_In_ LONGLONG Frequency
+)
+{
+	const LONG64 us = (Ticks > 0) ? (Ticks * 1000000) / Frequency : 0;
+	LONG64 bound = DS_OUTPUT_TELEMETRY_HISTOGRAM_BASE_US;
+	LONG64 max;
+	ULONG bucket = 0;
+
+	while (us >= bound && bucket < DS_OUTPUT_TELEMETRY_HISTOGRAM_BUCKETS - 1)
+	{
+		bound <<= 1;
+		bucket++;
+	}
+
+	InterlockedIncrement64(&Histogram->Buckets[bucket]);
+	InterlockedAdd64(&Histogram->TotalMicroseconds, us);
+
+	while (us > (max = Histogram->MaxMicroseconds)
+		&& InterlockedCompareExchange64(&Histogram->MaxMicroseconds, us, max) != max)
+	{
+	}
+}
+
+//
+// Tracks the number of buffers in the queue or held back by rate control
+//
+static VOID
+DSHM_OutputTelemetryUpdateInFlight(
+	_Inout_ PIPC_OUTPUT_REPORT_TELEMETRY Telemetry,
+	_In_ LONG Delta
+)
+{
+	const LONG current = InterlockedAdd(&Telemetry->InFlight, Delta);
+	LONG peak;
+
+	while (current > (peak = Telemetry->PeakInFlight)
+		&& InterlockedCompareExchange(&Telemetry->PeakInFlight, current, peak) != peak)
+	{
+	}
+}
+
+//
+// Reports a summary of the output path counters via ETW
+//
+VOID
+DSHM_OutputReportTelemetryTrace(
+	_In_ PDEVICE_CONTEXT Context
+)
+{
+	const PIPC_OUTPUT_REPORT_TELEMETRY pTel = Context->OutputReport.Telemetry;
+
+	if (!pTel)
+	{
+		return;
+	}
+
+	EventWriteOutputReportTelemetry(
+		Context->DeviceAddressString,
+		(ULONGLONG)pTel->Enqueued,
+		(ULONGLONG)pTel->Skipped,
+		(ULONGLONG)pTel->EnqueueFailed,
+		(ULONGLONG)pTel->Dequeued,
+		(ULONGLONG)pTel->Delayed,
+		(ULONGLONG)pTel->Replaced,
+		(ULONGLONG)pTel->Requeued,
+		(ULONGLONG)pTel->Sent,
+		(ULONGLONG)pTel->SendFailed,
+		(ULONG)pTel->PeakInFlight,
+		(ULONGLONG)(pTel->Dequeued ? pTel->QueueTime.TotalMicroseconds / pTel->Dequeued : 0),
+		(ULONGLONG)pTel->QueueTime.MaxMicroseconds,
+		(ULONGLONG)(pTel->Sent ? pTel->SendLatency.TotalMicroseconds / pTel->Sent : 0),
+		(ULONGLONG)pTel->SendLatency.MaxMicroseconds,
+		(ULONGLONG)(pTel->Sent ? pTel->EndToEnd.TotalMicroseconds / pTel->Sent : 0),
+		(ULONGLONG)pTel->EndToEnd.MaxMicroseconds
+	);
+}
+
+//
+// Joins the driver-wide Bluetooth writes budget
+//
+VOID
+DSHM_BthAirtimeRegister(
+	_In_ PDEVICE_CONTEXT Context
+)
+{
+	const PDSHM_DRIVER_CONTEXT pDrvCtx = DriverGetContext(WdfGetDriver());
+	LARGE_INTEGER now;
+
+	QueryPerformanceCounter(&now);
+
+	WdfWaitLockAcquire(pDrvCtx->BthAirtime.Lock, NULL);
+	DS_AIRTIME_REGISTER(&pDrvCtx->BthAirtime.Budget, &Context->OutputReport.Airtime, now.QuadPart);
+	WdfWaitLockRelease(pDrvCtx->BthAirtime.Lock);
+}
+
+//
+// Hands the device's share back to the remaining ones
+//
+VOID
+DSHM_BthAirtimeUnregister(
+	_In_ PDEVICE_CONTEXT Context
+)
+{
+	const PDSHM_DRIVER_CONTEXT pDrvCtx = DriverGetContext(WdfGetDriver());
+	const PDS_AIRTIME_CLIENT pClient = &Context->OutputReport.Airtime;
+	LARGE_INTEGER now;
+
+	QueryPerformanceCounter(&now);
+
+	WdfWaitLockAcquire(pDrvCtx->BthAirtime.Lock, NULL);
+	{
+		TraceVerbose(
+			TRACE_DSHIDMINIDRV,
+			"Airtime usage: %I64u own, %I64u borrowed, %I64u forced, %I64u deferred",
+			pClient->Granted,
+			pClient->Borrowed,
+			pClient->Forced,
+			pClient->Deferred
+		);
+
+		DS_AIRTIME_UNREGISTER(&pDrvCtx->BthAirtime.Budget, pClient, now.QuadPart);
+	}
+	WdfWaitLockRelease(pDrvCtx->BthAirtime.Lock);
+}
+
+//
+// Charges a write against the driver-wide budget, returns the milliseconds to hold it back
+//
+static ULONG
+DSHM_BthAirtimeAcquire(
+	_In_ PDEVICE_CONTEXT Context,
+	_In_ BOOLEAN IsPriority,
+	_In_ LONGLONG Now
+)
+{
+	const PDSHM_DRIVER_CONTEXT pDrvCtx = DriverGetContext(WdfGetDriver());
+	ULONG waitMs;
+
+	WdfWaitLockAcquire(pDrvCtx->BthAirtime.Lock, NULL);
+	waitMs = DS_AIRTIME_ACQUIRE(&pDrvCtx->BthAirtime.Budget, &Context->OutputReport.Airtime, IsPriority, Now);
+	WdfWaitLockRelease(pDrvCtx->BthAirtime.Lock);
+
+	return waitMs;
+}
+
 //
 // Enqueues current output report buffer to get sent to device.
 //
@@ -18,12 +170,38 @@ DSHM_SendOutputReport(
 	PUCHAR sourceBuffer, sendBuffer;
 	size_t sourceBufferLength;
 	PDS_OUTPUT_REPORT_CONTEXT sendContext;
-	const PDS_DRIVER_CONFIGURATION pConfig = &Context->Configuration;	
 
 	WdfWaitLockAcquire(Context->OutputReport.Lock, NULL);
 
 	do
 	{
+		//
+		// Compile pending state changes into the output report; custom LED
+		// patterns are already part of the state since configuration load
+		// 
+		const BOOLEAN isDirty = DS3_SERIALIZE_OUTPUT_REPORT(Context);
+
+		//
+		// Skip redundant requests; spinning motors and pass-through content are
+		// always sent as the device relies on being refreshed by the client
+		// 
+		if (!isDirty
+			&& Source != Ds3OutputReportSourceDriverHighPriority
+			&& Source != Ds3OutputReportSourcePassThrough
+			&& !DS3_OUTPUT_STATE_IS_RUMBLE_ACTIVE(&Context->OutputReport.State))
+		{
+			TraceVerbose(
+				TRACE_DSHIDMINIDRV,
+				"Output state unchanged, skipping report"
+			);
+
+			InterlockedIncrement64(&Context->OutputReport.Telemetry->Skipped);
+			DSHM_IPC_COUNTER_INCREMENT(&Context->IPC.Counters->DuplicatesSuppressed);
+
+			status = STATUS_SUCCESS;
+			break;
+		}
+
 		//
 		// Grab new buffer to send
 		//
@@ -41,48 +219,10 @@ DSHM_SendOutputReport(
 
 			EventWriteFailedWithNTStatus(__FUNCTION__, L"DMF_ThreadedBufferQueue_Fetch", status);
 
-			break;
-		}
+			InterlockedIncrement64(&Context->OutputReport.Telemetry->EnqueueFailed);
+			DSHM_IPC_COUNTER_INCREMENT(&Context->IPC.Counters->OutputDropped);
 
-		//
-		// Override LED pattern
-		// 
-		if (pConfig->LEDSettings.Mode == DsLEDModeCustomPattern)
-		{
-			DS3_SET_LED_FLAGS(Context, pConfig->LEDSettings.CustomPatterns.LEDFlags);
-
-			DS3_SET_LED_DURATION(
-				Context,
-				0,
-				pConfig->LEDSettings.CustomPatterns.Player1.TotalDuration,
-				pConfig->LEDSettings.CustomPatterns.Player1.BasePortionDuration,
-				pConfig->LEDSettings.CustomPatterns.Player1.OffPortionMultiplier,
-				pConfig->LEDSettings.CustomPatterns.Player1.OnPortionMultiplier
-			);
-			DS3_SET_LED_DURATION(
-				Context,
-				1,
-				pConfig->LEDSettings.CustomPatterns.Player2.TotalDuration,
-				pConfig->LEDSettings.CustomPatterns.Player2.BasePortionDuration,
-				pConfig->LEDSettings.CustomPatterns.Player2.OffPortionMultiplier,
-				pConfig->LEDSettings.CustomPatterns.Player2.OnPortionMultiplier
-			);
-			DS3_SET_LED_DURATION(
-				Context,
-				2,
-				pConfig->LEDSettings.CustomPatterns.Player3.TotalDuration,
-				pConfig->LEDSettings.CustomPatterns.Player3.BasePortionDuration,
-				pConfig->LEDSettings.CustomPatterns.Player3.OffPortionMultiplier,
-				pConfig->LEDSettings.CustomPatterns.Player3.OnPortionMultiplier
-			);
-			DS3_SET_LED_DURATION(
-				Context,
-				3,
-				pConfig->LEDSettings.CustomPatterns.Player4.TotalDuration,
-				pConfig->LEDSettings.CustomPatterns.Player4.BasePortionDuration,
-				pConfig->LEDSettings.CustomPatterns.Player4.OffPortionMultiplier,
-				pConfig->LEDSettings.CustomPatterns.Player4.OnPortionMultiplier
-			);
+			break;
 		}
 
 		//
@@ -98,6 +238,7 @@ DSHM_SendOutputReport(
 		// Timestamp arrival
 		//
 		QueryPerformanceCounter(&sendContext->ReceivedTimestamp);
+		sendContext->EnqueuedTimestamp = sendContext->ReceivedTimestamp;
 		// 
 		// Real buffer length
 		// 
@@ -106,12 +247,16 @@ DSHM_SendOutputReport(
 		// Store origin
 		//
 		sendContext->ReportSource = Source;
+		sendContext->IsRequeued = FALSE;
 
 		//
 		// Copy current report to buffer
 		//
 		RtlCopyMemory(sendBuffer, sourceBuffer, sourceBufferLength);
 
+		InterlockedIncrement64(&Context->OutputReport.Telemetry->Enqueued);
+		DSHM_OutputTelemetryUpdateInFlight(Context->OutputReport.Telemetry, 1);
+
 		//
 		// Enqueue current report
 		//
@@ -150,9 +295,11 @@ DSHM_EvtExecuteOutputPacketReceived(
 	const PDEVICE_CONTEXT pDevCtx = DeviceGetContext(device);
 	const PDS_OUTPUT_REPORT_CONTEXT pRepCtx = (PDS_OUTPUT_REPORT_CONTEXT)ClientWorkBufferContext;
 	const size_t bufferSize = pRepCtx->BufferSize;
+	const PIPC_OUTPUT_REPORT_TELEMETRY pTel = pDevCtx->OutputReport.Telemetry;
 
 	WDF_MEMORY_DESCRIPTOR memoryDesc;
 	LARGE_INTEGER freq;
+	LARGE_INTEGER sendStart, sendEnd;
 	LONGLONG ms;
 	ULONGLONG timeout;
 	size_t bytesWritten;
@@ -161,6 +308,15 @@ DSHM_EvtExecuteOutputPacketReceived(
 	UNREFERENCED_PARAMETER(NtStatus);	
 
 	QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&sendStart);
+
+	InterlockedIncrement64(&pTel->Dequeued);
+	DSHM_OutputTelemetryUpdateInFlight(pTel, -1);
+	DSHM_OutputTelemetryRecordLatency(
+		&pTel->QueueTime,
+		sendStart.QuadPart - pRepCtx->EnqueuedTimestamp.QuadPart,
+		freq.QuadPart
+	);
 
 	//
 	// Last successful send timestamp
@@ -217,15 +373,43 @@ DSHM_EvtExecuteOutputPacketReceived(
 			ms
 		);
 
+		timeout = 0;
+
+		LONG epoch;
+		const DS_CONFIG_SNAPSHOT* config = DS_CONFIG_READ_BEGIN(pDevCtx, &epoch);
+		const BOOLEAN isOutputRateControlEnabled = config->Configuration.IsOutputRateControlEnabled;
+		const UCHAR outputRateControlPeriodMs = config->Configuration.OutputRateControlPeriodMs;
+		DS_CONFIG_READ_END(pDevCtx, epoch);
+
+		const BOOLEAN isPriority = pRepCtx->ReportSource == Ds3OutputReportSourceDriverHighPriority;
+
+		//
+		// Per-device rate limit condition has been detected
+		// 
+		if (isOutputRateControlEnabled > 0
+			&& !isPriority
+			&& !pRepCtx->IsRequeued
+			&& ms < outputRateControlPeriodMs)
+		{
+			timeout = outputRateControlPeriodMs - ms;
+		}
+		//
+		// Radio is shared, charge against the driver-wide budget
+		// 
+		else
+		{
+			timeout = DSHM_BthAirtimeAcquire(
+				pDevCtx,
+				isPriority,
+				sendStart.QuadPart
+			);
+		}
+
 	//
 	// Rate limit condition has been detected
 	// 
-		if (pRepCtx->ReportSource > Ds3OutputReportSourceDriverHighPriority
-			&& pDevCtx->Configuration.IsOutputRateControlEnabled > 0
-			&& ms < pDevCtx->Configuration.OutputRateControlPeriodMs)
+		if (timeout > 0)
 		{
-			timeout = pDevCtx->Configuration.OutputRateControlPeriodMs - ms;
-
 			TraceVerbose(
 				TRACE_DSHIDMINIDRV,
 				"Rate control triggered, delaying buffer 0x%p for %I64u ms",
@@ -255,8 +439,15 @@ DSHM_EvtExecuteOutputPacketReceived(
 						pDevCtx->OutputReport.Cache.PendingClientBuffer,
 						STATUS_INVALID_DEVICE_REQUEST // Has no impact
 					);
+
+					InterlockedIncrement64(&pTel->Replaced);
+					DSHM_OutputTelemetryUpdateInFlight(pTel, -1);
 				}
 
+				InterlockedIncrement64(&pTel->Delayed);
+				DSHM_IPC_COUNTER_INCREMENT(&pDevCtx->IPC.Counters->RateLimitDelays);
+				DSHM_OutputTelemetryUpdateInFlight(pTel, 1);
+
 				//
 				// Overwrite after old one has been cancelled
 				// 
@@ -321,6 +512,42 @@ DSHM_EvtExecuteOutputPacketReceived(
 		status = STATUS_INVALID_PARAMETER;
 	}
 
+	if (retval == ThreadedBufferQueue_BufferDisposition_WorkComplete)
+	{
+		QueryPerformanceCounter(&sendEnd);
+
+		if (NT_SUCCESS(status))
+		{
+			InterlockedIncrement64(&pTel->Sent);
+			DSHM_IPC_COUNTER_INCREMENT(&pDevCtx->IPC.Counters->OutputReports);
+			DSHM_OutputTelemetryRecordLatency(
+				&pTel->SendLatency,
+				sendEnd.QuadPart - sendStart.QuadPart,
+				freq.QuadPart
+			);
+			DSHM_OutputTelemetryRecordLatency(
+				&pTel->EndToEnd,
+				sendEnd.QuadPart - pRepCtx->ReceivedTimestamp.QuadPart,
+				freq.QuadPart
+			);
+		}
+		else
+		{
+			InterlockedIncrement64(&pTel->SendFailed);
+			DSHM_IPC_COUNTER_INCREMENT(&pDevCtx->IPC.Counters->OutputDropped);
+		}
+
+		//
+		// Periodic summary for field diagnostics
+		// 
+		if ((sendEnd.QuadPart - pDevCtx->OutputReport.TelemetryEventTimestamp.QuadPart)
+			>= (freq.QuadPart * DS_OUTPUT_TELEMETRY_EVENT_INTERVAL_SEC))
+		{
+			pDevCtx->OutputReport.TelemetryEventTimestamp = sendEnd;
+			DSHM_OutputReportTelemetryTrace(pDevCtx);
+		}
+	}
+
 	*NtStatus = status;
 
 	FuncExit(TRACE_DSHIDMINIDRV, "status=%!STATUS!", status);
@@ -358,7 +585,7 @@ DSHM_OutputReportDelayTimerElapsed(
 		);
 
 		//
-		// Re-queue last cached buffer with high priority
+		// Re-queue last cached buffer past the per-device rate limit
 		// 
 
 		const NTSTATUS status = DMF_ThreadedBufferQueue_Fetch(
@@ -373,11 +600,19 @@ DSHM_OutputReportDelayTimerElapsed(
 
 			targetBufferContext->BufferSize = pRepCtx->BufferSize;
 			targetBufferContext->ReceivedTimestamp = pRepCtx->ReceivedTimestamp;
+			QueryPerformanceCounter(&targetBufferContext->EnqueuedTimestamp);
+
+			//
+			// Bypasses the per-device rate limit for this buffer, the airtime
+			// budget still applies to it like to its original source
+			// 
+			targetBufferContext->ReportSource = pRepCtx->ReportSource;
+			targetBufferContext->IsRequeued = TRUE;
 
 			//
-			// Set to high priority, bypasses rate control for this buffer
+			// Held back buffer is replaced by this one, in-flight count stays the same
 			// 
-			targetBufferContext->ReportSource = Ds3OutputReportSourceDriverHighPriority;
+			InterlockedIncrement64(&pDevCtx->OutputReport.Telemetry->Requeued);
 
 			DMF_ThreadedBufferQueue_Enqueue(
 				pDevCtx->OutputReport.Worker,
@@ -394,6 +629,11 @@ DSHM_OutputReportDelayTimerElapsed(
 			status
 		);
 
+		if (!NT_SUCCESS(status))
+		{
+			DSHM_OutputTelemetryUpdateInFlight(pDevCtx->OutputReport.Telemetry, -1);
+		}
+
 		pDevCtx->OutputReport.Cache.PendingClientBuffer = NULL;
 
 		pDevCtx->OutputReport.Cache.IsScheduled = FALSE;
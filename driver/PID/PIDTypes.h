@@ -73,7 +73,11 @@ typedef enum _PID_EFFECT_OPERATION
 	
 } PID_EFFECT_OPERATION;
 
+#ifdef _WIN32
 #include <pshpack1.h>
+#else
+#pragma pack(push, 1)
+#endif
 
 //
 // [OPTIONAL] The virtual device does not require this input report 
@@ -286,4 +290,8 @@ typedef struct _PID_POOL_REPORT
 	UCHAR : 6;
 } PID_POOL_REPORT, * PPID_POOL_REPORT;
 
+#ifdef _WIN32
 #include <poppack.h>
+#else
+#pragma pack(pop)
+#endif
@@ -83,7 +83,7 @@ DsHidMini_EvtDevicePrepareHardware(
 
 		if (NT_SUCCESS(status))
 		{
-			DsDevice_RegisterHotReloadListener(pDevCtx);
+			ConfigWatcherRegisterDevice(pDevCtx);
 		}
 	}
 
@@ -147,17 +147,19 @@ NTSTATUS DsHidMini_EvtDeviceD0Exit(
 	//
 	DMF_ThreadedBufferQueue_Stop(pDevCtx->OutputReport.Worker);
 
-	if (pDevCtx->ConfigurationDirectoryWatcherWaitHandle)
-	{
-		UnregisterWait(pDevCtx->ConfigurationDirectoryWatcherWaitHandle);
-		pDevCtx->ConfigurationDirectoryWatcherWaitHandle = NULL;
-	}
+	//
+	// Final output path summary of this session
+	// 
+	DSHM_OutputReportTelemetryTrace(pDevCtx);
 
-	if (pDevCtx->ConfigurationDirectoryWatcherEvent)
-	{
-		CloseHandle(pDevCtx->ConfigurationDirectoryWatcherEvent);
-		pDevCtx->ConfigurationDirectoryWatcherEvent = NULL;
-	}
+#ifdef DSHM_FEATURE_FFB
+	//
+	// No more effect rendering until the host sends new PID reports
+	// 
+	DSHM_FfbStop(pDevCtx);
+#endif
+
+	ConfigWatcherUnregisterDevice(pDevCtx);
 
 	if (pDevCtx->ConnectionType == DsDeviceConnectionTypeUsb)
 	{
@@ -166,6 +168,8 @@ NTSTATUS DsHidMini_EvtDeviceD0Exit(
 
 	if (pDevCtx->ConnectionType == DsDeviceConnectionTypeBth)
 	{
+		DSHM_BthAirtimeUnregister(pDevCtx);
+
 		WdfIoTargetPurge(
 			pDevCtx->Connection.Bth.HidInterrupt.InputStreamerIoTarget,
 			WdfIoTargetPurgeIoAndWait
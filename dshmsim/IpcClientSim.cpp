@@ -0,0 +1,1131 @@
+//
+// Runs the header-only IPC client against a fake driver loop that serves the
+// same shared memory layout through the POSIX transport
+//
+
+#include "../driver/DsPortable.h"
+#include "../include/DsHidMini/IpcClient.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+#ifndef _WIN32
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+extern "C" int SimIpcClient(int argc, char* argv[]);
+
+#ifndef _WIN32
+
+using namespace DsHidMini::Ipc;
+
+#define SIM_CLIENT_MAX_PADS				16
+#define SIM_CLIENT_MAX_PINGERS			16
+#define SIM_CLIENT_HISTORY_DEPTH		64
+#define SIM_CLIENT_OUTPUT_REQUESTS		2000
+#define SIM_CLIENT_COUNTERS_FREQUENCY	1000000000LL
+#define SIM_CLIENT_MAINTENANCE_MS		20
+
+#define SIM_STATUS_SUCCESS				((NTSTATUS)0x00000000L)
+#define SIM_STATUS_INVALID_PARAMETER	((NTSTATUS)0xC000000DL)
+#define SIM_STATUS_NOT_IMPLEMENTED		((NTSTATUS)0xC0000002L)
+
+static ULONG SimRoundUp(SIZE_T Size, ULONG Granularity)
+{
+	return (ULONG)((Size + Granularity - 1) / Granularity * Granularity);
+}
+
+//
+// Stand-in for the driver side: creates the regions the way InitIPC does,
+// answers commands like the dispatch thread and produces input reports
+//
+class SimFakeDriver
+{
+public:
+	SimFakeDriver(const std::string& Prefix, ULONG PadCount) : Link(Prefix), PadCount(PadCount) {}
+
+	~SimFakeDriver()
+	{
+		Stop();
+
+		if (Base != nullptr)
+		{
+			Link.UnmapView(Base, TotalSize);
+		}
+	}
+
+	bool Start()
+	{
+		const ULONG granularity = PosixTransport::AllocationGranularity;
+		const ULONG historyOffset = granularity * 2;
+		const ULONG historySize = SimRoundUp(
+			DSHM_IPC_HID_HISTORY_SIZE(SIM_CLIENT_HISTORY_DEPTH) * DSHM_IPC_HID_SLOT_COUNT,
+			granularity
+		);
+		const ULONG outputOffset = historyOffset + historySize;
+		const ULONG outputSize = SimRoundUp(DSHM_IPC_OUTPUT_REGION_SIZE, granularity);
+		const ULONG countersOffset = outputOffset + outputSize;
+		const ULONG countersSize = SimRoundUp(DSHM_IPC_COUNTERS_REGION_SIZE, granularity);
+
+		TotalSize = countersOffset + countersSize;
+
+		if (!Link.Create(TotalSize) || (Base = Link.MapView(0, TotalSize, true)) == nullptr)
+		{
+			return false;
+		}
+
+		CommandRingEvent = Link.CreateNamedEvent(DSHM_IPC_CMD_RING_EVENT_NAME);
+		OutputRingEvent = Link.CreateNamedEvent(DSHM_IPC_OUTPUT_RING_EVENT_NAME);
+		InputChangedEvent = Link.CreateNamedEvent(DSHM_IPC_HID_CHANGED_EVENT_NAME);
+
+		for (ULONG index = 0; index < DSHM_IPC_CMD_SLOT_COUNT; index++)
+		{
+			const std::string name = DSHM_IPC_CMD_REPLY_EVENT_PREFIX + std::to_string(index);
+
+			if (!(ReplyEvents[index] = Link.CreateNamedEvent(name.c_str())))
+			{
+				return false;
+			}
+		}
+
+		for (ULONG pad = 1; pad <= PadCount; pad++)
+		{
+			if (!(InputEvents[pad - 1] = Link.CreateNamedEvent(PosixTransport::RemoteEventName(WaitHandle(pad)).c_str())))
+			{
+				return false;
+			}
+		}
+
+		if (!CommandRingEvent || !OutputRingEvent || !InputChangedEvent)
+		{
+			return false;
+		}
+
+		Commands = Base;
+		Hid = Base + granularity;
+		History = Base + historyOffset;
+
+		DSHM_IPC_CMD_RING_INIT(DSHM_IPC_CMD_RING(Commands));
+		DSHM_IPC_OUTPUT_REGION_INIT(reinterpret_cast<PIPC_OUTPUT_REGION_HEADER>(Base + outputOffset));
+		DSHM_IPC_COUNTERS_REGION_INIT(reinterpret_cast<PIPC_COUNTERS_REGION_HEADER>(Base + countersOffset), SIM_CLIENT_COUNTERS_FREQUENCY);
+
+		const PIPC_HID_REGION_HEADER header = DSHM_IPC_HID_HEADER(Hid);
+
+		header->Version = DSHM_IPC_HID_VERSION;
+		header->Size = sizeof(IPC_HID_REGION_HEADER);
+		header->SlotCount = DSHM_IPC_HID_SLOT_COUNT;
+		header->SlotsOffset = 0;
+		header->SlotStride = DSHM_IPC_HID_SLOT_STRIDE;
+		header->SequenceOffset = FIELD_OFFSET(IPC_HID_SLOT, Sequence);
+		header->HistoryDepth = SIM_CLIENT_HISTORY_DEPTH;
+		header->HistoryStride = (UINT32)DSHM_IPC_HID_HISTORY_SIZE(SIM_CLIENT_HISTORY_DEPTH);
+		header->HistoryOffset = historyOffset;
+		header->TimestampFrequency = 1;
+		header->OutputOffset = outputOffset;
+		header->OutputSize = outputSize;
+		header->StateOffset = DSHM_IPC_HID_STATE_OFFSET;
+		header->StateStride = DSHM_IPC_HID_STATE_STRIDE;
+		header->CountersOffset = countersOffset;
+		header->CountersSize = countersSize;
+
+		Counters = reinterpret_cast<PIPC_COUNTERS_REGION_HEADER>(Base + countersOffset);
+
+		for (ULONG pad = 1; pad <= PadCount; pad++)
+		{
+			DSHM_IPC_COUNTERS_CLAIM(DSHM_IPC_COUNTERS_SLOT(Counters, pad), pad);
+		}
+
+		DSHM_IPC_WRITE_BARRIER();
+		DSHM_IPC_STORE32(&header->Magic, DSHM_IPC_HID_MAGIC);
+
+		Output = reinterpret_cast<PIPC_OUTPUT_REGION_HEADER>(Base + outputOffset);
+
+		Dispatcher = std::thread(&SimFakeDriver::DispatchLoop, this);
+		Producer = std::thread(&SimFakeDriver::ProduceLoop, this);
+
+		return true;
+	}
+
+	void Stop()
+	{
+		IsStopping = true;
+
+		if (Dispatcher.joinable())
+		{
+			Dispatcher.join();
+		}
+
+		if (Producer.joinable())
+		{
+			Producer.join();
+		}
+	}
+
+	//
+	// Pad unplugged and plugged in again, like DsHidMini_DeviceCleanup
+	// followed by DsDevice_InitContext
+	//
+	void Reclaim(ULONG Pad)
+	{
+		DSHM_IPC_COUNTERS_RELEASE(DSHM_IPC_COUNTERS_SLOT(Counters, Pad));
+		DSHM_IPC_COUNTERS_CLAIM(DSHM_IPC_COUNTERS_SLOT(Counters, Pad), Pad);
+	}
+
+	//
+	// Client that claimed a slot and a queue cell, then died before
+	// publishing the cell; DSHM_IPC_CMD_SUBMIT cut short
+	//
+	bool SubmitAndDie(ULONG ProcessId, ULONG& SlotIndex)
+	{
+		const PIPC_CMD_RING_HEADER ring = DSHM_IPC_CMD_RING(Commands);
+
+		if (!DSHM_IPC_CMD_SLOT_ACQUIRE(ring, ProcessId, &SlotIndex))
+		{
+			return false;
+		}
+
+		DSHM_IPC_STORE32(&DSHM_IPC_CMD_SLOT(ring, SlotIndex)->State, DSHM_IPC_CMD_SLOT_STATE_SUBMITTED);
+
+		const ULONG position = DSHM_IPC_LOAD32(&ring->Tail);
+
+		return DSHM_IPC_CAS32(&ring->Tail, position, position + 1);
+	}
+
+	bool IsSlotOwned(ULONG SlotIndex) const
+	{
+		return DSHM_IPC_LOAD32(&DSHM_IPC_CMD_SLOT(DSHM_IPC_CMD_RING(Commands), SlotIndex)->OwnerProcessId) != 0;
+	}
+
+	static HANDLE WaitHandle(ULONG Pad)
+	{
+		return reinterpret_cast<HANDLE>(static_cast<uintptr_t>(0x100 + Pad));
+	}
+
+	std::atomic<ULONGLONG> CommandsServed{ 0 };
+	std::atomic<ULONGLONG> CellsSkipped{ 0 };
+	std::atomic<ULONGLONG> BatchesServed{ 0 };
+	std::atomic<ULONGLONG> OutputRequestsApplied{ 0 };
+	std::atomic<ULONGLONG> OutputReportsSent{ 0 };
+	std::atomic<ULONG> LastLargeMotorStrength{ 0 };
+	std::atomic<ULONGLONG> Reports{ 0 };
+	std::atomic<ULONGLONG> ChangedSignals{ 0 };
+	DSHM_IPC_BD_ADDR HostAddress[SIM_CLIENT_MAX_PADS]{};
+	UCHAR PlayerIndex[SIM_CLIENT_MAX_PADS]{};
+
+private:
+	//
+	// Like DSHM_IPC_DispatchBatchMessage
+	//
+	void DispatchBatch(PDSHM_IPC_MSG_HEADER Message, UINT32 MaxSize)
+	{
+		const auto batch = reinterpret_cast<PDSHM_IPC_MSG_BATCH_REQUEST>(Message);
+		const UINT32 size = Message->Size;
+		UINT32 offsets[DSHM_IPC_MSG_BATCH_MAX_COUNT + 1];
+		UINT32 count;
+
+		if (size > MaxSize || !DSHM_IPC_MSG_BATCH_PARSE(batch, size, offsets, &count))
+		{
+			return;
+		}
+
+		for (UINT32 index = 0; index < count; index++)
+		{
+			const auto entry = reinterpret_cast<PDSHM_IPC_MSG_BATCH_ENTRY>(reinterpret_cast<PUCHAR>(Message) + offsets[index]);
+			const PDSHM_IPC_MSG_HEADER command = DSHM_IPC_MSG_BATCH_ENTRY_MESSAGE(entry);
+
+			entry->Status = DSHM_IPC_MSG_IS_BATCH(command)
+				? SIM_STATUS_INVALID_PARAMETER
+				: Dispatch(command, offsets[index + 1] - offsets[index] - sizeof(DSHM_IPC_MSG_BATCH_ENTRY));
+		}
+
+		DSHM_IPC_MSG_BATCH_RESPONSE_INIT(batch, size, count);
+		BatchesServed++;
+	}
+
+	NTSTATUS Dispatch(PDSHM_IPC_MSG_HEADER Message, UINT32 MaxSize)
+	{
+		if (Message->Size < sizeof(DSHM_IPC_MSG_HEADER) || Message->Size > MaxSize)
+		{
+			return SIM_STATUS_INVALID_PARAMETER;
+		}
+
+		if (DSHM_IPC_MSG_IS_PING(Message))
+		{
+			DSHM_IPC_MSG_PING_RESPONSE_INIT(Message);
+			return SIM_STATUS_SUCCESS;
+		}
+
+		if (Message->Target != DSHM_IPC_MSG_TARGET_DEVICE || Message->TargetIndex == 0 || Message->TargetIndex > PadCount)
+		{
+			return SIM_STATUS_NOT_IMPLEMENTED;
+		}
+
+		const ULONG pad = Message->TargetIndex;
+
+		switch (Message->Command.Device)
+		{
+		case DSHM_IPC_MSG_CMD_DEVICE_PAIR_TO:
+			if (Message->Size >= sizeof(DSHM_IPC_MSG_PAIR_TO_REQUEST))
+			{
+				HostAddress[pad - 1] = reinterpret_cast<PDSHM_IPC_MSG_PAIR_TO_REQUEST>(Message)->Address;
+				DSHM_IPC_MSG_PAIR_TO_RESPONSE_INIT(
+					reinterpret_cast<PDSHM_IPC_MSG_PAIR_TO_REPLY>(Message), pad, SIM_STATUS_SUCCESS, SIM_STATUS_SUCCESS
+				);
+			}
+			break;
+		case DSHM_IPC_MSG_CMD_DEVICE_SET_PLAYER_INDEX:
+			if (Message->Size >= sizeof(DSHM_IPC_MSG_SET_PLAYER_INDEX_REQUEST))
+			{
+				const UCHAR index = reinterpret_cast<PDSHM_IPC_MSG_SET_PLAYER_INDEX_REQUEST>(Message)->PlayerIndex;
+				const bool isValid = index >= 1 && index <= 7;
+
+				if (isValid)
+				{
+					PlayerIndex[pad - 1] = index;
+				}
+
+				DSHM_IPC_MSG_SET_PLAYER_INDEX_RESPONSE_INIT(
+					reinterpret_cast<PDSHM_IPC_MSG_SET_PLAYER_INDEX_REPLY>(Message),
+					pad,
+					isValid ? SIM_STATUS_SUCCESS : SIM_STATUS_INVALID_PARAMETER
+				);
+			}
+			break;
+		case DSHM_IPC_MSG_CMD_DEVICE_GET_HID_WAIT_HANDLE:
+			DSHM_IPC_MSG_GET_HID_WAIT_HANDLE_RESPONSE_INIT(
+				reinterpret_cast<PDSHM_IPC_MSG_GET_HID_WAIT_HANDLE_RESPONSE>(Message),
+				pad,
+				static_cast<DWORD>(getpid()),
+				WaitHandle(pad)
+			);
+			break;
+		default:
+			return SIM_STATUS_NOT_IMPLEMENTED;
+		}
+
+		return SIM_STATUS_SUCCESS;
+	}
+
+	void DrainOutputRings()
+	{
+		for (ULONG pad = 1; pad <= PadCount; pad++)
+		{
+			const PIPC_OUTPUT_RING ring = DSHM_IPC_OUTPUT_RING(Output, pad);
+			ULONG tail;
+			const ULONG pending = DSHM_IPC_OUTPUT_RING_PENDING(ring, &tail);
+
+			if (pending == 0)
+			{
+				continue;
+			}
+
+			// folded into one report, like DSHM_DispatchDeviceOutputRequests
+			for (ULONG index = tail - pending; index != tail; index++)
+			{
+				const IPC_OUTPUT_REQUEST request = ring->Requests[index & (DSHM_IPC_OUTPUT_RING_DEPTH - 1)];
+
+				if (request.Fields & DSHM_IPC_OUTPUT_FIELD_LARGE_MOTOR_STRENGTH)
+				{
+					LastLargeMotorStrength = request.LargeMotorStrength;
+				}
+			}
+
+			DSHM_IPC_OUTPUT_RING_CONSUME(ring, tail);
+
+			DSHM_IPC_COUNTER_INCREMENT(&DSHM_IPC_COUNTERS_SLOT(Counters, pad)->OutputReports);
+
+			OutputRequestsApplied += pending;
+			OutputReportsSent++;
+		}
+	}
+
+	//
+	// Like DSHM_IPC_RecoverCommandQueue and DSHM_IPC_ReclaimCommandRingSlots
+	//
+	void Maintain(bool& IsStalled, ULONG& StalledPosition)
+	{
+		const PIPC_CMD_RING_HEADER ring = DSHM_IPC_CMD_RING(Commands);
+		ULONG position;
+
+		if (!DSHM_IPC_CMD_IS_STALLED(ring, &position))
+		{
+			IsStalled = false;
+		}
+		else if (!IsStalled || StalledPosition != position)
+		{
+			IsStalled = true;
+			StalledPosition = position;
+		}
+		else
+		{
+			IsStalled = false;
+
+			if (DSHM_IPC_CMD_SKIP(ring, position))
+			{
+				CellsSkipped++;
+			}
+		}
+
+		for (ULONG slotIndex = 0; slotIndex < ring->SlotCount; slotIndex++)
+		{
+			const ULONG ownerProcessId = DSHM_IPC_LOAD32(&DSHM_IPC_CMD_SLOT(ring, slotIndex)->OwnerProcessId);
+
+			if (ownerProcessId == 0
+				|| kill(static_cast<pid_t>(ownerProcessId), 0) == 0 || errno != ESRCH
+				|| DSHM_IPC_CMD_IS_QUEUED(ring, slotIndex))
+			{
+				continue;
+			}
+
+			(void)DSHM_IPC_CAS32(&DSHM_IPC_CMD_SLOT(ring, slotIndex)->OwnerProcessId, ownerProcessId, 0);
+		}
+	}
+
+	void DispatchLoop()
+	{
+		const PIPC_CMD_RING_HEADER ring = DSHM_IPC_CMD_RING(Commands);
+		auto lastMaintenance = std::chrono::steady_clock::now();
+		bool isStalled = false;
+		ULONG stalledPosition = 0;
+
+		while (!IsStopping)
+		{
+			ULONG slotIndex;
+
+			(void)CommandRingEvent->Wait(1);
+
+			if (std::chrono::steady_clock::now() - lastMaintenance >= std::chrono::milliseconds(SIM_CLIENT_MAINTENANCE_MS))
+			{
+				lastMaintenance = std::chrono::steady_clock::now();
+
+				Maintain(isStalled, stalledPosition);
+			}
+
+			while (DSHM_IPC_CMD_DEQUEUE(ring, &slotIndex))
+			{
+				if (slotIndex >= ring->SlotCount)
+				{
+					continue;
+				}
+
+				const PDSHM_IPC_MSG_HEADER message = reinterpret_cast<PDSHM_IPC_MSG_HEADER>(DSHM_IPC_CMD_SLOT(ring, slotIndex)->Message);
+
+				if (DSHM_IPC_MSG_IS_BATCH(message))
+				{
+					DispatchBatch(message, DSHM_IPC_CMD_MESSAGE_MAX);
+				}
+				else
+				{
+					(void)Dispatch(message, DSHM_IPC_CMD_MESSAGE_MAX);
+				}
+
+				CommandsServed++;
+
+				if (DSHM_IPC_CMD_COMPLETE(ring, slotIndex))
+				{
+					ReplyEvents[slotIndex]->Signal();
+				}
+			}
+
+			(void)OutputRingEvent->Wait(0);
+
+			DrainOutputRings();
+		}
+	}
+
+	//
+	// Every pad reports every 250 us; report N of a pad is filled with N and
+	// carries N as its timestamp, so readers can tell torn or missing copies.
+	// States get the thumb axes flipped, as if configured so.
+	//
+	void ProduceLoop()
+	{
+		const PIPC_HID_REGION_HEADER header = DSHM_IPC_HID_HEADER(Hid);
+		ULONGLONG count = 0;
+
+		while (!IsStopping)
+		{
+			for (ULONG pad = 1; pad <= PadCount; pad++)
+			{
+				const PIPC_HID_SLOT slot = DSHM_IPC_HID_SLOT(Hid, pad);
+				const auto begin = std::chrono::steady_clock::now();
+				ULONG sequence;
+
+				if (!DSHM_IPC_HID_WRITE_BEGIN(Hid, pad, &sequence))
+				{
+					continue;
+				}
+
+				slot->Message.SlotIndex = pad;
+				memset(&slot->Message.InputReport, (UCHAR)count, sizeof(DS3_RAW_INPUT_REPORT));
+
+				const PIPC_HID_STATE state = DSHM_IPC_HID_STATE(Hid, pad);
+
+				state->Timestamp = (LONGLONG)count;
+				state->Buttons = slot->Message.InputReport.Buttons.lButtons;
+				state->LeftThumbX = state->LeftThumbY = state->RightThumbX = state->RightThumbY = (UCHAR)(0xFF - (UCHAR)count);
+				memset(state->Pressure, (UCHAR)count, sizeof(state->Pressure));
+
+				DSHM_IPC_HID_HISTORY_APPEND(
+					DSHM_IPC_HID_HISTORY_RING(History, header, pad),
+					SIM_CLIENT_HISTORY_DEPTH,
+					&slot->Message.InputReport,
+					(LONGLONG)count
+				);
+
+				DSHM_IPC_HID_WRITE_END(Hid, pad, sequence);
+
+				const PIPC_DEVICE_COUNTERS counters = DSHM_IPC_COUNTERS_SLOT(Counters, pad);
+
+				DSHM_IPC_COUNTER_INCREMENT(&counters->InputReports);
+				DSHM_IPC_COUNTER_ADD(
+					&counters->ProcessingTicks,
+					std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count()
+				);
+
+				InputEvents[pad - 1]->Signal();
+
+				if (DSHM_IPC_HID_MARK_CHANGED(Hid, pad))
+				{
+					InputChangedEvent->Signal();
+					ChangedSignals++;
+				}
+			}
+
+			Reports += PadCount;
+
+			count++;
+
+			std::this_thread::sleep_for(std::chrono::microseconds(250));
+		}
+	}
+
+	PosixTransport Link;
+	ULONG PadCount;
+	ULONG TotalSize{};
+	PUCHAR Base{};
+	PUCHAR Commands{};
+	PUCHAR Hid{};
+	PUCHAR History{};
+	PIPC_OUTPUT_REGION_HEADER Output{};
+	PIPC_COUNTERS_REGION_HEADER Counters{};
+
+	std::unique_ptr<Event> CommandRingEvent;
+	std::unique_ptr<Event> OutputRingEvent;
+	std::unique_ptr<Event> InputChangedEvent;
+	std::unique_ptr<Event> ReplyEvents[DSHM_IPC_CMD_SLOT_COUNT];
+	std::unique_ptr<Event> InputEvents[SIM_CLIENT_MAX_PADS];
+
+	std::atomic<bool> IsStopping{ false };
+	std::thread Dispatcher;
+	std::thread Producer;
+};
+
+//
+// Per thread results, a cache line each
+//
+struct alignas(64) SimClientWorker
+{
+	ULONGLONG Operations;
+	ULONGLONG Failures;
+	ULONGLONG Lost;
+	double MaxLatencyUs;
+	double TotalLatencyUs;
+};
+
+static bool SimClientCheck(bool Condition, const char* What, ULONG& Failed)
+{
+	printf("%-44s %s\n", What, Condition ? "ok" : "FAILED");
+
+	if (!Condition)
+	{
+		Failed++;
+	}
+
+	return Condition;
+}
+
+//
+// Drains a pad's input history for the whole run, verifying every copy
+// against the position it was taken from
+//
+static void SimClientDrain(Client& Session, ULONG Pad, const std::atomic<bool>& IsStopping, SimClientWorker& Worker)
+{
+	IPC_HID_HISTORY_ENTRY entries[16];
+	ULONGLONG cursor = Session.GetInputHistoryPosition(Pad);
+
+	while (!IsStopping)
+	{
+		ULONGLONG lost;
+		const ULONG count = Session.DrainInputHistory(Pad, cursor, entries, 16, lost);
+
+		for (ULONG index = 0; index < count; index++)
+		{
+			const PUCHAR bytes = reinterpret_cast<PUCHAR>(&entries[index].InputReport);
+			const ULONGLONG position = cursor - count + index;
+			bool isIntact = (ULONGLONG)entries[index].Timestamp == position;
+
+			for (SIZE_T offset = 0; offset < sizeof(DS3_RAW_INPUT_REPORT) && isIntact; offset++)
+			{
+				isIntact = bytes[offset] == (UCHAR)position;
+			}
+
+			if (!isIntact)
+			{
+				Worker.Failures++;
+			}
+		}
+
+		Worker.Operations += count;
+		Worker.Lost += lost;
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+}
+
+//
+// Single reader of the driver-wide event, counts wakes and the pads seen
+//
+static void SimClientWatch(
+	Client& Session,
+	ULONG PadCount,
+	const std::atomic<bool>& IsStopping,
+	SimClientWorker& Worker,
+	std::vector<ULONGLONG>& Seen
+)
+{
+	ULONGLONG changed[DSHM_IPC_HID_CHANGED_WORDS];
+
+	while (!IsStopping)
+	{
+		if (Session.WaitForInputChanges(changed, 10) != Result::Success)
+		{
+			continue;
+		}
+
+		Worker.Operations++;
+
+		for (ULONG word = 0; word < DSHM_IPC_HID_CHANGED_WORDS; word++)
+		{
+			for (ULONGLONG bits = changed[word]; bits != 0; bits &= bits - 1)
+			{
+				const ULONG pad = word * 64 + DS_BIT_SCAN_FORWARD64(bits) + 1;
+
+				if (pad > PadCount)
+				{
+					Worker.Failures++;
+					continue;
+				}
+
+				Seen[pad - 1]++;
+			}
+		}
+
+		// batches the changes of a few reports per wake, like a polling consumer would
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+}
+
+//
+// Samples the counters of every pad like a monitoring agent would, only much
+// more often; within a generation no counter may ever go backwards
+//
+static void SimClientSample(
+	Client& Session,
+	ULONG PadCount,
+	const std::atomic<bool>& IsStopping,
+	SimClientWorker& Worker
+)
+{
+	std::vector<IPC_DEVICE_COUNTERS> previous(PadCount);
+
+	while (!IsStopping)
+	{
+		for (ULONG pad = 1; pad <= PadCount; pad++)
+		{
+			IPC_DEVICE_COUNTERS sample;
+			IPC_DEVICE_COUNTERS& last = previous[pad - 1];
+
+			if (Session.ReadDeviceCounters(pad, sample) != Result::Success)
+			{
+				continue;
+			}
+
+			Worker.Operations++;
+
+			if (sample.Generation == last.Generation
+				&& (sample.InputReports < last.InputReports
+					|| sample.OutputReports < last.OutputReports
+					|| sample.ProcessingTicks < last.ProcessingTicks))
+			{
+				Worker.Failures++;
+			}
+
+			if (sample.Generation != last.Generation && last.Generation != 0)
+			{
+				Worker.Lost++;
+			}
+
+			last = sample;
+		}
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+}
+
+//
+// Feeds DSHM_IPC_MSG_BATCH_PARSE broken framings
+//
+static bool SimClientCheckBatchFraming()
+{
+	struct
+	{
+		DSHM_IPC_MSG_BATCH_REQUEST Request;
+		DSHM_IPC_MSG_BATCH_ENTRY Entries[2];
+		UCHAR Messages[2][DSHM_IPC_MSG_BATCH_MESSAGE_MIN];
+	} batch{};
+	UINT32 offsets[DSHM_IPC_MSG_BATCH_MAX_COUNT + 1];
+	UINT32 count;
+	const UINT32 entrySize = DSHM_IPC_MSG_BATCH_ENTRY_SIZE_MIN;
+	const UINT32 size = sizeof(DSHM_IPC_MSG_BATCH_REQUEST) + entrySize * 2;
+	const auto entry = [&](ULONG Index)
+	{
+		return reinterpret_cast<PDSHM_IPC_MSG_BATCH_ENTRY>(reinterpret_cast<PUCHAR>(&batch) + sizeof(DSHM_IPC_MSG_BATCH_REQUEST) + entrySize * Index);
+	};
+	const auto parse = [&](UINT32 Count, UINT32 FirstSize, UINT32 SecondSize, UINT32 Size)
+	{
+		batch.Request.Count = Count;
+		entry(0)->Size = FirstSize;
+		entry(1)->Size = SecondSize;
+
+		return DSHM_IPC_MSG_BATCH_PARSE(&batch.Request, Size, offsets, &count);
+	};
+
+	static_assert(sizeof(batch) >= size);
+
+	return parse(2, entrySize, entrySize, size) && count == 2 && offsets[1] == sizeof(DSHM_IPC_MSG_BATCH_REQUEST) + entrySize && offsets[2] == size
+		&& !parse(0, entrySize, entrySize, size)
+		&& !parse(DSHM_IPC_MSG_BATCH_MAX_COUNT + 1, entrySize, entrySize, size)
+		&& !parse(3, entrySize, entrySize, size)
+		&& !parse(2, entrySize, entrySize, size + 8)
+		&& !parse(2, entrySize, entrySize, size - 8)
+		&& !parse(2, entrySize - 8, entrySize, size - 8)
+		&& !parse(2, entrySize + 4, entrySize - 4, size)
+		&& !parse(2, entrySize, 0xFFFFFFF8, size)
+		&& !parse(1, entrySize, entrySize, sizeof(DSHM_IPC_MSG_BATCH_REQUEST) - 1)
+		&& count == 0;
+}
+
+static void SimClientPing(Client& Session, const std::atomic<bool>& IsStopping, SimClientWorker& Worker)
+{
+	while (!IsStopping)
+	{
+		const auto begin = std::chrono::steady_clock::now();
+		const Result result = Session.Ping();
+		const double latencyUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - begin).count();
+
+		if (result == Result::Success)
+		{
+			Worker.Operations++;
+			Worker.TotalLatencyUs += latencyUs;
+			Worker.MaxLatencyUs = std::max(Worker.MaxLatencyUs, latencyUs);
+		}
+		else if (result != Result::Busy)
+		{
+			Worker.Failures++;
+		}
+	}
+}
+
+int SimIpcClient(int argc, char* argv[])
+{
+	ULONG padCount = 4;
+	ULONG pingerCount = 4;
+	ULONG durationMs = 1000;
+	ULONG failed = 0;
+
+	if (argc > 0)
+	{
+		padCount = strtoul(argv[0], NULL, 10);
+	}
+
+	if (argc > 1)
+	{
+		pingerCount = strtoul(argv[1], NULL, 10);
+	}
+
+	if (argc > 2)
+	{
+		durationMs = strtoul(argv[2], NULL, 10);
+	}
+
+	if (padCount == 0 || padCount > SIM_CLIENT_MAX_PADS || pingerCount == 0 || pingerCount > SIM_CLIENT_MAX_PINGERS)
+	{
+		printf("Pad count must be between 1 and %d, pinger count between 1 and %d\n", SIM_CLIENT_MAX_PADS, SIM_CLIENT_MAX_PINGERS);
+		return EXIT_FAILURE;
+	}
+
+	const std::string prefix = "dshmsim-" + std::to_string(getpid()) + "-";
+	SimFakeDriver driver(prefix, padCount);
+	PosixTransport link(prefix);
+	Client session(link);
+
+	if (!SimClientCheck(session.Connect() == Result::Unavailable, "connect without driver", failed))
+	{
+		return EXIT_FAILURE;
+	}
+
+	if (!driver.Start())
+	{
+		printf("Can't set up the fake driver\n");
+		return EXIT_FAILURE;
+	}
+
+	if (!SimClientCheck(session.Connect() == Result::Success, "connect", failed)
+		|| !SimClientCheck(session.HasCommands() && session.HasInputHistory() && session.HasOutputChannel(), "regions advertised", failed))
+	{
+		return EXIT_FAILURE;
+	}
+
+	SimClientCheck(session.Ping() == Result::Success, "ping", failed);
+
+	IPC_DEVICE_COUNTERS counters;
+
+	SimClientCheck(
+		session.HasCounters() && session.GetCountersFrequency() == SIM_CLIENT_COUNTERS_FREQUENCY
+		&& session.ReadDeviceCounters(padCount, counters) == Result::Success
+		&& counters.SlotIndex == (LONG)padCount && counters.Generation == 2
+		&& session.ReadDeviceCounters(padCount + 1, counters) == Result::Busy,
+		"device counters",
+		failed
+	);
+
+	const DSHM_IPC_BD_ADDR address = { { 0x00, 0x1A, 0x7D, 0xDA, 0x71, 0x13 } };
+	NTSTATUS writeStatus = -1, readStatus = -1, status = -1;
+
+	SimClientCheck(
+		session.PairTo(1, address, writeStatus, readStatus) == Result::Success
+		&& writeStatus == SIM_STATUS_SUCCESS && readStatus == SIM_STATUS_SUCCESS
+		&& memcmp(&driver.HostAddress[0], &address, sizeof(address)) == 0,
+		"pair to",
+		failed
+	);
+
+	SimClientCheck(
+		session.SetPlayerIndex(padCount, 3, status) == Result::Success && status == SIM_STATUS_SUCCESS
+		&& driver.PlayerIndex[padCount - 1] == 3,
+		"set player index",
+		failed
+	);
+
+	SimClientCheck(
+		session.SetPlayerIndex(1, 9, status) == Result::Success && status == SIM_STATUS_INVALID_PARAMETER,
+		"set player index out of range",
+		failed
+	);
+
+	SimClientCheck(session.SetPlayerIndex(0, 1, status) == Result::InvalidParameter, "device index 0 rejected", failed);
+
+	//
+	// More commands than fit into one slot, the last one for a pad that
+	// isn't there and one with an invalid player index
+	//
+	ULONG batchIndexes[30];
+	UCHAR batchPlayers[ARRAYSIZE(batchIndexes)];
+	NTSTATUS batchStatuses[ARRAYSIZE(batchIndexes)], batchReadStatuses[ARRAYSIZE(batchIndexes)];
+	const ULONGLONG batchesBefore = driver.BatchesServed, commandsBefore = driver.CommandsServed;
+
+	for (ULONG index = 0; index < ARRAYSIZE(batchIndexes); index++)
+	{
+		batchIndexes[index] = index % padCount + 1;
+		batchPlayers[index] = (UCHAR)(index % 7 + 1);
+	}
+
+	batchIndexes[ARRAYSIZE(batchIndexes) - 1] = padCount + 1;
+	batchPlayers[0] = 0;
+
+	bool isBatchIntact = session.HasCommandBatches()
+		&& session.SetPlayerIndex(batchIndexes, batchPlayers, ARRAYSIZE(batchIndexes), batchStatuses) == Result::Success
+		&& driver.BatchesServed - batchesBefore == 2 && driver.CommandsServed - commandsBefore == 2
+		&& batchStatuses[0] == SIM_STATUS_INVALID_PARAMETER
+		&& batchStatuses[ARRAYSIZE(batchIndexes) - 1] == SIM_STATUS_NOT_IMPLEMENTED;
+
+	for (ULONG index = 1; index < ARRAYSIZE(batchIndexes) - 1 && isBatchIntact; index++)
+	{
+		isBatchIntact = batchStatuses[index] == SIM_STATUS_SUCCESS;
+	}
+
+	for (ULONG pad = 1; pad <= padCount && isBatchIntact; pad++)
+	{
+		// the last command for the pad wins
+		ULONG last = 0;
+
+		for (ULONG index = 1; index < ARRAYSIZE(batchIndexes) - 1; index++)
+		{
+			last = batchIndexes[index] == pad ? index : last;
+		}
+
+		isBatchIntact = last == 0 || driver.PlayerIndex[pad - 1] == batchPlayers[last];
+	}
+
+	SimClientCheck(isBatchIntact, "batched set player index", failed);
+
+	const DSHM_IPC_BD_ADDR batchAddress = { { 0x00, 0x1B, 0xDC, 0x0F, 0xAA, 0x55 } };
+
+	isBatchIntact = session.PairTo(batchIndexes, padCount, batchAddress, batchStatuses, batchReadStatuses) == Result::Success;
+
+	for (ULONG index = 0; index < padCount && isBatchIntact; index++)
+	{
+		isBatchIntact = batchStatuses[index] == SIM_STATUS_SUCCESS && batchReadStatuses[index] == SIM_STATUS_SUCCESS
+			&& memcmp(&driver.HostAddress[index], &batchAddress, sizeof(batchAddress)) == 0;
+	}
+
+	SimClientCheck(isBatchIntact, "batched pair to", failed);
+
+	SimClientCheck(SimClientCheckBatchFraming(), "batch framing checked", failed);
+
+	//
+	// A client that died halfway through submitting must neither hold up the
+	// clients queued behind it nor keep its slot
+	//
+	const pid_t deadProcessId = fork();
+
+	if (deadProcessId == 0)
+	{
+		_exit(0);
+	}
+
+	(void)waitpid(deadProcessId, nullptr, 0);
+
+	ULONG deadSlot = 0;
+
+	SimClientCheck(
+		deadProcessId > 0 && driver.SubmitAndDie(static_cast<ULONG>(deadProcessId), deadSlot)
+		&& session.Ping() == Result::Success && driver.CellsSkipped == 1,
+		"stalled queue cell skipped",
+		failed
+	);
+
+	for (ULONG wait = 0; wait < 50 && driver.IsSlotOwned(deadSlot); wait++)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(SIM_CLIENT_MAINTENANCE_MS));
+	}
+
+	SimClientCheck(!driver.IsSlotOwned(deadSlot), "dead client's slot reclaimed", failed);
+
+	std::unique_ptr<Event> inputEvent;
+
+	if (SimClientCheck(session.GetInputReportEvent(1, inputEvent) == Result::Success, "input report wait handle", failed))
+	{
+		SimClientCheck(inputEvent->Wait(100), "input report signaled", failed);
+	}
+
+	IPC_HID_INPUT_REPORT_MESSAGE message;
+	ULONG sequence = 0, previous = 0;
+	bool isIntact = true;
+
+	for (ULONG read = 0; read < 100 && isIntact; read++)
+	{
+		isIntact = session.ReadInputReport(1, message, sequence) == Result::Success && message.SlotIndex == 1;
+
+		const PUCHAR bytes = reinterpret_cast<PUCHAR>(&message.InputReport);
+
+		for (SIZE_T offset = 1; offset < sizeof(DS3_RAW_INPUT_REPORT) && isIntact; offset++)
+		{
+			isIntact = bytes[offset] == bytes[0];
+		}
+
+		isIntact = isIntact && (sequence & 1) == 0 && sequence >= previous;
+		previous = sequence;
+	}
+
+	SimClientCheck(isIntact, "input report snapshots", failed);
+
+	IPC_HID_STATE state;
+
+	isIntact = true;
+
+	for (ULONG read = 0; read < 100 && isIntact; read++)
+	{
+		ULONG stateSequence = 0;
+
+		isIntact = session.ReadInputState(1, state, stateSequence) == Result::Success
+			&& session.ReadInputReport(1, message, sequence) == Result::Success;
+
+		const UCHAR value = (UCHAR)state.Timestamp;
+
+		isIntact = isIntact
+			&& state.LeftThumbX == (UCHAR)(0xFF - value) && state.RightThumbY == (UCHAR)(0xFF - value)
+			&& state.Pressure[0] == value && state.Pressure[11] == value;
+
+		// same sequence, same report
+		if (isIntact && stateSequence == sequence)
+		{
+			isIntact = message.InputReport.LeftThumbX == value;
+		}
+	}
+
+	SimClientCheck(isIntact, "input state snapshots", failed);
+
+	ULONGLONG changed[DSHM_IPC_HID_CHANGED_WORDS];
+
+	SimClientCheck(
+		session.HasInputChangedEvent()
+		&& session.WaitForInputChanges(changed, 100) == Result::Success
+		&& (changed[0] & 1) != 0,
+		"input changed event",
+		failed
+	);
+
+	//
+	// Load phase: history drains per pad, concurrent pings, output requests
+	//
+	std::atomic<bool> isStopping{ false };
+	std::vector<std::thread> threads;
+	std::vector<SimClientWorker> drainers(padCount);
+	std::vector<SimClientWorker> pingers(pingerCount);
+	std::vector<ULONGLONG> seen(padCount);
+	SimClientWorker watcher{};
+	SimClientWorker sampler{};
+
+	for (ULONG pad = 1; pad <= padCount; pad++)
+	{
+		threads.emplace_back(SimClientDrain, std::ref(session), pad, std::cref(isStopping), std::ref(drainers[pad - 1]));
+	}
+
+	for (ULONG index = 0; index < pingerCount; index++)
+	{
+		threads.emplace_back(SimClientPing, std::ref(session), std::cref(isStopping), std::ref(pingers[index]));
+	}
+
+	threads.emplace_back(SimClientWatch, std::ref(session), padCount, std::cref(isStopping), std::ref(watcher), std::ref(seen));
+	threads.emplace_back(SimClientSample, std::ref(session), padCount, std::cref(isStopping), std::ref(sampler));
+
+	const auto begin = std::chrono::steady_clock::now();
+	const ULONGLONG reportsBefore = driver.Reports;
+	const ULONGLONG signalsBefore = driver.ChangedSignals;
+	ULONG outputBusy = 0;
+
+	for (ULONG index = 0; index < SIM_CLIENT_OUTPUT_REQUESTS; index++)
+	{
+		IPC_OUTPUT_REQUEST request{};
+
+		request.Fields = DSHM_IPC_OUTPUT_FIELD_LARGE_MOTOR_STRENGTH;
+		request.LargeMotorStrength = (UCHAR)(index + 1);
+
+		while (session.SendOutputRequest(1, request) == Result::Busy)
+		{
+			outputBusy++;
+			std::this_thread::yield();
+		}
+	}
+
+	std::this_thread::sleep_until(begin + std::chrono::milliseconds(durationMs / 2));
+
+	driver.Reclaim(1);
+
+	std::this_thread::sleep_until(begin + std::chrono::milliseconds(durationMs));
+
+	isStopping = true;
+
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+	const ULONGLONG reports = driver.Reports - reportsBefore;
+	const ULONGLONG signals = driver.ChangedSignals - signalsBefore;
+	SimClientWorker history{}, pings{};
+
+	for (const SimClientWorker& worker : drainers)
+	{
+		history.Operations += worker.Operations;
+		history.Failures += worker.Failures;
+		history.Lost += worker.Lost;
+	}
+
+	for (const SimClientWorker& worker : pingers)
+	{
+		pings.Operations += worker.Operations;
+		pings.Failures += worker.Failures;
+		pings.TotalLatencyUs += worker.TotalLatencyUs;
+		pings.MaxLatencyUs = std::max(pings.MaxLatencyUs, worker.MaxLatencyUs);
+	}
+
+	printf("\n%lu pads, %lu pinging threads, %.2f s\n\n", (unsigned long)padCount, (unsigned long)pingerCount, seconds);
+	printf("pings              %10.0f/s   avg %8.1f us   max %8.1f us\n",
+		pings.Operations / seconds,
+		pings.Operations ? pings.TotalLatencyUs / pings.Operations : 0.0,
+		pings.MaxLatencyUs
+	);
+	printf("history entries    %10.0f/s   lost %llu\n", history.Operations / seconds, (unsigned long long)history.Lost);
+	printf("input changed      %10.0f/s   %llu signals for %llu reports\n",
+		watcher.Operations / seconds,
+		(unsigned long long)signals,
+		(unsigned long long)reports
+	);
+	printf("counter samples    %10.0f/s   %llu generation changes\n",
+		sampler.Operations / seconds,
+		(unsigned long long)sampler.Lost
+	);
+	printf("output requests    %10lu     %llu reports, %lu full ring retries\n\n",
+		(unsigned long)SIM_CLIENT_OUTPUT_REQUESTS,
+		(unsigned long long)driver.OutputReportsSent.load(),
+		(unsigned long)outputBusy
+	);
+
+	SimClientCheck(pings.Operations > 0 && pings.Failures == 0, "concurrent pings", failed);
+	SimClientCheck(history.Operations > 0 && history.Failures == 0, "input history drains", failed);
+	SimClientCheck(
+		watcher.Operations > 0 && watcher.Failures == 0
+		&& std::all_of(seen.begin(), seen.end(), [](ULONGLONG count) { return count > 0; }),
+		"changed slots cover every pad",
+		failed
+	);
+	SimClientCheck(
+		driver.OutputRequestsApplied == SIM_CLIENT_OUTPUT_REQUESTS
+		&& driver.LastLargeMotorStrength == (UCHAR)SIM_CLIENT_OUTPUT_REQUESTS,
+		"output requests applied in order",
+		failed
+	);
+
+	SimClientCheck(sampler.Operations > 0 && sampler.Failures == 0 && sampler.Lost == 1, "counter samples monotonic", failed);
+	SimClientCheck(
+		session.ReadDeviceCounters(1, counters) == Result::Success && counters.Generation == 4 && counters.SlotIndex == 1
+		&& counters.InputReports > 0 && (ULONGLONG)counters.InputReports < driver.Reports / padCount
+		&& counters.ProcessingTicks > 0,
+		"counters start over on reclaim",
+		failed
+	);
+
+	session.Disconnect();
+	driver.Stop();
+
+	if (failed)
+	{
+		printf("\nFAILED: %lu checks\n", (unsigned long)failed);
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+#else
+
+int SimIpcClient(int argc, char* argv[])
+{
+	UNREFERENCED_PARAMETER(argc);
+	UNREFERENCED_PARAMETER(argv);
+
+	printf("The fake driver needs the POSIX transport, run this on a Linux host\n");
+	return EXIT_FAILURE;
+}
+
+#endif
@@ -0,0 +1,1818 @@
+//
+// Host-side simulations of self-contained driver modules (no device required)
+//
+// Outside of Visual Studio, e.g. on Linux:
+//   gcc -std=c11 -O2 -I../driver -I../include -Iposix -c dshmsim.c ../driver/Ds3.OutputState.c
+//       ../driver/DsAirtime.c ../driver/FFB.Engine.c ../driver/FFB.Blocks.c
+//       ../driver/FFB.Record.c ../driver/FFB.Q15.c
+//   g++ -std=c++17 -O2 -I../driver -I../include -Iposix -c IpcClientSim.cpp
+//   g++ *.o -lm -lpthread -lrt -o dshmsim
+//
+
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../driver/Ds3.OutputState.h"
+#include "../driver/DsAirtime.h"
+#include "../driver/FFB.Blocks.h"
+#include "../driver/FFB.Engine.h"
+#include "../driver/FFB.Q15.h"
+#include "../driver/FFB.Record.h"
+#include "../include/DsHidMini/IpcHidRegion.h"
+
+//
+// IpcClientSim.cpp
+//
+int SimIpcClient(int argc, char* argv[]);
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+//
+// Simulated clock runs in microseconds
+//
+#define SIM_TICKS_PER_SECOND	1000000LL
+#define SIM_TICKS_PER_MS		(SIM_TICKS_PER_SECOND / 1000)
+#define SIM_MAX_PADS			16
+
+typedef struct
+{
+	//
+	// Output reports the game submits per second
+	//
+	ULONG RateHz;
+
+	DS_AIRTIME_CLIENT Client;
+
+	LONGLONG NextReport;
+	LONGLONG RetryAt;
+	LONGLONG PendingSince;
+	BOOLEAN IsPending;
+
+	ULONGLONG Submitted;
+	ULONGLONG Replaced;
+	ULONGLONG Sent;
+	LONGLONG TotalLatency;
+	LONGLONG MaxLatency;
+
+} SIM_PAD;
+
+//
+// One pad fires a burst of priority writes, then both pads keep the radio
+// busy. The priority writes are taken on credit and have to be paid back in
+// full from the bursting pad's own share, so neither the pad nor the radio
+// ends up above budget.
+//
+static BOOLEAN SimAirtimeDebt(void)
+{
+	const ULONG seconds = 2;
+	const ULONG burst = 40;
+	DS_AIRTIME_BUDGET budget;
+	DS_AIRTIME_CLIENT clients[2];
+	ULONGLONG sent[ARRAYSIZE(clients)] = { 0 };
+	ULONGLONG sentInDebt = 0;
+
+	memset(clients, 0, sizeof(clients));
+
+	DS_AIRTIME_BUDGET_INIT(
+		&budget,
+		DS_AIRTIME_DEFAULT_WRITES_PER_SECOND,
+		DS_AIRTIME_DEFAULT_BURST_WRITES,
+		SIM_TICKS_PER_SECOND,
+		0
+	);
+
+	for (ULONG index = 0; index < ARRAYSIZE(clients); index++)
+	{
+		DS_AIRTIME_REGISTER(&budget, &clients[index], 0);
+	}
+
+	for (ULONG index = 0; index < burst; index++)
+	{
+		if (DS_AIRTIME_ACQUIRE(&budget, &clients[0], TRUE, 0) == 0)
+		{
+			sent[0]++;
+		}
+	}
+
+	for (LONGLONG now = 0; now < (LONGLONG)seconds * SIM_TICKS_PER_SECOND; now += SIM_TICKS_PER_MS)
+	{
+		for (ULONG index = 0; index < ARRAYSIZE(clients); index++)
+		{
+			const ULONGLONG borrowed = clients[index].Borrowed;
+
+			if (DS_AIRTIME_ACQUIRE(&budget, &clients[index], FALSE, now) == 0)
+			{
+				sent[index]++;
+				sentInDebt += clients[index].Borrowed != borrowed && clients[index].Tokens < 0;
+			}
+		}
+	}
+
+	const ULONGLONG forced = clients[0].Forced;
+
+	//
+	// Again in debt while the other pad idles and its share fills the pool,
+	// the pool must not be tapped before the debt is paid back
+	//
+	for (ULONG index = 0; index < burst; index++)
+	{
+		(void)DS_AIRTIME_ACQUIRE(&budget, &clients[0], TRUE, (LONGLONG)seconds * SIM_TICKS_PER_SECOND);
+	}
+
+	for (LONGLONG now = (LONGLONG)seconds * SIM_TICKS_PER_SECOND; now < (LONGLONG)(seconds + 1) * SIM_TICKS_PER_SECOND; now += SIM_TICKS_PER_MS)
+	{
+		const ULONGLONG borrowed = clients[0].Borrowed;
+
+		if (DS_AIRTIME_ACQUIRE(&budget, &clients[0], FALSE, now) == 0)
+		{
+			sentInDebt += clients[0].Borrowed != borrowed && clients[0].Tokens < 0;
+		}
+	}
+
+	//
+	// Own share plus the initial write and whatever the pool may hand out
+	//
+	const ULONGLONG share = (ULONGLONG)budget.WritesPerSecond * seconds / ARRAYSIZE(clients)
+		+ 1 + budget.BurstWrites;
+	const ULONGLONG total = sent[0] + sent[1];
+	const ULONGLONG allowed = (ULONGLONG)budget.WritesPerSecond * seconds + ARRAYSIZE(clients) + budget.BurstWrites;
+	const BOOLEAN isOk = sent[0] <= share && total <= allowed && forced == burst - 1 && sentInDebt == 0;
+
+	printf("\nPriority debt: %lu priority writes, pad 1 sent %llu (share %llu), total %llu (budget %llu), %llu borrowed in debt  %s\n",
+		(unsigned long)burst,
+		(unsigned long long)sent[0],
+		(unsigned long long)share,
+		(unsigned long long)total,
+		(unsigned long long)allowed,
+		(unsigned long long)sentInDebt,
+		isOk ? "ok" : "FAILED"
+	);
+
+	return isOk;
+}
+
+//
+// Models N pads on one radio, each submitting output reports at its own rate.
+// Like the driver, a held back report gets replaced by newer ones and the
+// send is retried after the delay the budget asked for.
+//
+static int SimAirtime(int argc, char* argv[])
+{
+	static const ULONG defaultRates[] = { 1000, 500, 250, 125, 60, 20, 2 };
+	SIM_PAD pads[SIM_MAX_PADS];
+	ULONG padCount = 0;
+	ULONG seconds = 10;
+	DS_AIRTIME_BUDGET budget;
+	ULONGLONG totalSent = 0;
+
+	if (argc > 0)
+	{
+		seconds = strtoul(argv[0], NULL, 10);
+	}
+
+	memset(pads, 0, sizeof(pads));
+
+	for (int arg = 1; arg < argc && padCount < SIM_MAX_PADS; arg++)
+	{
+		pads[padCount++].RateHz = strtoul(argv[arg], NULL, 10);
+	}
+
+	if (padCount == 0)
+	{
+		for (; padCount < ARRAYSIZE(defaultRates); padCount++)
+		{
+			pads[padCount].RateHz = defaultRates[padCount];
+		}
+	}
+
+	if (seconds == 0)
+	{
+		seconds = 1;
+	}
+
+	DS_AIRTIME_BUDGET_INIT(
+		&budget,
+		DS_AIRTIME_DEFAULT_WRITES_PER_SECOND,
+		DS_AIRTIME_DEFAULT_BURST_WRITES,
+		SIM_TICKS_PER_SECOND,
+		0
+	);
+
+	for (ULONG index = 0; index < padCount; index++)
+	{
+		DS_AIRTIME_REGISTER(&budget, &pads[index].Client, 0);
+	}
+
+	const LONGLONG end = (LONGLONG)seconds * SIM_TICKS_PER_SECOND;
+
+	for (LONGLONG now = 0; now < end; now++)
+	{
+		for (ULONG index = 0; index < padCount; index++)
+		{
+			SIM_PAD* pad = &pads[index];
+
+			if (pad->RateHz && now >= pad->NextReport)
+			{
+				pad->NextReport = now + SIM_TICKS_PER_SECOND / pad->RateHz;
+				pad->Submitted++;
+
+				if (pad->IsPending)
+				{
+					pad->Replaced++;
+				}
+				else
+				{
+					pad->IsPending = TRUE;
+					pad->RetryAt = now;
+				}
+
+				pad->PendingSince = now;
+			}
+
+			if (!pad->IsPending || now < pad->RetryAt)
+			{
+				continue;
+			}
+
+			const ULONG waitMs = DS_AIRTIME_ACQUIRE(&budget, &pad->Client, FALSE, now);
+
+			if (waitMs)
+			{
+				pad->RetryAt = now + (LONGLONG)waitMs * SIM_TICKS_PER_MS;
+				continue;
+			}
+
+			const LONGLONG latency = now - pad->PendingSince;
+
+			pad->IsPending = FALSE;
+			pad->Sent++;
+			pad->TotalLatency += latency;
+
+			if (latency > pad->MaxLatency)
+			{
+				pad->MaxLatency = latency;
+			}
+
+			totalSent++;
+		}
+	}
+
+	printf("Budget: %lu writes/s, burst %lu, %lu pads, %lu s\n\n",
+		(unsigned long)budget.WritesPerSecond,
+		(unsigned long)budget.BurstWrites,
+		(unsigned long)padCount,
+		(unsigned long)seconds
+	);
+	printf("%4s %8s %10s %10s %10s %10s %10s %10s %12s %12s\n",
+		"Pad", "Rate", "Submitted", "Replaced", "Sent", "Sent/s", "Own", "Borrowed", "Avg lat ms", "Max lat ms");
+
+	for (ULONG index = 0; index < padCount; index++)
+	{
+		const SIM_PAD* pad = &pads[index];
+
+		printf("%4lu %8lu %10llu %10llu %10llu %10.1f %10llu %10llu %12.2f %12.2f\n",
+			(unsigned long)index + 1,
+			(unsigned long)pad->RateHz,
+			(unsigned long long)pad->Submitted,
+			(unsigned long long)pad->Replaced,
+			(unsigned long long)pad->Sent,
+			(double)pad->Sent / seconds,
+			(unsigned long long)pad->Client.Granted,
+			(unsigned long long)pad->Client.Borrowed,
+			pad->Sent ? (double)pad->TotalLatency / pad->Sent / SIM_TICKS_PER_MS : 0.0,
+			(double)pad->MaxLatency / SIM_TICKS_PER_MS
+		);
+	}
+
+	const double aggregate = (double)totalSent / seconds;
+
+	printf("\nAggregate: %.1f writes/s\n", aggregate);
+
+	//
+	// Initial tokens of every client plus a full pool may be spent on top
+	//
+	const ULONGLONG allowed = (ULONGLONG)budget.WritesPerSecond * seconds
+		+ (ULONGLONG)padCount + budget.BurstWrites;
+
+	if (totalSent > allowed)
+	{
+		printf("FAILED: %llu writes exceed budget of %llu\n",
+			(unsigned long long)totalSent,
+			(unsigned long long)allowed
+		);
+		return EXIT_FAILURE;
+	}
+
+	return SimAirtimeDebt() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+//
+// Force feedback engine driven by a fake millisecond clock
+//
+typedef struct
+{
+	FFB_ENGINE Engine;
+
+	ULONGLONG Now;
+
+	//
+	// Times the engine got evaluated
+	//
+	ULONG Evaluations;
+
+	//
+	// Output reports the driver would have sent
+	//
+	ULONG Reports;
+
+	ULONG Failures;
+
+} SIM_FFB;
+
+static VOID SimFfbEffect(
+	SIM_FFB* Sim,
+	UCHAR Index,
+	UCHAR Type,
+	USHORT Duration,
+	USHORT StartDelay,
+	USHORT Gain
+)
+{
+	PID_SET_EFFECT_REPORT report;
+
+	memset(&report, 0, sizeof(report));
+	report.ReportId = PID_SET_EFFECT_REPORT_ID;
+	report.EffectBlockIndex = Index;
+	report.EffectType = Type;
+	report.Duration = Duration;
+	report.StartDelay = StartDelay;
+	report.Gain = Gain;
+	report.AxesEnableX = 1;
+
+	FFB_ENGINE_SET_EFFECT(&Sim->Engine, &report);
+}
+
+static VOID SimFfbOperation(
+	SIM_FFB* Sim,
+	UCHAR Index,
+	UCHAR Operation,
+	UCHAR LoopCount
+)
+{
+	PID_EFFECT_OPERATION_REPORT report;
+
+	report.ReportId = PID_EFFECT_OPERATION_REPORT_ID;
+	report.EffectBlockIndex = Index;
+	report.EffectOperation = Operation;
+	report.LoopCount = LoopCount;
+
+	FFB_ENGINE_EFFECT_OPERATION(&Sim->Engine, &report, Sim->Now);
+}
+
+//
+// Evaluates right away (like the driver does after PID reports) and then
+// only whenever the engine asks to be woken up, until the given time
+//
+static VOID SimFfbRun(
+	SIM_FFB* Sim,
+	ULONGLONG Until
+)
+{
+	UCHAR large, small;
+	ULONG delayMs;
+
+	for (;;)
+	{
+		Sim->Evaluations++;
+
+		if (FFB_ENGINE_TICK(&Sim->Engine, Sim->Now, &large, &small))
+		{
+			Sim->Reports++;
+		}
+
+		if (!FFB_ENGINE_GET_NEXT_WAKE(&Sim->Engine, Sim->Now, &delayMs) || Sim->Now + delayMs > Until)
+		{
+			break;
+		}
+
+		Sim->Now += delayMs;
+	}
+
+	Sim->Now = Until;
+}
+
+static VOID SimFfbExpect(
+	SIM_FFB* Sim,
+	const char* Step,
+	UCHAR Large,
+	UCHAR Small
+)
+{
+	const BOOLEAN isMatch = Sim->Engine.LargeMotor == Large && Sim->Engine.SmallMotor == Small;
+
+	printf("%8llu ms  %-36s large %3u small %3u  %s\n",
+		(unsigned long long)Sim->Now,
+		Step,
+		Sim->Engine.LargeMotor,
+		Sim->Engine.SmallMotor,
+		isMatch ? "ok" : "MISMATCH"
+	);
+
+	if (!isMatch)
+	{
+		printf("          expected large %3u small %3u\n", Large, Small);
+		Sim->Failures++;
+	}
+}
+
+static int SimFfb(int argc, char* argv[])
+{
+	SIM_FFB sim;
+
+	UNREFERENCED_PARAMETER(argc);
+	UNREFERENCED_PARAMETER(argv);
+
+	memset(&sim, 0, sizeof(sim));
+	FFB_ENGINE_INIT(&sim.Engine);
+
+	//
+	// Constant force, half strength for 200 ms
+	//
+	{
+		PID_SET_CONSTANT_FORCE_REPORT constant = { PID_SET_CONSTANT_FORCE_REPORT_ID, 1, -5000 };
+
+		SimFfbEffect(&sim, 1, PidEtConstantForce, 200, 0, 10000);
+		FFB_ENGINE_SET_CONSTANT_FORCE(&sim.Engine, &constant);
+		SimFfbOperation(&sim, 1, PidEoStart, 1);
+
+		SimFfbRun(&sim, 100);
+		SimFfbExpect(&sim, "constant force playing", 128, 0);
+
+		FFB_ENGINE_SET_DEVICE_GAIN(&sim.Engine, 5000);
+		SimFfbRun(&sim, 150);
+		SimFfbExpect(&sim, "device gain halved", 64, 0);
+
+		FFB_ENGINE_SET_DEVICE_GAIN(&sim.Engine, 10000);
+		SimFfbRun(&sim, 300);
+		SimFfbExpect(&sim, "constant force expired", 0, 0);
+	}
+
+	//
+	// Attack envelope ramping up over 100 ms
+	//
+	{
+		PID_SET_ENVELOPE_REPORT envelope = { PID_SET_ENVELOPE_REPORT_ID, 1, 0, 0, 100, 0 };
+		PID_SET_CONSTANT_FORCE_REPORT constant = { PID_SET_CONSTANT_FORCE_REPORT_ID, 1, 10000 };
+
+		SimFfbEffect(&sim, 1, PidEtConstantForce, 0xFFFF, 0, 10000);
+		FFB_ENGINE_SET_CONSTANT_FORCE(&sim.Engine, &constant);
+		FFB_ENGINE_SET_ENVELOPE(&sim.Engine, &envelope);
+		SimFfbOperation(&sim, 1, PidEoStart, 1);
+
+		//
+		// 127.5 is a tie, Q15 full scale being 0x7FFF rounds it down
+		//
+		SimFfbRun(&sim, 350);
+		SimFfbExpect(&sim, "envelope attack half way", 127, 0);
+
+		SimFfbRun(&sim, 500);
+		SimFfbExpect(&sim, "envelope sustain", 255, 0);
+
+		SimFfbOperation(&sim, 1, PidEoStop, 0);
+		FFB_ENGINE_FREE_EFFECT(&sim.Engine, 1);
+		SimFfbRun(&sim, 510);
+		SimFfbExpect(&sim, "effect stopped", 0, 0);
+	}
+
+	//
+	// Slow sine renders on the large motor, fast one buzzes the small motor
+	//
+	{
+		PID_SET_PERIODIC_REPORT slow = { PID_SET_PERIODIC_REPORT_ID, 2, 10000, 0, 0, 1000 };
+		PID_SET_PERIODIC_REPORT fast = { PID_SET_PERIODIC_REPORT_ID, 3, 6000, 0, 0, 20 };
+
+		SimFfbEffect(&sim, 2, PidEtSine, 0xFFFF, 0, 10000);
+		FFB_ENGINE_SET_PERIODIC(&sim.Engine, &slow);
+		SimFfbEffect(&sim, 3, PidEtSine, 0xFFFF, 0, 5000);
+		FFB_ENGINE_SET_PERIODIC(&sim.Engine, &fast);
+
+		SimFfbOperation(&sim, 2, PidEoStart, 1);
+		SimFfbOperation(&sim, 3, PidEoStart, 1);
+
+		SimFfbRun(&sim, 760);
+		SimFfbExpect(&sim, "sine peak", 255, 76);
+
+		SimFfbRun(&sim, 1010);
+		SimFfbExpect(&sim, "sine zero crossing", 0, 76);
+
+		SimFfbOperation(&sim, 2, PidEoStartSolo, 1);
+		SimFfbRun(&sim, 1020);
+		SimFfbExpect(&sim, "start solo stops others", 16, 0);
+	}
+
+	//
+	// Pause freezes playback, continue resumes where it left off
+	//
+	{
+		FFB_ENGINE_DEVICE_CONTROL(&sim.Engine, PidDcPause, sim.Now);
+		SimFfbRun(&sim, 5000);
+		SimFfbExpect(&sim, "paused", 0, 0);
+
+		FFB_ENGINE_DEVICE_CONTROL(&sim.Engine, PidDcContinue, sim.Now);
+		SimFfbRun(&sim, 5240);
+		SimFfbExpect(&sim, "continued to sine peak", 255, 0);
+
+		FFB_ENGINE_DEVICE_CONTROL(&sim.Engine, PidDcReset, sim.Now);
+		SimFfbRun(&sim, 5250);
+		SimFfbExpect(&sim, "reset", 0, 0);
+	}
+
+	//
+	// Spring pulls back towards center proportional to stick deflection
+	//
+	{
+		PID_SET_CONDITION_REPORT spring;
+
+		memset(&spring, 0, sizeof(spring));
+		spring.ReportId = PID_SET_CONDITION_REPORT_ID;
+		spring.EffectBlockIndex = 4;
+		spring.PositiveCoefficient = 10000;
+		spring.NegativeCoefficient = 10000;
+
+		SimFfbEffect(&sim, 4, PidEtSpring, 0xFFFF, 0, 10000);
+		FFB_ENGINE_SET_CONDITION(&sim.Engine, &spring);
+
+		if (sim.Engine.HasConditions)
+		{
+			printf("          axes wanted before a condition effect started\n");
+			sim.Failures++;
+		}
+
+		SimFfbOperation(&sim, 4, PidEoStart, 1);
+
+		SimFfbRun(&sim, 5300);
+		SimFfbExpect(&sim, "spring centered", 0, 0);
+
+		FFB_ENGINE_SET_AXES(&sim.Engine, -FFB_Q15_ONE / 2, 0);
+		SimFfbRun(&sim, 5350);
+		SimFfbExpect(&sim, "spring deflected", 127, 0);
+
+		FFB_ENGINE_DEVICE_CONTROL(&sim.Engine, PidDcStopAllEffects, sim.Now);
+		SimFfbRun(&sim, 5360);
+		SimFfbExpect(&sim, "all stopped", 0, 0);
+
+		if (sim.Engine.HasConditions)
+		{
+			printf("          axes still wanted after condition effects stopped\n");
+			sim.Failures++;
+		}
+	}
+
+	//
+	// Start delay and loop count, nothing to evaluate in between boundaries
+	//
+	{
+		PID_SET_CONSTANT_FORCE_REPORT constant = { PID_SET_CONSTANT_FORCE_REPORT_ID, 5, 10000 };
+		const ULONG evaluations = sim.Evaluations;
+
+		SimFfbEffect(&sim, 5, PidEtConstantForce, 100, 50, 10000);
+		FFB_ENGINE_SET_CONSTANT_FORCE(&sim.Engine, &constant);
+		SimFfbOperation(&sim, 5, PidEoStart, 2);
+
+		SimFfbRun(&sim, 5400);
+		SimFfbExpect(&sim, "start delay", 0, 0);
+
+		SimFfbRun(&sim, 5420);
+		SimFfbExpect(&sim, "first iteration", 255, 0);
+
+		SimFfbRun(&sim, 5515);
+		SimFfbExpect(&sim, "second iteration, no start delay", 255, 0);
+
+		SimFfbRun(&sim, 5605);
+		SimFfbExpect(&sim, "second iteration", 255, 0);
+
+		SimFfbRun(&sim, 5615);
+		SimFfbExpect(&sim, "loops done", 0, 0);
+
+		SimFfbRun(&sim, 6000);
+		SimFfbExpect(&sim, "still done", 0, 0);
+
+		if (sim.Evaluations - evaluations > 10)
+		{
+			printf("          %lu evaluations, expected boundaries only\n",
+				(unsigned long)(sim.Evaluations - evaluations));
+			sim.Failures++;
+		}
+	}
+
+	printf("\nEvaluations: %lu (fixed rate: %lu), output reports: %lu\n",
+		(unsigned long)sim.Evaluations,
+		(unsigned long)(sim.Now / FFB_ENGINE_TICK_MS),
+		(unsigned long)sim.Reports
+	);
+
+	if (sim.Failures)
+	{
+		printf("FAILED: %lu mismatches\n", (unsigned long)sim.Failures);
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+//
+// Recorded PID reports replayed through the effect engine
+//
+#define SIM_REPLAY_COALESCING_MS	5
+#define SIM_REPLAY_DRAIN_MS			60000
+
+typedef struct
+{
+	FFB_ENGINE Engine;
+
+	FFB_BLOCK_TABLE Blocks;
+
+	//
+	// Engine time of next evaluation, FFB_ENGINE_NO_DEADLINE if idle
+	//
+	ULONGLONG WakeAt;
+
+	ULONG Evaluations;
+
+	ULONG Reports;
+
+	//
+	// Block indexes that differ from what the driver handed out
+	//
+	ULONG BlockMismatches;
+
+	ULONG Skipped;
+
+	//
+	// Motor timeline, may be NULL
+	//
+	FILE* Timeline;
+
+} SIM_REPLAY;
+
+static VOID SimReplayEvaluate(
+	SIM_REPLAY* Replay,
+	ULONGLONG Now
+)
+{
+	UCHAR large, small;
+	ULONG delayMs;
+
+	Replay->Evaluations++;
+
+	if (FFB_ENGINE_TICK(&Replay->Engine, Now, &large, &small))
+	{
+		Replay->Reports++;
+
+		if (Replay->Timeline)
+		{
+			fprintf(Replay->Timeline, "%llu,%u,%u\n", (unsigned long long)Now, large, small);
+		}
+	}
+
+	Replay->WakeAt = FFB_ENGINE_GET_NEXT_WAKE(&Replay->Engine, Now, &delayMs)
+		? Now + delayMs
+		: FFB_ENGINE_NO_DEADLINE;
+}
+
+//
+// Copies a report into its structure if the recorded length covers it
+//
+#define SIM_REPLAY_REPORT(_entry_, _report_) \
+	((_entry_)->Length >= sizeof(_report_) && (memcpy(&(_report_), (_entry_)->Data, sizeof(_report_)), TRUE))
+
+//
+// Same handling as DSHM_GetFeature, DSHM_SetFeature and DSHM_WriteReport
+//
+static BOOLEAN SimReplayApply(
+	SIM_REPLAY* Replay,
+	const FFB_RECORD_ENTRY* Entry,
+	ULONGLONG Now
+)
+{
+	PID_SET_EFFECT_REPORT setEffect;
+	PID_SET_ENVELOPE_REPORT setEnvelope;
+	PID_SET_CONDITION_REPORT setCondition;
+	PID_SET_PERIODIC_REPORT setPeriodic;
+	PID_SET_CONSTANT_FORCE_REPORT setConstant;
+	PID_SET_RAMP_FORCE_REPORT setRamp;
+	PID_EFFECT_OPERATION_REPORT effectOperation;
+	PID_DEVICE_CONTROL_REPORT deviceControl;
+	PID_DEVICE_GAIN_REPORT deviceGain;
+	PID_BLOCK_FREE_REPORT blockFree;
+	PID_NEW_EFFECT_REPORT newEffect;
+	PID_BLOCK_LOAD_REPORT blockLoad;
+
+	const PFFB_ENGINE engine = &Replay->Engine;
+
+	switch (Entry->Kind)
+	{
+	case FfbRecordSetFeature:
+
+		if (Entry->Data[0] == PID_NEW_EFFECT_REPORT_ID && SIM_REPLAY_REPORT(Entry, newEffect))
+		{
+			(void)FFB_BLOCKS_ALLOCATE(&Replay->Blocks, (PID_EFFECT_TYPE)newEffect.EffectType);
+			return TRUE;
+		}
+
+		return FALSE;
+
+	case FfbRecordGetFeature:
+
+		if (Entry->Data[0] == PID_BLOCK_LOAD_REPORT_ID && SIM_REPLAY_REPORT(Entry, blockLoad))
+		{
+			if (FFB_BLOCKS_CLAIM(&Replay->Blocks) != blockLoad.EffectBlockIndex)
+			{
+				Replay->BlockMismatches++;
+			}
+			return TRUE;
+		}
+
+		return Entry->Data[0] == PID_POOL_REPORT_ID;
+
+	case FfbRecordWriteReport:
+
+		switch (Entry->Data[0])
+		{
+		case PID_SET_EFFECT_REPORT_ID:
+			if (!SIM_REPLAY_REPORT(Entry, setEffect))
+				return FALSE;
+			FFB_ENGINE_SET_EFFECT(engine, &setEffect);
+			return TRUE;
+		case PID_SET_ENVELOPE_REPORT_ID:
+			if (!SIM_REPLAY_REPORT(Entry, setEnvelope))
+				return FALSE;
+			FFB_ENGINE_SET_ENVELOPE(engine, &setEnvelope);
+			return TRUE;
+		case PID_SET_CONDITION_REPORT_ID:
+			if (!SIM_REPLAY_REPORT(Entry, setCondition))
+				return FALSE;
+			FFB_ENGINE_SET_CONDITION(engine, &setCondition);
+			return TRUE;
+		case PID_SET_PERIODIC_REPORT_ID:
+			if (!SIM_REPLAY_REPORT(Entry, setPeriodic))
+				return FALSE;
+			FFB_ENGINE_SET_PERIODIC(engine, &setPeriodic);
+			return TRUE;
+		case PID_SET_CONSTANT_FORCE_REPORT_ID:
+			if (!SIM_REPLAY_REPORT(Entry, setConstant))
+				return FALSE;
+			FFB_ENGINE_SET_CONSTANT_FORCE(engine, &setConstant);
+			return TRUE;
+		case PID_SET_RAMP_FORCE_REPORT_ID:
+			if (!SIM_REPLAY_REPORT(Entry, setRamp))
+				return FALSE;
+			FFB_ENGINE_SET_RAMP_FORCE(engine, &setRamp);
+			return TRUE;
+		case PID_EFFECT_OPERATION_REPORT_ID:
+			if (!SIM_REPLAY_REPORT(Entry, effectOperation))
+				return FALSE;
+			FFB_ENGINE_EFFECT_OPERATION(engine, &effectOperation, Now);
+			return TRUE;
+		case PID_DEVICE_CONTROL_REPORT_ID:
+			if (!SIM_REPLAY_REPORT(Entry, deviceControl))
+				return FALSE;
+			if (deviceControl.DeviceControlCommand == PidDcReset)
+				FFB_BLOCKS_INIT(&Replay->Blocks);
+			FFB_ENGINE_DEVICE_CONTROL(engine, deviceControl.DeviceControlCommand, Now);
+			return TRUE;
+		case PID_DEVICE_GAIN_REPORT_ID:
+			if (!SIM_REPLAY_REPORT(Entry, deviceGain))
+				return FALSE;
+			FFB_ENGINE_SET_DEVICE_GAIN(engine, deviceGain.DeviceGain);
+			return TRUE;
+		case PID_BLOCK_FREE_REPORT_ID:
+			if (!SIM_REPLAY_REPORT(Entry, blockFree))
+				return FALSE;
+			FFB_ENGINE_FREE_EFFECT(engine, blockFree.EffectBlockIndex);
+			FFB_BLOCKS_FREE(&Replay->Blocks, blockFree.EffectBlockIndex);
+			return TRUE;
+		default:
+			return FALSE;
+		}
+
+	default:
+		return FALSE;
+	}
+}
+
+//
+// Plays a recording like the driver would, including coalescing and deadline wake-ups
+//
+static VOID SimReplayRun(
+	SIM_REPLAY* Replay,
+	const UCHAR* Recording,
+	SIZE_T RecordingSize,
+	SIZE_T Offset
+)
+{
+	FFB_RECORD_ENTRY entry;
+	ULONGLONG now = 0;
+
+	FFB_ENGINE_INIT(&Replay->Engine);
+	FFB_BLOCKS_INIT(&Replay->Blocks);
+	Replay->WakeAt = FFB_ENGINE_NO_DEADLINE;
+
+	while (FFB_RECORD_DECODE_ENTRY(Recording, RecordingSize, &Offset, &entry))
+	{
+		now = entry.TimestampMs;
+
+		while (Replay->WakeAt <= now)
+		{
+			SimReplayEvaluate(Replay, Replay->WakeAt);
+		}
+
+		if (!SimReplayApply(Replay, &entry, now))
+		{
+			Replay->Skipped++;
+			continue;
+		}
+
+		if (entry.Kind == FfbRecordWriteReport && now + SIM_REPLAY_COALESCING_MS < Replay->WakeAt)
+		{
+			Replay->WakeAt = now + SIM_REPLAY_COALESCING_MS;
+		}
+	}
+
+	//
+	// Let effects still playing run out (endless ones get cut off)
+	//
+	while (Replay->WakeAt <= now + SIM_REPLAY_DRAIN_MS)
+	{
+		SimReplayEvaluate(Replay, Replay->WakeAt);
+	}
+}
+
+static int SimFfbReplay(int argc, char* argv[])
+{
+	SIM_REPLAY replay;
+	ULONG repeat = 1;
+
+	if (argc < 1)
+	{
+		printf("Missing recording file\n");
+		return EXIT_FAILURE;
+	}
+
+	FILE* file = fopen(argv[0], "rb");
+
+	if (file == NULL)
+	{
+		printf("Can't open %s\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	fseek(file, 0, SEEK_END);
+	const long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+
+	UCHAR* recording = malloc(size > 0 ? (size_t)size : 1);
+	const SIZE_T read = (recording && size > 0) ? fread(recording, 1, (size_t)size, file) : 0;
+
+	fclose(file);
+
+	const SIZE_T offset = FFB_RECORD_DECODE_HEADER(recording, read);
+
+	if (offset == 0)
+	{
+		printf("%s is not a PID report recording\n", argv[0]);
+		free(recording);
+		return EXIT_FAILURE;
+	}
+
+	memset(&replay, 0, sizeof(replay));
+
+	if (argc > 1 && strcmp(argv[1], "-") != 0)
+	{
+		replay.Timeline = fopen(argv[1], "w");
+
+		if (replay.Timeline == NULL)
+		{
+			printf("Can't create %s\n", argv[1]);
+			free(recording);
+			return EXIT_FAILURE;
+		}
+
+		fprintf(replay.Timeline, "time_ms,large,small\n");
+	}
+
+	if (argc > 2)
+	{
+		repeat = strtoul(argv[2], NULL, 10);
+	}
+
+	if (repeat == 0)
+	{
+		repeat = 1;
+	}
+
+	//
+	// First pass produces the timeline, further ones only measure
+	//
+	SimReplayRun(&replay, recording, read, offset);
+
+	if (replay.Timeline)
+	{
+		fclose(replay.Timeline);
+		replay.Timeline = NULL;
+	}
+
+	const ULONG evaluations = replay.Evaluations;
+	const clock_t started = clock();
+
+	for (ULONG pass = 1; pass < repeat; pass++)
+	{
+		SimReplayRun(&replay, recording, read, offset);
+	}
+
+	const double seconds = (double)(clock() - started) / CLOCKS_PER_SEC;
+
+	printf("Skipped reports: %lu, block index mismatches: %lu\n",
+		(unsigned long)replay.Skipped / repeat,
+		(unsigned long)replay.BlockMismatches / repeat
+	);
+	printf("Evaluations: %lu, output reports: %lu\n",
+		(unsigned long)evaluations,
+		(unsigned long)replay.Reports / repeat
+	);
+
+	if (repeat > 1)
+	{
+		printf("%lu passes in %.3f s, %.1f ns per evaluation\n",
+			(unsigned long)repeat - 1,
+			seconds,
+			seconds * 1e9 / ((double)evaluations * (repeat - 1))
+		);
+	}
+
+	free(recording);
+
+	return replay.BlockMismatches ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+//
+// Writes a short recording of a typical DirectInput session, e.g. to try ffbreplay
+//
+static int SimFfbSample(int argc, char* argv[])
+{
+	UCHAR buffer[FFB_RECORD_ENTRY_HEADER_SIZE + FFB_RECORD_MAX_PAYLOAD];
+	SIZE_T size;
+
+	if (argc < 1)
+	{
+		printf("Missing recording file\n");
+		return EXIT_FAILURE;
+	}
+
+	FILE* file = fopen(argv[0], "wb");
+
+	if (file == NULL)
+	{
+		printf("Can't create %s\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+#define SIM_SAMPLE_WRITE(_time_, _kind_, _report_) \
+	size = FFB_RECORD_ENCODE_ENTRY(buffer, sizeof(buffer), (_time_), (_kind_), (const UCHAR*)&(_report_), sizeof(_report_)); \
+	fwrite(buffer, 1, size, file)
+
+	size = FFB_RECORD_ENCODE_HEADER(buffer, sizeof(buffer));
+	fwrite(buffer, 1, size, file);
+
+	for (ULONG shot = 0; shot < 20; shot++)
+	{
+		const ULONG time = shot * 500;
+
+		PID_NEW_EFFECT_REPORT newEffect = { PID_NEW_EFFECT_REPORT_ID, PidEtConstantForce, 0 };
+		PID_BLOCK_LOAD_REPORT blockLoad = { PID_BLOCK_LOAD_REPORT_ID, 1, PidBlsSuccess, 65535 };
+		PID_SET_EFFECT_REPORT setEffect;
+		PID_SET_ENVELOPE_REPORT setEnvelope = { PID_SET_ENVELOPE_REPORT_ID, 1, 10000, 0, 0, 200 };
+		PID_SET_CONSTANT_FORCE_REPORT setConstant = { PID_SET_CONSTANT_FORCE_REPORT_ID, 1, (SHORT)(2000 + shot * 400) };
+		PID_EFFECT_OPERATION_REPORT start = { PID_EFFECT_OPERATION_REPORT_ID, 1, PidEoStart, 1 };
+		PID_BLOCK_FREE_REPORT blockFree = { PID_BLOCK_FREE_REPORT_ID, 1 };
+
+		memset(&setEffect, 0, sizeof(setEffect));
+		setEffect.ReportId = PID_SET_EFFECT_REPORT_ID;
+		setEffect.EffectBlockIndex = 1;
+		setEffect.EffectType = PidEtConstantForce;
+		setEffect.Duration = 300;
+		setEffect.Gain = 10000;
+
+		SIM_SAMPLE_WRITE(time, FfbRecordSetFeature, newEffect);
+		SIM_SAMPLE_WRITE(time, FfbRecordGetFeature, blockLoad);
+		SIM_SAMPLE_WRITE(time + 1, FfbRecordWriteReport, setEffect);
+		SIM_SAMPLE_WRITE(time + 1, FfbRecordWriteReport, setEnvelope);
+		SIM_SAMPLE_WRITE(time + 1, FfbRecordWriteReport, setConstant);
+		SIM_SAMPLE_WRITE(time + 2, FfbRecordWriteReport, start);
+		SIM_SAMPLE_WRITE(time + 400, FfbRecordWriteReport, blockFree);
+	}
+
+#undef SIM_SAMPLE_WRITE
+
+	fclose(file);
+
+	return EXIT_SUCCESS;
+}
+
+//
+// Q15 helpers against a floating point reference
+//
+#define SIM_Q15_PI	3.14159265358979323846
+
+typedef struct
+{
+	const char* Name;
+
+	//
+	// Largest deviation allowed, in Q15 LSB or motor steps
+	//
+	double Bound;
+
+	double MaxError;
+
+} SIM_Q15_CHECK;
+
+static VOID SimQ15Track(
+	SIM_Q15_CHECK* Check,
+	double Actual,
+	double Expected
+)
+{
+	const double error = (Actual > Expected) ? Actual - Expected : Expected - Actual;
+
+	if (error > Check->MaxError)
+	{
+		Check->MaxError = error;
+	}
+}
+
+static double SimQ15Round(
+	double Value
+)
+{
+	return (Value < 0) ? -(double)(LONGLONG)(-Value + 0.5) : (double)(LONGLONG)(Value + 0.5);
+}
+
+static int SimQ15(int argc, char* argv[])
+{
+	UNREFERENCED_PARAMETER(argc);
+	UNREFERENCED_PARAMETER(argv);
+
+	SIM_Q15_CHECK checks[] = {
+		{ "PID value to Q15", 0.5, 0 },
+		{ "Q15 product", 0.5, 0 },
+		{ "sine table", 2.0, 0 },
+		{ "triangle", 1.0, 0 },
+		{ "sawtooth", 1.0, 0 },
+		{ "phase from angle", 0.5, 0 },
+		{ "phase within period", 1.0, 0 },
+		{ "magnitude x gain x device gain to motor", 1.0, 0 },
+	};
+	ULONG failed = 0;
+
+	for (LONG value = -FFB_Q15_PID_MAX; value <= FFB_Q15_PID_MAX; value++)
+	{
+		SimQ15Track(&checks[0], FFB_Q15_FROM_PID(value), value * (double)FFB_Q15_ONE / FFB_Q15_PID_MAX);
+	}
+
+	for (LONG a = -FFB_Q15_ONE * 2; a <= FFB_Q15_ONE * 2; a += 7)
+	{
+		for (LONG b = 0; b <= FFB_Q15_ONE; b += 13)
+		{
+			SimQ15Track(&checks[1], FFB_Q15_MUL(a, b), (double)a * b / 32768.0);
+		}
+	}
+
+	for (ULONG phase = 0; phase < (1UL << FFB_Q15_PHASE_BITS); phase++)
+	{
+		const double turn = (double)phase / (1UL << FFB_Q15_PHASE_BITS);
+		const double triangle = (turn < 0.25) ? turn * 4 : (turn < 0.75) ? 2 - turn * 4 : turn * 4 - 4;
+
+		SimQ15Track(&checks[2], FFB_Q15_SINE((USHORT)phase), sin(turn * 2 * SIM_Q15_PI) * FFB_Q15_ONE);
+		SimQ15Track(&checks[3], FFB_Q15_TRIANGLE((USHORT)phase), triangle * FFB_Q15_ONE);
+		SimQ15Track(&checks[4], FFB_Q15_SAWTOOTH_UP((USHORT)phase), (turn * 2 - 1) * FFB_Q15_ONE);
+	}
+
+	for (ULONG angle = 0; angle < 36000; angle++)
+	{
+		SimQ15Track(&checks[5], FFB_Q15_PHASE_FROM_CENTIDEGREES((USHORT)angle), angle * 65536.0 / 36000);
+	}
+
+	for (ULONG period = FFB_ENGINE_FAST_PERIOD_MS; period <= 0xFFFF; period += (period < 2000) ? 1 : 997)
+	{
+		const ULONG step = FFB_Q15_PHASE_STEP((USHORT)period);
+
+		for (ULONG elapsed = 0; elapsed < period; elapsed += 1 + period / 200)
+		{
+			SimQ15Track(&checks[6], FFB_Q15_PHASE_AT(step, elapsed), elapsed * 65536.0 / period);
+		}
+
+		if (FFB_Q15_PHASE_AT(step, period - 1) < FFB_Q15_PHASE_AT(step, period - 2))
+		{
+			checks[6].MaxError = 65536;
+		}
+	}
+
+	//
+	// Whole mixing path of a constant force, as the engine renders it
+	//
+	for (LONG magnitude = 0; magnitude <= FFB_Q15_PID_MAX; magnitude += 97)
+	{
+		for (LONG gain = 0; gain <= FFB_Q15_PID_MAX; gain += 250)
+		{
+			for (LONG deviceGain = 0; deviceGain <= FFB_Q15_PID_MAX; deviceGain += 500)
+			{
+				const LONG mixed = FFB_Q15_MUL(FFB_Q15_FROM_PID(magnitude), FFB_Q15_FROM_PID(gain));
+				const UCHAR motor = FFB_Q15_TO_MOTOR(FFB_Q15_MUL(mixed, FFB_Q15_FROM_PID(deviceGain)));
+				const double expected = (double)magnitude * gain * deviceGain * 255.0
+					/ ((double)FFB_Q15_PID_MAX * FFB_Q15_PID_MAX * FFB_Q15_PID_MAX);
+
+				SimQ15Track(&checks[7], motor, SimQ15Round(expected));
+			}
+		}
+	}
+
+	for (ULONG index = 0; index < ARRAYSIZE(checks); index++)
+	{
+		const BOOLEAN isOk = checks[index].MaxError <= checks[index].Bound;
+
+		printf("%-42s max error %8.3f  bound %5.1f  %s\n",
+			checks[index].Name,
+			checks[index].MaxError,
+			checks[index].Bound,
+			isOk ? "ok" : "EXCEEDED"
+		);
+
+		if (!isOk)
+		{
+			failed++;
+		}
+	}
+
+	if (failed)
+	{
+		printf("\nFAILED: %lu checks out of bounds\n", (unsigned long)failed);
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+//
+// Wire report as the driver starts out with, Report ID and for Bluetooth the
+// HID BT SET_REPORT header in front
+//
+static void SimOutputStateTemplate(
+	DS3_OUTPUT_REPORT_FORMAT Format,
+	PUCHAR Buffer
+)
+{
+	const SIZE_T prefix = (Format == Ds3OutputReportFormatBth) ? 2 : 1;
+
+	RtlZeroMemory(Buffer, DS3_OUTPUT_REPORT_FORMAT_SIZE(Format));
+
+	if (Format == Ds3OutputReportFormatBth)
+	{
+		Buffer[0] = 0x52;
+	}
+
+	Buffer[prefix - 1] = 0x01;
+}
+
+static void SimOutputStateCheck(
+	const char* Name,
+	BOOLEAN IsOk,
+	PULONG Failed
+)
+{
+	printf("%-52s %s\n", Name, IsOk ? "ok" : "FAILED");
+
+	if (!IsOk)
+	{
+		(*Failed)++;
+	}
+}
+
+//
+// Serializer and parser of the output state against both wire layouts
+//
+static int SimOutputState(int argc, char* argv[])
+{
+	UNREFERENCED_PARAMETER(argc);
+	UNREFERENCED_PARAMETER(argv);
+
+	const DS3_OUTPUT_REPORT_FORMAT formats[] = { Ds3OutputReportFormatUsb, Ds3OutputReportFormatBth };
+	ULONG failed = 0;
+	char name[64];
+
+	for (ULONG formatIndex = 0; formatIndex < ARRAYSIZE(formats); formatIndex++)
+	{
+		const DS3_OUTPUT_REPORT_FORMAT format = formats[formatIndex];
+		const char* formatName = (format == Ds3OutputReportFormatBth) ? "BTH 0x32" : "USB 0x31";
+		const SIZE_T size = DS3_OUTPUT_REPORT_FORMAT_SIZE(format);
+		const SIZE_T prefix = (format == Ds3OutputReportFormatBth) ? 2 : 1;
+		UCHAR buffer[0x40];
+		UCHAR before[0x40];
+		DS3_OUTPUT_STATE state;
+		DS3_OUTPUT_STATE parsed;
+
+		//
+		// Every field set to a distinct value lands at its documented offset
+		//
+		DS3_OUTPUT_STATE_INIT(&state);
+		DS3_OUTPUT_STATE_SET_LED_FLAGS(&state, 0x1E);
+
+		for (UCHAR index = 0; index < ARRAYSIZE(state.Leds); index++)
+		{
+			DS3_OUTPUT_STATE_SET_LED(&state, index, 0x10 + index, (USHORT)(0x1234 + index), 0x20 + index, 0x30 + index);
+		}
+
+		DS3_OUTPUT_STATE_SET_SMALL_MOTOR_DURATION(&state, 0x40);
+		DS3_OUTPUT_STATE_SET_LARGE_MOTOR_DURATION(&state, 0x41);
+		DS3_OUTPUT_STATE_SET_MOTOR_STRENGTHS(&state, 0x80, 0x7F);
+
+		SimOutputStateTemplate(format, buffer);
+
+		BOOLEAN isOk = DS3_OUTPUT_STATE_SERIALIZE(&state, DS3_OUTPUT_STATE_TAKE_DIRTY(&state), format, buffer, size)
+			&& buffer[prefix - 1] == 0x01
+			&& (format == Ds3OutputReportFormatUsb || buffer[0] == 0x52)
+			&& buffer[prefix + 1] == 0x40
+			&& buffer[prefix + 2] == 0x01
+			&& buffer[prefix + 3] == 0x41
+			&& buffer[prefix + 4] == 0x80
+			&& buffer[prefix + 9] == 0x1E;
+
+		//
+		// LED blocks go Player 4 first
+		//
+		for (UCHAR index = 0; index < ARRAYSIZE(state.Leds); index++)
+		{
+			const PUCHAR block = &buffer[prefix + 10 + (3 - index) * 5];
+
+			isOk = isOk
+				&& block[0] == 0x10 + index
+				&& block[1] == 0x12
+				&& block[2] == 0x34 + index
+				&& block[3] == 0x20 + index
+				&& block[4] == 0x30 + index;
+		}
+
+		snprintf(name, sizeof(name), "%s serialize offsets", formatName);
+		SimOutputStateCheck(name, isOk, &failed);
+
+		//
+		// Parsing the compiled report yields the state again, the small motor
+		// only knows on and off
+		//
+		DS3_OUTPUT_STATE_INIT(&parsed);
+		DS3_OUTPUT_STATE_PARSE(&parsed, DS3_OUTPUT_DIRTY_ALL, format, buffer, size);
+
+		isOk = parsed.LedFlags == state.LedFlags
+			&& memcmp(parsed.Leds, state.Leds, sizeof(state.Leds)) == 0
+			&& parsed.SmallMotor.Duration == state.SmallMotor.Duration
+			&& parsed.SmallMotor.Strength == 0x01
+			&& parsed.LargeMotor.Duration == state.LargeMotor.Duration
+			&& parsed.LargeMotor.Strength == state.LargeMotor.Strength;
+
+		snprintf(name, sizeof(name), "%s parse round trip", formatName);
+		SimOutputStateCheck(name, isOk, &failed);
+
+		//
+		// Setters only flag what they changed, a serialization only touches
+		// the flagged fields
+		//
+		DS3_OUTPUT_STATE_SET_LED_FLAGS(&state, 0x1E);
+		DS3_OUTPUT_STATE_SET_MOTOR_STRENGTHS(&state, 0x80, 0x7F);
+
+		isOk = DS3_OUTPUT_STATE_TAKE_DIRTY(&state) == 0;
+
+		DS3_OUTPUT_STATE_SET_LED_FLAGS(&state, 0x02);
+		DS3_OUTPUT_STATE_SET_MOTOR_STRENGTHS(&state, 0x81, 0x7F);
+
+		const ULONG dirty = DS3_OUTPUT_STATE_TAKE_DIRTY(&state);
+
+		isOk = isOk
+			&& dirty == (DS3_OUTPUT_DIRTY_LED_FLAGS | DS3_OUTPUT_DIRTY_LARGE_MOTOR_STRENGTH)
+			&& DS3_OUTPUT_STATE_TAKE_DIRTY(&state) == 0;
+
+		RtlCopyMemory(before, buffer, size);
+
+		isOk = isOk && DS3_OUTPUT_STATE_SERIALIZE(&state, DS3_OUTPUT_DIRTY_LED_FLAGS, format, buffer, size);
+
+		for (SIZE_T offset = 0; offset < size; offset++)
+		{
+			isOk = isOk && buffer[offset] == ((offset == prefix + 9) ? 0x02 : before[offset]);
+		}
+
+		isOk = isOk && !DS3_OUTPUT_STATE_SERIALIZE(&state, 0, format, buffer, size)
+			&& !DS3_OUTPUT_STATE_SERIALIZE(&state, DS3_OUTPUT_DIRTY_ALL, format, buffer, size - 1);
+
+		snprintf(name, sizeof(name), "%s dirty masks", formatName);
+		SimOutputStateCheck(name, isOk, &failed);
+
+		//
+		// Locked fields ignore setters and imports but still serialize
+		//
+		DS3_OUTPUT_STATE_SET_LOCKED_FIELDS(&state, DS3_OUTPUT_DIRTY_LED_FLAGS | DS3_OUTPUT_DIRTY_LED(0));
+		DS3_OUTPUT_STATE_SET_LED_FLAGS(&state, 0x04);
+		DS3_OUTPUT_STATE_SET_LED(&state, 0, 0x01, 0x0001, 0x01, 0x01);
+		DS3_OUTPUT_STATE_SET_LED(&state, 1, 0x02, 0x0002, 0x02, 0x02);
+
+		isOk = state.LedFlags == 0x02
+			&& state.Leds[0].TotalDuration == 0x10
+			&& state.Leds[1].TotalDuration == 0x02
+			&& DS3_OUTPUT_STATE_TAKE_DIRTY(&state) == DS3_OUTPUT_DIRTY_LED(1);
+
+		SimOutputStateTemplate(format, before);
+		before[prefix + 9] = 0x08;
+		before[prefix + 10 + 3 * 5] = 0x03;
+		before[prefix + 10 + 2 * 5] = 0x04;
+		before[prefix + 4] = 0x55;
+
+		DS3_OUTPUT_STATE_PARSE(&state, DS3_OUTPUT_DIRTY_ALL, format, before, size);
+
+		isOk = isOk
+			&& state.LedFlags == 0x02
+			&& state.Leds[0].TotalDuration == 0x10
+			&& state.Leds[1].TotalDuration == 0x04
+			&& state.LargeMotor.Strength == 0x55;
+
+		SimOutputStateTemplate(format, buffer);
+
+		isOk = isOk
+			&& DS3_OUTPUT_STATE_SERIALIZE(&state, DS3_OUTPUT_DIRTY_LED_FLAGS | DS3_OUTPUT_DIRTY_LED(0), format, buffer, size)
+			&& buffer[prefix + 9] == 0x02
+			&& buffer[prefix + 10 + 3 * 5] == 0x10;
+
+		snprintf(name, sizeof(name), "%s locked fields", formatName);
+		SimOutputStateCheck(name, isOk, &failed);
+	}
+
+	if (failed)
+	{
+		printf("\nFAILED: %lu checks\n", (unsigned long)failed);
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+//
+// Size of the stand-in for the driver's HID region
+//
+#define SIM_IPC_REGION_SIZE		0x10000
+#define SIM_IPC_MAX_PADS		64
+
+#ifdef _WIN32
+typedef HANDLE SIM_THREAD;
+#define SIM_THREAD_ROUTINE(_name_)	DWORD WINAPI _name_(LPVOID Context)
+#define SIM_THREAD_RETURN			0
+#else
+typedef pthread_t SIM_THREAD;
+#define SIM_THREAD_ROUTINE(_name_)	void* _name_(void* Context)
+#define SIM_THREAD_RETURN			NULL
+#endif
+
+//
+// Per thread counters, a cache line each so they don't skew the result
+//
+typedef struct
+{
+	PUCHAR Region;
+
+	ULONG SlotIndex;
+
+	volatile LONG* Stop;
+
+	ULONGLONG Operations;
+
+	ULONGLONG Torn;
+
+	UCHAR Padding[64];
+
+} SIM_IPC_WORKER;
+
+typedef struct
+{
+	const char* Name;
+
+	UINT32 SlotStride;
+
+	UINT32 SequenceOffset;
+
+} SIM_IPC_LAYOUT;
+
+static double SimNowSeconds(void)
+{
+#ifdef _WIN32
+	LARGE_INTEGER counter, frequency;
+	QueryPerformanceCounter(&counter);
+	QueryPerformanceFrequency(&frequency);
+	return (double)counter.QuadPart / (double)frequency.QuadPart;
+#else
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+#endif
+}
+
+static void SimSleepMs(ULONG Milliseconds)
+{
+#ifdef _WIN32
+	Sleep(Milliseconds);
+#else
+	struct timespec delay = { Milliseconds / 1000, (long)(Milliseconds % 1000) * 1000000L };
+	nanosleep(&delay, NULL);
+#endif
+}
+
+static BOOLEAN SimThreadStart(
+	SIM_THREAD* Thread,
+#ifdef _WIN32
+	LPTHREAD_START_ROUTINE Routine,
+#else
+	void* (*Routine)(void*),
+#endif
+	void* Context
+)
+{
+#ifdef _WIN32
+	*Thread = CreateThread(NULL, 0, Routine, Context, 0, NULL);
+	return *Thread != NULL;
+#else
+	return pthread_create(Thread, NULL, Routine, Context) == 0;
+#endif
+}
+
+static void SimThreadJoin(SIM_THREAD Thread)
+{
+#ifdef _WIN32
+	WaitForSingleObject(Thread, INFINITE);
+	CloseHandle(Thread);
+#else
+	pthread_join(Thread, NULL);
+#endif
+}
+
+//
+// Shared memory stands in for the driver's file mapping, so readers and
+// writers see the same cache behavior as across processes
+//
+static PUCHAR SimIpcMapRegion(void)
+{
+#ifdef _WIN32
+	const HANDLE mapping = CreateFileMappingA(
+		INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, SIM_IPC_REGION_SIZE, NULL
+	);
+
+	if (mapping == NULL)
+	{
+		return NULL;
+	}
+
+	PUCHAR region = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, SIM_IPC_REGION_SIZE);
+
+	// the view keeps the section alive
+	CloseHandle(mapping);
+
+	return region;
+#else
+	char name[64];
+	snprintf(name, sizeof(name), "/dshmsim-ipcbench-%ld", (long)getpid());
+
+	const int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+
+	if (fd < 0)
+	{
+		return NULL;
+	}
+
+	shm_unlink(name);
+
+	void* region = (ftruncate(fd, SIM_IPC_REGION_SIZE) == 0)
+		? mmap(NULL, SIM_IPC_REGION_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)
+		: MAP_FAILED;
+
+	close(fd);
+
+	return (region == MAP_FAILED) ? NULL : region;
+#endif
+}
+
+static void SimIpcUnmapRegion(PUCHAR Region)
+{
+#ifdef _WIN32
+	UnmapViewOfFile(Region);
+#else
+	munmap(Region, SIM_IPC_REGION_SIZE);
+#endif
+}
+
+//
+// Writes a slot the way the driver does, but at whatever layout the header
+// describes so both layouts run the very same code
+//
+static void SimIpcWrite(
+	PUCHAR Region,
+	ULONG SlotIndex,
+	UCHAR Fill
+)
+{
+	const PIPC_HID_REGION_HEADER header = DSHM_IPC_HID_HEADER(Region);
+	const PUCHAR slotBase = Region + header->SlotsOffset + (SIZE_T)header->SlotStride * (SlotIndex - 1);
+	const PIPC_HID_INPUT_REPORT_MESSAGE slot = (PIPC_HID_INPUT_REPORT_MESSAGE)slotBase;
+	volatile LONG* sequence = (volatile LONG*)(slotBase + header->SequenceOffset);
+	ULONG current;
+
+	while (((current = DSHM_IPC_LOAD32(sequence)) & 1) || !DSHM_IPC_CAS32(sequence, current, current + 1))
+	{
+	}
+
+	DSHM_IPC_WRITE_BARRIER();
+
+	slot->SlotIndex = SlotIndex;
+	memset(&slot->InputReport, Fill, sizeof(DS3_RAW_INPUT_REPORT));
+
+	DSHM_IPC_STORE32(sequence, current + 2);
+}
+
+static SIM_THREAD_ROUTINE(SimIpcWriter)
+{
+	SIM_IPC_WORKER* worker = Context;
+	ULONGLONG count = 0;
+
+	while (!DSHM_IPC_LOAD32(worker->Stop))
+	{
+		SimIpcWrite(worker->Region, worker->SlotIndex, (UCHAR)count);
+		count++;
+	}
+
+	worker->Operations = count;
+
+	return SIM_THREAD_RETURN;
+}
+
+//
+// Polls its pad like a feeder application would, verifying every copy
+//
+static SIM_THREAD_ROUTINE(SimIpcReader)
+{
+	SIM_IPC_WORKER* worker = Context;
+	IPC_HID_INPUT_REPORT_MESSAGE message;
+	ULONGLONG count = 0;
+	ULONGLONG torn = 0;
+	ULONG sequence;
+
+	while (!DSHM_IPC_LOAD32(worker->Stop))
+	{
+		if (!DSHM_IPC_HID_READ(worker->Region, worker->SlotIndex, &message, &sequence))
+		{
+			continue;
+		}
+
+		const PUCHAR bytes = (PUCHAR)&message.InputReport;
+
+		for (SIZE_T index = 1; index < sizeof(DS3_RAW_INPUT_REPORT); index++)
+		{
+			if (bytes[index] != bytes[0])
+			{
+				torn++;
+				break;
+			}
+		}
+
+		count++;
+	}
+
+	worker->Operations = count;
+	worker->Torn = torn;
+
+	return SIM_THREAD_RETURN;
+}
+
+static BOOLEAN SimIpcRun(
+	PUCHAR Region,
+	const SIM_IPC_LAYOUT* Layout,
+	ULONG PadCount,
+	ULONG DurationMs
+)
+{
+	static SIM_IPC_WORKER writers[SIM_IPC_MAX_PADS];
+	static SIM_IPC_WORKER readers[SIM_IPC_MAX_PADS];
+	SIM_THREAD threads[SIM_IPC_MAX_PADS * 2];
+	volatile LONG stop = 0;
+	ULONG started = 0;
+	ULONGLONG writes = 0, reads = 0, torn = 0;
+
+	memset(Region, 0, SIM_IPC_REGION_SIZE);
+
+	const PIPC_HID_REGION_HEADER header = DSHM_IPC_HID_HEADER(Region);
+
+	header->Version = DSHM_IPC_HID_VERSION;
+	header->Size = sizeof(IPC_HID_REGION_HEADER);
+	header->SlotCount = DSHM_IPC_HID_SLOT_COUNT;
+	header->SlotStride = Layout->SlotStride;
+	header->SequenceOffset = Layout->SequenceOffset;
+	header->Magic = DSHM_IPC_HID_MAGIC;
+
+	for (ULONG pad = 0; pad < PadCount; pad++)
+	{
+		SIM_IPC_WORKER init = { Region, pad + 1, &stop, 0, 0, { 0 } };
+
+		writers[pad] = init;
+		readers[pad] = init;
+	}
+
+	for (ULONG pad = 0; pad < PadCount; pad++)
+	{
+		if (!SimThreadStart(&threads[started], SimIpcWriter, &writers[pad]))
+			break;
+		started++;
+
+		if (!SimThreadStart(&threads[started], SimIpcReader, &readers[pad]))
+			break;
+		started++;
+	}
+
+	const double begin = SimNowSeconds();
+
+	if (started == PadCount * 2)
+	{
+		SimSleepMs(DurationMs);
+	}
+
+	DSHM_IPC_STORE32(&stop, 1);
+
+	for (ULONG index = 0; index < started; index++)
+	{
+		SimThreadJoin(threads[index]);
+	}
+
+	const double seconds = SimNowSeconds() - begin;
+
+	if (started != PadCount * 2)
+	{
+		printf("Can't start %lu threads\n", (unsigned long)PadCount * 2);
+		return FALSE;
+	}
+
+	for (ULONG pad = 0; pad < PadCount; pad++)
+	{
+		writes += writers[pad].Operations;
+		reads += readers[pad].Operations;
+		torn += readers[pad].Torn;
+	}
+
+	printf("%-14s %6lu %14.0f %14.0f %8llu\n",
+		Layout->Name,
+		(unsigned long)Layout->SlotStride,
+		writes / seconds,
+		reads / seconds,
+		(unsigned long long)torn
+	);
+
+	return torn == 0;
+}
+
+//
+// Pads updating their slots while one reader per pad polls it, once with
+// slots packed back to back (counter right behind the message) and once with
+// cache line sized slots as the driver lays them out
+//
+static int SimIpcBench(int argc, char* argv[])
+{
+	const UINT32 packedSequenceOffset = (sizeof(IPC_HID_INPUT_REPORT_MESSAGE) + sizeof(LONG) - 1) & ~(sizeof(LONG) - 1);
+	const SIM_IPC_LAYOUT layouts[] = {
+		{ "packed", packedSequenceOffset + sizeof(LONG), packedSequenceOffset },
+		{ "aligned", DSHM_IPC_HID_SLOT_STRIDE, FIELD_OFFSET(IPC_HID_SLOT, Sequence) },
+	};
+	ULONG padCount = 8;
+	ULONG durationMs = 2000;
+	BOOLEAN isOk = TRUE;
+
+	if (argc > 0)
+	{
+		padCount = strtoul(argv[0], NULL, 10);
+	}
+
+	if (argc > 1)
+	{
+		durationMs = strtoul(argv[1], NULL, 10);
+	}
+
+	if (padCount == 0 || padCount > SIM_IPC_MAX_PADS)
+	{
+		printf("Pad count must be between 1 and %d\n", SIM_IPC_MAX_PADS);
+		return EXIT_FAILURE;
+	}
+
+	const PUCHAR region = SimIpcMapRegion();
+
+	if (region == NULL)
+	{
+		printf("Can't map shared memory\n");
+		return EXIT_FAILURE;
+	}
+
+	printf("%lu pads, %lu ms per layout\n\n", (unsigned long)padCount, (unsigned long)durationMs);
+	printf("%-14s %6s %14s %14s %8s\n", "layout", "stride", "writes/s", "reads/s", "torn");
+
+	for (ULONG index = 0; index < ARRAYSIZE(layouts); index++)
+	{
+		isOk = SimIpcRun(region, &layouts[index], padCount, durationMs) && isOk;
+	}
+
+	SimIpcUnmapRegion(region);
+
+	return isOk ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static void Usage(const char* Name)
+{
+	printf("Usage: %s <simulation> [arguments]\n\n", Name);
+	printf("  airtime [seconds] [rate Hz per pad...]\n");
+	printf("      Bluetooth output report budget shared by multiple pads\n");
+	printf("  ffb\n");
+	printf("      Force feedback effect engine against scripted PID reports\n");
+	printf("  ffbreplay <recording> [timeline.csv|-] [passes]\n");
+	printf("      Replays recorded PID reports, optionally measuring engine cost\n");
+	printf("  ffbsample <recording>\n");
+	printf("      Writes a sample recording\n");
+	printf("  q15\n");
+	printf("      Fixed point effect math error bounds against floating point\n");
+	printf("  outputstate\n");
+	printf("      Output report serialization and parsing for USB and Bluetooth\n");
+	printf("  ipcbench [pads] [milliseconds]\n");
+	printf("      Input report slot throughput of the packed and the cache line aligned layout\n");
+	printf("  ipcclient [pads] [pinging threads] [milliseconds]\n");
+	printf("      C++ IPC client against a fake driver serving the shared memory regions\n");
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		Usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	if (strcmp(argv[1], "airtime") == 0)
+	{
+		return SimAirtime(argc - 2, &argv[2]);
+	}
+
+	if (strcmp(argv[1], "ffb") == 0)
+	{
+		return SimFfb(argc - 2, &argv[2]);
+	}
+
+	if (strcmp(argv[1], "ffbreplay") == 0)
+	{
+		return SimFfbReplay(argc - 2, &argv[2]);
+	}
+
+	if (strcmp(argv[1], "ffbsample") == 0)
+	{
+		return SimFfbSample(argc - 2, &argv[2]);
+	}
+
+	if (strcmp(argv[1], "q15") == 0)
+	{
+		return SimQ15(argc - 2, &argv[2]);
+	}
+
+	if (strcmp(argv[1], "outputstate") == 0)
+	{
+		return SimOutputState(argc - 2, &argv[2]);
+	}
+
+	if (strcmp(argv[1], "ipcbench") == 0)
+	{
+		return SimIpcBench(argc - 2, &argv[2]);
+	}
+
+	if (strcmp(argv[1], "ipcclient") == 0)
+	{
+		return SimIpcClient(argc - 2, &argv[2]);
+	}
+
+	Usage(argv[0]);
+	return EXIT_FAILURE;
+}
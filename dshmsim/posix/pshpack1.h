@@ -0,0 +1,5 @@
+//
+// Stand-in for the Windows SDK header on POSIX hosts
+//
+
+#pragma pack(push, 1)
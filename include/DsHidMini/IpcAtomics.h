@@ -0,0 +1,51 @@
+#pragma once
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+//
+// Atomic accesses to the driver IPC file mapping, shared by the driver and
+// native clients. Loads are plain (relaxed) reads, ordering is established
+// with the explicit barriers. Stores publish (release), compare-exchanges,
+// exchanges and ORs act as full barriers and return the previous value.
+// Relaxed adds only guarantee that no increment gets lost, for counters.
+//
+
+#if defined(_MSC_VER)
+#define DSHM_IPC_LOAD32(_target_)					((ULONG)__iso_volatile_load32((const volatile int*)(_target_)))
+#define DSHM_IPC_STORE32(_target_, _value_)			((void)_InterlockedExchange((volatile LONG*)(_target_), (LONG)(_value_)))
+#define DSHM_IPC_CAS32(_target_, _expected_, _desired_)	\
+	(_InterlockedCompareExchange((volatile LONG*)(_target_), (LONG)(_desired_), (LONG)(_expected_)) == (LONG)(_expected_))
+#define DSHM_IPC_LOAD64(_target_)					((ULONGLONG)__iso_volatile_load64((const volatile __int64*)(_target_)))
+#define DSHM_IPC_CAS64(_target_, _expected_, _desired_)	\
+	(_InterlockedCompareExchange64((volatile LONGLONG*)(_target_), (LONGLONG)(_desired_), (LONGLONG)(_expected_)) == (LONGLONG)(_expected_))
+#define DSHM_IPC_STORE64(_target_, _value_)			((void)_InterlockedExchange64((volatile LONGLONG*)(_target_), (LONGLONG)(_value_)))
+#define DSHM_IPC_EXCHANGE64(_target_, _value_)		((ULONGLONG)_InterlockedExchange64((volatile LONGLONG*)(_target_), (LONGLONG)(_value_)))
+// no _InterlockedOr64 intrinsic on x86, winnt.h falls back to a compare-exchange loop there
+#define DSHM_IPC_OR64(_target_, _value_)			((ULONGLONG)InterlockedOr64((volatile LONGLONG*)(_target_), (LONGLONG)(_value_)))
+#define DSHM_IPC_ADD64_RELAXED(_target_, _value_)	((void)InterlockedExchangeAddNoFence64((volatile LONGLONG*)(_target_), (LONGLONG)(_value_)))
+#if defined(_M_ARM64)
+#define DSHM_IPC_READ_BARRIER()						__dmb(_ARM64_BARRIER_ISHLD)
+#define DSHM_IPC_WRITE_BARRIER()					__dmb(_ARM64_BARRIER_ISH)
+#else
+#define DSHM_IPC_READ_BARRIER()						_ReadWriteBarrier()
+#define DSHM_IPC_WRITE_BARRIER()					_ReadWriteBarrier()
+#endif
+#else
+#define DSHM_IPC_LOAD32(_target_)					((ULONG)__atomic_load_n((_target_), __ATOMIC_RELAXED))
+#define DSHM_IPC_STORE32(_target_, _value_)			__atomic_store_n((_target_), (LONG)(_value_), __ATOMIC_RELEASE)
+#define DSHM_IPC_CAS32(_target_, _expected_, _desired_)	\
+	__extension__ ({ LONG _e = (LONG)(_expected_); \
+		__atomic_compare_exchange_n((_target_), &_e, (LONG)(_desired_), 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED); })
+#define DSHM_IPC_LOAD64(_target_)					((ULONGLONG)__atomic_load_n((_target_), __ATOMIC_RELAXED))
+#define DSHM_IPC_CAS64(_target_, _expected_, _desired_)	\
+	__extension__ ({ LONGLONG _e = (LONGLONG)(_expected_); \
+		__atomic_compare_exchange_n((_target_), &_e, (LONGLONG)(_desired_), 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED); })
+#define DSHM_IPC_STORE64(_target_, _value_)			__atomic_store_n((_target_), (LONGLONG)(_value_), __ATOMIC_RELEASE)
+#define DSHM_IPC_EXCHANGE64(_target_, _value_)		((ULONGLONG)__atomic_exchange_n((_target_), (LONGLONG)(_value_), __ATOMIC_ACQ_REL))
+#define DSHM_IPC_OR64(_target_, _value_)			((ULONGLONG)__atomic_fetch_or((_target_), (LONGLONG)(_value_), __ATOMIC_ACQ_REL))
+#define DSHM_IPC_ADD64_RELAXED(_target_, _value_)	((void)__atomic_fetch_add((_target_), (LONGLONG)(_value_), __ATOMIC_RELAXED))
+#define DSHM_IPC_READ_BARRIER()						__atomic_thread_fence(__ATOMIC_ACQUIRE)
+#define DSHM_IPC_WRITE_BARRIER()					__atomic_thread_fence(__ATOMIC_RELEASE)
+#endif
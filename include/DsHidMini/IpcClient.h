@@ -0,0 +1,1251 @@
+#pragma once
+
+//
+// Header-only C++ client for the driver IPC file mapping, for native tools
+// that would otherwise go through the .NET SDK or plain HID.
+//
+// The protocol logic only ever talks to a Transport, which supplies the file
+// mapping views and the named auto-reset events. WindowsTransport attaches to
+// a running driver. PosixTransport puts the same objects into POSIX shared
+// memory with futex based events, so the protocol can be exercised against a
+// fake driver loop on a Linux host (see dshmsim ipcclient); there the Windows
+// types come from DsPortable.h, which must be included first.
+//
+// Commands require a driver offering the command ring (IpcCommandRing.h).
+//
+
+#ifndef __cplusplus
+#error IpcClient.h requires C++17 or newer
+#endif
+
+#include "IpcMessages.h"
+#include "IpcHidRegion.h"
+#include "IpcCommandRing.h"
+#include "IpcOutputRing.h"
+#include "IpcCounters.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <climits>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace DsHidMini::Ipc
+{
+	/** Timeout value to wait without limit */
+	constexpr ULONG WaitForever = 0xFFFFFFFF;
+
+	/** Default time to wait for a command reply, same as the .NET SDK */
+	constexpr ULONG DefaultReplyTimeoutMs = 500;
+
+	/** Outcome of a client call */
+	enum class Result
+	{
+		Success,
+		/** No driver around, or it doesn't offer what the call needs */
+		Unavailable,
+		/** Device index or argument out of range */
+		InvalidParameter,
+		/** All command slots are in use, or the output ring is full or owned by another process */
+		Busy,
+		/** The driver didn't reply in time */
+		Timeout,
+		/** The reply doesn't belong to the request */
+		UnexpectedReply
+	};
+
+	/** Auto-reset event shared with the driver */
+	class Event
+	{
+	public:
+		virtual ~Event() = default;
+
+		virtual void Signal() = 0;
+
+		/** Waits for the event to become signaled and resets it, false on timeout */
+		virtual bool Wait(ULONG TimeoutMs) = 0;
+	};
+
+	/** Supplies the named objects the driver creates */
+	class Transport
+	{
+	public:
+		virtual ~Transport() = default;
+
+		/** Opens the driver file mapping, false if there's no driver */
+		virtual bool Open() = 0;
+
+		virtual void Close() = 0;
+
+		/** Views start at multiples of the allocation granularity */
+		virtual ULONG Granularity() const = 0;
+
+		/** nullptr on failure */
+		virtual PUCHAR MapView(ULONG Offset, ULONG Size, bool Writable) = 0;
+
+		virtual void UnmapView(PUCHAR View, ULONG Size) = 0;
+
+		/** nullptr if the driver didn't create the event */
+		virtual std::unique_ptr<Event> OpenNamedEvent(const char* Name) = 0;
+
+		/** Takes over an event the driver host process handed out by handle */
+		virtual std::unique_ptr<Event> OpenRemoteEvent(ULONG ProcessId, HANDLE Handle) = 0;
+
+		virtual ULONG ProcessId() const = 0;
+	};
+
+#if defined(_WIN32)
+
+	class WindowsEvent final : public Event
+	{
+	public:
+		explicit WindowsEvent(HANDLE Handle) : Handle(Handle) {}
+
+		~WindowsEvent() override { CloseHandle(Handle); }
+
+		WindowsEvent(const WindowsEvent&) = delete;
+		WindowsEvent& operator=(const WindowsEvent&) = delete;
+
+		void Signal() override { SetEvent(Handle); }
+
+		bool Wait(ULONG TimeoutMs) override { return WaitForSingleObject(Handle, TimeoutMs) == WAIT_OBJECT_0; }
+
+		/** For use with WaitForMultipleObjects and friends */
+		HANDLE Get() const { return Handle; }
+
+	private:
+		HANDLE Handle;
+	};
+
+	/** Attaches to the running driver */
+	class WindowsTransport final : public Transport
+	{
+	public:
+		~WindowsTransport() override { WindowsTransport::Close(); }
+
+		bool Open() override
+		{
+			if (Mapping == nullptr)
+			{
+				Mapping = OpenFileMappingA(FILE_MAP_READ | FILE_MAP_WRITE, FALSE, DSHM_IPC_FILE_MAP_NAME);
+			}
+
+			return Mapping != nullptr;
+		}
+
+		void Close() override
+		{
+			if (Mapping != nullptr)
+			{
+				CloseHandle(Mapping);
+				Mapping = nullptr;
+			}
+		}
+
+		ULONG Granularity() const override
+		{
+			SYSTEM_INFO info;
+			GetSystemInfo(&info);
+			return info.dwAllocationGranularity;
+		}
+
+		PUCHAR MapView(ULONG Offset, ULONG Size, bool Writable) override
+		{
+			return static_cast<PUCHAR>(MapViewOfFile(
+				Mapping,
+				Writable ? FILE_MAP_READ | FILE_MAP_WRITE : FILE_MAP_READ,
+				0,
+				Offset,
+				Size
+			));
+		}
+
+		void UnmapView(PUCHAR View, ULONG Size) override
+		{
+			UNREFERENCED_PARAMETER(Size);
+			UnmapViewOfFile(View);
+		}
+
+		std::unique_ptr<Event> OpenNamedEvent(const char* Name) override
+		{
+			const HANDLE handle = OpenEventA(EVENT_MODIFY_STATE | SYNCHRONIZE, FALSE, Name);
+
+			return handle != nullptr ? std::make_unique<WindowsEvent>(handle) : nullptr;
+		}
+
+		std::unique_ptr<Event> OpenRemoteEvent(ULONG ProcessId, HANDLE Handle) override
+		{
+			const HANDLE process = OpenProcess(PROCESS_DUP_HANDLE, FALSE, ProcessId);
+			HANDLE duplicate = nullptr;
+
+			if (process == nullptr)
+			{
+				return nullptr;
+			}
+
+			const BOOL isDuplicated = DuplicateHandle(
+				process,
+				Handle,
+				GetCurrentProcess(),
+				&duplicate,
+				0,
+				FALSE,
+				DUPLICATE_SAME_ACCESS
+			);
+
+			CloseHandle(process);
+
+			return isDuplicated ? std::make_unique<WindowsEvent>(duplicate) : nullptr;
+		}
+
+		ULONG ProcessId() const override { return GetCurrentProcessId(); }
+
+	private:
+		HANDLE Mapping{};
+	};
+
+#else
+
+	/** Auto-reset event on a futex word living in a shared memory object of its own */
+	class PosixEvent final : public Event
+	{
+	public:
+		explicit PosixEvent(volatile LONG* Word) : Word(Word) {}
+
+		~PosixEvent() override { munmap(const_cast<LONG*>(Word), sizeof(LONG)); }
+
+		PosixEvent(const PosixEvent&) = delete;
+		PosixEvent& operator=(const PosixEvent&) = delete;
+
+		void Signal() override
+		{
+			DSHM_IPC_STORE32(Word, 1);
+			syscall(SYS_futex, Word, FUTEX_WAKE, 1, nullptr, nullptr, 0);
+		}
+
+		bool Wait(ULONG TimeoutMs) override
+		{
+			const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(TimeoutMs);
+
+			while (!DSHM_IPC_CAS32(Word, 1, 0))
+			{
+				if (TimeoutMs == WaitForever)
+				{
+					syscall(SYS_futex, Word, FUTEX_WAIT, 0, nullptr, nullptr, 0);
+					continue;
+				}
+
+				const auto remaining = std::chrono::duration_cast<std::chrono::nanoseconds>(
+					deadline - std::chrono::steady_clock::now()
+				).count();
+
+				if (remaining <= 0)
+				{
+					return false;
+				}
+
+				const timespec timeout{
+					static_cast<time_t>(remaining / 1000000000),
+					static_cast<long>(remaining % 1000000000)
+				};
+
+				// returns right away if signaled in between
+				syscall(SYS_futex, Word, FUTEX_WAIT, 0, &timeout, nullptr, 0);
+			}
+
+			return true;
+		}
+
+	private:
+		volatile LONG* Word;
+	};
+
+	/**
+	 * Stand-in for the Windows named objects. "Global\Name" becomes the shared
+	 * memory object "/<Prefix>Name"; the prefix keeps concurrent runs apart.
+	 * The Create* methods play the driver's part; whatever got created is
+	 * removed again along with the transport.
+	 */
+	class PosixTransport final : public Transport
+	{
+	public:
+		/** Same as the driver's layout on Windows, mmap offsets must be page aligned */
+		static constexpr ULONG AllocationGranularity = 0x10000;
+
+		explicit PosixTransport(std::string Prefix = {}) : Prefix(std::move(Prefix)) {}
+
+		~PosixTransport() override
+		{
+			PosixTransport::Close();
+
+			for (const std::string& name : Created)
+			{
+				shm_unlink(name.c_str());
+			}
+		}
+
+		PosixTransport(const PosixTransport&) = delete;
+		PosixTransport& operator=(const PosixTransport&) = delete;
+
+		bool Open() override
+		{
+			if (Mapping < 0)
+			{
+				Mapping = shm_open(ObjectName(DSHM_IPC_FILE_MAP_NAME).c_str(), O_RDWR, 0);
+			}
+
+			return Mapping >= 0;
+		}
+
+		void Close() override
+		{
+			if (Mapping >= 0)
+			{
+				close(Mapping);
+				Mapping = -1;
+			}
+		}
+
+		ULONG Granularity() const override { return AllocationGranularity; }
+
+		PUCHAR MapView(ULONG Offset, ULONG Size, bool Writable) override
+		{
+			void* view = mmap(
+				nullptr,
+				Size,
+				Writable ? PROT_READ | PROT_WRITE : PROT_READ,
+				MAP_SHARED,
+				Mapping,
+				static_cast<off_t>(Offset)
+			);
+
+			return view != MAP_FAILED ? static_cast<PUCHAR>(view) : nullptr;
+		}
+
+		void UnmapView(PUCHAR View, ULONG Size) override { munmap(View, Size); }
+
+		std::unique_ptr<Event> OpenNamedEvent(const char* Name) override
+		{
+			return MapEvent(ObjectName(Name), false);
+		}
+
+		/** Handles resolve to events named after RemoteEventName */
+		std::unique_ptr<Event> OpenRemoteEvent(ULONG ProcessId, HANDLE Handle) override
+		{
+			UNREFERENCED_PARAMETER(ProcessId);
+			return OpenNamedEvent(RemoteEventName(Handle).c_str());
+		}
+
+		ULONG ProcessId() const override { return static_cast<ULONG>(getpid()); }
+
+		/** Driver side, creates and opens the file mapping */
+		bool Create(ULONG Size)
+		{
+			const std::string name = ObjectName(DSHM_IPC_FILE_MAP_NAME);
+
+			Mapping = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+
+			if (Mapping < 0)
+			{
+				return false;
+			}
+
+			Created.push_back(name);
+
+			return ftruncate(Mapping, static_cast<off_t>(Size)) == 0;
+		}
+
+		/** Driver side */
+		std::unique_ptr<Event> CreateNamedEvent(const char* Name)
+		{
+			return MapEvent(ObjectName(Name), true);
+		}
+
+		/** Name of the event a handle value handed out by the (fake) driver stands for */
+		static std::string RemoteEventName(HANDLE Handle)
+		{
+			return "Global\\DsHidMiniRemoteEvent" + std::to_string(reinterpret_cast<uintptr_t>(Handle));
+		}
+
+	private:
+		std::string ObjectName(const char* Name) const
+		{
+			const char* separator = std::strrchr(Name, '\\');
+
+			return "/" + Prefix + (separator != nullptr ? separator + 1 : Name);
+		}
+
+		std::unique_ptr<Event> MapEvent(const std::string& Name, bool IsCreate)
+		{
+			const int fd = shm_open(Name.c_str(), IsCreate ? O_RDWR | O_CREAT | O_EXCL : O_RDWR, 0600);
+
+			if (fd < 0)
+			{
+				return nullptr;
+			}
+
+			if (IsCreate)
+			{
+				Created.push_back(Name);
+
+				if (ftruncate(fd, sizeof(LONG)) != 0)
+				{
+					close(fd);
+					return nullptr;
+				}
+			}
+
+			void* word = mmap(nullptr, sizeof(LONG), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+			// the mapping keeps the object alive
+			close(fd);
+
+			return word != MAP_FAILED ? std::make_unique<PosixEvent>(static_cast<volatile LONG*>(word)) : nullptr;
+		}
+
+		std::string Prefix;
+		int Mapping{ -1 };
+		std::vector<std::string> Created;
+	};
+
+#endif
+
+	/**
+	 * Session with the driver. Commands may be issued from multiple threads at
+	 * once (each takes a command ring slot of its own); output requests of a
+	 * device must come from one Client per process.
+	 */
+	class Client
+	{
+	public:
+		explicit Client(Transport& Link) : Link(Link) {}
+
+		~Client() { Disconnect(); }
+
+		Client(const Client&) = delete;
+		Client& operator=(const Client&) = delete;
+
+		/** Maps the regions the driver offers */
+		Result Connect()
+		{
+			Disconnect();
+
+			if (!Link.Open())
+			{
+				return Result::Unavailable;
+			}
+
+			ViewSize = Link.Granularity();
+			Commands = Link.MapView(0, ViewSize, true);
+			// writable for taking the changed slots mask
+			Hid = Link.MapView(ViewSize, ViewSize, true);
+
+			if (Commands == nullptr || Hid == nullptr)
+			{
+				Disconnect();
+				return Result::Unavailable;
+			}
+
+			const PIPC_HID_REGION_HEADER header = DSHM_IPC_HID_HEADER(Hid);
+
+			if (DSHM_IPC_LOAD32(&header->Magic) != DSHM_IPC_HID_MAGIC)
+			{
+				Disconnect();
+				return Result::Unavailable;
+			}
+
+			DSHM_IPC_READ_BARRIER();
+
+			const PIPC_CMD_RING_HEADER ring = DSHM_IPC_CMD_RING(Commands);
+
+			if (DSHM_IPC_LOAD32(&ring->Magic) == DSHM_IPC_CMD_RING_MAGIC
+				&& ring->SlotCount <= DSHM_IPC_CMD_SLOT_COUNT
+				&& ring->QueueCapacity == DSHM_IPC_CMD_QUEUE_CAPACITY)
+			{
+				CommandRingEvent = Link.OpenNamedEvent(DSHM_IPC_CMD_RING_EVENT_NAME);
+				CommandRing = CommandRingEvent ? ring : nullptr;
+			}
+
+			if (header->HistoryDepth != 0)
+			{
+				HistorySize = header->HistoryStride * DSHM_IPC_HID_SLOT_COUNT;
+				History = Link.MapView(header->HistoryOffset, HistorySize, false);
+				HistoryDepth = History != nullptr ? header->HistoryDepth : 0;
+			}
+
+			InputChangedEvent = Link.OpenNamedEvent(DSHM_IPC_HID_CHANGED_EVENT_NAME);
+
+			if (header->OutputOffset != 0)
+			{
+				OutputSize = header->OutputSize;
+				Output = reinterpret_cast<PIPC_OUTPUT_REGION_HEADER>(
+					Link.MapView(header->OutputOffset, OutputSize, true)
+				);
+
+				if (Output != nullptr
+					&& DSHM_IPC_LOAD32(&Output->Magic) == DSHM_IPC_OUTPUT_MAGIC
+					&& Output->RingCount == DSHM_IPC_OUTPUT_RING_COUNT
+					&& Output->RingDepth == DSHM_IPC_OUTPUT_RING_DEPTH
+					&& Output->RequestSize == sizeof(IPC_OUTPUT_REQUEST))
+				{
+					OutputRingEvent = Link.OpenNamedEvent(DSHM_IPC_OUTPUT_RING_EVENT_NAME);
+				}
+			}
+
+			if (header->CountersOffset != 0)
+			{
+				CountersSize = header->CountersSize;
+				Counters = reinterpret_cast<PIPC_COUNTERS_REGION_HEADER>(
+					Link.MapView(header->CountersOffset, CountersSize, false)
+				);
+			}
+
+			return Result::Success;
+		}
+
+		/** Unmaps everything and hands claimed output rings back */
+		void Disconnect()
+		{
+			if (Counters != nullptr)
+			{
+				Link.UnmapView(reinterpret_cast<PUCHAR>(Counters), CountersSize);
+				Counters = nullptr;
+			}
+
+			if (Output != nullptr)
+			{
+				if (OutputRingEvent)
+				{
+					for (ULONG index = 1; index <= DSHM_IPC_OUTPUT_RING_COUNT; index++)
+					{
+						DSHM_IPC_OUTPUT_RING_RELEASE(DSHM_IPC_OUTPUT_RING(Output, index), Link.ProcessId());
+					}
+				}
+
+				Link.UnmapView(reinterpret_cast<PUCHAR>(Output), OutputSize);
+				Output = nullptr;
+			}
+
+			if (History != nullptr)
+			{
+				Link.UnmapView(History, HistorySize);
+				History = nullptr;
+				HistoryDepth = 0;
+			}
+
+			if (Hid != nullptr)
+			{
+				Link.UnmapView(Hid, ViewSize);
+				Hid = nullptr;
+			}
+
+			if (Commands != nullptr)
+			{
+				Link.UnmapView(Commands, ViewSize);
+				Commands = nullptr;
+			}
+
+			CommandRing = nullptr;
+			CommandRingEvent.reset();
+			OutputRingEvent.reset();
+			InputChangedEvent.reset();
+
+			for (std::unique_ptr<Event>& replyEvent : ReplyEvents)
+			{
+				replyEvent.reset();
+			}
+
+			Link.Close();
+		}
+
+		bool IsConnected() const { return Hid != nullptr; }
+
+		bool HasCommands() const { return CommandRing != nullptr; }
+
+		/** Commands to several devices go out in a single round trip */
+		bool HasCommandBatches() const { return HasCommands() && CommandRing->Version >= DSHM_IPC_CMD_RING_BATCH_VERSION; }
+
+		bool HasInputHistory() const { return HistoryDepth != 0; }
+
+		bool HasOutputChannel() const { return OutputRingEvent != nullptr; }
+
+		bool HasInputChangedEvent() const { return InputChangedEvent != nullptr; }
+
+		bool HasCounters() const { return Counters != nullptr && DSHM_IPC_LOAD32(&Counters->Magic) == DSHM_IPC_COUNTERS_MAGIC; }
+
+		/** Ticks per second of IPC_DEVICE_COUNTERS::ProcessingTicks, 0 without counters */
+		LONGLONG GetCountersFrequency() const { return HasCounters() ? Counters->TimestampFrequency : 0; }
+
+		/** Checks whether the driver processes commands */
+		Result Ping(ULONG TimeoutMs = DefaultReplyTimeoutMs)
+		{
+			DSHM_IPC_MSG_HEADER message{};
+
+			message.Type = DSHM_IPC_MSG_TYPE_REQUEST_RESPONSE;
+			message.Target = DSHM_IPC_MSG_TARGET_DRIVER;
+			message.Command.Driver = DSHM_IPC_MSG_CMD_DRIVER_PING;
+			message.TargetIndex = 0;
+			message.Size = sizeof(message);
+
+			const Result result = Exchange(&message, sizeof(message), sizeof(message), TimeoutMs);
+
+			if (result != Result::Success)
+			{
+				return result;
+			}
+
+			return message.Type == DSHM_IPC_MSG_TYPE_REQUEST_REPLY
+				&& message.Target == DSHM_IPC_MSG_TARGET_CLIENT
+				&& message.Command.Driver == DSHM_IPC_MSG_CMD_DRIVER_PING
+				&& message.TargetIndex == 0
+				&& message.Size == sizeof(message)
+				? Result::Success
+				: Result::UnexpectedReply;
+		}
+
+		/** Writes a new host address to a device, the statuses come from the driver */
+		Result PairTo(
+			ULONG DeviceIndex,
+			const DSHM_IPC_BD_ADDR& Address,
+			NTSTATUS& WriteStatus,
+			NTSTATUS& ReadStatus,
+			ULONG TimeoutMs = DefaultReplyTimeoutMs
+		)
+		{
+			union
+			{
+				DSHM_IPC_MSG_PAIR_TO_REQUEST Request;
+				DSHM_IPC_MSG_PAIR_TO_REPLY Reply;
+			} message{};
+
+			if (!IsValidDeviceIndex(DeviceIndex))
+			{
+				return Result::InvalidParameter;
+			}
+
+			InitDeviceRequest(message.Request.Header, DSHM_IPC_MSG_CMD_DEVICE_PAIR_TO, DeviceIndex, sizeof(message.Request));
+			message.Request.Address = Address;
+
+			const Result result = Exchange(&message, sizeof(message.Request), sizeof(message.Reply), TimeoutMs);
+
+			if (result != Result::Success)
+			{
+				return result;
+			}
+
+			if (!IsDeviceReply(message.Reply.Header, DSHM_IPC_MSG_TYPE_REQUEST_REPLY, DSHM_IPC_MSG_CMD_DEVICE_PAIR_TO, DeviceIndex, sizeof(message.Reply)))
+			{
+				return Result::UnexpectedReply;
+			}
+
+			WriteStatus = message.Reply.WriteStatus;
+			ReadStatus = message.Reply.ReadStatus;
+
+			return Result::Success;
+		}
+
+		/** Switches the player LEDs to a player index of 1 to 7 */
+		Result SetPlayerIndex(
+			ULONG DeviceIndex,
+			UCHAR PlayerIndex,
+			NTSTATUS& Status,
+			ULONG TimeoutMs = DefaultReplyTimeoutMs
+		)
+		{
+			union
+			{
+				DSHM_IPC_MSG_SET_PLAYER_INDEX_REQUEST Request;
+				DSHM_IPC_MSG_SET_PLAYER_INDEX_REPLY Reply;
+			} message{};
+
+			if (!IsValidDeviceIndex(DeviceIndex))
+			{
+				return Result::InvalidParameter;
+			}
+
+			InitDeviceRequest(message.Request.Header, DSHM_IPC_MSG_CMD_DEVICE_SET_PLAYER_INDEX, DeviceIndex, sizeof(message.Request));
+			message.Request.PlayerIndex = PlayerIndex;
+
+			const Result result = Exchange(&message, sizeof(message.Request), sizeof(message.Reply), TimeoutMs);
+
+			if (result != Result::Success)
+			{
+				return result;
+			}
+
+			if (!IsDeviceReply(message.Reply.Header, DSHM_IPC_MSG_TYPE_REQUEST_REPLY, DSHM_IPC_MSG_CMD_DEVICE_SET_PLAYER_INDEX, DeviceIndex, sizeof(message.Reply)))
+			{
+				return Result::UnexpectedReply;
+			}
+
+			Status = message.Reply.NtStatus;
+
+			return Result::Success;
+		}
+
+		/**
+		 * Writes the same host address to several devices, as many per round
+		 * trip as fit into a command ring slot. A device's statuses are the
+		 * ones of PairTo, or both the reason the driver couldn't dispatch the
+		 * command (e.g. no such device). Drivers predating batches get one
+		 * command per device.
+		 */
+		Result PairTo(
+			const ULONG* DeviceIndexes,
+			ULONG Count,
+			const DSHM_IPC_BD_ADDR& Address,
+			NTSTATUS* WriteStatuses,
+			NTSTATUS* ReadStatuses,
+			ULONG TimeoutMs = DefaultReplyTimeoutMs
+		)
+		{
+			for (ULONG index = 0; index < Count; index++)
+			{
+				if (!IsValidDeviceIndex(DeviceIndexes[index]))
+				{
+					return Result::InvalidParameter;
+				}
+			}
+
+			if (!HasCommandBatches())
+			{
+				for (ULONG index = 0; index < Count; index++)
+				{
+					const Result result = PairTo(DeviceIndexes[index], Address, WriteStatuses[index], ReadStatuses[index], TimeoutMs);
+
+					if (result != Result::Success)
+					{
+						return result;
+					}
+				}
+
+				return Result::Success;
+			}
+
+			return ExchangeBatch<DSHM_IPC_MSG_PAIR_TO_REQUEST, DSHM_IPC_MSG_PAIR_TO_REPLY>(
+				Count,
+				[&](DSHM_IPC_MSG_PAIR_TO_REQUEST& Request, ULONG Index)
+				{
+					InitDeviceRequest(Request.Header, DSHM_IPC_MSG_CMD_DEVICE_PAIR_TO, DeviceIndexes[Index], sizeof(Request));
+					Request.Address = Address;
+				},
+				[&](const DSHM_IPC_MSG_PAIR_TO_REPLY* Reply, NTSTATUS DispatchStatus, ULONG Index)
+				{
+					if (Reply == nullptr)
+					{
+						WriteStatuses[Index] = ReadStatuses[Index] = DispatchStatus;
+						return true;
+					}
+
+					WriteStatuses[Index] = Reply->WriteStatus;
+					ReadStatuses[Index] = Reply->ReadStatus;
+
+					return IsDeviceReply(Reply->Header, DSHM_IPC_MSG_TYPE_REQUEST_REPLY, DSHM_IPC_MSG_CMD_DEVICE_PAIR_TO, DeviceIndexes[Index], sizeof(*Reply));
+				},
+				TimeoutMs
+			);
+		}
+
+		/**
+		 * Switches the player LEDs of several devices, as many per round trip
+		 * as fit into a command ring slot. A device's status is the one of
+		 * SetPlayerIndex, or the reason the driver couldn't dispatch the
+		 * command. Drivers predating batches get one command per device.
+		 */
+		Result SetPlayerIndex(
+			const ULONG* DeviceIndexes,
+			const UCHAR* PlayerIndexes,
+			ULONG Count,
+			NTSTATUS* Statuses,
+			ULONG TimeoutMs = DefaultReplyTimeoutMs
+		)
+		{
+			for (ULONG index = 0; index < Count; index++)
+			{
+				if (!IsValidDeviceIndex(DeviceIndexes[index]))
+				{
+					return Result::InvalidParameter;
+				}
+			}
+
+			if (!HasCommandBatches())
+			{
+				for (ULONG index = 0; index < Count; index++)
+				{
+					const Result result = SetPlayerIndex(DeviceIndexes[index], PlayerIndexes[index], Statuses[index], TimeoutMs);
+
+					if (result != Result::Success)
+					{
+						return result;
+					}
+				}
+
+				return Result::Success;
+			}
+
+			return ExchangeBatch<DSHM_IPC_MSG_SET_PLAYER_INDEX_REQUEST, DSHM_IPC_MSG_SET_PLAYER_INDEX_REPLY>(
+				Count,
+				[&](DSHM_IPC_MSG_SET_PLAYER_INDEX_REQUEST& Request, ULONG Index)
+				{
+					InitDeviceRequest(Request.Header, DSHM_IPC_MSG_CMD_DEVICE_SET_PLAYER_INDEX, DeviceIndexes[Index], sizeof(Request));
+					Request.PlayerIndex = PlayerIndexes[Index];
+				},
+				[&](const DSHM_IPC_MSG_SET_PLAYER_INDEX_REPLY* Reply, NTSTATUS DispatchStatus, ULONG Index)
+				{
+					if (Reply == nullptr)
+					{
+						Statuses[Index] = DispatchStatus;
+						return true;
+					}
+
+					Statuses[Index] = Reply->NtStatus;
+
+					return IsDeviceReply(Reply->Header, DSHM_IPC_MSG_TYPE_REQUEST_REPLY, DSHM_IPC_MSG_CMD_DEVICE_SET_PLAYER_INDEX, DeviceIndexes[Index], sizeof(*Reply));
+				},
+				TimeoutMs
+			);
+		}
+
+		/** Gets the event the driver signals whenever the device delivered an input report */
+		Result GetInputReportEvent(
+			ULONG DeviceIndex,
+			std::unique_ptr<Event>& InputReportEvent,
+			ULONG TimeoutMs = DefaultReplyTimeoutMs
+		)
+		{
+			DSHM_IPC_MSG_GET_HID_WAIT_HANDLE_RESPONSE message{};
+
+			if (!IsValidDeviceIndex(DeviceIndex))
+			{
+				return Result::InvalidParameter;
+			}
+
+			InitDeviceRequest(message.Header, DSHM_IPC_MSG_CMD_DEVICE_GET_HID_WAIT_HANDLE, DeviceIndex, sizeof(message.Header));
+			message.Header.Type = DSHM_IPC_MSG_TYPE_RESPONSE_ONLY;
+
+			const Result result = Exchange(&message, sizeof(message.Header), sizeof(message), TimeoutMs);
+
+			if (result != Result::Success)
+			{
+				return result;
+			}
+
+			if (!IsDeviceReply(message.Header, DSHM_IPC_MSG_TYPE_RESPONSE_ONLY, DSHM_IPC_MSG_CMD_DEVICE_GET_HID_WAIT_HANDLE, DeviceIndex, sizeof(message))
+				|| message.WaitHandle == nullptr)
+			{
+				return Result::UnexpectedReply;
+			}
+
+			InputReportEvent = Link.OpenRemoteEvent(message.ProcessId, message.WaitHandle);
+
+			return InputReportEvent ? Result::Success : Result::Unavailable;
+		}
+
+		/**
+		 * Waits until any device delivered an input report or went away. Bit
+		 * (N - 1) % 64 of Changed[(N - 1) / 64] is set if device N changed since
+		 * the previous call. Changes already pending return without waiting, so
+		 * a busy reader makes no system call at all. Only one thread on the
+		 * machine may call this, the mask is taken by whoever comes first.
+		 */
+		Result WaitForInputChanges(ULONGLONG (&Changed)[DSHM_IPC_HID_CHANGED_WORDS], ULONG TimeoutMs = WaitForever)
+		{
+			if (!HasInputChangedEvent())
+			{
+				return Result::Unavailable;
+			}
+
+			// an empty mask after waking means the bits got taken before the event reset
+			while (!DSHM_IPC_HID_TAKE_CHANGED(Hid, Changed))
+			{
+				if (!InputChangedEvent->Wait(TimeoutMs))
+				{
+					return Result::Timeout;
+				}
+			}
+
+			return Result::Success;
+		}
+
+		/**
+		 * Consistent copy of the most recent input report of a device. The
+		 * sequence number changes with every update, equal numbers mean
+		 * nothing changed since the previous read.
+		 */
+		Result ReadInputReport(ULONG DeviceIndex, IPC_HID_INPUT_REPORT_MESSAGE& Message, ULONG& Sequence) const
+		{
+			if (Hid == nullptr)
+			{
+				return Result::Unavailable;
+			}
+
+			if (!IsValidDeviceIndex(DeviceIndex))
+			{
+				return Result::InvalidParameter;
+			}
+
+			// also fails if the driver died mid-update
+			return DSHM_IPC_HID_READ(Hid, DeviceIndex, &Message, &Sequence) ? Result::Success : Result::Busy;
+		}
+
+		/**
+		 * Consistent copy of the most recent state of a device, thumb axes as
+		 * the HID device reports them. Unavailable with drivers that don't
+		 * publish states.
+		 */
+		Result ReadInputState(ULONG DeviceIndex, IPC_HID_STATE& State, ULONG& Sequence) const
+		{
+			if (Hid == nullptr || DSHM_IPC_HID_HEADER(Hid)->StateOffset == 0)
+			{
+				return Result::Unavailable;
+			}
+
+			if (!IsValidDeviceIndex(DeviceIndex))
+			{
+				return Result::InvalidParameter;
+			}
+
+			return DSHM_IPC_HID_READ_STATE(Hid, DeviceIndex, &State, &Sequence) ? Result::Success : Result::Busy;
+		}
+
+		/**
+		 * Samples the performance counters of a device, never involves the
+		 * driver. Busy if the slot never had a device or got reclaimed while
+		 * sampling; SlotIndex of the sample is 0 if the device is gone.
+		 */
+		Result ReadDeviceCounters(ULONG DeviceIndex, IPC_DEVICE_COUNTERS& Sample) const
+		{
+			if (!HasCounters())
+			{
+				return Result::Unavailable;
+			}
+
+			if (!IsValidDeviceIndex(DeviceIndex))
+			{
+				return Result::InvalidParameter;
+			}
+
+			return DSHM_IPC_COUNTERS_SAMPLE(Counters, DeviceIndex, &Sample) ? Result::Success : Result::Busy;
+		}
+
+		/** Cursor for DrainInputHistory to only receive reports arriving from now on */
+		ULONGLONG GetInputHistoryPosition(ULONG DeviceIndex) const
+		{
+			if (!HasInputHistory() || !IsValidDeviceIndex(DeviceIndex))
+			{
+				return 0;
+			}
+
+			return DSHM_IPC_HID_HISTORY_POSITION(DSHM_IPC_HID_HISTORY_RING(History, HistoryHeader(), DeviceIndex));
+		}
+
+		/**
+		 * Copies the reports a device delivered since Cursor, oldest first, and
+		 * advances Cursor. Lost receives the number of reports that got
+		 * overwritten before they could be copied. Never blocks.
+		 */
+		ULONG DrainInputHistory(
+			ULONG DeviceIndex,
+			ULONGLONG& Cursor,
+			PIPC_HID_HISTORY_ENTRY Entries,
+			ULONG Capacity,
+			ULONGLONG& Lost
+		) const
+		{
+			Lost = 0;
+
+			if (!HasInputHistory() || !IsValidDeviceIndex(DeviceIndex))
+			{
+				return 0;
+			}
+
+			return DSHM_IPC_HID_HISTORY_DRAIN(
+				DSHM_IPC_HID_HISTORY_RING(History, HistoryHeader(), DeviceIndex),
+				HistoryDepth,
+				&Cursor,
+				Entries,
+				Capacity,
+				&Lost
+			);
+		}
+
+		/**
+		 * Queues a rumble and/or LED update for a device without a command
+		 * round trip. Busy if the driver hasn't caught up yet or another
+		 * process feeds this device.
+		 */
+		Result SendOutputRequest(ULONG DeviceIndex, const IPC_OUTPUT_REQUEST& Request)
+		{
+			if (!HasOutputChannel())
+			{
+				return Result::Unavailable;
+			}
+
+			if (!IsValidDeviceIndex(DeviceIndex))
+			{
+				return Result::InvalidParameter;
+			}
+
+			const PIPC_OUTPUT_RING ring = DSHM_IPC_OUTPUT_RING(Output, DeviceIndex);
+
+			if (!DSHM_IPC_OUTPUT_RING_ACQUIRE(ring, Link.ProcessId()))
+			{
+				return Result::Busy;
+			}
+
+			{
+				// one producer per ring, threads of this process take turns
+				std::lock_guard<std::mutex> guard(OutputLock);
+
+				if (!DSHM_IPC_OUTPUT_RING_PUSH(ring, &Request))
+				{
+					return Result::Busy;
+				}
+			}
+
+			OutputRingEvent->Signal();
+
+			return Result::Success;
+		}
+
+	private:
+		static_assert(sizeof(DSHM_IPC_MSG_PAIR_TO_REPLY) <= DSHM_IPC_CMD_MESSAGE_MAX);
+		static_assert(sizeof(DSHM_IPC_MSG_GET_HID_WAIT_HANDLE_RESPONSE) <= DSHM_IPC_CMD_MESSAGE_MAX);
+
+		static bool IsValidDeviceIndex(ULONG DeviceIndex)
+		{
+			return DeviceIndex > 0 && DeviceIndex <= DSHM_IPC_HID_SLOT_COUNT;
+		}
+
+		static void InitDeviceRequest(
+			DSHM_IPC_MSG_HEADER& Header,
+			DSHM_IPC_MSG_CMD_DEVICE Command,
+			ULONG DeviceIndex,
+			ULONG Size
+		)
+		{
+			Header.Type = DSHM_IPC_MSG_TYPE_REQUEST_RESPONSE;
+			Header.Target = DSHM_IPC_MSG_TARGET_DEVICE;
+			Header.Command.Device = Command;
+			Header.TargetIndex = DeviceIndex;
+			Header.Size = Size;
+		}
+
+		static bool IsDeviceReply(
+			const DSHM_IPC_MSG_HEADER& Header,
+			DSHM_IPC_MSG_TYPE Type,
+			DSHM_IPC_MSG_CMD_DEVICE Command,
+			ULONG DeviceIndex,
+			ULONG Size
+		)
+		{
+			return Header.Type == Type
+				&& Header.Target == DSHM_IPC_MSG_TARGET_CLIENT
+				&& Header.Command.Device == Command
+				&& Header.TargetIndex == DeviceIndex
+				&& Header.Size == Size;
+		}
+
+		const IPC_HID_REGION_HEADER* HistoryHeader() const
+		{
+			return DSHM_IPC_HID_HEADER(Hid);
+		}
+
+		Event* GetReplyEvent(ULONG SlotIndex)
+		{
+			std::lock_guard<std::mutex> guard(ReplyEventsLock);
+			std::unique_ptr<Event>& replyEvent = ReplyEvents[SlotIndex];
+
+			if (!replyEvent)
+			{
+				const std::string name = DSHM_IPC_CMD_REPLY_EVENT_PREFIX + std::to_string(SlotIndex);
+
+				replyEvent = Link.OpenNamedEvent(name.c_str());
+			}
+
+			return replyEvent.get();
+		}
+
+		/**
+		 * Sends Count device commands as batches, as many per command ring
+		 * slot as fit. Fill sets up command Index in a zeroed buffer, Read
+		 * takes its reply and tells whether it's plausible; it gets no reply
+		 * but the dispatch status if the driver couldn't run the command.
+		 */
+		template <typename TRequest, typename TReply, typename TFill, typename TRead>
+		Result ExchangeBatch(ULONG Count, TFill Fill, TRead Read, ULONG TimeoutMs)
+		{
+			constexpr SIZE_T largest = sizeof(TRequest) > sizeof(TReply) ? sizeof(TRequest) : sizeof(TReply);
+			constexpr SIZE_T messageSize = largest > DSHM_IPC_MSG_BATCH_MESSAGE_MIN ? largest : DSHM_IPC_MSG_BATCH_MESSAGE_MIN;
+			constexpr ULONG entrySize = static_cast<ULONG>((sizeof(DSHM_IPC_MSG_BATCH_ENTRY) + messageSize + 7) / 8 * 8);
+			constexpr ULONG fitting = static_cast<ULONG>((DSHM_IPC_CMD_MESSAGE_MAX - sizeof(DSHM_IPC_MSG_BATCH_REQUEST)) / entrySize);
+			constexpr ULONG perBatch = fitting < DSHM_IPC_MSG_BATCH_MAX_COUNT ? fitting : DSHM_IPC_MSG_BATCH_MAX_COUNT;
+
+			static_assert(perBatch > 0);
+
+			alignas(8) UCHAR buffer[DSHM_IPC_CMD_MESSAGE_MAX];
+			const auto batch = reinterpret_cast<PDSHM_IPC_MSG_BATCH_REQUEST>(buffer);
+			const auto entryAt = [&](ULONG Index)
+			{
+				return reinterpret_cast<PDSHM_IPC_MSG_BATCH_ENTRY>(buffer + sizeof(DSHM_IPC_MSG_BATCH_REQUEST) + (SIZE_T)entrySize * Index);
+			};
+
+			for (ULONG first = 0; first < Count; first += perBatch)
+			{
+				const ULONG count = (Count - first) < perBatch ? (Count - first) : perBatch;
+				const ULONG size = static_cast<ULONG>(sizeof(DSHM_IPC_MSG_BATCH_REQUEST) + (SIZE_T)entrySize * count);
+
+				std::memset(buffer, 0, size);
+
+				batch->Header.Type = DSHM_IPC_MSG_TYPE_REQUEST_RESPONSE;
+				batch->Header.Target = DSHM_IPC_MSG_TARGET_DRIVER;
+				batch->Header.Command.Driver = DSHM_IPC_MSG_CMD_DRIVER_BATCH;
+				batch->Header.TargetIndex = 0;
+				batch->Header.Size = size;
+				batch->Count = count;
+
+				for (ULONG index = 0; index < count; index++)
+				{
+					entryAt(index)->Size = entrySize;
+					Fill(*reinterpret_cast<TRequest*>(DSHM_IPC_MSG_BATCH_ENTRY_MESSAGE(entryAt(index))), first + index);
+				}
+
+				const Result result = Exchange(buffer, size, size, TimeoutMs);
+
+				if (result != Result::Success)
+				{
+					return result;
+				}
+
+				if (batch->Header.Type != DSHM_IPC_MSG_TYPE_REQUEST_REPLY
+					|| batch->Header.Target != DSHM_IPC_MSG_TARGET_CLIENT
+					|| batch->Header.Command.Driver != DSHM_IPC_MSG_CMD_DRIVER_BATCH
+					|| batch->Header.Size != size
+					|| batch->Count != count)
+				{
+					return Result::UnexpectedReply;
+				}
+
+				for (ULONG index = 0; index < count; index++)
+				{
+					const PDSHM_IPC_MSG_BATCH_ENTRY entry = entryAt(index);
+					const bool isDispatched = entry->Status >= 0; // NT_SUCCESS
+					const auto reply = reinterpret_cast<const TReply*>(DSHM_IPC_MSG_BATCH_ENTRY_MESSAGE(entry));
+
+					if (!Read(isDispatched ? reply : nullptr, entry->Status, first + index))
+					{
+						return Result::UnexpectedReply;
+					}
+				}
+			}
+
+			return Result::Success;
+		}
+
+		/**
+		 * Sends a request through a command ring slot of its own and copies
+		 * the reply back. On timeout the slot is left to the driver, which
+		 * frees it once done with the request.
+		 */
+		Result Exchange(PVOID Message, ULONG RequestSize, ULONG ReplySize, ULONG TimeoutMs)
+		{
+			ULONG slotIndex;
+
+			if (CommandRing == nullptr)
+			{
+				return Result::Unavailable;
+			}
+
+			if (!DSHM_IPC_CMD_SLOT_ACQUIRE(CommandRing, Link.ProcessId(), &slotIndex))
+			{
+				return Result::Busy;
+			}
+
+			Event* replyEvent = GetReplyEvent(slotIndex);
+			const PIPC_CMD_SLOT slot = DSHM_IPC_CMD_SLOT(CommandRing, slotIndex);
+
+			if (replyEvent == nullptr)
+			{
+				DSHM_IPC_CMD_SLOT_RELEASE(CommandRing, slotIndex);
+				return Result::Unavailable;
+			}
+
+			std::memcpy(slot->Message, Message, RequestSize);
+
+			if (!DSHM_IPC_CMD_SUBMIT(CommandRing, slotIndex))
+			{
+				DSHM_IPC_CMD_SLOT_RELEASE(CommandRing, slotIndex);
+				return Result::Busy;
+			}
+
+			CommandRingEvent->Signal();
+
+			const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(TimeoutMs);
+
+			//
+			// The event may still be set from a previous user of the slot, so
+			// the state decides
+			//
+			while (!DSHM_IPC_CMD_IS_COMPLETED(CommandRing, slotIndex))
+			{
+				const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+					deadline - std::chrono::steady_clock::now()
+				).count();
+
+				if (TimeoutMs != WaitForever && remaining <= 0)
+				{
+					if (DSHM_IPC_CMD_ABANDON(CommandRing, slotIndex))
+					{
+						return Result::Timeout;
+					}
+
+					// completed in the meantime
+					break;
+				}
+
+				replyEvent->Wait(TimeoutMs == WaitForever ? WaitForever : static_cast<ULONG>(remaining) + 1);
+			}
+
+			std::memcpy(Message, slot->Message, ReplySize);
+
+			DSHM_IPC_CMD_SLOT_RELEASE(CommandRing, slotIndex);
+
+			return Result::Success;
+		}
+
+		Transport& Link;
+
+		ULONG ViewSize{};
+		PUCHAR Commands{};
+		PUCHAR Hid{};
+		PUCHAR History{};
+		ULONG HistorySize{};
+		ULONG HistoryDepth{};
+		PIPC_OUTPUT_REGION_HEADER Output{};
+		ULONG OutputSize{};
+		PIPC_COUNTERS_REGION_HEADER Counters{};
+		ULONG CountersSize{};
+
+		PIPC_CMD_RING_HEADER CommandRing{};
+		std::unique_ptr<Event> CommandRingEvent;
+		std::unique_ptr<Event> OutputRingEvent;
+		std::unique_ptr<Event> InputChangedEvent;
+
+		std::mutex ReplyEventsLock;
+		std::unique_ptr<Event> ReplyEvents[DSHM_IPC_CMD_SLOT_COUNT];
+
+		std::mutex OutputLock;
+	};
+}
@@ -0,0 +1,474 @@
+#pragma once
+
+#include "IpcAtomics.h"
+
+//
+// Multi-client command channel, shared by the driver and native clients.
+// Lives in the command region of "Global\DsHidMiniSharedMemory", past the
+// legacy single message buffer guarded by "Global\DsHidMiniCommandMutex".
+//
+// A client claims a free slot, writes its request message (same format as
+// the legacy buffer) into it and pushes the slot index onto the request
+// queue, then signals DSHM_IPC_CMD_RING_EVENT_NAME. The driver drains the
+// queue in batches, writes each reply over the request in place and signals
+// the reply event of the slot. No lock is held across a round trip, so any
+// number of clients (up to the slot count) can have a command in flight.
+//
+// Clients may die at any point. The driver periodically frees slots of
+// exited processes that no queued cell references, and skips a cell at the
+// head of the queue that a client claimed but never published.
+//
+
+//
+// Ring header location, relative to the start of the command region
+//
+#define DSHM_IPC_CMD_RING_OFFSET			0x1000
+
+//
+// "DCMD", set once the driver has initialized the header
+//
+#define DSHM_IPC_CMD_RING_MAGIC				0x444D4344
+
+#define DSHM_IPC_CMD_RING_VERSION			2
+
+//
+// Drivers with a ring of this version or newer handle command batches
+// (DSHM_IPC_MSG_CMD_DRIVER_BATCH), older ones leave them unanswered
+//
+#define DSHM_IPC_CMD_RING_BATCH_VERSION		2
+
+//
+// Concurrent commands, one per slot
+//
+#define DSHM_IPC_CMD_SLOT_COUNT				32
+
+//
+// Power of two above the slot count; a slot is queued at most once at a
+// time, so the queue never runs full
+//
+#define DSHM_IPC_CMD_QUEUE_CAPACITY			64
+
+#define DSHM_IPC_CMD_SLOT_SIZE				1024
+
+//
+// Largest request or reply message a slot holds
+//
+#define DSHM_IPC_CMD_MESSAGE_MAX			(DSHM_IPC_CMD_SLOT_SIZE - 64)
+
+//
+// Slots follow the header at this offset from the start of the header
+//
+#define DSHM_IPC_CMD_SLOTS_OFFSET			0x400
+
+//
+// Doorbell, auto-reset, signaled by clients after queuing a slot
+//
+#define DSHM_IPC_CMD_RING_EVENT_NAME		"Global\\DsHidMiniCommandRingEvent"
+
+//
+// Auto-reset event per slot signaled after the reply got written, the
+// zero-based slot index gets appended
+//
+#define DSHM_IPC_CMD_REPLY_EVENT_PREFIX		"Global\\DsHidMiniCommandReplyEvent"
+
+typedef enum
+{
+	//
+	// Owned by a client, the message buffer is the client's
+	//
+	DSHM_IPC_CMD_SLOT_STATE_IDLE = 0,
+	//
+	// Queued or being processed, the message buffer is the driver's
+	//
+	DSHM_IPC_CMD_SLOT_STATE_SUBMITTED,
+	//
+	// Reply written, the message buffer is the client's again
+	//
+	DSHM_IPC_CMD_SLOT_STATE_COMPLETED,
+	//
+	// The client gave up waiting, the driver frees the slot once done
+	//
+	DSHM_IPC_CMD_SLOT_STATE_ABANDONED
+} DSHM_IPC_CMD_SLOT_STATE;
+
+//
+// Both fields get published at once with a 64 bit compare-exchange, so a
+// cell the driver skipped can't receive a late slot index
+//
+typedef struct _IPC_CMD_QUEUE_CELL
+{
+	//
+	// Queue position the cell is ready for, see DSHM_IPC_CMD_SUBMIT
+	//
+	volatile LONG Sequence;
+
+	//
+	// Zero-based slot index
+	//
+	UINT32 SlotIndex;
+
+} IPC_CMD_QUEUE_CELL, *PIPC_CMD_QUEUE_CELL;
+
+//
+// Cell content as a single 64 bit value, Sequence in the low half
+//
+#define DSHM_IPC_CMD_CELL_VALUE(_sequence_, _slotIndex_)	\
+	((ULONGLONG)(ULONG)(_sequence_) | ((ULONGLONG)(ULONG)(_slotIndex_) << 32))
+
+typedef struct _IPC_CMD_SLOT
+{
+	//
+	// Process ID of the owning client, 0 if the slot is free
+	//
+	volatile LONG OwnerProcessId;
+
+	//
+	// DSHM_IPC_CMD_SLOT_STATE
+	//
+	volatile LONG State;
+
+	UINT32 Reserved[14];
+
+	//
+	// Request, overwritten with the reply
+	//
+	UCHAR Message[DSHM_IPC_CMD_MESSAGE_MAX];
+
+} IPC_CMD_SLOT, *PIPC_CMD_SLOT;
+
+//
+// Describes the command ring, located at DSHM_IPC_CMD_RING_OFFSET
+//
+typedef struct _IPC_CMD_RING_HEADER
+{
+	//
+	// DSHM_IPC_CMD_RING_MAGIC, anything else means no ring (older driver)
+	//
+	UINT32 Magic;
+
+	UINT32 Version;
+
+	//
+	// Size of this header in bytes
+	//
+	UINT32 Size;
+
+	UINT32 SlotCount;
+
+	//
+	// Offset of the first slot from the start of this header
+	//
+	UINT32 SlotsOffset;
+
+	UINT32 SlotSize;
+
+	UINT32 QueueCapacity;
+
+	UINT32 Reserved[9];
+
+	//
+	// Next queue position to fill, shared by all clients
+	//
+	volatile LONG Tail;
+
+	UCHAR TailPadding[60];
+
+	//
+	// Next queue position the driver takes, only the driver writes it
+	//
+	volatile LONG Head;
+
+	UCHAR HeadPadding[60];
+
+	IPC_CMD_QUEUE_CELL Queue[DSHM_IPC_CMD_QUEUE_CAPACITY];
+
+} IPC_CMD_RING_HEADER, *PIPC_CMD_RING_HEADER;
+
+FORCEINLINE PIPC_CMD_RING_HEADER DSHM_IPC_CMD_RING(
+	_In_ PUCHAR Commands
+)
+{
+	return (PIPC_CMD_RING_HEADER)(Commands + DSHM_IPC_CMD_RING_OFFSET);
+}
+
+//
+// Gets a slot by zero-based index
+//
+FORCEINLINE PIPC_CMD_SLOT DSHM_IPC_CMD_SLOT(
+	_In_ PIPC_CMD_RING_HEADER Ring,
+	_In_ ULONG SlotIndex
+)
+{
+	return (PIPC_CMD_SLOT)((PUCHAR)Ring + Ring->SlotsOffset + (SIZE_T)Ring->SlotSize * SlotIndex);
+}
+
+//
+// Driver only, sets up an empty ring and publishes it
+//
+FORCEINLINE VOID DSHM_IPC_CMD_RING_INIT(
+	_Out_ PIPC_CMD_RING_HEADER Ring
+)
+{
+	RtlZeroMemory(Ring, DSHM_IPC_CMD_SLOTS_OFFSET + (SIZE_T)DSHM_IPC_CMD_SLOT_SIZE * DSHM_IPC_CMD_SLOT_COUNT);
+
+	Ring->Version = DSHM_IPC_CMD_RING_VERSION;
+	Ring->Size = sizeof(IPC_CMD_RING_HEADER);
+	Ring->SlotCount = DSHM_IPC_CMD_SLOT_COUNT;
+	Ring->SlotsOffset = DSHM_IPC_CMD_SLOTS_OFFSET;
+	Ring->SlotSize = DSHM_IPC_CMD_SLOT_SIZE;
+	Ring->QueueCapacity = DSHM_IPC_CMD_QUEUE_CAPACITY;
+
+	for (ULONG index = 0; index < DSHM_IPC_CMD_QUEUE_CAPACITY; index++)
+	{
+		Ring->Queue[index].Sequence = (LONG)index;
+	}
+
+	DSHM_IPC_WRITE_BARRIER();
+	DSHM_IPC_STORE32(&Ring->Magic, DSHM_IPC_CMD_RING_MAGIC);
+}
+
+//
+// Claims a free slot for the calling process. Fails if all are in use.
+//
+FORCEINLINE BOOLEAN DSHM_IPC_CMD_SLOT_ACQUIRE(
+	_In_ PIPC_CMD_RING_HEADER Ring,
+	_In_ ULONG ProcessId,
+	_Out_ PULONG SlotIndex
+)
+{
+	for (ULONG index = 0; index < Ring->SlotCount; index++)
+	{
+		const PIPC_CMD_SLOT slot = DSHM_IPC_CMD_SLOT(Ring, index);
+
+		if (DSHM_IPC_LOAD32(&slot->OwnerProcessId) == 0 && DSHM_IPC_CAS32(&slot->OwnerProcessId, 0, ProcessId))
+		{
+			DSHM_IPC_STORE32(&slot->State, DSHM_IPC_CMD_SLOT_STATE_IDLE);
+			*SlotIndex = index;
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+//
+// Hands a slot back. Slots with a command still in flight must be given up
+// with DSHM_IPC_CMD_ABANDON instead.
+//
+FORCEINLINE VOID DSHM_IPC_CMD_SLOT_RELEASE(
+	_In_ PIPC_CMD_RING_HEADER Ring,
+	_In_ ULONG SlotIndex
+)
+{
+	DSHM_IPC_STORE32(&DSHM_IPC_CMD_SLOT(Ring, SlotIndex)->OwnerProcessId, 0);
+}
+
+//
+// Queues the request in an owned slot; bounded multi-producer queue where
+// each cell's sequence tells producers and the consumer whose turn it is.
+// The caller signals DSHM_IPC_CMD_RING_EVENT_NAME afterwards.
+//
+FORCEINLINE BOOLEAN DSHM_IPC_CMD_SUBMIT(
+	_In_ PIPC_CMD_RING_HEADER Ring,
+	_In_ ULONG SlotIndex
+)
+{
+	const PIPC_CMD_SLOT slot = DSHM_IPC_CMD_SLOT(Ring, SlotIndex);
+
+	DSHM_IPC_STORE32(&slot->State, DSHM_IPC_CMD_SLOT_STATE_SUBMITTED);
+
+	for (;;)
+	{
+		const ULONG position = DSHM_IPC_LOAD32(&Ring->Tail);
+		const PIPC_CMD_QUEUE_CELL cell = &Ring->Queue[position & (DSHM_IPC_CMD_QUEUE_CAPACITY - 1)];
+		const LONG distance = (LONG)(DSHM_IPC_LOAD32(&cell->Sequence) - position);
+
+		if (distance == 0)
+		{
+			if (DSHM_IPC_CAS32(&Ring->Tail, position, position + 1))
+			{
+				const ULONGLONG current = DSHM_IPC_LOAD64((volatile LONGLONG*)cell);
+
+				//
+				// Fails if the driver skipped the cell meanwhile (took too
+				// long to get here), queue again then
+				//
+				if ((ULONG)current == position
+					&& DSHM_IPC_CAS64((volatile LONGLONG*)cell, current, DSHM_IPC_CMD_CELL_VALUE(position + 1, SlotIndex)))
+				{
+					return TRUE;
+				}
+			}
+		}
+		else if (distance < 0)
+		{
+			//
+			// Full, only possible if someone queues slots twice
+			//
+			DSHM_IPC_STORE32(&slot->State, DSHM_IPC_CMD_SLOT_STATE_IDLE);
+			return FALSE;
+		}
+	}
+}
+
+//
+// Driver only, takes the next queued slot. The index comes from a client and
+// must be validated.
+//
+FORCEINLINE BOOLEAN DSHM_IPC_CMD_DEQUEUE(
+	_In_ PIPC_CMD_RING_HEADER Ring,
+	_Out_ PULONG SlotIndex
+)
+{
+	const ULONG position = (ULONG)Ring->Head;
+	const PIPC_CMD_QUEUE_CELL cell = &Ring->Queue[position & (DSHM_IPC_CMD_QUEUE_CAPACITY - 1)];
+
+	if (DSHM_IPC_LOAD32(&cell->Sequence) != position + 1)
+	{
+		return FALSE;
+	}
+
+	DSHM_IPC_READ_BARRIER();
+
+	*SlotIndex = cell->SlotIndex;
+
+	DSHM_IPC_STORE32(&cell->Sequence, position + DSHM_IPC_CMD_QUEUE_CAPACITY);
+	DSHM_IPC_STORE32(&Ring->Head, position + 1);
+
+	return TRUE;
+}
+
+//
+// Driver only, TRUE if the cell at the head of the queue got claimed by a
+// client but isn't published yet. Position receives the queue position. A
+// cell that stays like this for long belongs to a client that died in
+// between and gets skipped with DSHM_IPC_CMD_SKIP.
+//
+FORCEINLINE BOOLEAN DSHM_IPC_CMD_IS_STALLED(
+	_In_ PIPC_CMD_RING_HEADER Ring,
+	_Out_ PULONG Position
+)
+{
+	const ULONG position = (ULONG)Ring->Head;
+
+	if (DSHM_IPC_LOAD32(&Ring->Tail) == position
+		|| DSHM_IPC_LOAD32(&Ring->Queue[position & (DSHM_IPC_CMD_QUEUE_CAPACITY - 1)].Sequence) != position)
+	{
+		return FALSE;
+	}
+
+	*Position = position;
+
+	return TRUE;
+}
+
+//
+// Driver only, gives up on the unpublished cell at Position, which must be
+// the head of the queue. Fails if the client published it in the meantime.
+//
+FORCEINLINE BOOLEAN DSHM_IPC_CMD_SKIP(
+	_In_ PIPC_CMD_RING_HEADER Ring,
+	_In_ ULONG Position
+)
+{
+	const PIPC_CMD_QUEUE_CELL cell = &Ring->Queue[Position & (DSHM_IPC_CMD_QUEUE_CAPACITY - 1)];
+
+	if ((ULONG)Ring->Head != Position
+		|| !DSHM_IPC_CAS32(&cell->Sequence, Position, Position + DSHM_IPC_CMD_QUEUE_CAPACITY))
+	{
+		return FALSE;
+	}
+
+	DSHM_IPC_STORE32(&Ring->Head, Position + 1);
+
+	return TRUE;
+}
+
+//
+// Driver only, TRUE if a published cell still in the queue references the
+// slot, so it is going to be dispatched and must not be freed yet
+//
+FORCEINLINE BOOLEAN DSHM_IPC_CMD_IS_QUEUED(
+	_In_ PIPC_CMD_RING_HEADER Ring,
+	_In_ ULONG SlotIndex
+)
+{
+	const ULONG head = (ULONG)Ring->Head;
+	ULONG pending = DSHM_IPC_LOAD32(&Ring->Tail) - head;
+
+	//
+	// Tail is written by clients
+	//
+	if (pending > DSHM_IPC_CMD_QUEUE_CAPACITY)
+	{
+		pending = DSHM_IPC_CMD_QUEUE_CAPACITY;
+	}
+
+	for (ULONG position = head; position != head + pending; position++)
+	{
+		const PIPC_CMD_QUEUE_CELL cell = &Ring->Queue[position & (DSHM_IPC_CMD_QUEUE_CAPACITY - 1)];
+
+		if (DSHM_IPC_LOAD64((volatile LONGLONG*)cell) == DSHM_IPC_CMD_CELL_VALUE(position + 1, SlotIndex))
+		{
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+//
+// Driver only, hands the slot with the reply back to its client. Returns
+// FALSE if the client had abandoned it, the slot is free again then.
+//
+FORCEINLINE BOOLEAN DSHM_IPC_CMD_COMPLETE(
+	_In_ PIPC_CMD_RING_HEADER Ring,
+	_In_ ULONG SlotIndex
+)
+{
+	const PIPC_CMD_SLOT slot = DSHM_IPC_CMD_SLOT(Ring, SlotIndex);
+
+	if (DSHM_IPC_CAS32(&slot->State, DSHM_IPC_CMD_SLOT_STATE_SUBMITTED, DSHM_IPC_CMD_SLOT_STATE_COMPLETED))
+	{
+		return TRUE;
+	}
+
+	if (DSHM_IPC_CAS32(&slot->State, DSHM_IPC_CMD_SLOT_STATE_ABANDONED, DSHM_IPC_CMD_SLOT_STATE_IDLE))
+	{
+		DSHM_IPC_STORE32(&slot->OwnerProcessId, 0);
+	}
+
+	return FALSE;
+}
+
+FORCEINLINE BOOLEAN DSHM_IPC_CMD_IS_COMPLETED(
+	_In_ PIPC_CMD_RING_HEADER Ring,
+	_In_ ULONG SlotIndex
+)
+{
+	if (DSHM_IPC_LOAD32(&DSHM_IPC_CMD_SLOT(Ring, SlotIndex)->State) != DSHM_IPC_CMD_SLOT_STATE_COMPLETED)
+	{
+		return FALSE;
+	}
+
+	DSHM_IPC_READ_BARRIER();
+
+	return TRUE;
+}
+
+//
+// Gives up waiting for a reply. If the driver completed the command in the
+// meantime the slot stays owned and must be released as usual (returns
+// FALSE), otherwise the driver frees the slot once done with it.
+//
+FORCEINLINE BOOLEAN DSHM_IPC_CMD_ABANDON(
+	_In_ PIPC_CMD_RING_HEADER Ring,
+	_In_ ULONG SlotIndex
+)
+{
+	return DSHM_IPC_CAS32(
+		&DSHM_IPC_CMD_SLOT(Ring, SlotIndex)->State,
+		DSHM_IPC_CMD_SLOT_STATE_SUBMITTED,
+		DSHM_IPC_CMD_SLOT_STATE_ABANDONED
+	);
+}
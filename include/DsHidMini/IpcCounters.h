@@ -0,0 +1,304 @@
+#pragma once
+
+#include "IpcAtomics.h"
+
+//
+// Per device performance counters, shared by the driver and native clients.
+// The location of the region within "Global\DsHidMiniSharedMemory" is
+// advertised by the HID region header (CountersOffset).
+//
+// Clients map the region read-only and sample it as often as they like, the
+// driver never waits on them. Every counter is updated on its own with a
+// relaxed atomic add, so a sample is exact per counter but not across
+// counters; rates are the difference of two samples. A slot starts over at
+// zero when a device claims it and keeps the values of the last device after
+// it is gone, until the next one claims it.
+//
+
+//
+// "DCNT", set once the driver has initialized the region
+//
+#define DSHM_IPC_COUNTERS_MAGIC				0x544E4344
+
+#define DSHM_IPC_COUNTERS_VERSION			1
+
+//
+// Slots, one-based slot indexes map to entries 0 to 254
+//
+#define DSHM_IPC_COUNTERS_SLOT_COUNT		255
+
+//
+// Slots follow the region header at this offset
+//
+#define DSHM_IPC_COUNTERS_SLOTS_OFFSET		64
+
+//
+// Consecutive resets observed before a sample gives up
+//
+#define DSHM_IPC_COUNTERS_READ_ATTEMPTS		1000
+
+//
+// Counters of a single device, two cache lines. Newer versions only ever
+// append counters, CounterCount of the region header tells how many the
+// driver maintains.
+//
+typedef struct _IPC_DEVICE_COUNTERS
+{
+	//
+	// One-based device index, 0 while no device occupies the slot
+	//
+	volatile LONG SlotIndex;
+
+	//
+	// Odd while the driver resets the slot for a new device, advances by two
+	// with every device claiming it. Samples with different generations
+	// belong to different devices and can't be subtracted.
+	//
+	volatile LONG Generation;
+
+	//
+	// Input reports received and passed on to the HID stack and IPC readers
+	//
+	volatile LONGLONG InputReports;
+
+	//
+	// Input reports ignored as too short or broken
+	//
+	volatile LONGLONG InputDropped;
+
+	//
+	// Output reports transferred to the device
+	//
+	volatile LONGLONG OutputReports;
+
+	//
+	// Output reports lost due to no free queue buffer or a failed transfer
+	//
+	volatile LONGLONG OutputDropped;
+
+	//
+	// Output reports not sent since the output state didn't change
+	//
+	volatile LONGLONG DuplicatesSuppressed;
+
+	//
+	// Output reports held back by rate control
+	//
+	volatile LONGLONG RateLimitDelays;
+
+	//
+	// Button combos held long enough to trigger their action
+	//
+	volatile LONGLONG ComboFires;
+
+	//
+	// Battery status changes picked up from input reports
+	//
+	volatile LONGLONG BatteryChanges;
+
+	//
+	// Configuration reloads after the configuration file changed
+	//
+	volatile LONGLONG ConfigReloads;
+
+	//
+	// Time spent translating and publishing input reports, in ticks of
+	// TimestampFrequency of the region header
+	//
+	volatile LONGLONG ProcessingTicks;
+
+	//
+	// Input reports not published to IPC readers since the slot stayed
+	// claimed for DSHM_IPC_HID_WRITE_ATTEMPTS
+	//
+	volatile LONGLONG InputSlotSkips;
+
+	UCHAR Reserved[32];
+
+} IPC_DEVICE_COUNTERS, *PIPC_DEVICE_COUNTERS;
+
+//
+// Counters following Generation in this revision
+//
+#define DSHM_IPC_COUNTERS_COUNT	\
+	((ULONG)((FIELD_OFFSET(IPC_DEVICE_COUNTERS, Reserved) - FIELD_OFFSET(IPC_DEVICE_COUNTERS, InputReports)) / sizeof(LONGLONG)))
+
+//
+// Describes the counters region, slots follow at SlotsOffset
+//
+typedef struct _IPC_COUNTERS_REGION_HEADER
+{
+	//
+	// DSHM_IPC_COUNTERS_MAGIC, anything else means no counters
+	//
+	UINT32 Magic;
+
+	UINT32 Version;
+
+	//
+	// Size of this header in bytes
+	//
+	UINT32 Size;
+
+	UINT32 SlotCount;
+
+	//
+	// Offset of the first slot from the start of this header
+	//
+	UINT32 SlotsOffset;
+
+	//
+	// Distance between two slots in bytes
+	//
+	UINT32 SlotStride;
+
+	//
+	// 64 bit counters per slot following Generation
+	//
+	UINT32 CounterCount;
+
+	UINT32 Reserved;
+
+	//
+	// ProcessingTicks per second (QueryPerformanceFrequency)
+	//
+	LONGLONG TimestampFrequency;
+
+	UINT32 Reserved2[6];
+
+} IPC_COUNTERS_REGION_HEADER, *PIPC_COUNTERS_REGION_HEADER;
+
+#define DSHM_IPC_COUNTERS_REGION_SIZE	\
+	(DSHM_IPC_COUNTERS_SLOTS_OFFSET + sizeof(IPC_DEVICE_COUNTERS) * (SIZE_T)DSHM_IPC_COUNTERS_SLOT_COUNT)
+
+//
+// Gets the counters of a device by one-based slot index
+//
+FORCEINLINE PIPC_DEVICE_COUNTERS DSHM_IPC_COUNTERS_SLOT(
+	_In_ PIPC_COUNTERS_REGION_HEADER Region,
+	_In_ ULONG SlotIndex
+)
+{
+	return (PIPC_DEVICE_COUNTERS)((PUCHAR)Region + Region->SlotsOffset + (SIZE_T)Region->SlotStride * (SlotIndex - 1));
+}
+
+//
+// Driver only, sets up all slots unoccupied and publishes the region
+//
+FORCEINLINE VOID DSHM_IPC_COUNTERS_REGION_INIT(
+	_Out_ PIPC_COUNTERS_REGION_HEADER Region,
+	_In_ LONGLONG TimestampFrequency
+)
+{
+	RtlZeroMemory(Region, DSHM_IPC_COUNTERS_REGION_SIZE);
+
+	Region->Version = DSHM_IPC_COUNTERS_VERSION;
+	Region->Size = sizeof(IPC_COUNTERS_REGION_HEADER);
+	Region->SlotCount = DSHM_IPC_COUNTERS_SLOT_COUNT;
+	Region->SlotsOffset = DSHM_IPC_COUNTERS_SLOTS_OFFSET;
+	Region->SlotStride = sizeof(IPC_DEVICE_COUNTERS);
+	Region->CounterCount = DSHM_IPC_COUNTERS_COUNT;
+	Region->TimestampFrequency = TimestampFrequency;
+
+	DSHM_IPC_WRITE_BARRIER();
+	DSHM_IPC_STORE32(&Region->Magic, DSHM_IPC_COUNTERS_MAGIC);
+}
+
+//
+// Driver only, starts over with all counters at zero for the device that
+// just claimed the slot. Also used on counters that don't live in the
+// region (IPC disabled).
+//
+FORCEINLINE VOID DSHM_IPC_COUNTERS_CLAIM(
+	_Inout_ PIPC_DEVICE_COUNTERS Counters,
+	_In_ ULONG SlotIndex
+)
+{
+	const ULONG generation = DSHM_IPC_LOAD32(&Counters->Generation) | 1;
+
+	DSHM_IPC_STORE32(&Counters->Generation, generation);
+	DSHM_IPC_WRITE_BARRIER();
+
+	RtlZeroMemory(
+		(PUCHAR)Counters + FIELD_OFFSET(IPC_DEVICE_COUNTERS, InputReports),
+		sizeof(IPC_DEVICE_COUNTERS) - FIELD_OFFSET(IPC_DEVICE_COUNTERS, InputReports)
+	);
+	DSHM_IPC_STORE32(&Counters->SlotIndex, SlotIndex);
+
+	DSHM_IPC_STORE32(&Counters->Generation, generation + 1);
+}
+
+//
+// Driver only, marks the slot unoccupied, the counters stay for a last sample
+//
+FORCEINLINE VOID DSHM_IPC_COUNTERS_RELEASE(
+	_Inout_ PIPC_DEVICE_COUNTERS Counters
+)
+{
+	DSHM_IPC_STORE32(&Counters->SlotIndex, 0);
+}
+
+#define DSHM_IPC_COUNTER_ADD(_counter_, _value_)	DSHM_IPC_ADD64_RELAXED((_counter_), (_value_))
+#define DSHM_IPC_COUNTER_INCREMENT(_counter_)		DSHM_IPC_ADD64_RELAXED((_counter_), 1)
+
+//
+// Copies the counters of a device. Counters this revision knows but the
+// driver doesn't maintain read as zero. Fails if the region isn't there,
+// the slot never got claimed or kept getting reclaimed while copying.
+// Follows the layout the header describes, so newer drivers work as well.
+//
+FORCEINLINE BOOLEAN DSHM_IPC_COUNTERS_SAMPLE(
+	_In_ const IPC_COUNTERS_REGION_HEADER* Region,
+	_In_ ULONG SlotIndex,
+	_Out_ PIPC_DEVICE_COUNTERS Sample
+)
+{
+	RtlZeroMemory(Sample, sizeof(IPC_DEVICE_COUNTERS));
+
+	if (DSHM_IPC_LOAD32(&Region->Magic) != DSHM_IPC_COUNTERS_MAGIC || SlotIndex == 0 || SlotIndex > Region->SlotCount)
+	{
+		return FALSE;
+	}
+
+	DSHM_IPC_READ_BARRIER();
+
+	const IPC_DEVICE_COUNTERS* counters = (const IPC_DEVICE_COUNTERS*)((const UCHAR*)Region + Region->SlotsOffset
+		+ (SIZE_T)Region->SlotStride * (SlotIndex - 1));
+	const ULONG count = (Region->CounterCount < DSHM_IPC_COUNTERS_COUNT) ? Region->CounterCount : DSHM_IPC_COUNTERS_COUNT;
+	volatile LONGLONG* source = (volatile LONGLONG*)&counters->InputReports;
+	PLONGLONG target = (PLONGLONG)&Sample->InputReports;
+
+	for (ULONG attempt = 0; attempt < DSHM_IPC_COUNTERS_READ_ATTEMPTS; attempt++)
+	{
+		const ULONG generation = DSHM_IPC_LOAD32(&counters->Generation);
+
+		DSHM_IPC_READ_BARRIER();
+
+		if (generation == 0)
+		{
+			return FALSE;
+		}
+
+		if (generation & 1)
+		{
+			continue;
+		}
+
+		Sample->SlotIndex = (LONG)DSHM_IPC_LOAD32(&counters->SlotIndex);
+
+		for (ULONG index = 0; index < count; index++)
+		{
+			target[index] = (LONGLONG)DSHM_IPC_LOAD64(&source[index]);
+		}
+
+		DSHM_IPC_READ_BARRIER();
+
+		if (DSHM_IPC_LOAD32(&counters->Generation) == generation)
+		{
+			Sample->Generation = (LONG)generation;
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
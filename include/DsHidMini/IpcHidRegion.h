@@ -0,0 +1,637 @@
+#pragma once
+
+#include "Ds3Types.h"
+#include "IpcAtomics.h"
+
+//
+// Layout of the HID region of the driver IPC file mapping, shared by the
+// driver and native readers. It starts one allocation granularity (64 KiB)
+// into "Global\DsHidMiniSharedMemory", right after the command region.
+//
+
+//
+// Number of device slots, one-based slot indexes map to entries 0 to 254
+//
+#define DSHM_IPC_HID_SLOT_COUNT			255
+
+//
+// Distance between two slots. Drivers without a region header pack slots
+// back to back, so neighbouring devices share cache lines and every update
+// of one device invalidates the line another device's reader is polling.
+//
+#define DSHM_IPC_HID_SLOT_STRIDE		64
+
+//
+// Region header location, past the slot array (255 * 64 bytes)
+//
+#define DSHM_IPC_HID_HEADER_OFFSET		0x4000
+
+//
+// "DHID", set once the driver has initialized the header
+//
+#define DSHM_IPC_HID_MAGIC				0x44494844
+
+//
+// Layout revision, newer revisions only ever append to the header
+//
+#define DSHM_IPC_HID_VERSION			1
+
+//
+// Per slot state section location, past the header,
+// one cache line per slot
+//
+#define DSHM_IPC_HID_STATE_OFFSET		0x8000
+#define DSHM_IPC_HID_STATE_STRIDE		64
+
+//
+// Consecutive torn reads before a reader gives up (the writer died mid-update)
+//
+#define DSHM_IPC_HID_READ_ATTEMPTS		1000
+
+//
+// Attempts the driver makes to claim a slot before it skips the update. The
+// mapping is writable by clients, so a sequence left odd must not stall it.
+//
+#define DSHM_IPC_HID_WRITE_ATTEMPTS		64
+
+//
+// Input history entries per slot unless configured otherwise, and the limits
+//
+#define DSHM_IPC_HID_HISTORY_DEFAULT_DEPTH	64
+#define DSHM_IPC_HID_HISTORY_MAX_DEPTH		4096
+
+//
+// Auto-reset event the driver signals when a slot gets marked in
+// ChangedSlots. Meant for a single reader, which takes
+// the mask with DSHM_IPC_HID_TAKE_CHANGED; readers that can't agree on one
+// taker keep using the per device events.
+//
+#define DSHM_IPC_HID_CHANGED_EVENT_NAME		"Global\\DsHidMiniInputChangedEvent"
+
+//
+// 64 bit words of ChangedSlots, one bit per slot
+//
+#define DSHM_IPC_HID_CHANGED_WORDS			((DSHM_IPC_HID_SLOT_COUNT + 63) / 64)
+
+#include <pshpack1.h>
+//
+// Describes a raw input report packet shared via IPC
+//
+typedef struct _IPC_HID_INPUT_REPORT_MESSAGE
+{
+	//
+	// One-based device index
+	//
+	UINT32 SlotIndex;
+
+	//
+	// Input report copy
+	//
+	DS3_RAW_INPUT_REPORT InputReport;
+} IPC_HID_INPUT_REPORT_MESSAGE, *PIPC_HID_INPUT_REPORT_MESSAGE;
+#include <poppack.h>
+
+//
+// A slot owns a cache line, the message comes first so readers that only
+// know IPC_HID_INPUT_REPORT_MESSAGE keep working given the stride
+//
+typedef struct _IPC_HID_SLOT
+{
+	IPC_HID_INPUT_REPORT_MESSAGE Message;
+
+	UCHAR Reserved[7];
+
+	//
+	// Odd while the driver updates the slot, even once stable. Advances by
+	// two with every update, including removal.
+	//
+	volatile LONG Sequence;
+
+} IPC_HID_SLOT, *PIPC_HID_SLOT;
+
+//
+// Describes the HID region, located at DSHM_IPC_HID_HEADER_OFFSET
+//
+typedef struct _IPC_HID_REGION_HEADER
+{
+	//
+	// DSHM_IPC_HID_MAGIC, anything else means no header (older driver)
+	//
+	UINT32 Magic;
+
+	//
+	// DSHM_IPC_HID_VERSION the driver implements
+	//
+	UINT32 Version;
+
+	//
+	// Size of this header in bytes
+	//
+	UINT32 Size;
+
+	//
+	// Number of slots
+	//
+	UINT32 SlotCount;
+
+	//
+	// Offset of the first slot from the start of the region
+	//
+	UINT32 SlotsOffset;
+
+	//
+	// Distance between two slots in bytes
+	//
+	UINT32 SlotStride;
+
+	//
+	// Offset of the sequence counter within a slot
+	//
+	UINT32 SequenceOffset;
+
+	UINT32 Reserved;
+
+	//
+	// Input history entries per slot, a power of two, 0 if there's no history
+	//
+	UINT32 HistoryDepth;
+
+	//
+	// Distance between two history rings in bytes
+	//
+	UINT32 HistoryStride;
+
+	//
+	// Offset of the first history ring from the start of the file mapping
+	//
+	UINT32 HistoryOffset;
+
+	UINT32 Reserved2;
+
+	//
+	// History timestamp ticks per second (QueryPerformanceFrequency)
+	//
+	LONGLONG TimestampFrequency;
+
+	//
+	// Offset of the output region (IPC_OUTPUT_REGION_HEADER) from the start
+	// of the file mapping, 0 if there's none
+	//
+	UINT32 OutputOffset;
+
+	//
+	// Size of the output region in bytes
+	//
+	UINT32 OutputSize;
+
+	//
+	// Bit (N - 1) % 64 of word (N - 1) / 64 gets set after slot N changed,
+	// cleared by the reader. Starts a cache line so the driver setting bits
+	// doesn't invalidate the header fields readers look at on every call.
+	//
+	volatile LONGLONG ChangedSlots[DSHM_IPC_HID_CHANGED_WORDS];
+
+	UCHAR Reserved3[32];
+
+	//
+	// Offset of the first IPC_HID_STATE from the start of the region, 0 if
+	// there are none
+	//
+	UINT32 StateOffset;
+
+	//
+	// Distance between two states in bytes
+	//
+	UINT32 StateStride;
+
+	//
+	// Offset of the counters region (IPC_COUNTERS_REGION_HEADER) from the
+	// start of the file mapping, 0 if there's none
+	//
+	UINT32 CountersOffset;
+
+	//
+	// Size of the counters region in bytes
+	//
+	UINT32 CountersSize;
+
+} IPC_HID_REGION_HEADER, *PIPC_HID_REGION_HEADER;
+
+//
+// Controller state of a slot as the HID device reports it, thumb axes flipped
+// and with the dead zone applied as configured. Written together with the slot
+// and guarded by its sequence counter.
+//
+typedef struct _IPC_HID_STATE
+{
+	//
+	// QueryPerformanceCounter value the report got processed at, same as in
+	// the history entry of the report
+	//
+	LONGLONG Timestamp;
+
+	//
+	// Button bits as in DS3_RAW_INPUT_REPORT
+	//
+	ULONG Buttons;
+
+	//
+	// Thumb axes (0x00 = left/bottom, 0x80 = centered, 0xFF = right/top)
+	//
+	UCHAR LeftThumbX;
+	UCHAR LeftThumbY;
+	UCHAR RightThumbX;
+	UCHAR RightThumbY;
+
+	//
+	// Pressure values in DS3_RAW_INPUT_REPORT order
+	//
+	UCHAR Pressure[12];
+
+	UCHAR Reserved[36];
+
+} IPC_HID_STATE, *PIPC_HID_STATE;
+
+//
+// Timestamped input report in the history of a slot
+//
+typedef struct _IPC_HID_HISTORY_ENTRY
+{
+	//
+	// QueryPerformanceCounter value the report got processed at
+	//
+	LONGLONG Timestamp;
+
+	DS3_RAW_INPUT_REPORT InputReport;
+
+	UCHAR Reserved[7];
+
+} IPC_HID_HISTORY_ENTRY, *PIPC_HID_HISTORY_ENTRY;
+
+//
+// Per slot ring of the most recent input reports, written by the driver only.
+// The cursor has a cache line of its own, HistoryDepth entries follow.
+//
+typedef struct _IPC_HID_HISTORY
+{
+	//
+	// Number of entries ever written, entry N lives at index N % HistoryDepth
+	//
+	volatile LONGLONG WriteCursor;
+
+	UCHAR Reserved[56];
+
+	IPC_HID_HISTORY_ENTRY Entries[1];
+
+} IPC_HID_HISTORY, *PIPC_HID_HISTORY;
+
+#define DSHM_IPC_HID_HISTORY_SIZE(_depth_)	\
+	(FIELD_OFFSET(IPC_HID_HISTORY, Entries) + sizeof(IPC_HID_HISTORY_ENTRY) * (SIZE_T)(_depth_))
+
+//
+// Gets a slot by one-based index, as laid out by this revision
+//
+FORCEINLINE PIPC_HID_SLOT DSHM_IPC_HID_SLOT(
+	_In_ PUCHAR Region,
+	_In_ ULONG SlotIndex
+)
+{
+	return (PIPC_HID_SLOT)(Region + DSHM_IPC_HID_SLOT_STRIDE * (SIZE_T)(SlotIndex - 1));
+}
+
+FORCEINLINE PIPC_HID_REGION_HEADER DSHM_IPC_HID_HEADER(
+	_In_ PUCHAR Region
+)
+{
+	return (PIPC_HID_REGION_HEADER)(Region + DSHM_IPC_HID_HEADER_OFFSET);
+}
+
+//
+// Gets the state of a slot by one-based index, as laid out by this revision
+//
+FORCEINLINE PIPC_HID_STATE DSHM_IPC_HID_STATE(
+	_In_ PUCHAR Region,
+	_In_ ULONG SlotIndex
+)
+{
+	return (PIPC_HID_STATE)(Region + DSHM_IPC_HID_STATE_OFFSET + DSHM_IPC_HID_STATE_STRIDE * (SIZE_T)(SlotIndex - 1));
+}
+
+//
+// Starts updating a slot. Fails if another writer is updating it right now,
+// the caller must then leave the slot alone. Only the driver writes.
+//
+FORCEINLINE BOOLEAN DSHM_IPC_HID_WRITE_BEGIN(
+	_In_ PUCHAR Region,
+	_In_ ULONG SlotIndex,
+	_Out_ PULONG Sequence
+)
+{
+	volatile LONG* sequence = &DSHM_IPC_HID_SLOT(Region, SlotIndex)->Sequence;
+	const ULONG current = DSHM_IPC_LOAD32(sequence);
+
+	if ((current & 1) || !DSHM_IPC_CAS32(sequence, current, current + 1))
+	{
+		return FALSE;
+	}
+
+	DSHM_IPC_WRITE_BARRIER();
+
+	*Sequence = current + 1;
+
+	return TRUE;
+}
+
+//
+// Claims a slot no matter its current sequence, for updates that must not
+// be skipped. Moves the sequence to an odd value it never had before, so
+// readers that copied the slot in the meantime retry. Only the driver writes.
+//
+FORCEINLINE VOID DSHM_IPC_HID_WRITE_FORCE(
+	_In_ PUCHAR Region,
+	_In_ ULONG SlotIndex,
+	_Out_ PULONG Sequence
+)
+{
+	volatile LONG* sequence = &DSHM_IPC_HID_SLOT(Region, SlotIndex)->Sequence;
+	const ULONG next = (DSHM_IPC_LOAD32(sequence) | 1) + 2;
+
+	DSHM_IPC_STORE32(sequence, next);
+
+	DSHM_IPC_WRITE_BARRIER();
+
+	*Sequence = next;
+}
+
+//
+// Publishes a slot update begun with DSHM_IPC_HID_WRITE_BEGIN or
+// DSHM_IPC_HID_WRITE_FORCE
+//
+FORCEINLINE VOID DSHM_IPC_HID_WRITE_END(
+	_In_ PUCHAR Region,
+	_In_ ULONG SlotIndex,
+	_In_ ULONG Sequence
+)
+{
+	DSHM_IPC_STORE32(&DSHM_IPC_HID_SLOT(Region, SlotIndex)->Sequence, Sequence + 1);
+}
+
+//
+// Marks a slot changed after DSHM_IPC_HID_WRITE_END. Returns TRUE if it
+// wasn't marked yet, the driver then signals DSHM_IPC_HID_CHANGED_EVENT_NAME.
+// Otherwise the reader has yet to take the mask and got signaled already.
+//
+FORCEINLINE BOOLEAN DSHM_IPC_HID_MARK_CHANGED(
+	_In_ PUCHAR Region,
+	_In_ ULONG SlotIndex
+)
+{
+	const ULONGLONG bit = 1ULL << ((SlotIndex - 1) % 64);
+
+	return (DSHM_IPC_OR64(&DSHM_IPC_HID_HEADER(Region)->ChangedSlots[(SlotIndex - 1) / 64], bit) & bit) == 0;
+}
+
+//
+// Takes and clears the changed slots, Changed receives one bit per slot as
+// laid out in ChangedSlots. Returns FALSE if no slot changed or the region
+// has no header. Reads slots after the take see their updates.
+//
+FORCEINLINE BOOLEAN DSHM_IPC_HID_TAKE_CHANGED(
+	_In_ PUCHAR Region,
+	_Out_writes_(DSHM_IPC_HID_CHANGED_WORDS) PULONGLONG Changed
+)
+{
+	const PIPC_HID_REGION_HEADER header = DSHM_IPC_HID_HEADER(Region);
+	ULONGLONG any = 0;
+
+	if (DSHM_IPC_LOAD32(&header->Magic) != DSHM_IPC_HID_MAGIC)
+	{
+		RtlZeroMemory(Changed, sizeof(ULONGLONG) * DSHM_IPC_HID_CHANGED_WORDS);
+		return FALSE;
+	}
+
+	for (ULONG word = 0; word < DSHM_IPC_HID_CHANGED_WORDS; word++)
+	{
+		// only words with bits set get written, the others stay shared
+		Changed[word] = DSHM_IPC_LOAD64(&header->ChangedSlots[word])
+			? DSHM_IPC_EXCHANGE64(&header->ChangedSlots[word], 0)
+			: 0;
+
+		any |= Changed[word];
+	}
+
+	return any != 0;
+}
+
+//
+// Takes a consistent copy of a slot and returns its sequence number, which
+// tells whether anything changed since a previous read. Fails if the region
+// has no header or the slot stayed locked for DSHM_IPC_HID_READ_ATTEMPTS.
+// Follows the slot layout the header describes.
+//
+FORCEINLINE BOOLEAN DSHM_IPC_HID_READ(
+	_In_ PUCHAR Region,
+	_In_ ULONG SlotIndex,
+	_Out_ PIPC_HID_INPUT_REPORT_MESSAGE Message,
+	_Out_ PULONG Sequence
+)
+{
+	const PIPC_HID_REGION_HEADER header = DSHM_IPC_HID_HEADER(Region);
+
+	if (header->Magic != DSHM_IPC_HID_MAGIC || SlotIndex == 0 || SlotIndex > header->SlotCount)
+	{
+		return FALSE;
+	}
+
+	const PUCHAR slotBase = Region + header->SlotsOffset + (SIZE_T)header->SlotStride * (SlotIndex - 1);
+	const PIPC_HID_INPUT_REPORT_MESSAGE slot = (PIPC_HID_INPUT_REPORT_MESSAGE)slotBase;
+	volatile LONG* sequence = (volatile LONG*)(slotBase + header->SequenceOffset);
+
+	for (ULONG attempt = 0; attempt < DSHM_IPC_HID_READ_ATTEMPTS; attempt++)
+	{
+		const ULONG begin = DSHM_IPC_LOAD32(sequence);
+
+		DSHM_IPC_READ_BARRIER();
+
+		if (begin & 1)
+		{
+			continue;
+		}
+
+		*Message = *slot;
+
+		DSHM_IPC_READ_BARRIER();
+
+		if (DSHM_IPC_LOAD32(sequence) == begin)
+		{
+			*Sequence = begin;
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+//
+// Takes a consistent copy of the state of a slot, same as DSHM_IPC_HID_READ.
+// Fails if the driver publishes no states or the slot stayed locked.
+//
+FORCEINLINE BOOLEAN DSHM_IPC_HID_READ_STATE(
+	_In_ PUCHAR Region,
+	_In_ ULONG SlotIndex,
+	_Out_ PIPC_HID_STATE State,
+	_Out_ PULONG Sequence
+)
+{
+	const PIPC_HID_REGION_HEADER header = DSHM_IPC_HID_HEADER(Region);
+
+	if (header->Magic != DSHM_IPC_HID_MAGIC || header->StateOffset == 0
+		|| SlotIndex == 0 || SlotIndex > header->SlotCount)
+	{
+		return FALSE;
+	}
+
+	const PIPC_HID_STATE state = (PIPC_HID_STATE)(Region + header->StateOffset + (SIZE_T)header->StateStride * (SlotIndex - 1));
+	volatile LONG* sequence = (volatile LONG*)(Region + header->SlotsOffset
+		+ (SIZE_T)header->SlotStride * (SlotIndex - 1) + header->SequenceOffset);
+
+	for (ULONG attempt = 0; attempt < DSHM_IPC_HID_READ_ATTEMPTS; attempt++)
+	{
+		const ULONG begin = DSHM_IPC_LOAD32(sequence);
+
+		DSHM_IPC_READ_BARRIER();
+
+		if (begin & 1)
+		{
+			continue;
+		}
+
+		*State = *state;
+
+		DSHM_IPC_READ_BARRIER();
+
+		if (DSHM_IPC_LOAD32(sequence) == begin)
+		{
+			*Sequence = begin;
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+//
+// Gets the history ring of a slot by one-based index. History points to the
+// start of the file mapping plus HistoryOffset.
+//
+FORCEINLINE PIPC_HID_HISTORY DSHM_IPC_HID_HISTORY_RING(
+	_In_ PUCHAR History,
+	_In_ const IPC_HID_REGION_HEADER* Header,
+	_In_ ULONG SlotIndex
+)
+{
+	return (PIPC_HID_HISTORY)(History + (SIZE_T)Header->HistoryStride * (SlotIndex - 1));
+}
+
+//
+// Appends a report to the history of a slot. Single producer, the driver
+// calls this while holding the slot (DSHM_IPC_HID_WRITE_BEGIN).
+//
+FORCEINLINE VOID DSHM_IPC_HID_HISTORY_APPEND(
+	_Inout_ PIPC_HID_HISTORY Ring,
+	_In_ ULONG Depth,
+	_In_ const DS3_RAW_INPUT_REPORT* Report,
+	_In_ LONGLONG Timestamp
+)
+{
+	const ULONGLONG cursor = DSHM_IPC_LOAD64(&Ring->WriteCursor);
+	const PIPC_HID_HISTORY_ENTRY entry = &Ring->Entries[cursor & (Depth - 1)];
+
+	//
+	// Readers must not observe the overwrite before the cursor that announces it
+	//
+	DSHM_IPC_WRITE_BARRIER();
+
+	entry->Timestamp = Timestamp;
+	entry->InputReport = *Report;
+
+	DSHM_IPC_STORE64(&Ring->WriteCursor, cursor + 1);
+}
+
+//
+// Cursor to start draining from to receive only reports written from now on
+//
+FORCEINLINE ULONGLONG DSHM_IPC_HID_HISTORY_POSITION(
+	_In_ const IPC_HID_HISTORY* Ring
+)
+{
+	return DSHM_IPC_LOAD64(&Ring->WriteCursor);
+}
+
+//
+// Copies up to Capacity reports written since Cursor, oldest first, and
+// advances Cursor past them. Lost receives the number of reports that got
+// overwritten before they could be read. Returns the number of reports
+// copied. Never blocks and never calls into the system.
+//
+FORCEINLINE ULONG DSHM_IPC_HID_HISTORY_DRAIN(
+	_In_ const IPC_HID_HISTORY* Ring,
+	_In_ ULONG Depth,
+	_Inout_ PULONGLONG Cursor,
+	_Out_writes_(Capacity) PIPC_HID_HISTORY_ENTRY Entries,
+	_In_ ULONG Capacity,
+	_Out_ PULONGLONG Lost
+)
+{
+	const ULONGLONG written = DSHM_IPC_LOAD64(&Ring->WriteCursor);
+	ULONGLONG next = *Cursor;
+
+	DSHM_IPC_READ_BARRIER();
+
+	*Lost = 0;
+
+	//
+	// Cursor from before the driver host restarted, the ring started over
+	//
+	if (next > written)
+	{
+		next = 0;
+	}
+
+	if (written - next > Depth)
+	{
+		*Lost = written - next - Depth;
+		next = written - Depth;
+	}
+
+	const ULONG count = (written - next < Capacity) ? (ULONG)(written - next) : Capacity;
+
+	for (ULONG index = 0; index < count; index++)
+	{
+		Entries[index] = Ring->Entries[(next + index) & (Depth - 1)];
+	}
+
+	DSHM_IPC_READ_BARRIER();
+
+	//
+	// While copying, the writer may have started overwriting entries up to
+	// and including (cursor - depth), those copies can't be trusted
+	//
+	const ULONGLONG after = DSHM_IPC_LOAD64(&Ring->WriteCursor);
+	ULONG torn = 0;
+
+	if (after >= Depth && after - Depth >= next)
+	{
+		torn = (after - Depth - next + 1 < count) ? (ULONG)(after - Depth - next + 1) : count;
+
+		for (ULONG index = torn; index < count; index++)
+		{
+			Entries[index - torn] = Entries[index];
+		}
+	}
+
+	*Lost += torn;
+	*Cursor = next + count;
+
+	return count - torn;
+}
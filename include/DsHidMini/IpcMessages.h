@@ -0,0 +1,451 @@
+#pragma once
+
+//
+// Command messages exchanged with the driver through the command region of
+// "Global\DsHidMiniSharedMemory", shared by the driver and native clients.
+// Messages go into a command ring slot (see IpcCommandRing.h) or, with older
+// drivers, the start of the command region; the reply replaces the request.
+//
+
+#define DSHM_IPC_FILE_MAP_NAME		"Global\\DsHidMiniSharedMemory"
+#define DSHM_IPC_MUTEX_NAME			"Global\\DsHidMiniCommandMutex"
+#define DSHM_IPC_READ_EVENT_NAME	"Global\\DsHidMiniReadEvent"
+#define DSHM_IPC_WRITE_EVENT_NAME	"Global\\DsHidMiniWriteEvent"
+
+
+//
+// Describes the type of IPC message response behavior
+//
+typedef enum
+{
+	//
+	// Invalid/reserved, do not use
+	//
+	DSHM_IPC_MSG_TYPE_INVALID = 0,
+	//
+	// Client-to-driver data incoming, no acknowledgment/reply requested
+	//
+	DSHM_IPC_MSG_TYPE_REQUEST_ONLY,
+	//
+	// Client-to-driver data incoming, must be acknowledged by reply
+	//
+	DSHM_IPC_MSG_TYPE_REQUEST_RESPONSE,
+	//
+	// Client requested data, there is nothing to read for the driver
+	//
+	DSHM_IPC_MSG_TYPE_RESPONSE_ONLY,
+	//
+	// Driver-to-client response to a previous DSHM_IPC_MSG_TYPE_REQUEST_RESPONSE
+	//
+	DSHM_IPC_MSG_TYPE_REQUEST_REPLY
+} DSHM_IPC_MSG_TYPE;
+
+//
+// Describes the message receiver
+//
+typedef enum
+{
+	//
+	// Invalid/reserved, do not use
+	//
+	DSHM_IPC_MSG_TARGET_INVALID = 0,
+	//
+	// The message is targeted at the driver
+	//
+	DSHM_IPC_MSG_TARGET_DRIVER,
+	//
+	// The message is targeted at a device
+	//
+	DSHM_IPC_MSG_TARGET_DEVICE,
+	//
+	// The message is targeted at the client/caller/app
+	//
+	DSHM_IPC_MSG_TARGET_CLIENT
+} DSHM_IPC_MSG_TARGET;
+
+//
+// Describes a per-driver command
+//
+typedef enum
+{
+	//
+	// Invalid/reserved, do not use
+	//
+	DSHM_IPC_MSG_CMD_DRIVER_INVALID = 0,
+	//
+	// Message without payload, useful to check for functionality
+	//
+	DSHM_IPC_MSG_CMD_DRIVER_PING,
+	//
+	// Carries several commands handled in one go, see
+	// DSHM_IPC_MSG_BATCH_REQUEST
+	//
+	DSHM_IPC_MSG_CMD_DRIVER_BATCH
+} DSHM_IPC_MSG_CMD_DRIVER;
+
+//
+// Describes a per-device command
+//
+typedef enum
+{
+	//
+	// Invalid/reserved, do not use
+	//
+	DSHM_IPC_MSG_CMD_DEVICE_INVALID = 0,
+	//
+	// Pair a given device to a new host
+	//
+	DSHM_IPC_MSG_CMD_DEVICE_PAIR_TO,
+	//
+	// Requests a player index update (switch player LED etc.)
+	//
+	DSHM_IPC_MSG_CMD_DEVICE_SET_PLAYER_INDEX,
+	//
+	// Requests a wait handle for input report state changes
+	//
+	DSHM_IPC_MSG_CMD_DEVICE_GET_HID_WAIT_HANDLE,
+} DSHM_IPC_MSG_CMD_DEVICE;
+
+//
+// Prefix of every packet describing the message
+//
+typedef struct _DSHM_IPC_MSG_HEADER
+{
+	//
+	// What request-behavior is expected (request, request-reply, ...)
+	//
+	DSHM_IPC_MSG_TYPE Type;
+
+	//
+	// What component is this message targeting (driver, device, ...)
+	//
+	DSHM_IPC_MSG_TARGET Target;
+
+	//
+	// What command is this message carrying
+	//
+	union
+	{
+		DSHM_IPC_MSG_CMD_DRIVER Driver;
+
+		DSHM_IPC_MSG_CMD_DEVICE Device;
+	} Command;
+
+	//
+	// One-based index of which device is this message for
+	//   Set to 0 if driver is targeted
+	//
+	UINT32 TargetIndex;
+
+	//
+	// The size of the entire message (header + payload) in bytes
+	//   A size of 0 is invalid
+	//
+	UINT32 Size;
+} DSHM_IPC_MSG_HEADER, * PDSHM_IPC_MSG_HEADER;
+
+//
+// Bluetooth host address, same layout as the driver's BD_ADDR
+//
+typedef struct _DSHM_IPC_BD_ADDR
+{
+	UCHAR Address[6];
+} DSHM_IPC_BD_ADDR, * PDSHM_IPC_BD_ADDR;
+
+//
+// Updates a specified devices' host address
+//
+typedef struct _DSHM_IPC_MSG_PAIR_TO_REQUEST
+{
+	DSHM_IPC_MSG_HEADER Header;
+
+	DSHM_IPC_BD_ADDR Address;
+
+} DSHM_IPC_MSG_PAIR_TO_REQUEST, *PDSHM_IPC_MSG_PAIR_TO_REQUEST;
+
+//
+// Reply to struct _DSHM_IPC_MSG_PAIR_TO_REQUEST
+//
+typedef struct _DSHM_IPC_MSG_PAIR_TO_REPLY
+{
+	DSHM_IPC_MSG_HEADER Header;
+
+	//
+	// NTSTATUS of the set address action
+	//
+	NTSTATUS WriteStatus;
+
+	//
+	// NTSTATUS of the get address action
+	//
+	NTSTATUS ReadStatus;
+
+} DSHM_IPC_MSG_PAIR_TO_REPLY, *PDSHM_IPC_MSG_PAIR_TO_REPLY;
+
+//
+// Updates the player index of a given device
+//
+typedef struct _DSHM_IPC_MSG_SET_PLAYER_INDEX_REQUEST
+{
+	DSHM_IPC_MSG_HEADER Header;
+
+	//
+	// The new player index to set
+	//   Valid values are 1 to 7
+	//
+	BYTE PlayerIndex;
+
+} DSHM_IPC_MSG_SET_PLAYER_INDEX_REQUEST, *PDSHM_IPC_MSG_SET_PLAYER_INDEX_REQUEST;
+
+//
+// Reply to struct _DSHM_IPC_MSG_SET_PLAYER_INDEX_REQUEST
+//
+typedef struct _DSHM_IPC_MSG_SET_PLAYER_INDEX_REPLY
+{
+	DSHM_IPC_MSG_HEADER Header;
+
+	NTSTATUS NtStatus;
+
+} DSHM_IPC_MSG_SET_PLAYER_INDEX_REPLY, *PDSHM_IPC_MSG_SET_PLAYER_INDEX_REPLY;
+
+//
+// Requests the driver host process PID and a wait handle for new input reports
+//
+typedef struct _DSHM_IPC_MSG_GET_HID_WAIT_HANDLE_RESPONSE
+{
+	DSHM_IPC_MSG_HEADER Header;
+
+	//
+	// The driver hosting process PID
+	//
+	DWORD ProcessId;
+
+	//
+	// A handle to an auto-reset event
+	//
+	HANDLE WaitHandle;
+
+} DSHM_IPC_MSG_GET_HID_WAIT_HANDLE_RESPONSE, *PDSHM_IPC_MSG_GET_HID_WAIT_HANDLE_RESPONSE;
+
+//
+// Most commands a single batch may carry
+//
+#define DSHM_IPC_MSG_BATCH_MAX_COUNT		64
+
+//
+// Message bytes every batch entry has room for at the least, enough for the
+// largest reply
+//
+#define DSHM_IPC_MSG_BATCH_MESSAGE_MIN		32
+
+//
+// Runs several commands in a single round trip. Count entries follow back to
+// back, each holding a complete command message the way it would be sent on
+// its own; the reply replaces the command within its entry. The framing of
+// all entries gets checked before any command runs, a batch that's off is
+// ignored as a whole. Batches don't nest.
+//
+typedef struct _DSHM_IPC_MSG_BATCH_REQUEST
+{
+	DSHM_IPC_MSG_HEADER Header;
+
+	//
+	// Number of entries following, 1 to DSHM_IPC_MSG_BATCH_MAX_COUNT
+	//
+	UINT32 Count;
+
+} DSHM_IPC_MSG_BATCH_REQUEST, *PDSHM_IPC_MSG_BATCH_REQUEST;
+
+//
+// Prefix of a batch entry, the command message follows
+//
+typedef struct _DSHM_IPC_MSG_BATCH_ENTRY
+{
+	//
+	// Size of the entry including this prefix in bytes, a multiple of 8 with
+	// room for at least DSHM_IPC_MSG_BATCH_MESSAGE_MIN message bytes
+	//
+	UINT32 Size;
+
+	//
+	// Set by the driver, NTSTATUS of dispatching the command; the outcome of
+	// the action itself is part of the reply as usual
+	//
+	NTSTATUS Status;
+
+} DSHM_IPC_MSG_BATCH_ENTRY, *PDSHM_IPC_MSG_BATCH_ENTRY;
+
+#define DSHM_IPC_MSG_BATCH_ENTRY_SIZE_MIN	(sizeof(DSHM_IPC_MSG_BATCH_ENTRY) + DSHM_IPC_MSG_BATCH_MESSAGE_MIN)
+
+#define DSHM_IPC_MSG_EXPECTS_REPLY(_msg_) \
+	((_msg_)->Type == DSHM_IPC_MSG_TYPE_REQUEST_RESPONSE \
+		|| (_msg_)->Type == DSHM_IPC_MSG_TYPE_RESPONSE_ONLY)
+
+#define DSHM_IPC_MSG_IS_PING(_msg_) \
+	((_msg_)->Type == DSHM_IPC_MSG_TYPE_REQUEST_RESPONSE \
+	&& (_msg_)->Target == DSHM_IPC_MSG_TARGET_DRIVER \
+	&& (_msg_)->Command.Driver == DSHM_IPC_MSG_CMD_DRIVER_PING \
+	&& (_msg_)->TargetIndex == 0 \
+	&& (_msg_)->Size == sizeof(DSHM_IPC_MSG_HEADER))
+
+#define DSHM_IPC_MSG_IS_BATCH(_msg_) \
+	((_msg_)->Type == DSHM_IPC_MSG_TYPE_REQUEST_RESPONSE \
+	&& (_msg_)->Target == DSHM_IPC_MSG_TARGET_DRIVER \
+	&& (_msg_)->Command.Driver == DSHM_IPC_MSG_CMD_DRIVER_BATCH \
+	&& (_msg_)->TargetIndex == 0)
+
+FORCEINLINE PDSHM_IPC_MSG_HEADER DSHM_IPC_MSG_BATCH_ENTRY_MESSAGE(
+	_In_ PDSHM_IPC_MSG_BATCH_ENTRY Entry
+)
+{
+	return (PDSHM_IPC_MSG_HEADER)(Entry + 1);
+}
+
+//
+// Checks the framing of a batch of Size bytes and records where its entries
+// start, Offsets[Count] being the end of the last one. Counts and sizes get
+// read exactly once, so the client can't change the framing after the
+// check; use the recorded offsets rather than the entries' Size fields.
+//
+FORCEINLINE BOOLEAN DSHM_IPC_MSG_BATCH_PARSE(
+	_In_ const DSHM_IPC_MSG_BATCH_REQUEST* Batch,
+	_In_ UINT32 Size,
+	_Out_writes_(DSHM_IPC_MSG_BATCH_MAX_COUNT + 1) UINT32* Offsets,
+	_Out_ UINT32* Count
+)
+{
+	*Count = 0;
+
+	if (Size < sizeof(DSHM_IPC_MSG_BATCH_REQUEST))
+	{
+		return FALSE;
+	}
+
+	const UINT32 count = *(volatile const UINT32*)&Batch->Count;
+	UINT32 offset = sizeof(DSHM_IPC_MSG_BATCH_REQUEST);
+
+	if (count == 0 || count > DSHM_IPC_MSG_BATCH_MAX_COUNT)
+	{
+		return FALSE;
+	}
+
+	for (UINT32 index = 0; index < count; index++)
+	{
+		if (Size - offset < DSHM_IPC_MSG_BATCH_ENTRY_SIZE_MIN)
+		{
+			return FALSE;
+		}
+
+		const UINT32 entrySize = *(volatile const UINT32*)((const UCHAR*)Batch + offset);
+
+		if (entrySize % 8 != 0 || entrySize < DSHM_IPC_MSG_BATCH_ENTRY_SIZE_MIN || entrySize > Size - offset)
+		{
+			return FALSE;
+		}
+
+		Offsets[index] = offset;
+		offset += entrySize;
+	}
+
+	//
+	// No stray bytes past the last entry
+	//
+	if (offset != Size)
+	{
+		return FALSE;
+	}
+
+	Offsets[count] = offset;
+	*Count = count;
+
+	return TRUE;
+}
+
+FORCEINLINE VOID DSHM_IPC_MSG_PING_RESPONSE_INIT(
+	_Inout_ PDSHM_IPC_MSG_HEADER Message
+)
+{
+	RtlZeroMemory(Message, sizeof(DSHM_IPC_MSG_HEADER));
+
+	Message->Type = DSHM_IPC_MSG_TYPE_REQUEST_REPLY;
+	Message->Target = DSHM_IPC_MSG_TARGET_CLIENT;
+	Message->Command.Driver = DSHM_IPC_MSG_CMD_DRIVER_PING;
+	Message->TargetIndex = 0;
+	Message->Size = sizeof(DSHM_IPC_MSG_HEADER); // no payload
+}
+
+FORCEINLINE VOID DSHM_IPC_MSG_PAIR_TO_RESPONSE_INIT(
+	_Inout_ PDSHM_IPC_MSG_PAIR_TO_REPLY Message,
+	_In_ UINT32 DeviceIndex,
+	_In_ NTSTATUS WriteStatus,
+	_In_ NTSTATUS ReadStatus
+)
+{
+	const UINT32 size = sizeof(DSHM_IPC_MSG_PAIR_TO_REPLY);
+	RtlZeroMemory(Message, size);
+
+	Message->Header.Type = DSHM_IPC_MSG_TYPE_REQUEST_REPLY;
+	Message->Header.Target = DSHM_IPC_MSG_TARGET_CLIENT;
+	Message->Header.Command.Device = DSHM_IPC_MSG_CMD_DEVICE_PAIR_TO;
+	Message->Header.TargetIndex = DeviceIndex;
+	Message->Header.Size = size;
+
+	Message->WriteStatus = WriteStatus;
+	Message->ReadStatus = ReadStatus;
+}
+
+FORCEINLINE VOID DSHM_IPC_MSG_SET_PLAYER_INDEX_RESPONSE_INIT(
+	_Inout_ PDSHM_IPC_MSG_SET_PLAYER_INDEX_REPLY Message,
+	_In_ UINT32 DeviceIndex,
+	_In_ NTSTATUS Status
+)
+{
+	const UINT32 size = sizeof(DSHM_IPC_MSG_SET_PLAYER_INDEX_REPLY);
+	RtlZeroMemory(Message, size);
+
+	Message->Header.Type = DSHM_IPC_MSG_TYPE_REQUEST_REPLY;
+	Message->Header.Target = DSHM_IPC_MSG_TARGET_CLIENT;
+	Message->Header.Command.Device = DSHM_IPC_MSG_CMD_DEVICE_SET_PLAYER_INDEX;
+	Message->Header.TargetIndex = DeviceIndex;
+	Message->Header.Size = size;
+
+	Message->NtStatus = Status;
+}
+
+FORCEINLINE VOID DSHM_IPC_MSG_GET_HID_WAIT_HANDLE_RESPONSE_INIT(
+	_Inout_ PDSHM_IPC_MSG_GET_HID_WAIT_HANDLE_RESPONSE Message,
+	_In_ UINT32 DeviceIndex,
+	_In_ DWORD ProcessId,
+	_In_opt_ HANDLE WaitHandle
+)
+{
+	const UINT32 size = sizeof(DSHM_IPC_MSG_GET_HID_WAIT_HANDLE_RESPONSE);
+	RtlZeroMemory(Message, size);
+
+	Message->Header.Type = DSHM_IPC_MSG_TYPE_RESPONSE_ONLY;
+	Message->Header.Target = DSHM_IPC_MSG_TARGET_CLIENT;
+	Message->Header.Command.Device = DSHM_IPC_MSG_CMD_DEVICE_GET_HID_WAIT_HANDLE;
+	Message->Header.TargetIndex = DeviceIndex;
+	Message->Header.Size = size;
+
+	Message->ProcessId = ProcessId;
+	Message->WaitHandle = WaitHandle;
+}
+
+//
+// Turns a batch into its reply, the entries hold the replies already
+//
+FORCEINLINE VOID DSHM_IPC_MSG_BATCH_RESPONSE_INIT(
+	_Inout_ PDSHM_IPC_MSG_BATCH_REQUEST Message,
+	_In_ UINT32 Size,
+	_In_ UINT32 Count
+)
+{
+	Message->Header.Type = DSHM_IPC_MSG_TYPE_REQUEST_REPLY;
+	Message->Header.Target = DSHM_IPC_MSG_TARGET_CLIENT;
+	Message->Header.Command.Driver = DSHM_IPC_MSG_CMD_DRIVER_BATCH;
+	Message->Header.TargetIndex = 0;
+	Message->Header.Size = Size;
+
+	Message->Count = Count;
+}
@@ -0,0 +1,305 @@
+#pragma once
+
+#include "IpcAtomics.h"
+
+//
+// Output (rumble and LED) channel, shared by the driver and native clients.
+// One single-producer single-consumer ring per device slot; the location of
+// the region within "Global\DsHidMiniSharedMemory" is advertised by the HID
+// region header (OutputRingOffset).
+//
+// A client claims the ring of a device, appends requests describing the
+// desired output state and signals DSHM_IPC_OUTPUT_RING_EVENT_NAME. The
+// driver folds all pending requests into the device output state and sends
+// at most one output report, subject to the same deduplication and rate
+// control as reports coming in through the HID stack.
+//
+
+//
+// "DOUT", set once the driver has initialized the region
+//
+#define DSHM_IPC_OUTPUT_MAGIC				0x54554F44
+
+#define DSHM_IPC_OUTPUT_VERSION				1
+
+//
+// Rings, one-based slot indexes map to entries 0 to 254
+//
+#define DSHM_IPC_OUTPUT_RING_COUNT			255
+
+//
+// Requests per ring, a power of two
+//
+#define DSHM_IPC_OUTPUT_RING_DEPTH			16
+
+//
+// Rings follow the region header at this offset
+//
+#define DSHM_IPC_OUTPUT_RINGS_OFFSET		64
+
+//
+// Doorbell, auto-reset, signaled by clients after appending requests
+//
+#define DSHM_IPC_OUTPUT_RING_EVENT_NAME		"Global\\DsHidMiniOutputRingEvent"
+
+//
+// Fields of IPC_OUTPUT_REQUEST to apply
+//
+#define DSHM_IPC_OUTPUT_FIELD_LED_FLAGS				0x00000001
+#define DSHM_IPC_OUTPUT_FIELD_LED(_index_)			(0x00000002 << (_index_))
+#define DSHM_IPC_OUTPUT_FIELD_LEDS					0x0000001E
+#define DSHM_IPC_OUTPUT_FIELD_SMALL_MOTOR_DURATION	0x00000020
+#define DSHM_IPC_OUTPUT_FIELD_SMALL_MOTOR_STRENGTH	0x00000040
+#define DSHM_IPC_OUTPUT_FIELD_LARGE_MOTOR_DURATION	0x00000080
+#define DSHM_IPC_OUTPUT_FIELD_LARGE_MOTOR_STRENGTH	0x00000100
+#define DSHM_IPC_OUTPUT_FIELD_MOTORS				0x000001E0
+#define DSHM_IPC_OUTPUT_FIELD_ALL					0x000001FF
+
+//
+// Properties of a single Player LED
+//
+typedef struct _IPC_OUTPUT_LED
+{
+	USHORT BasePortionDuration;
+
+	UCHAR TotalDuration;
+
+	UCHAR OffPortionMultiplier;
+
+	UCHAR OnPortionMultiplier;
+
+	UCHAR Reserved;
+
+} IPC_OUTPUT_LED, *PIPC_OUTPUT_LED;
+
+//
+// Desired output state, only the fields flagged get applied
+//
+typedef struct _IPC_OUTPUT_REQUEST
+{
+	//
+	// DSHM_IPC_OUTPUT_FIELD_* bits
+	//
+	UINT32 Fields;
+
+	//
+	// Player LED enable bits
+	//
+	UCHAR LedFlags;
+
+	UCHAR SmallMotorDuration;
+
+	//
+	// Right (light) motor, on/off only
+	//
+	UCHAR SmallMotorStrength;
+
+	UCHAR LargeMotorDuration;
+
+	//
+	// Left (heavy) motor, subject to the rumble settings of the device
+	//
+	UCHAR LargeMotorStrength;
+
+	UCHAR Reserved[3];
+
+	//
+	// Index 0 is Player 1
+	//
+	IPC_OUTPUT_LED Leds[4];
+
+	UINT32 Reserved2;
+
+} IPC_OUTPUT_REQUEST, *PIPC_OUTPUT_REQUEST;
+
+//
+// Ring of a single device; the indexes have a cache line each since they
+// are written from different processes
+//
+typedef struct _IPC_OUTPUT_RING
+{
+	//
+	// Number of requests ever appended, only the owner writes it
+	//
+	volatile LONG Tail;
+
+	//
+	// Process ID of the producing client, 0 if unclaimed
+	//
+	volatile LONG OwnerProcessId;
+
+	UCHAR TailPadding[56];
+
+	//
+	// Number of requests ever consumed, only the driver writes it
+	//
+	volatile LONG Head;
+
+	UCHAR HeadPadding[60];
+
+	IPC_OUTPUT_REQUEST Requests[DSHM_IPC_OUTPUT_RING_DEPTH];
+
+} IPC_OUTPUT_RING, *PIPC_OUTPUT_RING;
+
+//
+// Describes the output region, rings follow at RingsOffset
+//
+typedef struct _IPC_OUTPUT_REGION_HEADER
+{
+	//
+	// DSHM_IPC_OUTPUT_MAGIC, anything else means no output channel
+	//
+	UINT32 Magic;
+
+	UINT32 Version;
+
+	//
+	// Size of this header in bytes
+	//
+	UINT32 Size;
+
+	UINT32 RingCount;
+
+	//
+	// Offset of the first ring from the start of this header
+	//
+	UINT32 RingsOffset;
+
+	//
+	// Distance between two rings in bytes
+	//
+	UINT32 RingStride;
+
+	//
+	// Requests per ring
+	//
+	UINT32 RingDepth;
+
+	//
+	// Size of IPC_OUTPUT_REQUEST
+	//
+	UINT32 RequestSize;
+
+	UINT32 Reserved[8];
+
+} IPC_OUTPUT_REGION_HEADER, *PIPC_OUTPUT_REGION_HEADER;
+
+#define DSHM_IPC_OUTPUT_REGION_SIZE	\
+	(DSHM_IPC_OUTPUT_RINGS_OFFSET + sizeof(IPC_OUTPUT_RING) * (SIZE_T)DSHM_IPC_OUTPUT_RING_COUNT)
+
+//
+// Gets a ring by one-based slot index
+//
+FORCEINLINE PIPC_OUTPUT_RING DSHM_IPC_OUTPUT_RING(
+	_In_ PIPC_OUTPUT_REGION_HEADER Region,
+	_In_ ULONG SlotIndex
+)
+{
+	return (PIPC_OUTPUT_RING)((PUCHAR)Region + Region->RingsOffset + (SIZE_T)Region->RingStride * (SlotIndex - 1));
+}
+
+//
+// Driver only, sets up empty, unclaimed rings and publishes the region
+//
+FORCEINLINE VOID DSHM_IPC_OUTPUT_REGION_INIT(
+	_Out_ PIPC_OUTPUT_REGION_HEADER Region
+)
+{
+	RtlZeroMemory(Region, DSHM_IPC_OUTPUT_REGION_SIZE);
+
+	Region->Version = DSHM_IPC_OUTPUT_VERSION;
+	Region->Size = sizeof(IPC_OUTPUT_REGION_HEADER);
+	Region->RingCount = DSHM_IPC_OUTPUT_RING_COUNT;
+	Region->RingsOffset = DSHM_IPC_OUTPUT_RINGS_OFFSET;
+	Region->RingStride = sizeof(IPC_OUTPUT_RING);
+	Region->RingDepth = DSHM_IPC_OUTPUT_RING_DEPTH;
+	Region->RequestSize = sizeof(IPC_OUTPUT_REQUEST);
+
+	DSHM_IPC_WRITE_BARRIER();
+	DSHM_IPC_STORE32(&Region->Magic, DSHM_IPC_OUTPUT_MAGIC);
+}
+
+//
+// Makes the calling process the producer of a ring. Fails if another
+// process holds it.
+//
+FORCEINLINE BOOLEAN DSHM_IPC_OUTPUT_RING_ACQUIRE(
+	_In_ PIPC_OUTPUT_RING Ring,
+	_In_ ULONG ProcessId
+)
+{
+	const ULONG owner = DSHM_IPC_LOAD32(&Ring->OwnerProcessId);
+
+	return owner == ProcessId || (owner == 0 && DSHM_IPC_CAS32(&Ring->OwnerProcessId, 0, ProcessId));
+}
+
+FORCEINLINE VOID DSHM_IPC_OUTPUT_RING_RELEASE(
+	_In_ PIPC_OUTPUT_RING Ring,
+	_In_ ULONG ProcessId
+)
+{
+	(void)DSHM_IPC_CAS32(&Ring->OwnerProcessId, ProcessId, 0);
+}
+
+//
+// Owner only, appends a request. Fails if the driver hasn't caught up with
+// DSHM_IPC_OUTPUT_RING_DEPTH earlier requests. The caller signals
+// DSHM_IPC_OUTPUT_RING_EVENT_NAME afterwards.
+//
+FORCEINLINE BOOLEAN DSHM_IPC_OUTPUT_RING_PUSH(
+	_In_ PIPC_OUTPUT_RING Ring,
+	_In_ const IPC_OUTPUT_REQUEST* Request
+)
+{
+	const ULONG tail = (ULONG)Ring->Tail;
+
+	if (tail - DSHM_IPC_LOAD32(&Ring->Head) >= DSHM_IPC_OUTPUT_RING_DEPTH)
+	{
+		return FALSE;
+	}
+
+	//
+	// The driver is done reading the entry once Head moved past it
+	//
+	DSHM_IPC_READ_BARRIER();
+
+	Ring->Requests[tail & (DSHM_IPC_OUTPUT_RING_DEPTH - 1)] = *Request;
+
+	DSHM_IPC_STORE32(&Ring->Tail, tail + 1);
+
+	return TRUE;
+}
+
+//
+// Driver only, number of requests waiting, 0 to DSHM_IPC_OUTPUT_RING_DEPTH.
+// A client scribbling over Tail makes the whole ring count as skipped.
+//
+FORCEINLINE ULONG DSHM_IPC_OUTPUT_RING_PENDING(
+	_In_ PIPC_OUTPUT_RING Ring,
+	_Out_ PULONG Tail
+)
+{
+	*Tail = DSHM_IPC_LOAD32(&Ring->Tail);
+
+	const ULONG pending = *Tail - (ULONG)Ring->Head;
+
+	if (pending > DSHM_IPC_OUTPUT_RING_DEPTH)
+	{
+		return 0;
+	}
+
+	DSHM_IPC_READ_BARRIER();
+
+	return pending;
+}
+
+//
+// Driver only, hands consumed (or skipped) entries back to the producer
+//
+FORCEINLINE VOID DSHM_IPC_OUTPUT_RING_CONSUME(
+	_In_ PIPC_OUTPUT_RING Ring,
+	_In_ ULONG Tail
+)
+{
+	DSHM_IPC_STORE32(&Ring->Head, Tail);
+}